@@ -238,13 +238,11 @@ LightResult DoLighting(float3 P, float3 N, float specularPower) {
 }
 #endif // ENABLE_LIGHTING
 
-float3 ExpandNormal(float3 n) {
-	return n * 2.0f - 1.0f;
-}
-
 float3 DoNormalMapping(float3x3 TBN, Texture2D tex, float2 uv) {
-	float3 N = tex.Sample(TextureSampler, uv).xyz;
-	N = ExpandNormal(N);
+    // Z is rebuilt from X and Y, cooked normal maps are two channel BC5 textures.
+	float3 N;
+	N.xy = tex.Sample(TextureSampler, uv).xy * 2.0f - 1.0f;
+	N.z = sqrt(saturate(1.0f - dot(N.xy, N.xy)));
 
     // Transform normal from tangent space to view space.
 	N = mul(N, TBN);
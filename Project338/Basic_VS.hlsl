@@ -1,12 +1,41 @@
+#ifndef COMPACT_VERTEX
+#define COMPACT_VERTEX 0
+#endif
+
+#ifndef QUANTIZED_POSITION
+#define QUANTIZED_POSITION 0
+#endif
+
 struct Matrices {
 	matrix ModelMatrix;
 	matrix ModelViewMatrix;
 	matrix InverseTransposeModelViewMatrix;
 	matrix ModelViewProjectionMatrix;
+	float4 PositionScale; // Dequantization of UNORM16 positions, identity for float positions.
+	float4 PositionOffset;
 };
 
 ConstantBuffer<Matrices> MatCB : register(b0);
 
+#if COMPACT_VERTEX
+struct VertexPositionPackedNormalTangentTexture {
+#if QUANTIZED_POSITION
+	float4 Position : POSITION;
+#else
+	float3 Position : POSITION;
+#endif
+	float2 Normal : NORMAL;
+	float2 Tangent : TANGENT; // Bitangent sign in the sign of x.
+	float2 TexCoord : TEXCOORD;
+};
+
+float3 DecodeOctahedral(float2 e) {
+	float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-v.z);
+	v.xy -= (step(0.0f, v.xy) * 2.0f - 1.0f) * t;
+	return normalize(v);
+}
+#else
 struct VertexPositionNormalTangentBitangentTexture {
 	float3 Position : POSITION;
 	float3 Normal : NORMAL;
@@ -14,6 +43,7 @@ struct VertexPositionNormalTangentBitangentTexture {
 	float3 Bitangent : BITANGENT;
 	float3 TexCoord : TEXCOORD;
 };
+#endif
 
 struct VertexShaderOutput {
 	float4 PositionVS : POSITION;
@@ -24,15 +54,31 @@ struct VertexShaderOutput {
 	float4 Position : SV_Position;
 };
 
+#if COMPACT_VERTEX
+VertexShaderOutput main(VertexPositionPackedNormalTangentTexture IN) {
+	float3 position = IN.Position.xyz * MatCB.PositionScale.xyz + MatCB.PositionOffset.xyz;
+
+	float handedness = IN.Tangent.x < 0.0f ? -1.0f : 1.0f;
+	float3 normal = DecodeOctahedral(IN.Normal);
+	float3 tangent = DecodeOctahedral(float2(abs(IN.Tangent.x) * 2.0f - 1.0f, IN.Tangent.y));
+	float3 bitangent = cross(normal, tangent) * handedness;
+	float2 tex_coord = IN.TexCoord;
+#else
 VertexShaderOutput main(VertexPositionNormalTangentBitangentTexture IN) {
+	float3 position = IN.Position;
+	float3 normal = IN.Normal;
+	float3 tangent = IN.Tangent;
+	float3 bitangent = IN.Bitangent;
+	float2 tex_coord = IN.TexCoord.xy;
+#endif
 	VertexShaderOutput OUT;
 
-	OUT.PositionVS = mul(MatCB.ModelViewMatrix, float4(IN.Position, 1.0f));
-	OUT.NormalVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, IN.Normal);
-	OUT.TangentVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, IN.Tangent);
-	OUT.BitangentVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, IN.Bitangent);
-	OUT.TexCoord = IN.TexCoord.xy;
-	OUT.Position = mul(MatCB.ModelViewProjectionMatrix, float4(IN.Position, 1.0f));
+	OUT.PositionVS = mul(MatCB.ModelViewMatrix, float4(position, 1.0f));
+	OUT.NormalVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, normal);
+	OUT.TangentVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, tangent);
+	OUT.BitangentVS = mul((float3x3) MatCB.InverseTransposeModelViewMatrix, bitangent);
+	OUT.TexCoord = tex_coord;
+	OUT.Position = mul(MatCB.ModelViewProjectionMatrix, float4(position, 1.0f));
 
 	return OUT;
 }
\ No newline at end of file
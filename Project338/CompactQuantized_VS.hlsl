@@ -0,0 +1,4 @@
+#define COMPACT_VERTEX     1
+#define QUANTIZED_POSITION 1
+
+#include "Basic_VS.hlsl"
\ No newline at end of file
@@ -0,0 +1,3 @@
+#define COMPACT_VERTEX 1
+
+#include "Basic_VS.hlsl"
\ No newline at end of file
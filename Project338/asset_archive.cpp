@@ -0,0 +1,471 @@
+#include "asset_archive.h"
+
+#include "derived_data_cache.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include <compressapi.h>
+
+namespace AssetArchive {
+	struct MountedArchive {
+		std::shared_ptr<Reader> pReader;
+		std::filesystem::path RootPath;
+	};
+
+	static std::mutex Mount_mutex;
+	static std::vector<MountedArchive> Mounted_archives;
+
+	// XPRESS decompresses at several GB/s, but an entry that barely shrinks is better mapped directly.
+	constexpr double Max_compressed_ratio = 0.9;
+
+	inline uint64_t AlignOffset(uint64_t offset, uint64_t alignment) {
+		return (offset + alignment - 1u) & ~(alignment - 1u);
+	}
+
+	inline bool IsRangeValid(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size) {
+		if (offset % alignof(uint64_t) != 0u || offset > file_size) {
+			return false;
+		}
+		return count <= (file_size - offset) / element_size;
+	}
+
+	inline uint64_t HashPath(const std::string& archive_path) {
+		return DerivedDataCache::HashBytes(archive_path.data(), archive_path.size());
+	}
+
+	inline bool IsArchiveValid(const uint8_t* data, uint64_t file_size) {
+		if (file_size < sizeof(Header)) {
+			return false;
+		}
+
+		const Header& header = *reinterpret_cast<const Header*>(data);
+		if (header.Magic != Magic || header.Version != Version || header.FileSize != file_size) {
+			return false;
+		}
+		if (header.SlotCount <= header.EntryCount || (header.SlotCount & (header.SlotCount - 1u)) != 0u) {
+			return false;
+		}
+		if (!IsRangeValid(header.EntriesOffset, header.EntryCount, sizeof(EntryRecord), file_size) ||
+			!IsRangeValid(header.SlotsOffset, header.SlotCount, sizeof(uint32_t), file_size) ||
+			!IsRangeValid(header.NamesOffset, header.NamesSize, 1u, file_size)) {
+			return false;
+		}
+
+		const char* names = reinterpret_cast<const char*>(data + header.NamesOffset);
+		if (header.NamesSize > 0u && names[header.NamesSize - 1u] != '\0') {
+			return false;
+		}
+
+		const EntryRecord* entries = reinterpret_cast<const EntryRecord*>(data + header.EntriesOffset);
+		for (uint32_t i = 0u; i < header.EntryCount; ++i) {
+			const EntryRecord& entry = entries[i];
+			if (entry.NameOffset >= header.NamesSize || entry.Compression > static_cast<uint32_t>(Compression::Xpress)) {
+				return false;
+			}
+			if (entry.DataOffset > file_size || entry.StoredSize > file_size - entry.DataOffset) {
+				return false;
+			}
+			if (entry.Compression == static_cast<uint32_t>(Compression::None) && (entry.StoredSize != entry.Size || entry.DataOffset % Alignment != 0u)) {
+				return false;
+			}
+		}
+
+		const uint32_t* slots = reinterpret_cast<const uint32_t*>(data + header.SlotsOffset);
+		for (uint32_t i = 0u; i < header.SlotCount; ++i) {
+			if (slots[i] != InvalidIndex && slots[i] >= header.EntryCount) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	inline bool FindEntry(const std::filesystem::path& file_name, std::shared_ptr<Reader>& reader, uint32_t& index) {
+		std::lock_guard<std::mutex> lock(Mount_mutex);
+		for (const MountedArchive& mounted_archive : Mounted_archives) {
+			index = mounted_archive.pReader->Find(GetArchivePath(file_name, mounted_archive.RootPath));
+			if (index != InvalidIndex) {
+				reader = mounted_archive.pReader;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	inline bool ReadLooseFile(const std::filesystem::path& file_name, std::vector<uint8_t>& data) {
+		HANDLE file = CreateFileW(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+		bool is_read = GetFileSizeEx(file, &file_size) != FALSE;
+		if (is_read) {
+			data.resize(static_cast<size_t>(file_size.QuadPart));
+			size_t bytes_read = 0u;
+			while (bytes_read < data.size()) {
+				DWORD chunk_read = 0u;
+				if (!::ReadFile(file, data.data() + bytes_read, static_cast<DWORD>(std::min<size_t>(data.size() - bytes_read, std::numeric_limits<DWORD>::max())), &chunk_read, nullptr) || chunk_read == 0u) {
+					break;
+				}
+				bytes_read += chunk_read;
+			}
+			is_read = bytes_read == data.size();
+		}
+
+		CloseHandle(file);
+
+		return is_read;
+	}
+
+	std::string GetArchivePath(const std::filesystem::path& file_name, const std::filesystem::path& root_path) {
+		std::error_code error;
+		std::filesystem::path absolute_path = std::filesystem::absolute(file_name, error).lexically_normal();
+		std::filesystem::path absolute_root_path = std::filesystem::absolute(root_path, error).lexically_normal();
+		if (error) {
+			return std::string();
+		}
+
+		std::filesystem::path relative_path = absolute_path.lexically_relative(absolute_root_path);
+		if (relative_path.empty() || *relative_path.begin() == ".." || relative_path == ".") {
+			return std::string();
+		}
+
+		std::wstring name = relative_path.generic_wstring();
+		std::transform(name.begin(), name.end(), name.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+
+		return std::filesystem::path(name).generic_u8string();
+	}
+
+	Reader::Reader() : m_header(nullptr), m_entries(nullptr), m_slots(nullptr), m_names(nullptr) {}
+
+	bool Reader::Open(const std::filesystem::path& archive_path) {
+		m_header = nullptr;
+		if (!m_file.Open(archive_path.wstring()) || !IsArchiveValid(m_file.GetData(), m_file.GetSize())) {
+			m_file.Close();
+			return false;
+		}
+
+		const uint8_t* data = m_file.GetData();
+		m_header = reinterpret_cast<const Header*>(data);
+		m_entries = reinterpret_cast<const EntryRecord*>(data + m_header->EntriesOffset);
+		m_slots = reinterpret_cast<const uint32_t*>(data + m_header->SlotsOffset);
+		m_names = reinterpret_cast<const char*>(data + m_header->NamesOffset);
+
+		return true;
+	}
+
+	bool Reader::IsOpen() const {
+		return m_header != nullptr;
+	}
+
+	uint32_t Reader::GetEntryCount() const {
+		return m_header ? m_header->EntryCount : 0u;
+	}
+
+	const EntryRecord& Reader::GetEntry(uint32_t index) const {
+		return m_entries[index];
+	}
+
+	const char* Reader::GetName(uint32_t index) const {
+		return m_names + m_entries[index].NameOffset;
+	}
+
+	uint32_t Reader::Find(const std::string& archive_path) const {
+		if (!m_header || archive_path.empty()) {
+			return InvalidIndex;
+		}
+
+		const uint64_t hash = HashPath(archive_path);
+		const uint32_t mask = m_header->SlotCount - 1u;
+		uint32_t slot = static_cast<uint32_t>(hash) & mask;
+		for (uint32_t probe = 0u; probe < m_header->SlotCount; ++probe, slot = (slot + 1u) & mask) {
+			uint32_t index = m_slots[slot];
+			if (index == InvalidIndex) {
+				break;
+			}
+			if (m_entries[index].PathHash == hash && archive_path == GetName(index)) {
+				return index;
+			}
+		}
+
+		return InvalidIndex;
+	}
+
+	const uint8_t* Reader::GetStoredData(uint32_t index) const {
+		return m_file.GetData() + m_entries[index].DataOffset;
+	}
+
+	bool Reader::Extract(uint32_t index, uint8_t* destination) const {
+		const EntryRecord& entry = m_entries[index];
+		if (entry.Compression == static_cast<uint32_t>(Compression::None)) {
+			std::memcpy(destination, GetStoredData(index), static_cast<size_t>(entry.Size));
+			return true;
+		}
+
+		DECOMPRESSOR_HANDLE decompressor = nullptr;
+		if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, nullptr, &decompressor)) {
+			return false;
+		}
+
+		SIZE_T size = 0u;
+		BOOL is_decompressed = Decompress(decompressor, GetStoredData(index), static_cast<SIZE_T>(entry.StoredSize), destination, static_cast<SIZE_T>(entry.Size), &size);
+		CloseDecompressor(decompressor);
+
+		return is_decompressed && size == entry.Size;
+	}
+
+	bool Mount(const std::filesystem::path& archive_path, const std::filesystem::path& root_path) {
+		auto reader = std::make_shared<Reader>();
+		if (!reader->Open(archive_path)) {
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::path absolute_root_path = std::filesystem::absolute(root_path, error).lexically_normal();
+		if (error) {
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(Mount_mutex);
+			Mounted_archives.insert(Mounted_archives.begin(), { reader, absolute_root_path });
+		}
+
+		char message[512];
+		sprintf_s(message, "Mounted asset archive \"%s\" with %u files\n", archive_path.string().c_str(), reader->GetEntryCount());
+		OutputDebugStringA(message);
+
+		return true;
+	}
+
+	void UnmountAll() {
+		std::lock_guard<std::mutex> lock(Mount_mutex);
+		Mounted_archives.clear();
+	}
+
+	bool Exists(const std::filesystem::path& file_name) {
+		std::shared_ptr<Reader> reader;
+		uint32_t index = InvalidIndex;
+		return FindEntry(file_name, reader, index);
+	}
+
+	bool ReadFile(const std::filesystem::path& file_name, IOService::Buffer& buffer) {
+		std::shared_ptr<Reader> reader;
+		uint32_t index = InvalidIndex;
+		if (!FindEntry(file_name, reader, index)) {
+			return false;
+		}
+
+		// The buffer keeps the archive mapped even if it gets unmounted in the meantime.
+		const EntryRecord& entry = reader->GetEntry(index);
+		if (entry.Compression == static_cast<uint32_t>(Compression::None)) {
+			buffer = { reader, reader->GetStoredData(index), static_cast<size_t>(entry.Size) };
+			return true;
+		}
+
+		auto data = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(entry.Size));
+		if (!reader->Extract(index, data->data())) {
+			return false;
+		}
+		buffer = { data, data->data(), data->size() };
+
+		return true;
+	}
+
+	bool Pack(const std::filesystem::path& archive_path, const std::vector<std::filesystem::path>& source_paths, const std::filesystem::path& root_path, PackStatistics* statistics) {
+		using Clock = std::chrono::steady_clock;
+
+		struct PackEntry {
+			std::filesystem::path FileName;
+			std::string ArchivePath;
+			Compression EntryCompression;
+			uint64_t Size;
+			std::vector<uint8_t> Data;
+		};
+
+		Clock::time_point start_time = Clock::now();
+
+		PackStatistics local_statistics;
+		PackStatistics& pack_statistics = statistics ? *statistics : local_statistics;
+		pack_statistics = {};
+
+		std::vector<PackEntry> entries;
+		for (const std::filesystem::path& source_path : source_paths) {
+			std::error_code error;
+			if (std::filesystem::is_directory(source_path, error)) {
+				for (const std::filesystem::directory_entry& directory_entry : std::filesystem::recursive_directory_iterator(source_path, error)) {
+					if (directory_entry.is_regular_file(error)) {
+						entries.push_back({ directory_entry.path() });
+					}
+				}
+			}
+			else if (std::filesystem::is_regular_file(source_path, error)) {
+				entries.push_back({ source_path });
+			}
+			else {
+				pack_statistics.SkippedFiles.push_back(source_path);
+			}
+		}
+
+		bool is_successful = true;
+		for (PackEntry& entry : entries) {
+			entry.ArchivePath = GetArchivePath(entry.FileName, root_path);
+			if (entry.ArchivePath.empty()) {
+				pack_statistics.SkippedFiles.push_back(entry.FileName);
+			}
+		}
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [](const PackEntry& entry) { return entry.ArchivePath.empty(); }), entries.end());
+		std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.ArchivePath < b.ArchivePath; });
+		entries.erase(std::unique(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.ArchivePath == b.ArchivePath; }), entries.end());
+
+		// Reading and compressing run on the thread pool, the archive is written in path order.
+		std::atomic<bool> is_read = true;
+		ThreadPool::Get().ParallelFor(entries.size(), [&entries, &is_read](size_t i) {
+			PackEntry& entry = entries[i];
+			entry.EntryCompression = Compression::None;
+
+			std::vector<uint8_t> data;
+			if (!ReadLooseFile(entry.FileName, data)) {
+				is_read = false;
+				return;
+			}
+			entry.Size = data.size();
+
+			// A destination smaller than the ratio makes Compress fail for entries that don't shrink enough.
+			std::vector<uint8_t> compressed(static_cast<size_t>(data.size() * Max_compressed_ratio));
+			COMPRESSOR_HANDLE compressor = nullptr;
+			if (!compressed.empty() && CreateCompressor(COMPRESS_ALGORITHM_XPRESS_HUFF, nullptr, &compressor)) {
+				SIZE_T compressed_size = 0u;
+				if (Compress(compressor, data.data(), data.size(), compressed.data(), compressed.size(), &compressed_size)) {
+					compressed.resize(compressed_size);
+					entry.Data = std::move(compressed);
+					entry.EntryCompression = Compression::Xpress;
+				}
+				CloseCompressor(compressor);
+			}
+
+			if (entry.EntryCompression == Compression::None) {
+				entry.Data = std::move(data);
+			}
+		});
+		if (!is_read) {
+			OutputDebugStringA("Failed to read the source files of an asset archive\n");
+			return false;
+		}
+
+		uint32_t slot_count = 1u;
+		while (slot_count < entries.size() * 2u) {
+			slot_count *= 2u;
+		}
+
+		std::vector<EntryRecord> records(entries.size());
+		std::vector<uint32_t> slots(slot_count, InvalidIndex);
+		std::string names;
+		for (size_t i = 0u; i < entries.size(); ++i) {
+			records[i].PathHash = HashPath(entries[i].ArchivePath);
+			records[i].NameOffset = static_cast<uint32_t>(names.size());
+			records[i].Compression = static_cast<uint32_t>(entries[i].EntryCompression);
+			records[i].Size = entries[i].Size;
+			records[i].StoredSize = entries[i].Data.size();
+			names.append(entries[i].ArchivePath);
+			names.push_back('\0');
+
+			uint32_t slot = static_cast<uint32_t>(records[i].PathHash) & (slot_count - 1u);
+			while (slots[slot] != InvalidIndex) {
+				slot = (slot + 1u) & (slot_count - 1u);
+			}
+			slots[slot] = static_cast<uint32_t>(i);
+		}
+
+		Header header = {};
+		header.Magic = Magic;
+		header.Version = Version;
+		header.EntryCount = static_cast<uint32_t>(entries.size());
+		header.SlotCount = slot_count;
+		header.NamesSize = static_cast<uint32_t>(names.size());
+		header.EntriesOffset = sizeof(Header);
+		header.SlotsOffset = AlignOffset(header.EntriesOffset + records.size() * sizeof(EntryRecord), alignof(uint64_t));
+		header.NamesOffset = AlignOffset(header.SlotsOffset + slots.size() * sizeof(uint32_t), alignof(uint64_t));
+
+		uint64_t offset = header.NamesOffset + names.size();
+		size_t compressed_count = 0u;
+		uint64_t total_size = 0u;
+		for (EntryRecord& record : records) {
+			bool is_compressed = record.Compression != static_cast<uint32_t>(Compression::None);
+			offset = AlignOffset(offset, is_compressed ? CompressedAlignment : Alignment);
+			record.DataOffset = offset;
+			offset += record.StoredSize;
+
+			compressed_count += is_compressed ? 1u : 0u;
+			total_size += record.Size;
+		}
+		header.FileSize = offset;
+
+		// Written next to the archive first, a failed pack never leaves a broken archive behind.
+		std::filesystem::path temp_path = archive_path;
+		temp_path += ".tmp";
+		{
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				char message[512];
+				sprintf_s(message, "Failed to create asset archive \"%s\"\n", temp_path.string().c_str());
+				OutputDebugStringA(message);
+				return false;
+			}
+
+			const char zeros[Alignment] = {};
+			auto write_padding = [&file, &zeros](uint64_t target_offset) {
+				uint64_t position = static_cast<uint64_t>(file.tellp());
+				file.write(zeros, static_cast<std::streamsize>(target_offset - position));
+			};
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(EntryRecord));
+			write_padding(header.SlotsOffset);
+			file.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint32_t));
+			write_padding(header.NamesOffset);
+			file.write(names.data(), names.size());
+			for (size_t i = 0u; i < entries.size(); ++i) {
+				write_padding(records[i].DataOffset);
+				file.write(reinterpret_cast<const char*>(entries[i].Data.data()), entries[i].Data.size());
+			}
+
+			is_successful = static_cast<bool>(file);
+		}
+
+		std::error_code error;
+		if (is_successful) {
+			std::filesystem::rename(temp_path, archive_path, error);
+			is_successful = !error;
+		}
+		if (!is_successful) {
+			std::filesystem::remove(temp_path, error);
+
+			char message[512];
+			sprintf_s(message, "Failed to write asset archive \"%s\"\n", archive_path.string().c_str());
+			OutputDebugStringA(message);
+			return false;
+		}
+
+		pack_statistics.FileCount = entries.size();
+		pack_statistics.CompressedCount = compressed_count;
+		pack_statistics.Size = total_size;
+		pack_statistics.ArchiveSize = header.FileSize;
+		pack_statistics.PackTime = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "io_service.h"
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Packed asset file that replaces a tree of loose files. A hashed path table finds an entry
+// without touching the file system, stored entries start on a 4 KB boundary and are handed
+// out straight from the mapping, entries that shrink enough are compressed with XPRESS.
+// Mounted archives serve the whole file reads of the I/O service and the DDS files mapped by
+// DDSFile, files they don't hold are still read from disk.
+namespace AssetArchive {
+	constexpr uint32_t Magic = 0x4B415042u; // "BPAK"
+	constexpr uint32_t Version = 1u;
+	constexpr uint32_t InvalidIndex = ~0u;
+	constexpr uint64_t Alignment = 4096u;
+	constexpr uint64_t CompressedAlignment = 16u;
+
+	enum class Compression : uint32_t {
+		None,
+		Xpress,
+	};
+
+	struct Header {
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t EntryCount;
+		uint32_t SlotCount;
+		uint32_t NamesSize;
+		uint32_t Reserved;
+		uint64_t EntriesOffset;
+		uint64_t SlotsOffset;
+		uint64_t NamesOffset;
+		uint64_t FileSize;
+	};
+
+	// Names are offsets into the name table. Paths are stored lower case with forward slashes,
+	// relative to the root the archive was packed from.
+	struct EntryRecord {
+		uint64_t PathHash;
+		uint64_t DataOffset;
+		uint64_t StoredSize;
+		uint64_t Size;
+		uint32_t NameOffset;
+		uint32_t Compression;
+	};
+
+	// Archive path of a file below root_path, empty for files outside of it.
+	std::string GetArchivePath(const std::filesystem::path& file_name, const std::filesystem::path& root_path);
+
+	// The slot table has a power of two size and holds entry indices, a lookup probes linearly
+	// from the path hash until it finds the entry or an empty slot.
+	class Reader {
+	public:
+		Reader();
+
+		Reader(const Reader& copy) = delete;
+		Reader& operator=(const Reader& copy) = delete;
+
+		// Checks the header, the tables and every entry range against the file size.
+		bool Open(const std::filesystem::path& archive_path);
+		bool IsOpen() const;
+
+		uint32_t GetEntryCount() const;
+		const EntryRecord& GetEntry(uint32_t index) const;
+		const char* GetName(uint32_t index) const;
+
+		// Index of the entry or InvalidIndex.
+		uint32_t Find(const std::string& archive_path) const;
+
+		const uint8_t* GetStoredData(uint32_t index) const;
+
+		// Writes the uncompressed entry, destination has to hold EntryRecord::Size bytes.
+		bool Extract(uint32_t index, uint8_t* destination) const;
+
+	private:
+		MappedFile m_file;
+		const Header* m_header;
+		const EntryRecord* m_entries;
+		const uint32_t* m_slots;
+		const char* m_names;
+	};
+
+	// Mounted archives are searched newest first, an archive packed from root_path serves the files below it.
+	bool Mount(const std::filesystem::path& archive_path, const std::filesystem::path& root_path = std::filesystem::current_path());
+	void UnmountAll();
+
+	bool Exists(const std::filesystem::path& file_name);
+
+	// Reads a whole file from the mounted archives, fails if none holds it. Stored entries point into
+	// the mapping, compressed ones are decompressed into a buffer of their own.
+	bool ReadFile(const std::filesystem::path& file_name, IOService::Buffer& buffer);
+
+	// Summary of a Pack call. Sizes are in bytes before and after packing, the time is in milliseconds.
+	struct PackStatistics {
+		size_t FileCount;
+		size_t CompressedCount;
+		uint64_t Size;
+		uint64_t ArchiveSize;
+		double PackTime;
+		std::vector<std::filesystem::path> SkippedFiles; // Missing or outside of root_path.
+	};
+
+	// Packs the files and the contents of the directories in source_paths, with paths relative to root_path.
+	bool Pack(const std::filesystem::path& archive_path, const std::vector<std::filesystem::path>& source_paths, const std::filesystem::path& root_path, PackStatistics* statistics = nullptr);
+}
\ No newline at end of file
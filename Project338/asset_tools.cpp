@@ -0,0 +1,113 @@
+#include "tools.h"
+
+#include "asset_archive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+constexpr int Archive_load_runs = 3;
+
+// One open and one read of the whole file.
+inline bool ReadLooseFile(const std::filesystem::path& file_name, std::vector<uint8_t>& data) {
+	std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+
+	data.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+}
+
+bool Tools::WritePackReport(const std::filesystem::path& archive_path, const std::vector<std::filesystem::path>& source_paths, const std::filesystem::path& root_path, std::ostream& output) {
+	AssetArchive::PackStatistics statistics;
+	bool is_packed = AssetArchive::Pack(archive_path, source_paths, root_path, &statistics);
+
+	for (const std::filesystem::path& file_name : statistics.SkippedFiles) {
+		output << "Skipping " << file_name.string() << ": not found or outside of " << root_path.string() << std::endl;
+	}
+	if (!is_packed) {
+		output << "Failed to pack " << archive_path.string() << std::endl;
+		return false;
+	}
+
+	output << "Packed " << statistics.FileCount << " files, " << statistics.CompressedCount << " compressed: " << std::fixed << std::setprecision(2)
+		<< statistics.Size / (1024.0 * 1024.0) << " MB into " << statistics.ArchiveSize / (1024.0 * 1024.0) << " MB in "
+		<< statistics.PackTime << " ms" << std::defaultfloat << std::endl;
+
+	return true;
+}
+
+bool Tools::WriteArchiveLoadReport(const std::filesystem::path& archive_path, const std::filesystem::path& root_path, std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	AssetArchive::Reader probe;
+	if (!probe.Open(archive_path)) {
+		output << "Failed to open " << archive_path.string() << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> names;
+	uint64_t total_size = 0u;
+	for (uint32_t i = 0u; i < probe.GetEntryCount(); ++i) {
+		names.push_back(probe.GetName(i));
+		total_size += probe.GetEntry(i).Size;
+	}
+
+	std::vector<uint8_t> data;
+
+	// Loose files pay what the loaders paid before, an existence check and an open per file.
+	auto read_loose = [&]() {
+		Clock::time_point start_time = Clock::now();
+		for (const std::string& name : names) {
+			std::filesystem::path file_name = root_path / std::filesystem::u8path(name);
+			if (!std::filesystem::exists(file_name) || !ReadLooseFile(file_name, data)) {
+				return -1.0;
+			}
+		}
+		return std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+	};
+
+	auto read_archive = [&]() {
+		Clock::time_point start_time = Clock::now();
+		AssetArchive::Reader reader;
+		if (!reader.Open(archive_path)) {
+			return -1.0;
+		}
+		for (const std::string& name : names) {
+			uint32_t index = reader.Find(name);
+			if (index == AssetArchive::InvalidIndex) {
+				return -1.0;
+			}
+			data.resize(static_cast<size_t>(reader.GetEntry(index).Size));
+			if (!reader.Extract(index, data.data())) {
+				return -1.0;
+			}
+		}
+		return std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+	};
+
+	double first_loose_time = read_loose();
+	double first_archive_time = read_archive();
+	if (first_loose_time < 0.0 || first_archive_time < 0.0) {
+		output << "Failed to read every entry of " << archive_path.string() << " from the archive and from " << root_path.string() << std::endl;
+		return false;
+	}
+
+	double loose_time = std::numeric_limits<double>::max();
+	double archive_time = std::numeric_limits<double>::max();
+	for (int run = 0; run < Archive_load_runs; ++run) {
+		loose_time = std::min(loose_time, read_loose());
+		archive_time = std::min(archive_time, read_archive());
+	}
+
+	double megabytes = total_size / (1024.0 * 1024.0);
+	output << "Files, MB, Loose first ms, Archive first ms, Loose warm ms, Archive warm ms, Loose warm MB/s, Archive warm MB/s" << std::endl;
+	output << names.size() << ", " << std::fixed << std::setprecision(2) << megabytes << ", " << first_loose_time << ", " << first_archive_time << ", "
+		<< loose_time << ", " << archive_time << ", " << megabytes * 1000.0 / loose_time << ", " << megabytes * 1000.0 / archive_time << std::defaultfloat << std::endl;
+
+	return true;
+}
\ No newline at end of file
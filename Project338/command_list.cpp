@@ -4,32 +4,56 @@
 #include "command_queue.h"
 #include "constant_buffer.h"
 #include "constant_buffer_view.h"
+#include "dds_file.h"
 #include "device.h"
 #include "dynamic_descriptor_heap.h"
 #include "generate_mips_pso.h"
 #include "index_buffer.h"
+#include "io_service.h"
 #include "material.h"
 #include "mesh.h"
+#include "mip_generator.h"
 #include "pano_to_cubemap_pso.h"
 #include "pipeline_state_object.h"
+#include "pixel_convert.h"
 #include "render_target.h"
 #include "resource.h"
 #include "resource_state_tracker.h"
 #include "root_signature.h"
 #include "scene.h"
+#include "scene_cache.h"
 #include "scene_node.h"
 #include "shader_resource_view.h"
 #include "structured_buffer.h"
 #include "texture.h"
+#include "texture_cache.h"
+#include "texture_quality.h"
 #include "unordered_access_view.h"
 #include "upload_buffer.h"
 #include "utils.h"
 #include "vertex_buffer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
 
 #include <DirectXTex/DirectXTex.h>
 
+static std::atomic<size_t> Generate_mips_batches(0u);
+static std::atomic<size_t> Generate_mips_textures(0u);
+static std::atomic<size_t> Generate_mips_dispatches(0u);
+static std::atomic<size_t> Generate_mips_duplicates(0u);
+static std::atomic<size_t> Generate_mips_barriers(0u);
+static std::atomic<size_t> Generate_mips_barriers_saved(0u);
+static std::atomic<size_t> Generate_mips_submissions(0u);
+static std::atomic<size_t> Generate_mips_submissions_saved(0u);
+
+static std::atomic<size_t> DDS_textures(0u);
+static std::atomic<uint64_t> DDS_bytes_copied(0u);
+static std::atomic<uint64_t> DDS_copy_microseconds(0u);
+
 class MakeUploadBuffer : public UploadBuffer {
 public:
 	MakeUploadBuffer(Device& device, size_t pageSize = _2MB)
@@ -38,9 +62,6 @@ public:
 	virtual ~MakeUploadBuffer() {}
 };
 
-std::map<std::wstring, ID3D12Resource*> CommandList::ms_texture_cache;
-std::mutex CommandList::ms_texture_cache_mutex;
-
 D3D12_COMMAND_LIST_TYPE CommandList::GetCommandListType() const {
 	return m_d3d12_command_list_type;
 }
@@ -57,7 +78,18 @@ std::shared_ptr<CommandList> CommandList::GetGenerateMipsCommandList() const {
 	return m_compute_command_list;
 }
 
-CommandList::CommandList(Device& device, D3D12_COMMAND_LIST_TYPE type) : m_device(device), m_d3d12_command_list_type(type), m_root_signature(nullptr), m_pipeline_state(nullptr) {
+const std::vector<std::shared_ptr<Texture>>& CommandList::GetPendingMips() const {
+	return m_pending_mips;
+}
+
+void CommandList::RecordSubmittedMips(size_t merged_command_lists) {
+	Generate_mips_submissions++;
+	Generate_mips_submissions_saved += merged_command_lists > 0u ? merged_command_lists - 1u : 0u;
+}
+
+static std::atomic<uint64_t> Next_recording_index = 1u;
+
+CommandList::CommandList(Device& device, D3D12_COMMAND_LIST_TYPE type) : m_device(device), m_d3d12_command_list_type(type), m_recording_index(Next_recording_index++), m_root_signature(nullptr), m_pipeline_state(nullptr) {
 	auto d3d12_device = m_device.GetD3D12Device();
 
 	HRESULT hr = d3d12_device->CreateCommandAllocator(m_d3d12_command_list_type, IID_PPV_ARGS(m_d3d12_command_allocator.GetAddressOf()));
@@ -242,110 +274,339 @@ void CommandList::SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY primitive_topology
 	m_d3d12_command_list->IASetPrimitiveTopology(primitive_topology);
 }
 
-std::shared_ptr<Texture> CommandList::LoadTextureFromFile(const std::wstring& file_name, bool sRGB) {
-	std::shared_ptr<Texture> texture;
+std::shared_ptr<Texture> CommandList::LoadTextureFromFile(const std::wstring& file_name, bool sRGB, TextureCooker::Usage usage) {
+	return TextureCache::Get().GetOrLoad({ file_name, sRGB }, [&]() {
+		// DDS files that carry their mips are copied straight from the file mapping.
+		DDSFile dds_file;
+		if (std::filesystem::path(file_name).extension() == ".dds" && dds_file.Open(file_name) && (dds_file.GetMipLevels() > 1u || (dds_file.GetWidth() == 1u && dds_file.GetHeight() == 1u))) {
+			return CreateTextureFromDDS(file_name, sRGB, usage, dds_file);
+		}
+
+		DirectX::ScratchImage scratch_image;
+		TextureCooker::LoadTexture(file_name, sRGB, usage, scratch_image);
+
+		return CreateTextureFromImage(file_name, scratch_image);
+	});
+}
+
+void CommandList::DecodeTextureFromFile(const std::wstring& file_name, bool sRGB, DirectX::ScratchImage& scratch_image) {
 	std::filesystem::path file_path(file_name);
-	if (!std::filesystem::exists(file_path)) {
+
+	// The file comes from the I/O service, a scene import has usually queued it already.
+	IOService::Buffer buffer = IOService::Get().ReadFile(file_name).get();
+	if (!buffer.Storage) {
 		throw std::exception("File not found.");
 	}
 
-	std::lock_guard<std::mutex> lock(ms_texture_cache_mutex);
-	auto iter = ms_texture_cache.find(file_name);
-	if (iter != ms_texture_cache.end()) {
-		texture = m_device.CreateTexture(iter->second);
+	DirectX::TexMetadata metadata;
+	if (file_path.extension() == ".dds") {
+		ThrowIfFailed(LoadFromDDSMemory(buffer.pData, buffer.Size, DirectX::DDS_FLAGS_FORCE_RGB, &metadata, scratch_image));
+	}
+	else if (file_path.extension() == ".hdr") {
+		ThrowIfFailed(LoadFromHDRMemory(buffer.pData, buffer.Size, &metadata, scratch_image));
+	}
+	else if (file_path.extension() == ".tga") {
+		ThrowIfFailed(LoadFromTGAMemory(buffer.pData, buffer.Size, &metadata, scratch_image));
 	}
 	else {
-		DirectX::TexMetadata metadata;
-		DirectX::ScratchImage scratch_image;
+		ThrowIfFailed(LoadFromWICMemory(buffer.pData, buffer.Size, DirectX::WIC_FLAGS_FORCE_RGB, &metadata, scratch_image));
+	}
 
-		if (file_path.extension() == ".dds") {
-			ThrowIfFailed(LoadFromDDSFile(file_name.c_str(), DirectX::DDS_FLAGS_FORCE_RGB, &metadata, scratch_image));
-		}
-		else if (file_path.extension() == ".hdr") {
-			ThrowIfFailed(LoadFromHDRFile(file_name.c_str(), &metadata, scratch_image));
-		}
-		else if (file_path.extension() == ".tga") {
-			ThrowIfFailed(LoadFromTGAFile(file_name.c_str(), &metadata, scratch_image));
-		}
-		else {
-			ThrowIfFailed(LoadFromWICFile(file_name.c_str(), DirectX::WIC_FLAGS_FORCE_RGB, &metadata, scratch_image));
+	// BGRA data is swizzled here so the cooker and the mip generator only ever see RGBA.
+	DXGI_FORMAT base_format = DirectX::MakeTypelessUNORM(DirectX::MakeTypeless(metadata.format));
+	if (base_format == DXGI_FORMAT_B8G8R8A8_UNORM || base_format == DXGI_FORMAT_B8G8R8X8_UNORM) {
+		bool force_opaque = base_format == DXGI_FORMAT_B8G8R8X8_UNORM;
+		const DirectX::Image* images = scratch_image.GetImages();
+		for (size_t i = 0u; i < scratch_image.GetImageCount(); ++i) {
+			for (size_t row = 0u; row < images[i].height; ++row) {
+				uint8_t* pixels = images[i].pixels + row * images[i].rowPitch;
+				PixelConvert::BGRA8ToRGBA8(pixels, pixels, images[i].width, force_opaque);
+			}
 		}
+		metadata.format = DirectX::IsSRGB(metadata.format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		scratch_image.OverrideFormat(metadata.format);
+	}
 
-		if (sRGB) {
-			metadata.format = DirectX::MakeSRGB(metadata.format);
-		}
+	if (sRGB) {
+		scratch_image.OverrideFormat(DirectX::MakeSRGB(metadata.format));
+	}
 
-		D3D12_RESOURCE_DESC texture_desc = {};
-		switch (metadata.dimension) {
-			case DirectX::TEX_DIMENSION_TEXTURE1D:
-				texture_desc = CD3DX12_RESOURCE_DESC::Tex1D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT16>(metadata.arraySize));
-				break;
-			case DirectX::TEX_DIMENSION_TEXTURE2D:
-				texture_desc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT>(metadata.height), static_cast<UINT16>(metadata.arraySize));
-				break;
-			case DirectX::TEX_DIMENSION_TEXTURE3D:
-				texture_desc = CD3DX12_RESOURCE_DESC::Tex3D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT>(metadata.height), static_cast<UINT16>(metadata.depth));
-				break;
-			default:
-				throw std::exception("Invalid texture dimension.");
-				break;
-		}
+	MipGenerator::GenerateInPlace(scratch_image);
+}
 
-		auto d3d12_device = m_device.GetD3D12Device();
-		Microsoft::WRL::ComPtr<ID3D12Resource> texture_resource;
+bool CommandList::IsTextureCached(const std::wstring& file_name, bool sRGB) {
+	return TextureCache::Get().Contains({ file_name, sRGB });
+}
 
+std::shared_ptr<Texture> CommandList::LoadTextureFromImage(const std::wstring& file_name, bool sRGB, const DirectX::ScratchImage& scratch_image) {
+	return TextureCache::Get().GetOrLoad({ file_name, sRGB }, [&]() {
+		return CreateTextureFromImage(file_name, scratch_image);
+	});
+}
 
-		D3D12_HEAP_PROPERTIES props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-		HRESULT hr = d3d12_device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &texture_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(texture_resource.GetAddressOf()));
-		ThrowIfFailed(hr);
+std::shared_ptr<Texture> CommandList::CreateTextureFromImage(const std::wstring& file_name, const DirectX::ScratchImage& scratch_image) {
+	const DirectX::TexMetadata& metadata = scratch_image.GetMetadata();
+
+	D3D12_RESOURCE_DESC texture_desc = {};
+	switch (metadata.dimension) {
+		case DirectX::TEX_DIMENSION_TEXTURE1D:
+			texture_desc = CD3DX12_RESOURCE_DESC::Tex1D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT16>(metadata.arraySize));
+			break;
+		case DirectX::TEX_DIMENSION_TEXTURE2D:
+			texture_desc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT>(metadata.height), static_cast<UINT16>(metadata.arraySize));
+			break;
+		case DirectX::TEX_DIMENSION_TEXTURE3D:
+			texture_desc = CD3DX12_RESOURCE_DESC::Tex3D(metadata.format, static_cast<UINT64>(metadata.width), static_cast<UINT>(metadata.height), static_cast<UINT16>(metadata.depth));
+			break;
+		default:
+			throw std::exception("Invalid texture dimension.");
+			break;
+	}
 
-		texture = m_device.CreateTexture(texture_resource);
-		texture->SetName(file_name);
+	auto d3d12_device = m_device.GetD3D12Device();
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture_resource;
+
+	D3D12_HEAP_PROPERTIES props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	HRESULT hr = d3d12_device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &texture_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(texture_resource.GetAddressOf()));
+	ThrowIfFailed(hr);
+
+	std::shared_ptr<Texture> texture = m_device.CreateTexture(texture_resource);
+	texture->SetName(file_name);
+
+	ResourceStateTracker::AddGlobalResourceState(texture_resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+
+	std::vector<D3D12_SUBRESOURCE_DATA> subresources(scratch_image.GetImageCount());
+	const DirectX::Image* pImages = scratch_image.GetImages();
+	for (int i = 0; i < scratch_image.GetImageCount(); ++i) {
+		auto& subresource = subresources[i];
+		subresource.RowPitch = pImages[i].rowPitch;
+		subresource.SlicePitch = pImages[i].slicePitch;
+		subresource.pData = pImages[i].pixels;
+	}
+
+	CopyTextureSubresource(texture, 0, static_cast<uint32_t>(subresources.size()), subresources.data());
+
+	// Decoded images come with their mips, only formats the CPU mip generator skips get here.
+	if (subresources.size() < texture_resource->GetDesc().MipLevels) {
+		GenerateMips(texture);
+	}
+
+	return texture;
+}
+
+std::shared_ptr<Texture> CommandList::CreateTextureFromDDS(const std::wstring& file_name, bool sRGB, TextureCooker::Usage usage, const DDSFile& dds_file) {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start_time = Clock::now();
+
+	const DXGI_FORMAT format = sRGB ? DirectX::MakeSRGB(dds_file.GetFormat()) : dds_file.GetFormat();
+	const uint32_t skipped_mips = TextureQuality::GetSkippedMips(TextureCooker::ResolveUsage(usage, format), format, dds_file.GetWidth(), dds_file.GetHeight(), dds_file.GetMipLevels());
+	const UINT64 width = std::max<UINT64>(dds_file.GetWidth() >> skipped_mips, 1u);
+	const UINT height = std::max<UINT>(static_cast<UINT>(dds_file.GetHeight() >> skipped_mips), 1u);
+	const UINT16 array_size = static_cast<UINT16>(dds_file.GetArraySize());
+	const UINT16 mip_levels = static_cast<UINT16>(dds_file.GetMipLevels() - skipped_mips);
+
+	D3D12_RESOURCE_DESC texture_desc = dds_file.Is1D() ? CD3DX12_RESOURCE_DESC::Tex1D(format, width, array_size, mip_levels) : CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, array_size, mip_levels);
+
+	auto d3d12_device = m_device.GetD3D12Device();
+	Microsoft::WRL::ComPtr<ID3D12Resource> texture_resource;
 
-		ResourceStateTracker::AddGlobalResourceState(texture_resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+	D3D12_HEAP_PROPERTIES props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+	HRESULT hr = d3d12_device->CreateCommittedResource(&props, D3D12_HEAP_FLAG_NONE, &texture_desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(texture_resource.GetAddressOf()));
+	ThrowIfFailed(hr);
+
+	std::shared_ptr<Texture> texture = m_device.CreateTexture(texture_resource);
+	texture->SetName(file_name);
+
+	ResourceStateTracker::AddGlobalResourceState(texture_resource.Get(), D3D12_RESOURCE_STATE_COMMON);
 
-		std::vector<D3D12_SUBRESOURCE_DATA> subresources(scratch_image.GetImageCount());
-		const DirectX::Image* pImages = scratch_image.GetImages();
-		for (int i = 0; i < scratch_image.GetImageCount(); ++i) {
-			auto& subresource = subresources[i];
-			subresource.RowPitch = pImages[i].rowPitch;
-			subresource.SlicePitch = pImages[i].slicePitch;
-			subresource.pData = pImages[i].pixels;
+	const UINT subresource_count = static_cast<UINT>(array_size) * mip_levels;
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresource_count);
+	std::vector<UINT> row_counts(subresource_count);
+	std::vector<UINT64> row_sizes(subresource_count);
+	UINT64 required_size = 0u;
+	d3d12_device->GetCopyableFootprints(&texture_desc, 0u, subresource_count, 0u, layouts.data(), row_counts.data(), row_sizes.data(), &required_size);
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> upload_resource;
+	D3D12_HEAP_PROPERTIES upload_props = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	D3D12_RESOURCE_DESC upload_desc = CD3DX12_RESOURCE_DESC::Buffer(required_size);
+	hr = d3d12_device->CreateCommittedResource(&upload_props, D3D12_HEAP_FLAG_NONE, &upload_desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(upload_resource.GetAddressOf()));
+	ThrowIfFailed(hr);
+
+	// The only CPU copy: rows go from the mapped file pages into the pitch aligned upload rows.
+	// Skipped mips are never touched, so their pages are never read from disk.
+	uint8_t* upload_data = nullptr;
+	D3D12_RANGE read_range = { 0u, 0u };
+	ThrowIfFailed(upload_resource->Map(0u, &read_range, reinterpret_cast<void**>(&upload_data)));
+
+	uint64_t copied_bytes = 0u;
+	uint64_t skipped_bytes = 0u;
+	for (UINT16 item = 0u; item < array_size; ++item) {
+		for (UINT mip = 0u; mip < skipped_mips; ++mip) {
+			const DDSFile::Subresource& skipped = dds_file.GetSubresource(item, mip);
+			skipped_bytes += skipped.RowPitch * skipped.RowCount;
 		}
 
-		CopyTextureSubresource(texture, 0, static_cast<uint32_t>(subresources.size()), subresources.data());
+		for (UINT16 mip = 0u; mip < mip_levels; ++mip) {
+			const UINT subresource_index = D3D12CalcSubresource(mip, item, 0u, mip_levels, array_size);
+			const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts[subresource_index];
+			const DDSFile::Subresource& subresource = dds_file.GetSubresource(item, mip + skipped_mips);
+			const size_t row_size = std::min<size_t>(static_cast<size_t>(row_sizes[subresource_index]), subresource.RowPitch);
 
-		if (subresources.size() < texture_resource->GetDesc().MipLevels) {
-			GenerateMips(texture);
+			for (UINT row = 0u; row < row_counts[subresource_index]; ++row) {
+				std::memcpy(upload_data + layout.Offset + static_cast<size_t>(row) * layout.Footprint.RowPitch, subresource.Data + row * subresource.RowPitch, row_size);
+			}
+			copied_bytes += row_size * row_counts[subresource_index];
 		}
+	}
+
+	upload_resource->Unmap(0u, nullptr);
 
-		ms_texture_cache[file_name] = texture_resource.Get();
+	TransitionBarrier(texture, D3D12_RESOURCE_STATE_COPY_DEST);
+	FlushResourceBarriers();
+
+	for (UINT i = 0u; i < subresource_count; ++i) {
+		CD3DX12_TEXTURE_COPY_LOCATION destination(texture_resource.Get(), i);
+		CD3DX12_TEXTURE_COPY_LOCATION source(upload_resource.Get(), layouts[i]);
+		m_d3d12_command_list->CopyTextureRegion(&destination, 0u, 0u, 0u, &source, nullptr);
 	}
 
+	TrackResource(upload_resource);
+	TrackResource(texture_resource);
+
+	TextureQuality::ReportSkippedMips(skipped_mips, skipped_bytes);
+
+	DDS_textures++;
+	DDS_bytes_copied += copied_bytes;
+	DDS_copy_microseconds += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_time).count();
+
 	return texture;
 }
 
 void CommandList::GenerateMips(const std::shared_ptr<Texture>& texture) {
-	if (!texture)
+	GenerateMips(std::vector<std::shared_ptr<Texture>>({ texture }));
+}
+
+void CommandList::GenerateMips(const std::vector<std::shared_ptr<Texture>>& textures) {
+	// Copy lists collect the textures, the command queue records them for all lists of a submission at once.
+	if (m_d3d12_command_list_type == D3D12_COMMAND_LIST_TYPE_COPY) {
+		for (const auto& texture : textures) {
+			if (texture && std::find(m_pending_mips.begin(), m_pending_mips.end(), texture) == m_pending_mips.end()) {
+				m_pending_mips.push_back(texture);
+			}
+		}
 		return;
+	}
 
-	auto d3d12_device = m_device.GetD3D12Device();
+	std::vector<MipGenerationJob> jobs;
+	jobs.reserve(textures.size());
 
-	if (m_d3d12_command_list_type == D3D12_COMMAND_LIST_TYPE_COPY) {
-		if (!m_compute_command_list) {
-			m_compute_command_list = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE).GetCommandList();
+	std::vector<ID3D12Resource*> resources;
+	resources.reserve(textures.size());
+
+	for (const auto& texture : textures) {
+		if (!texture || !texture->GetD3D12Resource()) {
+			continue;
+		}
+
+		ID3D12Resource* d3d12_resource = texture->GetD3D12Resource().Get();
+		if (std::find(resources.begin(), resources.end(), d3d12_resource) != resources.end()) {
+			Generate_mips_duplicates++;
+			continue;
 		}
-		m_compute_command_list->GenerateMips(texture);
+		resources.push_back(d3d12_resource);
+
+		MipGenerationJob job;
+		if (BeginGenerateMips(texture, job)) {
+			jobs.push_back(job);
+		}
+	}
+
+	if (jobs.empty()) {
 		return;
 	}
 
-	auto d3d12_resource = texture->GetD3D12Resource();
+	if (!m_generate_mips_pso) {
+		m_generate_mips_pso = std::make_unique<GenerateMipsPSO>(m_device);
+	}
+
+	SetPipelineState(m_generate_mips_pso->GetPipelineState());
+	SetComputeRootSignature(m_generate_mips_pso->GetRootSignature());
+
+	// Every round records the next dispatch of every texture that has levels left and ends with
+	// one UAV barrier for all of them, instead of one barrier per texture and dispatch.
+	size_t dispatch_count = 0u;
+	size_t barrier_count = 0u;
+	for (bool has_levels_left = true; has_levels_left; ) {
+		has_levels_left = false;
+		for (MipGenerationJob& job : jobs) {
+			if (job.SrcMip + 1u < job.MipLevels) {
+				GenerateMips_UAV(job);
+				++dispatch_count;
+				has_levels_left = has_levels_left || job.SrcMip + 1u < job.MipLevels;
+			}
+		}
+
+		UAVBarrier();
+		++barrier_count;
+	}
+
+	for (const MipGenerationJob& job : jobs) {
+		EndGenerateMips(job);
+	}
+
+	Generate_mips_batches++;
+	Generate_mips_textures += jobs.size();
+	Generate_mips_dispatches += dispatch_count;
+	Generate_mips_barriers += barrier_count;
+	Generate_mips_barriers_saved += dispatch_count - barrier_count;
+}
+
+CommandList::GenerateMipsStatistics CommandList::GetGenerateMipsStatistics() {
+	GenerateMipsStatistics statistics;
+	statistics.Batches = Generate_mips_batches;
+	statistics.Textures = Generate_mips_textures;
+	statistics.Dispatches = Generate_mips_dispatches;
+	statistics.DuplicatesSkipped = Generate_mips_duplicates;
+	statistics.UAVBarriers = Generate_mips_barriers;
+	statistics.UAVBarriersSaved = Generate_mips_barriers_saved;
+	statistics.Submissions = Generate_mips_submissions;
+	statistics.SubmissionsSaved = Generate_mips_submissions_saved;
+	return statistics;
+}
+
+void CommandList::LogGenerateMipsStatistics() {
+	GenerateMipsStatistics statistics = GetGenerateMipsStatistics();
+
+	char message[512];
+	sprintf_s(message, "Generate mips: %zu textures in %zu batches, %zu dispatches, %zu duplicates skipped, %zu UAV barriers (%zu saved), %zu compute submissions (%zu saved)\n",
+		statistics.Textures, statistics.Batches, statistics.Dispatches, statistics.DuplicatesSkipped, statistics.UAVBarriers, statistics.UAVBarriersSaved, statistics.Submissions, statistics.SubmissionsSaved);
+	OutputDebugStringA(message);
+}
+
+CommandList::DDSStatistics CommandList::GetDDSStatistics() {
+	DDSStatistics statistics;
+	statistics.Textures = DDS_textures;
+	statistics.BytesCopied = DDS_bytes_copied;
+	statistics.CopyTime = DDS_copy_microseconds / 1000.0;
+	return statistics;
+}
 
-	if (!d3d12_resource) return;
+void CommandList::LogDDSStatistics() {
+	DDSStatistics statistics = GetDDSStatistics();
 
+	char message[512];
+	sprintf_s(message, "DDS textures: %zu mapped and copied, %.2f MB in %.2f ms, %.1f MB/s\n",
+		statistics.Textures, statistics.BytesCopied / (1024.0 * 1024.0), statistics.CopyTime,
+		statistics.CopyTime > 0.0 ? statistics.BytesCopied / (1024.0 * 1024.0) * 1000.0 / statistics.CopyTime : 0.0);
+	OutputDebugStringA(message);
+}
+
+bool CommandList::BeginGenerateMips(const std::shared_ptr<Texture>& texture, MipGenerationJob& job) {
+	auto d3d12_device = m_device.GetD3D12Device();
+	auto d3d12_resource = texture->GetD3D12Resource();
 	auto resource_desc = d3d12_resource->GetDesc();
 
-	if (resource_desc.MipLevels == 1) return;
+	if (resource_desc.MipLevels == 1) return false;
 	
 	if (resource_desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || resource_desc.DepthOrArraySize != 1 || resource_desc.SampleDesc.Count > 1) {
 		throw std::exception("GenerateMips is only supported for non-multi-sampled 2D Textures.");
@@ -400,84 +661,83 @@ void CommandList::GenerateMips(const std::shared_ptr<Texture>& texture) {
 		AliasingBarrier(alias_resource, uav_resource);
 	}
 
-	auto uav_texture = m_device.CreateTexture(uav_resource);
-	GenerateMips_UAV(uav_texture, Texture::IsSRGBFormat(resource_desc.Format));
-
-	if (alias_resource) {
-		AliasingBarrier(uav_resource, alias_resource);
-		CopyResource(d3d12_resource, alias_resource);
-	}
-}
-
-void CommandList::GenerateMips_UAV(const std::shared_ptr<Texture>& texture, bool is_sRGB) {
-	if (!m_generate_mips_pso) {
-		m_generate_mips_pso = std::make_unique<GenerateMipsPSO>(m_device);
-	}
-
-	SetPipelineState(m_generate_mips_pso->GetPipelineState());
-	SetComputeRootSignature(m_generate_mips_pso->GetRootSignature());
+	job.Resource = d3d12_resource;
+	job.AliasResource = alias_resource;
+	job.UAVTexture = m_device.CreateTexture(uav_resource);
+	job.IsSRGB = Texture::IsSRGBFormat(resource_desc.Format);
+	job.SrcMip = 0u;
+	job.MipLevels = resource_desc.MipLevels;
 
-	GenerateMipsCB generate_mips_cb;
-	generate_mips_cb.IsSRGB = is_sRGB;
-
-	auto resource = texture->GetD3D12Resource();
-	auto resource_desc = resource->GetDesc();
+	auto uav_desc = uav_resource->GetDesc();
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
-	srv_desc.Format = is_sRGB ? Texture::GetSRGBFormat(resource_desc.Format) : resource_desc.Format;
+	srv_desc.Format = job.IsSRGB ? Texture::GetSRGBFormat(uav_desc.Format) : uav_desc.Format;
 	srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 	srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srv_desc.Texture2D.MipLevels = resource_desc.MipLevels;
+	srv_desc.Texture2D.MipLevels = uav_desc.MipLevels;
 
-	auto srv = m_device.CreateShaderResourceView(texture, &srv_desc);
+	job.SRV = m_device.CreateShaderResourceView(job.UAVTexture, &srv_desc);
 
-	for (uint32_t src_mip = 0; src_mip < resource_desc.MipLevels - 1u; ) {
+	return true;
+}
 
-		uint64_t src_width = resource_desc.Width >> src_mip;
-		uint32_t src_height = resource_desc.Height >> src_mip;
-		uint32_t dst_width = static_cast<uint32_t>(src_width >> 1);
-		uint32_t dst_height = src_height >> 1;
+void CommandList::EndGenerateMips(const MipGenerationJob& job) {
+	if (job.AliasResource) {
+		AliasingBarrier(job.UAVTexture->GetD3D12Resource(), job.AliasResource);
+		CopyResource(job.Resource, job.AliasResource);
+	}
+}
 
-		generate_mips_cb.SrcDimension = (src_height & 1) << 1 | (src_width & 1);
+void CommandList::GenerateMips_UAV(MipGenerationJob& job) {
+	GenerateMipsCB generate_mips_cb;
+	generate_mips_cb.IsSRGB = job.IsSRGB;
 
-		DWORD mip_count;
-		_BitScanForward(&mip_count, (dst_width == 1 ? dst_height : dst_width) | (dst_height == 1 ? dst_width : dst_height));
-		
-		mip_count = std::min<DWORD>(4, mip_count + 1);
-		mip_count = (src_mip + mip_count) >= resource_desc.MipLevels ? resource_desc.MipLevels - src_mip - 1 : mip_count;
+	const auto& texture = job.UAVTexture;
+	auto resource_desc = texture->GetD3D12Resource()->GetDesc();
 
-		dst_width = std::max<DWORD>(1, dst_width);
-		dst_height = std::max<DWORD>(1, dst_height);
+	uint32_t src_mip = job.SrcMip;
+	uint64_t src_width = resource_desc.Width >> src_mip;
+	uint32_t src_height = resource_desc.Height >> src_mip;
+	uint32_t dst_width = static_cast<uint32_t>(src_width >> 1);
+	uint32_t dst_height = src_height >> 1;
 
-		generate_mips_cb.SrcMipLevel = src_mip;
-		generate_mips_cb.NumMipLevels = mip_count;
-		generate_mips_cb.TexelSize.x = 1.0f / (float)dst_width;
-		generate_mips_cb.TexelSize.y = 1.0f / (float)dst_height;
+	generate_mips_cb.SrcDimension = (src_height & 1) << 1 | (src_width & 1);
 
-		SetCompute32BitConstants(GenerateMips::GenerateMipsCB, generate_mips_cb);
+	DWORD mip_count;
+	_BitScanForward(&mip_count, (dst_width == 1 ? dst_height : dst_width) | (dst_height == 1 ? dst_width : dst_height));
+	
+	mip_count = std::min<DWORD>(4, mip_count + 1);
+	mip_count = (src_mip + mip_count) >= resource_desc.MipLevels ? resource_desc.MipLevels - src_mip - 1 : mip_count;
 
-		SetShaderResourceView(GenerateMips::SrcMip, 0u, srv, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, src_mip, 1u);
+	dst_width = std::max<DWORD>(1, dst_width);
+	dst_height = std::max<DWORD>(1, dst_height);
 
-		for (uint32_t mip = 0; mip < mip_count; ++mip) {
-			D3D12_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
-			uav_desc.Format = resource_desc.Format;
-			uav_desc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-			uav_desc.Texture2D.MipSlice = src_mip + mip + 1;
+	generate_mips_cb.SrcMipLevel = src_mip;
+	generate_mips_cb.NumMipLevels = mip_count;
+	generate_mips_cb.TexelSize.x = 1.0f / (float)dst_width;
+	generate_mips_cb.TexelSize.y = 1.0f / (float)dst_height;
 
-			auto uav = m_device.CreateUnorderedAccessView(texture, nullptr, &uav_desc);
-			SetUnorderedAccessView(GenerateMips::OutMip, mip, uav, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, src_mip + mip + 1u, 1u);
-		}
+	SetCompute32BitConstants(GenerateMips::GenerateMipsCB, generate_mips_cb);
 
-		if (mip_count < 4) {
-			m_dynamic_descriptor_heap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(GenerateMips::OutMip, mip_count, 4 - mip_count, m_generate_mips_pso->GetDefaultUAV());
-		}
+	SetShaderResourceView(GenerateMips::SrcMip, 0u, job.SRV, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, src_mip, 1u);
 
-		Dispatch(Math::DivideByMultiple(dst_width, 8u), Math::DivideByMultiple(dst_height, 8u));
+	for (uint32_t mip = 0; mip < mip_count; ++mip) {
+		D3D12_UNORDERED_ACCESS_VIEW_DESC uav_desc = {};
+		uav_desc.Format = resource_desc.Format;
+		uav_desc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+		uav_desc.Texture2D.MipSlice = src_mip + mip + 1;
 
-		UAVBarrier(texture);
+		auto uav = m_device.CreateUnorderedAccessView(texture, nullptr, &uav_desc);
+		SetUnorderedAccessView(GenerateMips::OutMip, mip, uav, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, src_mip + mip + 1u, 1u);
+	}
 
-		src_mip += mip_count;
+	if (mip_count < 4) {
+		m_dynamic_descriptor_heap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors(GenerateMips::OutMip, mip_count, 4 - mip_count, m_generate_mips_pso->GetDefaultUAV());
 	}
+
+	Dispatch(Math::DivideByMultiple(dst_width, 8u), Math::DivideByMultiple(dst_height, 8u));
+
+	job.SrcMip += mip_count;
 }
 
 void CommandList::PanoToCubemap(const std::shared_ptr<Texture>& cubemap_texture, const std::shared_ptr<Texture>& pano_texture) {
@@ -569,14 +829,27 @@ void CommandList::PanoToCubemap(const std::shared_ptr<Texture>& cubemap_texture,
 	}
 }
 
-std::shared_ptr<Scene> CommandList::LoadSceneFromFile(const std::wstring& file_name, const std::function<bool(float)>& loading_progress) {
+std::shared_ptr<Scene> CommandList::LoadSceneFromFile(const std::wstring& file_name, const std::function<bool(float)>& loading_progress, VertexFormat vertex_format) {
 	auto scene = std::make_shared<Scene>();
-
-	if (scene->LoadSceneFromFile(*this, file_name, loading_progress)) {
-		return scene;
+	scene->SetVertexFormat(vertex_format);
+
+	// Repeated loads of a file are instances sharing the meshes and materials of the first one. The uploads are
+	// executed on a copy list of their own, since this list may execute after other callers get the scene, and
+	// the scene is returned once they have completed, whichever load recorded them.
+	std::vector<SceneCache::Upload> uploads;
+	std::shared_ptr<Scene> instance = SceneCache::Get().GetOrLoad(SceneCache::CreateKey(file_name, *scene), [&]() {
+		std::shared_ptr<CommandList> command_list = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY).GetCommandList();
+		bool is_loaded = scene->LoadSceneFromFile(*command_list, file_name, loading_progress);
+
+		return SceneCache::Load{ is_loaded ? scene : nullptr, SceneCache::ExecuteUploads(m_device, command_list) };
+	}, uploads);
+	SceneCache::Wait(uploads);
+
+	if (instance && loading_progress) {
+		loading_progress(1.0f);
 	}
 
-	return nullptr;
+	return instance;
 }
 
 std::shared_ptr<Scene> CommandList::LoadSceneFromString(const std::string& sceneString, const std::string& format) {
@@ -1057,13 +1330,23 @@ void CommandList::SetDynamicIndexBuffer(size_t num_indices, DXGI_FORMAT index_fo
 }
 
 void CommandList::SetGraphicsDynamicStructuredBuffer(uint32_t slot, size_t num_elements, size_t element_size, const void* buffer_data) {
+	SetGraphicsRootShaderResourceView(slot, CopyDynamicStructuredBuffer(num_elements, element_size, buffer_data));
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS CommandList::CopyDynamicStructuredBuffer(size_t num_elements, size_t element_size, const void* buffer_data) {
 	size_t buffer_size = num_elements * element_size;
 
 	auto heap_allocation = m_upload_buffer->Allocate(buffer_size, element_size);
 
-	memcpy(heap_allocation.CPU, buffer_data, buffer_size);
+	if (buffer_size > 0u) {
+		memcpy(heap_allocation.CPU, buffer_data, buffer_size);
+	}
 
-	m_d3d12_command_list->SetGraphicsRootShaderResourceView(slot, heap_allocation.GPU);
+	return heap_allocation.GPU;
+}
+
+void CommandList::SetGraphicsRootShaderResourceView(uint32_t root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS buffer_location) {
+	m_d3d12_command_list->SetGraphicsRootShaderResourceView(root_parameter_index, buffer_location);
 }
 void CommandList::SetViewport(const D3D12_VIEWPORT& viewport) {
 	SetViewports({ viewport });
@@ -1345,6 +1628,13 @@ void CommandList::Reset() {
 	m_root_signature = nullptr;
 	m_pipeline_state = nullptr;
 	m_compute_command_list = nullptr;
+	m_pending_mips.clear();
+
+	m_recording_index = Next_recording_index++;
+}
+
+uint64_t CommandList::GetRecordingIndex() const {
+	return m_recording_index;
 }
 
 void CommandList::TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object) {
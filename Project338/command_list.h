@@ -1,5 +1,6 @@
 #pragma once
 
+#include "texture_cooker.h"
 #include "vertex_types.h"
 
 #include <DirectXMath.h>
@@ -16,6 +17,7 @@ class Buffer;
 class ByteAddressBuffer;
 class ConstantBuffer;
 class ConstantBufferView;
+class DDSFile;
 class Device;
 class DynamicDescriptorHeap;
 class GenerateMipsPSO;
@@ -34,13 +36,38 @@ class UnorderedAccessView;
 class UploadBuffer;
 class VertexBuffer;
 
+namespace DirectX {
+	class ScratchImage;
+}
+
 class CommandList : public std::enable_shared_from_this<CommandList> {
 public:
+	struct GenerateMipsStatistics {
+		size_t Batches;
+		size_t Textures;
+		size_t Dispatches;
+		size_t DuplicatesSkipped; // Textures requested more than once in a batch.
+		size_t UAVBarriers;
+		size_t UAVBarriersSaved; // Compared to one barrier after every dispatch.
+		size_t Submissions;
+		size_t SubmissionsSaved; // Compute lists of separate command lists merged into one.
+	};
+
+	// Cooked DDS files copied from their mapping by CreateTextureFromDDS, the time is in milliseconds.
+	struct DDSStatistics {
+		size_t Textures;
+		uint64_t BytesCopied;
+		double CopyTime;
+	};
 	
 	D3D12_COMMAND_LIST_TYPE GetCommandListType() const;
 	Device& GetDevice() const;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetD3D12CommandList() const;
 
+	// Process wide unique number of the current recording. Command lists are pooled and reused,
+	// so the number changes on every reset while the address of the list stays the same.
+	uint64_t GetRecordingIndex() const;
+
 	void TransitionBarrier(const std::shared_ptr<Resource>& resource, D3D12_RESOURCE_STATES state_after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flush_barriers = false);
 	void TransitionBarrier(Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES state_after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, bool flush_barriers = false);
 
@@ -97,9 +124,18 @@ public:
 
 	void SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY primitive_topology);
 
-	std::shared_ptr<Texture> LoadTextureFromFile(const std::wstring& file_name, bool sRGB = false);
+	// Files other than DDS with their mips go through the texture cooker, so they're cooked for the usage.
+	std::shared_ptr<Texture> LoadTextureFromFile(const std::wstring& file_name, bool sRGB = false, TextureCooker::Usage usage = TextureCooker::Usage::Color);
+
+	// CPU side of LoadTextureFromFile. Reads and decodes the file and builds the mip chain on the CPU
+	// when the format allows it, so it can run on worker threads.
+	static void DecodeTextureFromFile(const std::wstring& file_name, bool sRGB, DirectX::ScratchImage& scratch_image);
+	static bool IsTextureCached(const std::wstring& file_name, bool sRGB);
+
+	// GPU side of LoadTextureFromFile: creates the texture for a decoded image and records its upload.
+	std::shared_ptr<Texture> LoadTextureFromImage(const std::wstring& file_name, bool sRGB, const DirectX::ScratchImage& scratch_image);
 
-	std::shared_ptr<Scene> LoadSceneFromFile(const std::wstring& file_name, const std::function<bool(float)>& loading_progres = std::function<bool(float)>());
+	std::shared_ptr<Scene> LoadSceneFromFile(const std::wstring& file_name, const std::function<bool(float)>& loading_progres = std::function<bool(float)>(), VertexFormat vertex_format = VertexFormat::PositionPackedNormalTangentTexture);
 	std::shared_ptr<Scene> LoadSceneFromString(const std::string& scene_string, const std::string& format);
 
 	std::shared_ptr<Scene> CreateCube(float size = 1.0, bool reverse_winding = false);
@@ -112,7 +148,16 @@ public:
 	void ClearTexture(const std::shared_ptr<Texture>& texture, const float clear_color[4]);
 	void ClearDepthStencilTexture(const std::shared_ptr<Texture>& texture, D3D12_CLEAR_FLAGS clear_flags, float depth = 1.0f, uint8_t stencil = 0);
 
+	// Copy lists only collect the textures, the command queue generates the mips of all copy lists
+	// of one submission in a single compute list. Other lists record the work right away.
 	void GenerateMips(const std::shared_ptr<Texture>& texture);
+	void GenerateMips(const std::vector<std::shared_ptr<Texture>>& textures);
+
+	static GenerateMipsStatistics GetGenerateMipsStatistics();
+	static void LogGenerateMipsStatistics();
+
+	static DDSStatistics GetDDSStatistics();
+	static void LogDDSStatistics();
 
 	void PanoToCubemap(const std::shared_ptr<Texture>& cubemap_texture, const std::shared_ptr<Texture>& pano_texture);
 
@@ -170,6 +215,15 @@ public:
 		SetGraphicsDynamicStructuredBuffer(slot, buffer_data.size(), sizeof(T), buffer_data.data());
 	}
 
+	D3D12_GPU_VIRTUAL_ADDRESS CopyDynamicStructuredBuffer(size_t num_elements, size_t element_size, const void* buffer_data);
+
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS CopyDynamicStructuredBuffer(const std::vector<T>& buffer_data) {
+		return CopyDynamicStructuredBuffer(buffer_data.size(), sizeof(T), buffer_data.data());
+	}
+
+	void SetGraphicsRootShaderResourceView(uint32_t root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS buffer_location);
+
 	void SetViewport(const D3D12_VIEWPORT& viewport);
 	void SetViewports(const std::vector<D3D12_VIEWPORT>& viewports);
 
@@ -212,6 +266,8 @@ protected:
 	void SetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE heap_type, ID3D12DescriptorHeap* heap);
 
 	std::shared_ptr<CommandList> GetGenerateMipsCommandList() const;
+	const std::vector<std::shared_ptr<Texture>>& GetPendingMips() const;
+	static void RecordSubmittedMips(size_t merged_command_lists);
 
 private:
 	using VertexCollection = std::vector<VertexPositionNormalTangentBitangentTexture>;
@@ -228,7 +284,28 @@ private:
 	void TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object);
 	void TrackResource(const std::shared_ptr<Resource>& res);
 
-	void GenerateMips_UAV(const std::shared_ptr<Texture>& texture, bool is_sRGB);
+	struct MipGenerationJob {
+		Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+		Microsoft::WRL::ComPtr<ID3D12Resource> AliasResource;
+		std::shared_ptr<Texture> UAVTexture;
+		std::shared_ptr<ShaderResourceView> SRV;
+		bool IsSRGB;
+		uint32_t SrcMip;
+		uint32_t MipLevels;
+	};
+
+	// Begin copies textures without UAV support to a UAV compatible alias, End copies the result back.
+	bool BeginGenerateMips(const std::shared_ptr<Texture>& texture, MipGenerationJob& job);
+	void EndGenerateMips(const MipGenerationJob& job);
+
+	// Records the dispatch for the next (up to) four mips of the job.
+	void GenerateMips_UAV(MipGenerationJob& job);
+
+	// Creates the texture and records its upload, the texture cache makes sure this runs once per file and color space.
+	std::shared_ptr<Texture> CreateTextureFromImage(const std::wstring& file_name, const DirectX::ScratchImage& scratch_image);
+
+	// Creates the texture for a mapped DDS file, copying every subresource once from the mapping into upload memory.
+	std::shared_ptr<Texture> CreateTextureFromDDS(const std::wstring& file_name, bool sRGB, TextureCooker::Usage usage, const DDSFile& dds_file);
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> CopyBuffer(size_t buffer_size, const void* buffer_data, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
@@ -236,10 +313,12 @@ private:
 
 	Device& m_device;
 	D3D12_COMMAND_LIST_TYPE m_d3d12_command_list_type;
+	uint64_t m_recording_index;
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_d3d12_command_list;
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> m_d3d12_command_allocator;
 
 	std::shared_ptr<CommandList> m_compute_command_list;
+	std::vector<std::shared_ptr<Texture>> m_pending_mips;
 
 	ID3D12RootSignature* m_root_signature;
 	ID3D12PipelineState* m_pipeline_state;
@@ -256,9 +335,6 @@ private:
 	using TrackedObjects = std::vector<Microsoft::WRL::ComPtr<ID3D12Object>>;
 
 	TrackedObjects m_tracked_objects;
-
-	static std::map<std::wstring, ID3D12Resource*> ms_texture_cache;
-	static std::mutex ms_texture_cache_mutex;
 };
 
 inline DirectX::XMVECTOR CommandList::GetCircleVector(size_t i, size_t tessellation) noexcept {
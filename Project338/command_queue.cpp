@@ -119,7 +119,10 @@ uint64_t CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<Com
     to_be_queued.reserve(command_lists.size() * 2u);
 
     std::vector<std::shared_ptr<CommandList>> generate_mips_command_lists;
-    generate_mips_command_lists.reserve(command_lists.size());
+    generate_mips_command_lists.reserve(command_lists.size() + 1u);
+
+    std::vector<std::shared_ptr<Texture>> mip_textures;
+    size_t mip_command_list_count = 0u;
 
     std::vector<ID3D12CommandList*> d3d12_command_lists;
     d3d12_command_lists.reserve(command_lists.size() * 2u);
@@ -141,6 +144,12 @@ uint64_t CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<Com
         if (generate_mips_command_list) {
             generate_mips_command_lists.push_back(generate_mips_command_list);
         }
+
+        const auto& pending_mips = command_list->GetPendingMips();
+        if (!pending_mips.empty()) {
+            mip_textures.insert(mip_textures.end(), pending_mips.begin(), pending_mips.end());
+            ++mip_command_list_count;
+        }
     }
 
     UINT num_command_lists = static_cast<UINT>(d3d12_command_lists.size());
@@ -153,6 +162,15 @@ uint64_t CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<Com
         m_in_flight_command_lists.Push({ fence_value, command_list });
     }
 
+    // The mips of every copy list go into one compute list, so there is one dispatch sequence
+    // and one wait on this queue no matter how many lists loaded textures.
+    if (!mip_textures.empty()) {
+        auto mips_command_list = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE).GetCommandList();
+        mips_command_list->GenerateMips(mip_textures);
+        generate_mips_command_lists.push_back(mips_command_list);
+        CommandList::RecordSubmittedMips(mip_command_list_count);
+    }
+
     if (generate_mips_command_lists.size() > 0) {
         auto& computeQueue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
         computeQueue.Wait(*this);
@@ -0,0 +1,264 @@
+#include "cooked_scene.h"
+
+#include "mapped_file.h"
+#include "texture.h"
+#include "utils.h"
+
+#include <fstream>
+
+namespace CookedScene {
+	inline uint64_t AlignOffset(uint64_t offset) {
+		return (offset + Alignment - 1u) & ~static_cast<uint64_t>(Alignment - 1u);
+	}
+
+	inline bool IsRangeValid(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size) {
+		if (offset % Alignment != 0u || offset > file_size) {
+			return false;
+		}
+		return count <= (file_size - offset) / element_size;
+	}
+
+	const char* View::GetString(uint32_t offset) const {
+		return offset < pHeader->StringsSize ? pStrings + offset : "";
+	}
+
+	bool Parse(const MappedFile& file, View& view) {
+		if (!file.IsOpen() || file.GetSize() < sizeof(Header)) {
+			return false;
+		}
+
+		const uint8_t* data = file.GetData();
+		const Header& header = *reinterpret_cast<const Header*>(data);
+		const uint64_t file_size = file.GetSize();
+
+		if (header.Magic != Magic || header.Version != Version || header.FileSize != file_size) {
+			return false;
+		}
+		if (header.VertexFormat >= static_cast<uint32_t>(VertexFormat::NumVertexFormats)) {
+			return false;
+		}
+
+		if (!IsRangeValid(header.MaterialsOffset, header.MaterialCount, sizeof(MaterialRecord), file_size) ||
+			!IsRangeValid(header.MeshesOffset, header.MeshCount, sizeof(MeshRecord), file_size) ||
+			!IsRangeValid(header.LODsOffset, header.LODCount, sizeof(Mesh::LOD), file_size) ||
+			!IsRangeValid(header.MeshletsOffset, header.MeshletCount, sizeof(MeshOptimizer::Meshlet), file_size) ||
+			!IsRangeValid(header.NodesOffset, header.NodeCount, sizeof(NodeRecord), file_size) ||
+			!IsRangeValid(header.NodeMeshesOffset, header.NodeMeshCount, sizeof(uint32_t), file_size) ||
+			!IsRangeValid(header.StringsOffset, header.StringsSize, 1u, file_size) ||
+			!IsRangeValid(header.DataOffset, 0u, 1u, file_size)) {
+			return false;
+		}
+
+		view.pHeader = &header;
+		view.pMaterials = reinterpret_cast<const MaterialRecord*>(data + header.MaterialsOffset);
+		view.pMeshes = reinterpret_cast<const MeshRecord*>(data + header.MeshesOffset);
+		view.pLODs = reinterpret_cast<const Mesh::LOD*>(data + header.LODsOffset);
+		view.pMeshlets = reinterpret_cast<const MeshOptimizer::Meshlet*>(data + header.MeshletsOffset);
+		view.pNodes = reinterpret_cast<const NodeRecord*>(data + header.NodesOffset);
+		view.pNodeMeshes = reinterpret_cast<const uint32_t*>(data + header.NodeMeshesOffset);
+		view.pStrings = reinterpret_cast<const char*>(data + header.StringsOffset);
+		view.pData = data + header.DataOffset;
+
+		// Every string is terminated, so a terminated table keeps all lookups inside the file.
+		if (header.StringsSize > 0u && view.pStrings[header.StringsSize - 1u] != '\0') {
+			return false;
+		}
+
+		const uint64_t data_size = file_size - header.DataOffset;
+		const uint64_t vertex_stride = GetVertexStride(static_cast<VertexFormat>(header.VertexFormat));
+		for (uint32_t i = 0u; i < header.MeshCount; ++i) {
+			const MeshRecord& mesh = view.pMeshes[i];
+			if (mesh.IndexFormat != DXGI_FORMAT_R16_UINT && mesh.IndexFormat != DXGI_FORMAT_R32_UINT) {
+				return false;
+			}
+
+			uint64_t index_size = mesh.IndexFormat == DXGI_FORMAT_R16_UINT ? 2u : 4u;
+			if (mesh.MaterialIndex >= header.MaterialCount || mesh.VertexStride != vertex_stride ||
+				static_cast<uint64_t>(mesh.FirstLOD) + mesh.LODCount > header.LODCount ||
+				static_cast<uint64_t>(mesh.FirstMeshlet) + mesh.MeshletCount > header.MeshletCount ||
+				mesh.VertexDataOffset > data_size || static_cast<uint64_t>(mesh.VertexCount) * mesh.VertexStride > data_size - mesh.VertexDataOffset ||
+				mesh.IndexDataOffset > data_size || mesh.IndexCount * index_size > data_size - mesh.IndexDataOffset) {
+				return false;
+			}
+
+			// Levels of detail and meshlets are drawn as ranges of the index buffer.
+			for (uint32_t j = 0u; j < mesh.LODCount; ++j) {
+				const Mesh::LOD& lod = view.pLODs[mesh.FirstLOD + j];
+				if (static_cast<uint64_t>(lod.StartIndex) + lod.IndexCount > mesh.IndexCount) {
+					return false;
+				}
+			}
+			for (uint32_t j = 0u; j < mesh.MeshletCount; ++j) {
+				const MeshOptimizer::Meshlet& meshlet = view.pMeshlets[mesh.FirstMeshlet + j];
+				if (static_cast<uint64_t>(meshlet.StartIndex) + meshlet.IndexCount > mesh.IndexCount) {
+					return false;
+				}
+			}
+		}
+
+		for (uint32_t i = 0u; i < header.NodeCount; ++i) {
+			const NodeRecord& node = view.pNodes[i];
+			if ((i == 0u) != (node.ParentIndex == InvalidIndex) || (node.ParentIndex != InvalidIndex && node.ParentIndex >= i) ||
+				static_cast<uint64_t>(node.FirstMesh) + node.MeshCount > header.NodeMeshCount) {
+				return false;
+			}
+		}
+
+		for (uint32_t i = 0u; i < header.NodeMeshCount; ++i) {
+			if (view.pNodeMeshes[i] >= header.MeshCount) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	Writer::Writer(VertexFormat vertex_format, const std::filesystem::path& parent_path) : m_vertex_format(vertex_format), m_parent_path(parent_path) {}
+
+	void Writer::AddMaterial(const Material& material) {
+		MaterialRecord record = {};
+		record.Properties = material.GetMaterialProperties();
+		record.SRGBTextureMask = 0u;
+
+		for (size_t i = 0u; i < TextureTypeCount; ++i) {
+			record.TextureNames[i] = InvalidIndex;
+
+			std::shared_ptr<Texture> texture = material.GetTexture(static_cast<Material::TextureType>(i));
+			if (!texture || texture->GetName().empty()) {
+				continue;
+			}
+
+			// Relative names keep the cooked scene valid when the asset folder moves.
+			std::filesystem::path texture_path = texture->GetName();
+			std::filesystem::path relative_path = texture_path.lexically_relative(m_parent_path);
+			record.TextureNames[i] = AddString(ConvertString(relative_path.empty() ? texture_path.wstring() : relative_path.wstring()));
+
+			if (Texture::IsSRGBFormat(texture->GetD3D12ResourceDesc().Format)) {
+				record.SRGBTextureMask |= 1u << i;
+			}
+		}
+
+		m_materials.push_back(record);
+	}
+
+	void Writer::AddMesh(const Mesh& mesh, uint32_t material_index, const void* vertex_data, size_t vertex_count, size_t vertex_stride, const void* index_data, size_t index_count, DXGI_FORMAT index_format) {
+		MeshRecord record = {};
+		record.MaterialIndex = material_index;
+		record.VertexCount = static_cast<uint32_t>(vertex_count);
+		record.VertexStride = static_cast<uint32_t>(vertex_stride);
+		record.IndexCount = static_cast<uint32_t>(index_count);
+		record.IndexFormat = static_cast<uint32_t>(index_format);
+
+		const std::vector<Mesh::LOD>& lods = mesh.GetLODs();
+		record.FirstLOD = static_cast<uint32_t>(m_lods.size());
+		record.LODCount = static_cast<uint32_t>(lods.size());
+		m_lods.insert(m_lods.end(), lods.cbegin(), lods.cend());
+
+		const std::vector<MeshOptimizer::Meshlet>& meshlets = mesh.GetMeshlets();
+		record.FirstMeshlet = static_cast<uint32_t>(m_meshlets.size());
+		record.MeshletCount = static_cast<uint32_t>(meshlets.size());
+		m_meshlets.insert(m_meshlets.end(), meshlets.cbegin(), meshlets.cend());
+
+		record.AABBCenter = mesh.GetAABB().Center;
+		record.AABBExtents = mesh.GetAABB().Extents;
+		record.PositionScale = mesh.GetPositionScale();
+		record.PositionOffset = mesh.GetPositionOffset();
+
+		size_t index_size = index_format == DXGI_FORMAT_R16_UINT ? 2u : 4u;
+		record.VertexDataOffset = AddData(vertex_data, vertex_count * vertex_stride);
+		record.IndexDataOffset = AddData(index_data, index_count * index_size);
+
+		m_meshes.push_back(record);
+	}
+
+	uint32_t Writer::AddNode(const std::string& name, uint32_t parent_index, DirectX::FXMMATRIX local_transform, const std::vector<uint32_t>& mesh_indices) {
+		NodeRecord record = {};
+		DirectX::XMStoreFloat4x4(&record.LocalTransform, local_transform);
+		record.NameOffset = AddString(name);
+		record.ParentIndex = parent_index;
+		record.FirstMesh = static_cast<uint32_t>(m_node_meshes.size());
+		record.MeshCount = static_cast<uint32_t>(mesh_indices.size());
+		m_node_meshes.insert(m_node_meshes.end(), mesh_indices.cbegin(), mesh_indices.cend());
+
+		m_nodes.push_back(record);
+
+		return static_cast<uint32_t>(m_nodes.size() - 1u);
+	}
+
+	uint32_t Writer::AddString(const std::string& string) {
+		uint32_t offset = static_cast<uint32_t>(m_strings.size());
+		m_strings.insert(m_strings.end(), string.cbegin(), string.cend());
+		m_strings.push_back('\0');
+
+		return offset;
+	}
+
+	uint64_t Writer::AddData(const void* data, size_t size) {
+		uint64_t offset = AlignOffset(m_data.size());
+		m_data.resize(static_cast<size_t>(offset), 0u);
+		if (size > 0u) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			m_data.insert(m_data.end(), bytes, bytes + size);
+		}
+
+		return offset;
+	}
+
+	bool Writer::Write(const std::filesystem::path& file_name) const {
+		Header header = {};
+		header.Magic = Magic;
+		header.Version = Version;
+		header.VertexFormat = static_cast<uint32_t>(m_vertex_format);
+		header.MaterialCount = static_cast<uint32_t>(m_materials.size());
+		header.MeshCount = static_cast<uint32_t>(m_meshes.size());
+		header.LODCount = static_cast<uint32_t>(m_lods.size());
+		header.MeshletCount = static_cast<uint32_t>(m_meshlets.size());
+		header.NodeCount = static_cast<uint32_t>(m_nodes.size());
+		header.NodeMeshCount = static_cast<uint32_t>(m_node_meshes.size());
+		header.StringsSize = static_cast<uint32_t>(m_strings.size());
+
+		uint64_t offset = AlignOffset(sizeof(Header));
+		header.MaterialsOffset = offset;
+		offset = AlignOffset(offset + m_materials.size() * sizeof(MaterialRecord));
+		header.MeshesOffset = offset;
+		offset = AlignOffset(offset + m_meshes.size() * sizeof(MeshRecord));
+		header.LODsOffset = offset;
+		offset = AlignOffset(offset + m_lods.size() * sizeof(Mesh::LOD));
+		header.MeshletsOffset = offset;
+		offset = AlignOffset(offset + m_meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+		header.NodesOffset = offset;
+		offset = AlignOffset(offset + m_nodes.size() * sizeof(NodeRecord));
+		header.NodeMeshesOffset = offset;
+		offset = AlignOffset(offset + m_node_meshes.size() * sizeof(uint32_t));
+		header.StringsOffset = offset;
+		offset = AlignOffset(offset + m_strings.size());
+		header.DataOffset = offset;
+		header.FileSize = offset + m_data.size();
+
+		std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		auto write_section = [&file](uint64_t section_offset, const void* data, size_t size) {
+			static const char padding[Alignment] = {};
+			uint64_t position = static_cast<uint64_t>(file.tellp());
+			file.write(padding, static_cast<std::streamsize>(section_offset - position));
+			if (size > 0u) {
+				file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			}
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		write_section(header.MaterialsOffset, m_materials.data(), m_materials.size() * sizeof(MaterialRecord));
+		write_section(header.MeshesOffset, m_meshes.data(), m_meshes.size() * sizeof(MeshRecord));
+		write_section(header.LODsOffset, m_lods.data(), m_lods.size() * sizeof(Mesh::LOD));
+		write_section(header.MeshletsOffset, m_meshlets.data(), m_meshlets.size() * sizeof(MeshOptimizer::Meshlet));
+		write_section(header.NodesOffset, m_nodes.data(), m_nodes.size() * sizeof(NodeRecord));
+		write_section(header.NodeMeshesOffset, m_node_meshes.data(), m_node_meshes.size() * sizeof(uint32_t));
+		write_section(header.StringsOffset, m_strings.data(), m_strings.size());
+		write_section(header.DataOffset, m_data.data(), m_data.size());
+
+		return static_cast<bool>(file);
+	}
+}
\ No newline at end of file
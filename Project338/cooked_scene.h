@@ -0,0 +1,133 @@
+#pragma once
+
+#include "material.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "vertex_types.h"
+
+#include <DirectXMath.h>
+#include <dxgiformat.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// Engine native scene file written after an import. The tables are plain structures at
+// fixed offsets and the vertex and index blobs are stored in the final GPU layout, so a
+// loader maps the file and hands the blobs to the upload path without converting them.
+namespace CookedScene {
+	constexpr uint32_t Magic = 0x4E435343u; // "CSCN"
+	constexpr uint32_t Version = 2u;
+	constexpr uint32_t InvalidIndex = ~0u;
+	constexpr size_t Alignment = 16u;
+	constexpr size_t TextureTypeCount = static_cast<size_t>(Material::TextureType::NumTypes);
+
+	struct Header {
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t VertexFormat;
+		uint32_t MaterialCount;
+		uint32_t MeshCount;
+		uint32_t LODCount;
+		uint32_t MeshletCount;
+		uint32_t NodeCount;
+		uint32_t NodeMeshCount;
+		uint32_t StringsSize;
+		uint64_t MaterialsOffset;
+		uint64_t MeshesOffset;
+		uint64_t LODsOffset;
+		uint64_t MeshletsOffset;
+		uint64_t NodesOffset;
+		uint64_t NodeMeshesOffset;
+		uint64_t StringsOffset;
+		uint64_t DataOffset;
+		uint64_t FileSize;
+	};
+
+	// Texture names are offsets into the string table relative to the scene folder,
+	// InvalidIndex marks an unused slot.
+	struct MaterialRecord {
+		MaterialProperties Properties;
+		uint32_t TextureNames[TextureTypeCount];
+		uint32_t SRGBTextureMask;
+	};
+
+	// Blob offsets are relative to Header::DataOffset.
+	struct MeshRecord {
+		uint32_t MaterialIndex;
+		uint32_t VertexCount;
+		uint32_t VertexStride;
+		uint32_t IndexCount;
+		uint32_t IndexFormat;
+		uint32_t FirstLOD;
+		uint32_t LODCount;
+		uint32_t FirstMeshlet;
+		uint32_t MeshletCount;
+		DirectX::XMFLOAT3 AABBCenter;
+		DirectX::XMFLOAT3 AABBExtents;
+		DirectX::XMFLOAT3 PositionScale;
+		DirectX::XMFLOAT3 PositionOffset;
+		uint64_t VertexDataOffset;
+		uint64_t IndexDataOffset;
+	};
+
+	// Nodes are stored depth first, so a parent always precedes its children.
+	struct NodeRecord {
+		DirectX::XMFLOAT4X4 LocalTransform;
+		uint32_t NameOffset;
+		uint32_t ParentIndex;
+		uint32_t FirstMesh;
+		uint32_t MeshCount;
+	};
+
+	// Typed pointers into a mapped file, only valid while the file stays mapped.
+	struct View {
+		const Header* pHeader;
+		const MaterialRecord* pMaterials;
+		const MeshRecord* pMeshes;
+		const Mesh::LOD* pLODs;
+		const MeshOptimizer::Meshlet* pMeshlets;
+		const NodeRecord* pNodes;
+		const uint32_t* pNodeMeshes;
+		const char* pStrings;
+		const uint8_t* pData;
+
+		const char* GetString(uint32_t offset) const;
+	};
+
+	// Checks the header, the table bounds and every blob range against the file size, the vertex
+	// strides against the vertex format and the level of detail and meshlet ranges against the
+	// index count of their mesh.
+	bool Parse(const MappedFile& file, View& view);
+
+	class Writer {
+	public:
+		Writer(VertexFormat vertex_format, const std::filesystem::path& parent_path);
+
+		void AddMaterial(const Material& material);
+		void AddMesh(const Mesh& mesh, uint32_t material_index, const void* vertex_data, size_t vertex_count, size_t vertex_stride, const void* index_data, size_t index_count, DXGI_FORMAT index_format);
+		uint32_t AddNode(const std::string& name, uint32_t parent_index, DirectX::FXMMATRIX local_transform, const std::vector<uint32_t>& mesh_indices);
+
+		// Cooked scenes live in the derived data cache, which renames the file into place only after a successful write.
+		bool Write(const std::filesystem::path& file_name) const;
+
+	private:
+		uint32_t AddString(const std::string& string);
+		uint64_t AddData(const void* data, size_t size);
+
+		VertexFormat m_vertex_format;
+		std::filesystem::path m_parent_path;
+
+		std::vector<MaterialRecord> m_materials;
+		std::vector<MeshRecord> m_meshes;
+		std::vector<Mesh::LOD> m_lods;
+		std::vector<MeshOptimizer::Meshlet> m_meshlets;
+		std::vector<NodeRecord> m_nodes;
+		std::vector<uint32_t> m_node_meshes;
+		std::vector<char> m_strings;
+		std::vector<uint8_t> m_data;
+	};
+}
\ No newline at end of file
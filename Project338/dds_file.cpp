@@ -0,0 +1,275 @@
+#include "dds_file.h"
+
+#include "asset_archive.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <DirectXTex/DirectXTex.h>
+
+constexpr uint32_t DDS_magic = 0x20534444u; // "DDS "
+
+constexpr uint32_t DDS_pixel_format_alpha_pixels = 0x1u;
+constexpr uint32_t DDS_pixel_format_fourcc = 0x4u;
+constexpr uint32_t DDS_pixel_format_rgb = 0x40u;
+constexpr uint32_t DDS_caps2_cube_map = 0x200u;
+constexpr uint32_t DDS_caps2_volume = 0x200000u;
+constexpr uint32_t DDS_misc_texture_cube = 0x4u;
+constexpr uint32_t DDS_dimension_texture1D = 2u;
+constexpr uint32_t DDS_dimension_texture2D = 3u;
+
+struct DDSPixelFormat {
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t FourCC;
+	uint32_t RGBBitCount;
+	uint32_t RBitMask;
+	uint32_t GBitMask;
+	uint32_t BBitMask;
+	uint32_t ABitMask;
+};
+
+struct DDSHeader {
+	uint32_t Size;
+	uint32_t Flags;
+	uint32_t Height;
+	uint32_t Width;
+	uint32_t PitchOrLinearSize;
+	uint32_t Depth;
+	uint32_t MipMapCount;
+	uint32_t Reserved1[11];
+	DDSPixelFormat PixelFormat;
+	uint32_t Caps;
+	uint32_t Caps2;
+	uint32_t Caps3;
+	uint32_t Caps4;
+	uint32_t Reserved2;
+};
+
+struct DDSHeaderDX10 {
+	uint32_t Format;
+	uint32_t ResourceDimension;
+	uint32_t MiscFlag;
+	uint32_t ArraySize;
+	uint32_t MiscFlags2;
+};
+
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+	return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+inline DXGI_FORMAT GetLegacyFormat(const DDSPixelFormat& pixel_format) {
+	if (pixel_format.Flags & DDS_pixel_format_fourcc) {
+		switch (pixel_format.FourCC) {
+			case MakeFourCC('D', 'X', 'T', '1'):
+				return DXGI_FORMAT_BC1_UNORM;
+			case MakeFourCC('D', 'X', 'T', '2'):
+			case MakeFourCC('D', 'X', 'T', '3'):
+				return DXGI_FORMAT_BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '4'):
+			case MakeFourCC('D', 'X', 'T', '5'):
+				return DXGI_FORMAT_BC3_UNORM;
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'):
+				return DXGI_FORMAT_BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'S'):
+				return DXGI_FORMAT_BC4_SNORM;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'):
+				return DXGI_FORMAT_BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'S'):
+				return DXGI_FORMAT_BC5_SNORM;
+			case 36u:
+				return DXGI_FORMAT_R16G16B16A16_UNORM;
+			case 113u:
+				return DXGI_FORMAT_R16G16B16A16_FLOAT;
+			case 116u:
+				return DXGI_FORMAT_R32G32B32A32_FLOAT;
+			default:
+				return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	if ((pixel_format.Flags & DDS_pixel_format_rgb) && pixel_format.RGBBitCount == 32u) {
+		bool has_alpha = (pixel_format.Flags & DDS_pixel_format_alpha_pixels) && pixel_format.ABitMask == 0xFF000000u;
+		if (pixel_format.RBitMask == 0x000000FFu && pixel_format.GBitMask == 0x0000FF00u && pixel_format.BBitMask == 0x00FF0000u) {
+			return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+		if (pixel_format.RBitMask == 0x00FF0000u && pixel_format.GBitMask == 0x0000FF00u && pixel_format.BBitMask == 0x000000FFu) {
+			return has_alpha ? DXGI_FORMAT_B8G8R8A8_UNORM : DXGI_FORMAT_B8G8R8X8_UNORM;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+DDSFile::DDSFile() : m_data(nullptr), m_size(0u), m_format(DXGI_FORMAT_UNKNOWN), m_width(0u), m_height(0u), m_array_size(0u), m_mip_levels(0u), m_is_cube_map(false), m_is_1D(false) {}
+
+bool DDSFile::Open(const std::wstring& file_name) {
+	Close();
+
+	// Entries stored in a mounted archive point into its mapping, compressed ones are extracted once.
+	IOService::Buffer buffer;
+	if (AssetArchive::ReadFile(file_name, buffer)) {
+		m_storage = buffer.Storage;
+		m_data = buffer.pData;
+		m_size = buffer.Size;
+	}
+	else if (m_file.Open(file_name)) {
+		m_data = m_file.GetData();
+		m_size = m_file.GetSize();
+	}
+
+	if (!m_data || !Parse()) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void DDSFile::Close() {
+	m_file.Close();
+	m_storage.reset();
+	m_data = nullptr;
+	m_size = 0u;
+	m_subresources.clear();
+	m_format = DXGI_FORMAT_UNKNOWN;
+	m_width = 0u;
+	m_height = 0u;
+	m_array_size = 0u;
+	m_mip_levels = 0u;
+	m_is_cube_map = false;
+	m_is_1D = false;
+}
+
+bool DDSFile::IsOpen() const {
+	return m_data && !m_subresources.empty();
+}
+
+bool DDSFile::Parse() {
+	const uint8_t* data = m_data;
+	const size_t size = m_size;
+
+	uint32_t magic = 0u;
+	DDSHeader header = {};
+	if (size < sizeof(magic) + sizeof(header)) {
+		return false;
+	}
+	std::memcpy(&magic, data, sizeof(magic));
+	std::memcpy(&header, data + sizeof(magic), sizeof(header));
+	if (magic != DDS_magic || header.Size != sizeof(DDSHeader) || header.PixelFormat.Size != sizeof(DDSPixelFormat)) {
+		return false;
+	}
+
+	size_t offset = sizeof(magic) + sizeof(header);
+	m_width = header.Width;
+	m_height = header.Height;
+	m_mip_levels = header.MipMapCount > 0u ? header.MipMapCount : 1u;
+	m_array_size = 1u;
+
+	if ((header.PixelFormat.Flags & DDS_pixel_format_fourcc) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0')) {
+		DDSHeaderDX10 header_dx10 = {};
+		if (size < offset + sizeof(header_dx10)) {
+			return false;
+		}
+		std::memcpy(&header_dx10, data + offset, sizeof(header_dx10));
+		offset += sizeof(header_dx10);
+
+		if (header_dx10.ResourceDimension != DDS_dimension_texture1D && header_dx10.ResourceDimension != DDS_dimension_texture2D) {
+			return false;
+		}
+
+		m_format = static_cast<DXGI_FORMAT>(header_dx10.Format);
+		m_is_1D = header_dx10.ResourceDimension == DDS_dimension_texture1D;
+		m_is_cube_map = (header_dx10.MiscFlag & DDS_misc_texture_cube) != 0u;
+		m_array_size = std::max(header_dx10.ArraySize, 1u) * (m_is_cube_map ? 6u : 1u);
+		if (m_is_1D) {
+			m_height = 1u;
+		}
+	}
+	else {
+		// Legacy cube maps have to store all six faces.
+		if ((header.Caps2 & DDS_caps2_volume) || ((header.Caps2 & DDS_caps2_cube_map) && (header.Caps2 & 0xFC00u) != 0xFC00u)) {
+			return false;
+		}
+
+		m_format = GetLegacyFormat(header.PixelFormat);
+		m_is_cube_map = (header.Caps2 & DDS_caps2_cube_map) != 0u;
+		m_array_size = m_is_cube_map ? 6u : 1u;
+	}
+
+	if (m_format == DXGI_FORMAT_UNKNOWN || DirectX::IsPlanar(m_format) || DirectX::IsPacked(m_format) || DirectX::IsVideo(m_format) || DirectX::BitsPerPixel(m_format) == 0u) {
+		return false;
+	}
+	if (m_width == 0u || m_height == 0u || m_mip_levels > 16u) {
+		return false;
+	}
+
+	const bool is_compressed = DirectX::IsCompressed(m_format);
+	const size_t bits_per_pixel = DirectX::BitsPerPixel(m_format);
+
+	m_subresources.reserve(m_array_size * m_mip_levels);
+	for (size_t item = 0u; item < m_array_size; ++item) {
+		for (size_t mip = 0u; mip < m_mip_levels; ++mip) {
+			size_t width = std::max<size_t>(m_width >> mip, 1u);
+			size_t height = std::max<size_t>(m_height >> mip, 1u);
+
+			Subresource subresource = {};
+			if (is_compressed) {
+				// A 4x4 block takes as many bytes as 16 pixels at the format's bits per pixel.
+				subresource.RowPitch = std::max<size_t>((width + 3u) / 4u, 1u) * bits_per_pixel * 2u;
+				subresource.RowCount = std::max<size_t>((height + 3u) / 4u, 1u);
+			}
+			else {
+				subresource.RowPitch = (width * bits_per_pixel + 7u) / 8u;
+				subresource.RowCount = height;
+			}
+
+			size_t subresource_size = subresource.RowPitch * subresource.RowCount;
+			if (offset + subresource_size > size) {
+				m_subresources.clear();
+				return false;
+			}
+
+			subresource.Data = data + offset;
+			offset += subresource_size;
+			m_subresources.push_back(subresource);
+		}
+	}
+
+	return true;
+}
+
+DXGI_FORMAT DDSFile::GetFormat() const {
+	return m_format;
+}
+
+size_t DDSFile::GetWidth() const {
+	return m_width;
+}
+
+size_t DDSFile::GetHeight() const {
+	return m_height;
+}
+
+size_t DDSFile::GetArraySize() const {
+	return m_array_size;
+}
+
+size_t DDSFile::GetMipLevels() const {
+	return m_mip_levels;
+}
+
+bool DDSFile::IsCubeMap() const {
+	return m_is_cube_map;
+}
+
+bool DDSFile::Is1D() const {
+	return m_is_1D;
+}
+
+const DDSFile::Subresource& DDSFile::GetSubresource(size_t item, size_t mip) const {
+	return m_subresources[item * m_mip_levels + mip];
+}
\ No newline at end of file
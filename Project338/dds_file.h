@@ -0,0 +1,62 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <dxgiformat.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Memory mapped DDS file. Parses the header and points straight into the mapping, so
+// the upload path copies every subresource once, from the file pages into upload memory.
+// Files held by a mounted AssetArchive are served from the archive mapping instead.
+// Handles 1D and 2D textures, arrays and cube maps with DX10 headers or the legacy
+// FourCC and RGBA8 layouts DirectXTex writes. Anything else fails to open and goes
+// through DirectXTex instead.
+class DDSFile {
+public:
+	struct Subresource {
+		const uint8_t* Data;
+		size_t RowPitch;
+		size_t RowCount; // Rows of blocks for block compressed formats.
+	};
+
+	DDSFile();
+
+	bool Open(const std::wstring& file_name);
+	void Close();
+
+	bool IsOpen() const;
+
+	DXGI_FORMAT GetFormat() const;
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+	size_t GetArraySize() const; // Six faces per cube.
+	size_t GetMipLevels() const;
+	bool IsCubeMap() const;
+	bool Is1D() const;
+
+	const Subresource& GetSubresource(size_t item, size_t mip) const;
+
+private:
+	bool Parse();
+
+	// The loose file mapping, or the archive buffer holding the file.
+	MappedFile m_file;
+	std::shared_ptr<const void> m_storage;
+	const uint8_t* m_data;
+	size_t m_size;
+
+	DXGI_FORMAT m_format;
+	size_t m_width;
+	size_t m_height;
+	size_t m_array_size;
+	size_t m_mip_levels;
+	bool m_is_cube_map;
+	bool m_is_1D;
+
+	std::vector<Subresource> m_subresources;
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "derived_data_cache.h"
+
+#include "io_service.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+	constexpr uint64_t Prime1 = 11400714785074694791ull;
+	constexpr uint64_t Prime2 = 14029467366897019727ull;
+	constexpr uint64_t Prime3 = 1609587929392839161ull;
+	constexpr uint64_t Prime4 = 9650029242287828579ull;
+	constexpr uint64_t Prime5 = 2870177450012600261ull;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline uint64_t Read64(const uint8_t* data) {
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Read32(const uint8_t* data) {
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * Prime2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * Prime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t accumulator, uint64_t value) {
+		accumulator ^= Round(0u, value);
+		return accumulator * Prime1 + Prime4;
+	}
+
+	const wchar_t* TempExtension = L".tmp";
+}
+
+uint64_t DerivedDataCache::HashBytes(const void* data, size_t size, uint64_t seed) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const uint8_t* end = bytes + size;
+
+	uint64_t hash;
+	if (size >= 32u) {
+		uint64_t v1 = seed + Prime1 + Prime2;
+		uint64_t v2 = seed + Prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - Prime1;
+
+		const uint8_t* limit = end - 32u;
+		do {
+			v1 = Round(v1, Read64(bytes));
+			v2 = Round(v2, Read64(bytes + 8u));
+			v3 = Round(v3, Read64(bytes + 16u));
+			v4 = Round(v4, Read64(bytes + 24u));
+			bytes += 32u;
+		} while (bytes <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else {
+		hash = seed + Prime5;
+	}
+
+	hash += static_cast<uint64_t>(size);
+
+	for (; bytes + 8u <= end; bytes += 8u) {
+		hash ^= Round(0u, Read64(bytes));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+	}
+	if (bytes + 4u <= end) {
+		hash ^= static_cast<uint64_t>(Read32(bytes)) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		bytes += 4u;
+	}
+	for (; bytes < end; ++bytes) {
+		hash ^= static_cast<uint64_t>(*bytes) * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+DerivedDataCache::Key::Key(const std::string& kind) : m_kind(kind), m_hash(HashBytes(&EngineVersion, sizeof(EngineVersion))) {
+	Add(kind);
+}
+
+DerivedDataCache::Key& DerivedDataCache::Key::Add(const void* data, size_t size) {
+	m_hash = HashBytes(data, size, m_hash);
+	return *this;
+}
+
+DerivedDataCache::Key& DerivedDataCache::Key::Add(const std::string& string) {
+	return Add(string.data(), string.size());
+}
+
+DerivedDataCache::Key& DerivedDataCache::Key::Add(const std::wstring& string) {
+	return Add(string.data(), string.size() * sizeof(wchar_t));
+}
+
+bool DerivedDataCache::Key::AddFile(const std::filesystem::path& file_name) {
+	// Read through the I/O service, the file may live in an asset archive and its loader usually reads it next.
+	IOService::Buffer buffer = IOService::Get().ReadFile(file_name.wstring()).get();
+	if (!buffer.Storage) {
+		return false;
+	}
+	Add(buffer.pData, buffer.Size);
+
+	return true;
+}
+
+uint64_t DerivedDataCache::Key::GetHash() const {
+	return m_hash;
+}
+
+std::string DerivedDataCache::Key::ToString() const {
+	char hash[17];
+	sprintf_s(hash, "%016llx", static_cast<unsigned long long>(m_hash));
+	return std::string(hash) + "." + m_kind;
+}
+
+DerivedDataCache& DerivedDataCache::Get() {
+	static DerivedDataCache derived_data_cache(std::filesystem::current_path() / "DerivedDataCache");
+	return derived_data_cache;
+}
+
+DerivedDataCache::DerivedDataCache(const std::filesystem::path& root_path, uint64_t max_size) : m_root_path(root_path), m_max_size(max_size), m_size(0u), m_temp_counter(0u), m_statistics() {
+	std::error_code error;
+	std::filesystem::create_directories(m_root_path, error);
+
+	// Temporary files left behind by an interrupted write are never valid entries.
+	for (const auto& entry : std::filesystem::directory_iterator(m_root_path, error)) {
+		if (!entry.is_regular_file(error)) {
+			continue;
+		}
+		if (entry.path().extension() == TempExtension) {
+			std::filesystem::remove(entry.path(), error);
+		}
+		else {
+			m_size += entry.file_size(error);
+		}
+	}
+}
+
+void DerivedDataCache::SetMaxSize(uint64_t max_size) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_max_size = max_size;
+	EvictLocked(0u);
+}
+
+uint64_t DerivedDataCache::GetMaxSize() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_max_size;
+}
+
+uint64_t DerivedDataCache::GetSize() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_size;
+}
+
+std::filesystem::path DerivedDataCache::GetEntryPath(const Key& key) const {
+	return m_root_path / key.ToString();
+}
+
+std::filesystem::path DerivedDataCache::Find(const Key& key) {
+	std::filesystem::path entry_path = GetEntryPath(key);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::error_code error;
+	if (!std::filesystem::is_regular_file(entry_path, error)) {
+		++m_statistics.Misses;
+		return std::filesystem::path();
+	}
+
+	// The write time doubles as the last use time for eviction.
+	std::filesystem::last_write_time(entry_path, std::filesystem::file_time_type::clock::now(), error);
+	++m_statistics.Hits;
+
+	return entry_path;
+}
+
+bool DerivedDataCache::Store(const Key& key, const std::function<bool(const std::filesystem::path&)>& write_entry) {
+	std::filesystem::path entry_path = GetEntryPath(key);
+	std::filesystem::path temp_path;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		temp_path = entry_path;
+		temp_path += L"." + std::to_wstring(m_temp_counter++) + TempExtension;
+	}
+
+	std::error_code error;
+	if (!write_entry(temp_path)) {
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+
+	uintmax_t entry_size = std::filesystem::file_size(temp_path, error);
+	if (error) {
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uintmax_t replaced_size = 0u;
+	if (std::filesystem::is_regular_file(entry_path, error)) {
+		replaced_size = std::filesystem::file_size(entry_path, error);
+	}
+
+	std::filesystem::rename(temp_path, entry_path, error);
+	if (error) {
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+
+	m_size = m_size - std::min<uint64_t>(m_size, replaced_size) + entry_size;
+	++m_statistics.Stores;
+	m_statistics.BytesStored += entry_size;
+
+	EvictLocked(0u);
+
+	return true;
+}
+
+bool DerivedDataCache::Store(const Key& key, const void* data, size_t size) {
+	return Store(key, [data, size](const std::filesystem::path& file_name) {
+		std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		return static_cast<bool>(file);
+	});
+}
+
+bool DerivedDataCache::Remove(const Key& key) {
+	std::filesystem::path entry_path = GetEntryPath(key);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::error_code error;
+	uintmax_t entry_size = std::filesystem::file_size(entry_path, error);
+	if (error || !std::filesystem::remove(entry_path, error)) {
+		return false;
+	}
+	m_size -= std::min<uint64_t>(m_size, entry_size);
+
+	return true;
+}
+
+void DerivedDataCache::EvictLocked(uint64_t required_size) {
+	if (m_size + required_size <= m_max_size) {
+		return;
+	}
+
+	struct Entry {
+		std::filesystem::file_time_type LastUse;
+		uintmax_t Size;
+		std::filesystem::path Path;
+	};
+
+	std::error_code error;
+	std::vector<Entry> entries;
+	for (const auto& entry : std::filesystem::directory_iterator(m_root_path, error)) {
+		if (entry.is_regular_file(error) && entry.path().extension() != TempExtension) {
+			entries.push_back({ entry.last_write_time(error), entry.file_size(error), entry.path() });
+		}
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.LastUse < b.LastUse; });
+
+	// Entries that are still mapped by a loader can't be deleted and are skipped.
+	for (const Entry& entry : entries) {
+		if (m_size + required_size <= m_max_size) {
+			break;
+		}
+		if (std::filesystem::remove(entry.Path, error)) {
+			m_size -= std::min<uint64_t>(m_size, entry.Size);
+			++m_statistics.Evictions;
+			m_statistics.BytesEvicted += entry.Size;
+		}
+	}
+}
+
+DerivedDataCache::Statistics DerivedDataCache::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_statistics;
+}
+
+void DerivedDataCache::LogStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint64_t lookups = m_statistics.Hits + m_statistics.Misses;
+	char message[512];
+	sprintf_s(message, "Derived data cache: %llu hits, %llu misses (%.1f%% hit rate), %llu stores (%.2f MB), %llu evictions (%.2f MB), %.2f of %.2f MB used\n",
+		m_statistics.Hits, m_statistics.Misses, lookups > 0u ? 100.0 * m_statistics.Hits / lookups : 0.0,
+		m_statistics.Stores, m_statistics.BytesStored / (1024.0 * 1024.0),
+		m_statistics.Evictions, m_statistics.BytesEvicted / (1024.0 * 1024.0),
+		m_size / (1024.0 * 1024.0), m_max_size / (1024.0 * 1024.0));
+	OutputDebugStringA(message);
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+// Content addressed store for data derived from source assets: cooked scenes and processed
+// textures. Keys hash the source bytes together with every setting that influences the
+// result and the engine version, so a changed source or setting misses instead of returning
+// stale data. Entries are written atomically, the least recently used ones are evicted once
+// the cache grows beyond its size budget.
+class DerivedDataCache {
+public:
+	// Bump when a change in the engine invalidates all derived data.
+	static constexpr uint32_t EngineVersion = 1u;
+
+	struct Statistics {
+		uint64_t Hits;
+		uint64_t Misses;
+		uint64_t Stores;
+		uint64_t Evictions;
+		uint64_t BytesStored;
+		uint64_t BytesEvicted;
+	};
+
+	class Key {
+	public:
+		// The kind ends up as the file extension and keeps different derived data apart.
+		explicit Key(const std::string& kind);
+
+		Key& Add(const void* data, size_t size);
+		Key& Add(const std::string& string);
+		Key& Add(const std::wstring& string);
+
+		template<typename T>
+		Key& Add(const T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be hashed directly.");
+			return Add(&value, sizeof(T));
+		}
+
+		// Hashes the file contents, fails if the file can't be read.
+		bool AddFile(const std::filesystem::path& file_name);
+
+		uint64_t GetHash() const;
+		std::string ToString() const;
+
+	private:
+		std::string m_kind;
+		uint64_t m_hash;
+	};
+
+	static DerivedDataCache& Get();
+
+	explicit DerivedDataCache(const std::filesystem::path& root_path, uint64_t max_size = 1024ull * 1024ull * 1024ull);
+
+	DerivedDataCache(const DerivedDataCache& copy) = delete;
+	DerivedDataCache& operator=(const DerivedDataCache& copy) = delete;
+
+	void SetMaxSize(uint64_t max_size);
+	uint64_t GetMaxSize() const;
+	uint64_t GetSize() const;
+
+	// Returns the file of a cached entry or an empty path on a miss. A hit marks the entry
+	// as recently used, the file can be mapped directly instead of being copied.
+	std::filesystem::path Find(const Key& key);
+
+	// write_entry receives a temporary file name and returns whether it wrote the entry
+	// successfully. The file is only renamed into place after a successful write.
+	bool Store(const Key& key, const std::function<bool(const std::filesystem::path&)>& write_entry);
+	bool Store(const Key& key, const void* data, size_t size);
+
+	bool Remove(const Key& key);
+
+	Statistics GetStatistics() const;
+	void LogStatistics() const;
+
+	// xxHash64 of a byte range.
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0u);
+
+private:
+	std::filesystem::path GetEntryPath(const Key& key) const;
+	void EvictLocked(uint64_t required_size);
+
+	std::filesystem::path m_root_path;
+	uint64_t m_max_size;
+	uint64_t m_size;
+	uint64_t m_temp_counter;
+	Statistics m_statistics;
+
+	mutable std::mutex m_mutex;
+};
\ No newline at end of file
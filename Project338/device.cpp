@@ -13,6 +13,7 @@
 #include "resource_state_tracker.h"
 #include "root_signature.h"
 #include "scene.h"
+#include "scene_load_task.h"
 #include "shader_resource_view.h"
 #include "structured_buffer.h"
 #include "swap_chain.h"
@@ -32,6 +33,13 @@ public:
     virtual ~MakeGUI() {}
 };
 
+class MakeSceneLoadTask : public SceneLoadTask {
+public:
+    MakeSceneLoadTask(Device& device, const std::wstring& file_name, VertexFormat vertex_format, std::shared_ptr<TextureStreamer> texture_streamer) : SceneLoadTask(device, file_name, vertex_format, texture_streamer) {}
+
+    virtual ~MakeSceneLoadTask() {}
+};
+
 class MakeUnorderedAccessView : public UnorderedAccessView {
 public:
     MakeUnorderedAccessView(Device& device, const std::shared_ptr<Resource>& resource, const std::shared_ptr<Resource>& counter_resource, const D3D12_UNORDERED_ACCESS_VIEW_DESC* uav) : UnorderedAccessView(device, resource, counter_resource, uav) {}
@@ -281,6 +289,12 @@ std::shared_ptr<GUI> Device::CreateGUI(HWND hWnd, const RenderTarget& render_tar
     return gui;
 }
 
+std::shared_ptr<SceneLoadTask> Device::LoadSceneAsync(const std::wstring& file_name, VertexFormat vertex_format, std::shared_ptr<TextureStreamer> texture_streamer) {
+    std::shared_ptr<SceneLoadTask> scene_load_task = std::make_shared<MakeSceneLoadTask>(*this, file_name, vertex_format, texture_streamer);
+    scene_load_task->Start();
+    return scene_load_task;
+}
+
 std::shared_ptr<ConstantBuffer> Device::CreateConstantBuffer(Microsoft::WRL::ComPtr<ID3D12Resource> resource) {
     std::shared_ptr<ConstantBuffer> constant_buffer = std::make_shared<MakeConstantBuffer>(*this, resource);
     return constant_buffer;
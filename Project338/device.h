@@ -5,8 +5,10 @@
 #include <wrl/client.h>
 
 #include <memory>
+#include <string>
 
 #include "descriptor_allocation.h"
+#include "vertex_types.h"
 
 class AdapterData;
 class ByteAddressBuffer;
@@ -22,10 +24,12 @@ class RenderTarget;
 class Resource;
 class RootSignature;
 class Scene;
+class SceneLoadTask;
 class ShaderResourceView;
 class StructuredBuffer;
 class SwapChain;
 class Texture;
+class TextureStreamer;
 class UnorderedAccessView;
 class VertexBuffer;
 
@@ -64,6 +68,10 @@ public:
 	std::shared_ptr<ShaderResourceView> CreateShaderResourceView(const std::shared_ptr<Resource>& resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* srv = nullptr);
 	std::shared_ptr<UnorderedAccessView> CreateUnorderedAccessView(const std::shared_ptr<Resource>& resource, const std::shared_ptr<Resource>& counter_resource = nullptr, const D3D12_UNORDERED_ACCESS_VIEW_DESC* uav = nullptr);
 
+	// Imports the scene on a background thread and uploads it on the copy queue. With a texture
+	// streamer the scene is ready before its textures are, they are swapped in by the streamer.
+	std::shared_ptr<SceneLoadTask> LoadSceneAsync(const std::wstring& file_name, VertexFormat vertex_format = VertexFormat::PositionPackedNormalTangentTexture, std::shared_ptr<TextureStreamer> texture_streamer = nullptr);
+
 	void Flush();
 	void ReleaseStaleDescriptors();
 
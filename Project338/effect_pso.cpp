@@ -2,6 +2,7 @@
 
 #include "command_list.h"
 #include "device.h"
+#include "light_manager.h"
 #include "material.h"
 #include "pipeline_state_object.h"
 #include "root_signature.h"
@@ -12,13 +13,17 @@
 #include <d3dx12.h>
 #include <wrl/client.h>
 
-EffectPSO::EffectPSO(std::shared_ptr<Device> device, bool enable_lighting, bool enable_decal) : m_device(device), m_dirty_flags(DF_All), m_pPrevious_command_list(nullptr), m_enable_lighting(enable_lighting), m_enable_decal(enable_decal) {
+EffectPSO::EffectPSO(std::shared_ptr<Device> device, bool enable_lighting, bool enable_decal) : m_device(device), m_vertex_format(VertexFormat::PositionNormalTangentBitangentTexture), m_position_scale(1.0f, 1.0f, 1.0f), m_position_offset(0.0f, 0.0f, 0.0f), m_dirty_flags(DF_All), m_pPrevious_command_list(nullptr), m_enable_lighting(enable_lighting), m_enable_decal(enable_decal) {
     m_pAligned_mvp = (MVP*)_aligned_malloc(sizeof(MVP), 16);
 
-    Microsoft::WRL::ComPtr<ID3DBlob> vertex_shader_blob;
-    HRESULT hr = D3DReadFileToBlob(L"Basic_VS.cso", vertex_shader_blob.GetAddressOf());
-    ThrowIfFailed(hr);
+    static const wchar_t* Vertex_shader_files[] = {
+        L"Basic_VS.cso",
+        L"Compact_VS.cso",
+        L"CompactQuantized_VS.cso"
+    };
+    static_assert(_countof(Vertex_shader_files) == static_cast<size_t>(VertexFormat::NumVertexFormats), "Every vertex format needs a vertex shader");
 
+    HRESULT hr;
     Microsoft::WRL::ComPtr<ID3DBlob> pixel_shader_blob;
     if (enable_lighting)
         if (enable_decal) hr = D3DReadFileToBlob(L"Decal_PS.cso", pixel_shader_blob.GetAddressOf());
@@ -77,16 +82,23 @@ EffectPSO::EffectPSO(std::shared_ptr<Device> device, bool enable_lighting, bool
     }
 
     pipeline_state_stream.pRootSignature = m_root_signature->GetD3D12RootSignature().Get();
-    pipeline_state_stream.VS = CD3DX12_SHADER_BYTECODE(vertex_shader_blob.Get());
     pipeline_state_stream.PS = CD3DX12_SHADER_BYTECODE(pixel_shader_blob.Get());
     pipeline_state_stream.RasterizerState = rasterizer_state;
-    pipeline_state_stream.InputLayout = VertexPositionNormalTangentBitangentTexture::InputLayout;
     pipeline_state_stream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     pipeline_state_stream.DSVFormat = depth_buffer_format;
     pipeline_state_stream.RTVFormats = rtv_formats;
     pipeline_state_stream.SampleDesc = sample_desc;
 
-    m_pipeline_state_object = m_device->CreatePipelineStateObject(pipeline_state_stream);
+    for (size_t i = 0u; i < static_cast<size_t>(VertexFormat::NumVertexFormats); ++i) {
+        Microsoft::WRL::ComPtr<ID3DBlob> vertex_shader_blob;
+        hr = D3DReadFileToBlob(Vertex_shader_files[i], vertex_shader_blob.GetAddressOf());
+        ThrowIfFailed(hr);
+
+        pipeline_state_stream.VS = CD3DX12_SHADER_BYTECODE(vertex_shader_blob.Get());
+        pipeline_state_stream.InputLayout = GetInputLayout(static_cast<VertexFormat>(i));
+
+        m_pipeline_state_objects[i] = m_device->CreatePipelineStateObject(pipeline_state_stream);
+    }
 
     D3D12_SHADER_RESOURCE_VIEW_DESC default_srv;
     default_srv.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -111,7 +123,7 @@ inline void EffectPSO::BindTexture(CommandList& command_list, uint32_t offset, c
 }
 
 void EffectPSO::Apply(CommandList& command_list) {
-    command_list.SetPipelineState(m_pipeline_state_object);
+    command_list.SetPipelineState(m_pipeline_state_objects[static_cast<size_t>(m_vertex_format)]);
     command_list.SetGraphicsRootSignature(m_root_signature);
 
     if (m_dirty_flags & DF_Matrices) {
@@ -120,6 +132,8 @@ void EffectPSO::Apply(CommandList& command_list) {
         m.ModelViewMatrix = m_pAligned_mvp->World * m_pAligned_mvp->View;
         m.ModelViewProjectionMatrix = m.ModelViewMatrix * m_pAligned_mvp->Projection;
         m.InverseTransposeModelViewMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, m.ModelViewMatrix));
+        m.PositionScale = DirectX::XMFLOAT4(m_position_scale.x, m_position_scale.y, m_position_scale.z, 0.0f);
+        m.PositionOffset = DirectX::XMFLOAT4(m_position_offset.x, m_position_offset.y, m_position_offset.z, 0.0f);
 
         command_list.SetGraphicsDynamicConstantBuffer(RootParameters::MatricesCB, m);
     }
@@ -143,56 +157,35 @@ void EffectPSO::Apply(CommandList& command_list) {
         }
     }
 
-    if (m_dirty_flags & DF_PointLights) {
-        command_list.SetGraphicsDynamicStructuredBuffer(RootParameters::PointLights, m_point_lights);
-    }
+    // The light arrays live once per frame in the light manager, binding them is only
+    // a matter of pointing the root SRVs at the shared upload memory.
+    LightProperties light_props = {};
+    if (m_light_manager) {
+        if (!m_light_manager->IsUploaded(command_list)) {
+            m_light_manager->Upload(command_list);
+        }
 
-    if (m_dirty_flags & DF_SpotLights) {
-        command_list.SetGraphicsDynamicStructuredBuffer(RootParameters::SpotLights, m_spot_lights);
-    }
+        command_list.SetGraphicsRootShaderResourceView(RootParameters::PointLights, m_light_manager->GetPointLightsLocation());
+        command_list.SetGraphicsRootShaderResourceView(RootParameters::SpotLights, m_light_manager->GetSpotLightsLocation());
+        command_list.SetGraphicsRootShaderResourceView(RootParameters::DirectionalLights, m_light_manager->GetDirectionalLightsLocation());
 
-    if (m_dirty_flags & DF_DirectionalLights) {
-        command_list.SetGraphicsDynamicStructuredBuffer(RootParameters::DirectionalLights, m_directional_lights);
+        light_props.NumPointLights = m_light_manager->GetNumPointLights();
+        light_props.NumSpotLights = m_light_manager->GetNumSpotLights();
+        light_props.NumDirectionalLights = m_light_manager->GetNumDirectionalLights();
     }
 
-    if (m_dirty_flags & (DF_PointLights | DF_SpotLights | DF_DirectionalLights)) {
-        LightProperties light_props;
-        light_props.NumPointLights = static_cast<uint32_t>(m_point_lights.size());
-        light_props.NumSpotLights = static_cast<uint32_t>(m_spot_lights.size());
-        light_props.NumDirectionalLights = static_cast<uint32_t>(m_directional_lights.size());
-
-        command_list.SetGraphics32BitConstants(RootParameters::LightPropertiesCB, light_props);
-    }
+    command_list.SetGraphics32BitConstants(RootParameters::LightPropertiesCB, light_props);
 
     m_dirty_flags = DF_None;
 }
 
 
-const std::vector<PointLight>& EffectPSO::GetPointLights() const {
-	return m_point_lights;
-}
-
-void EffectPSO::SetPointLights(const std::vector<PointLight>& point_lights) {
-	m_point_lights = point_lights;
-	m_dirty_flags |= DF_PointLights;
-}
-
-const std::vector<SpotLight>& EffectPSO::GetSpotLights() const {
-	return m_spot_lights;
-}
-
-void EffectPSO::SetSpotLights(const std::vector<SpotLight>& spot_lights) {
-	m_spot_lights = spot_lights;
-	m_dirty_flags |= DF_SpotLights;
+const std::shared_ptr<LightManager>& EffectPSO::GetLightManager() const {
+	return m_light_manager;
 }
 
-const std::vector<DirectionalLight>& EffectPSO::GetDirectionalLights() const {
-	return m_directional_lights;
-}
-
-void EffectPSO::SetDirectionalLights(const std::vector<DirectionalLight>& directional_lights) {
-	m_directional_lights = directional_lights;
-	m_dirty_flags |= DF_DirectionalLights;
+void EffectPSO::SetLightManager(const std::shared_ptr<LightManager>& light_manager) {
+	m_light_manager = light_manager;
 }
 
 const std::shared_ptr<Material>& EffectPSO::GetMaterial() const {
@@ -230,3 +223,18 @@ void XM_CALLCONV EffectPSO::SetProjectionMatrix(DirectX::FXMMATRIX projection_ma
 DirectX::XMMATRIX EffectPSO::GetProjectionMatrix() const {
 	return m_pAligned_mvp->Projection;
 }
+
+
+VertexFormat EffectPSO::GetVertexFormat() const {
+	return m_vertex_format;
+}
+
+void EffectPSO::SetVertexFormat(VertexFormat vertex_format) {
+	m_vertex_format = vertex_format;
+}
+
+void EffectPSO::SetPositionDequantization(const DirectX::XMFLOAT3& position_scale, const DirectX::XMFLOAT3& position_offset) {
+	m_position_scale = position_scale;
+	m_position_offset = position_offset;
+	m_dirty_flags |= DF_Matrices;
+}
\ No newline at end of file
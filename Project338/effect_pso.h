@@ -1,6 +1,6 @@
 #pragma once
 
-#include "light.h"
+#include "vertex_types.h"
 
 #include <DirectXMath.h>
 
@@ -9,6 +9,7 @@
 
 class CommandList;
 class Device;
+class LightManager;
 class Material;
 class RootSignature;
 class PipelineStateObject;
@@ -28,6 +29,8 @@ public:
 		DirectX::XMMATRIX ModelViewMatrix;
 		DirectX::XMMATRIX InverseTransposeModelViewMatrix;
 		DirectX::XMMATRIX ModelViewProjectionMatrix;
+		DirectX::XMFLOAT4 PositionScale;
+		DirectX::XMFLOAT4 PositionOffset;
 	};
 
 	enum RootParameters {
@@ -44,14 +47,8 @@ public:
 	EffectPSO(std::shared_ptr<Device> device, bool enable_ligting, bool enable_decal);
 	virtual ~EffectPSO();
 
-	const std::vector<PointLight>& GetPointLights() const;
-	void SetPointLights(const std::vector<PointLight>& point_lights);
-
-	const std::vector<SpotLight>& GetSpotLights() const;
-	void SetSpotLights(const std::vector<SpotLight>& spot_lights);
-
-	const std::vector<DirectionalLight>& GetDirectionalLights() const;
-	void SetDirectionalLights(const std::vector<DirectionalLight>& directional_lights);
+	const std::shared_ptr<LightManager>& GetLightManager() const;
+	void SetLightManager(const std::shared_ptr<LightManager>& light_manager);
 
 	const std::shared_ptr<Material>& GetMaterial() const;
 	void SetMaterial(const std::shared_ptr<Material>& material);
@@ -65,17 +62,19 @@ public:
 	DirectX::XMMATRIX GetProjectionMatrix() const;
 	void XM_CALLCONV SetProjectionMatrix(DirectX::FXMMATRIX projection_matrix);
 
+	VertexFormat GetVertexFormat() const;
+	void SetVertexFormat(VertexFormat vertex_format);
+
+	void SetPositionDequantization(const DirectX::XMFLOAT3& position_scale, const DirectX::XMFLOAT3& position_offset);
+
 	void Apply(CommandList& command_list);
 
 private:
 	enum DirtyFlags {
 		DF_None = 0,
-		DF_PointLights = (1 << 0),
-		DF_SpotLights = (1 << 1),
-		DF_DirectionalLights = (1 << 2),
-		DF_Material = (1 << 3),
-		DF_Matrices = (1 << 4),
-		DF_All = DF_PointLights | DF_SpotLights | DF_DirectionalLights | DF_Material | DF_Matrices
+		DF_Material = (1 << 0),
+		DF_Matrices = (1 << 1),
+		DF_All = DF_Material | DF_Matrices
 	};
 
 	struct alignas(16) MVP {
@@ -88,11 +87,9 @@ private:
 
 	std::shared_ptr<Device> m_device;
 	std::shared_ptr<RootSignature> m_root_signature;
-	std::shared_ptr<PipelineStateObject> m_pipeline_state_object;
+	std::shared_ptr<PipelineStateObject> m_pipeline_state_objects[static_cast<size_t>(VertexFormat::NumVertexFormats)];
 
-	std::vector<PointLight> m_point_lights;
-	std::vector<SpotLight> m_spot_lights;
-	std::vector<DirectionalLight> m_directional_lights;
+	std::shared_ptr<LightManager> m_light_manager;
 
 	std::shared_ptr<Material> m_material;
 
@@ -100,6 +97,10 @@ private:
 
 	MVP* m_pAligned_mvp;
 
+	VertexFormat m_vertex_format;
+	DirectX::XMFLOAT3 m_position_scale;
+	DirectX::XMFLOAT3 m_position_offset;
+
 	CommandList* m_pPrevious_command_list;
 
 	uint32_t m_dirty_flags;
@@ -1,12 +1,23 @@
 #include "engine_impl.h"
 
 #include "application.h"
+#include "asset_archive.h"
+#include "command_list.h"
 #include "command_queue.h"
+#include "derived_data_cache.h"
+#include "io_service.h"
 #include "material.h"
 #include "mesh.h"
+#include "scene_cache.h"
+#include "scene_load_task.h"
 #include "scene_node.h"
 #include "scene_visitor.h"
 #include "texture.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "texture_quality.h"
+#include "texture_streamer.h"
+#include "thread_pool.h"
 #include "utils.h"
 
 #include <wrl.h>
@@ -86,14 +97,17 @@ bool EngineImpl::LoadContent() {
 
 	app.WndProcHandler += WndProcEvent::slot(&GUI::WndProcHandler, m_gui);
 
-	CommandQueue& command_queue = m_device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-	std::shared_ptr<CommandList> command_list = command_queue.GetCommandList();
+	// Assets packed with --pack are read from the archive, loose files work without one.
+	AssetArchive::Mount(L"assets.pak");
 
-	//m_scene = command_list->LoadSceneFromFile(L"feisar/feisar.obj");
-	m_scene = command_list->LoadSceneFromFile(L"crate/crate.obj");
+	// The scene streams in while the window is already rendering, see OnUpdate.
+	m_texture_streamer = std::make_shared<TextureStreamer>(*m_device, ThreadPool::Get());
 
-	command_queue.ExecuteCommandList(command_list);
-	command_queue.Flush();
+	//m_scene_load = m_device->LoadSceneAsync(L"feisar/feisar.obj", VertexFormat::PositionPackedNormalTangentTexture, m_texture_streamer);
+	m_scene_load = m_device->LoadSceneAsync(L"crate/crate.obj", VertexFormat::PositionPackedNormalTangentTexture, m_texture_streamer);
+
+	CommandQueue& command_queue = m_device->GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+	std::shared_ptr<CommandList> command_list = command_queue.GetCommandList();
 
 	m_sphere = command_list->CreateSphere(0.1f);
 	m_cone = command_list->CreateCone(0.1f, 0.2f);
@@ -111,14 +125,19 @@ bool EngineImpl::LoadContent() {
 	m_decal_pso = std::make_shared<EffectPSO>(m_device, true, true);
 	m_unlit_pso = std::make_shared<EffectPSO>(m_device, false, false);
 
+	m_light_manager = std::make_shared<LightManager>();
+	m_lighting_pso->SetLightManager(m_light_manager);
+	m_decal_pso->SetLightManager(m_light_manager);
+	m_unlit_pso->SetLightManager(m_light_manager);
+
 	const int num_directional_lights = 1;
 	static const DirectX::XMVECTORF32 Light_colors[] = {
 		DirectX::Colors::White,
 		DirectX::Colors::OrangeRed,
 		DirectX::Colors::Blue
 	};
-	m_directional_lights.resize(num_directional_lights);
-	DirectionalLight& l = m_directional_lights[0];
+	std::vector<DirectionalLight> directional_lights(num_directional_lights);
+	DirectionalLight& l = directional_lights[0];
 
 	float angle_around_x = DirectX::XM_PIDIV4;
 	float angle_around_y = DirectX::XM_PIDIV4;
@@ -134,24 +153,14 @@ bool EngineImpl::LoadContent() {
 		),
 		0.0f
 	);
-	DirectX::XMVECTOR direction_vs = DirectX::XMVectorSetW(
-		DirectX::XMVector3Normalize(
-			DirectX::XMVector3Transform(
-				direction_ws,
-				m_camera.get_ViewMatrix()
-			)
-		),
-		0.0f
-	);
 
 	XMStoreFloat4(&l.DirectionWS, direction_ws);
-	XMStoreFloat4(&l.DirectionVS, direction_vs);
 	//XMStoreFloat4(&l.DirectionWS, DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
 	//XMStoreFloat4(&l.DirectionVS, DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
 	l.Color = DirectX::XMFLOAT4(Light_colors[0]);
 
-	m_lighting_pso->SetDirectionalLights(m_directional_lights);
-	m_decal_pso->SetDirectionalLights(m_directional_lights);
+	m_light_manager->SetDirectionalLights(directional_lights);
+	m_light_manager->Update(m_camera.get_ViewMatrix());
 
 
 	DXGI_FORMAT back_buffer_format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
@@ -183,7 +192,7 @@ bool EngineImpl::LoadContent() {
 
 	command_queue.WaitForFenceValue(fence);
 
-	return m_scene != nullptr;
+	return true;
 }
 
 void EngineImpl::OnResize(ResizeEventArgs& e) {
@@ -200,9 +209,41 @@ void EngineImpl::OnResize(ResizeEventArgs& e) {
 
 void EngineImpl::UnloadContent() {
 	m_is_content_loaded = false;
+
+	if (m_scene_load) {
+		m_scene_load->Cancel();
+		m_scene_load->Wait();
+		m_scene_load.reset();
+	}
+
+	if (m_texture_streamer) {
+		m_texture_streamer->LogStatistics();
+		m_texture_streamer.reset();
+	}
+
+	SceneCache::Get().LogStatistics();
+	TextureCache::Get().LogStatistics();
+	DerivedDataCache::Get().LogStatistics();
+	CommandList::LogGenerateMipsStatistics();
+	CommandList::LogDDSStatistics();
+	TextureCooker::LogStatistics();
+	TextureQuality::LogStatistics();
+	IOService::Get().LogStatistics();
 }
 
 void EngineImpl::OnUpdate(UpdateEventArgs& e) {
+	if (m_scene_load && m_scene_load->IsDone()) {
+		if (m_scene_load->GetStatus() == SceneLoadTask::Status::Ready) {
+			m_scene = m_scene_load->GetScene();
+		}
+		else if (m_scene_load->GetStatus() == SceneLoadTask::Status::Failed) {
+			OutputDebugStringA(("Scene load failed: " + m_scene_load->GetError() + "\n").c_str());
+		}
+		m_scene_load.reset();
+	}
+
+	m_texture_streamer->Update();
+
 	const DirectX::XMVECTOR eye_position = DirectX::XMVectorSet(0.0f, 0.0f, -5.0f, 1.0f);
 	const DirectX::XMVECTOR focus_point = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 	const DirectX::XMVECTOR up_direction = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
@@ -210,13 +251,14 @@ void EngineImpl::OnUpdate(UpdateEventArgs& e) {
 	m_camera.set_LookAt(eye_position, focus_point, up_direction);
 	m_camera.set_Projection(45.0f, aspect_ratio, 0.1f, 100.0f);
 
-	m_lighting_pso->SetDirectionalLights(m_directional_lights);
-	m_decal_pso->SetDirectionalLights(m_directional_lights);
+	m_light_manager->Update(m_camera.get_ViewMatrix());
 
 	float angle = static_cast<float>(e.TotalTime * 45.0);
 	const DirectX::XMVECTOR rotation_axis = DirectX::XMVectorSetW(DirectX::XMVector3Normalize(DirectX::XMVectorSet(0.0f, 1.0f, 1.0f, 0.0f)), 0.0f);
 	DirectX::XMMATRIX model_matrix = DirectX::XMMatrixRotationAxis(rotation_axis, DirectX::XMConvertToRadians(angle));
-	m_scene->GetRootNode()->SetLocalTransform(model_matrix);
+	if (m_scene) {
+		m_scene->GetRootNode()->SetLocalTransform(model_matrix);
+	}
 
 	OnRender();
 }
@@ -235,6 +277,9 @@ void EngineImpl::OnRender() {
 	SceneVisitor transparent_pass(*command_list, m_camera, *m_decal_pso, true);
 	SceneVisitor unlit_pass(*command_list, m_camera, *m_unlit_pso, false);
 
+	opaque_pass.SetLODSelection(static_cast<float>(m_height));
+	transparent_pass.SetLODSelection(static_cast<float>(m_height));
+
 	{
 		FLOAT clear_color[] = { 0.4f, 0.6f, 0.9f, 1.0f };
 
@@ -246,11 +291,15 @@ void EngineImpl::OnRender() {
 	command_list->SetScissorRect(m_scissor_rect);
 	command_list->SetRenderTarget(m_render_target);
 
-	m_scene->Accept(opaque_pass);
-	m_scene->Accept(transparent_pass);
+	m_light_manager->Upload(*command_list);
+
+	if (m_scene) {
+		m_scene->Accept(opaque_pass);
+		m_scene->Accept(transparent_pass);
+	}
 
 	MaterialProperties light_material = Material::Black;
-	for (const auto& l : m_point_lights) {
+	for (const auto& l : m_light_manager->GetPointLights()) {
 		light_material.Emissive = l.Color;
 		auto light_pos = XMLoadFloat4(&l.PositionWS);
 		auto world_matrix = DirectX::XMMatrixTranslationFromVector(light_pos);
@@ -260,7 +309,7 @@ void EngineImpl::OnRender() {
 		m_sphere->Accept(unlit_pass);
 	}
 
-	for (const auto& l : m_spot_lights) {
+	for (const auto& l : m_light_manager->GetSpotLights()) {
 		light_material.Emissive = l.Color;
 		DirectX::XMVECTOR light_pos = DirectX::XMLoadFloat4(&l.PositionWS);
 		DirectX::XMVECTOR light_dir = DirectX::XMLoadFloat4(&l.DirectionWS);
@@ -312,8 +361,27 @@ void EngineImpl::OnGUI(const std::shared_ptr<CommandList>& command_list, const R
 	if (ImGui::Begin("Menu")) {
 		ImGui::Text("Hello World");
 
+		if (m_scene_load) {
+			ImGui::Text("Loading %s", ConvertString(m_scene_load->GetFileName()).c_str());
+			ImGui::ProgressBar(m_scene_load->GetProgress());
+			if (ImGui::Button("Cancel")) {
+				m_scene_load->Cancel();
+			}
+		}
+
+		TextureStreamer::Statistics streamer_statistics = m_texture_streamer->GetStatistics();
+		ImGui::Text("Textures: %zu streamed, %zu queued, %zu uploading, %.2f MB in flight", streamer_statistics.TexturesStreamed, streamer_statistics.QueueDepth, streamer_statistics.UploadsInFlight, streamer_statistics.BytesInFlight / (1024.0 * 1024.0));
+		ImGui::Text("Time to final texture: %.2f ms average, %.2f ms max", streamer_statistics.AverageTimeToFinal, streamer_statistics.MaxTimeToFinal);
+
+		// Applies to textures loaded from now on.
+		int quality_tier = static_cast<int>(TextureQuality::GetTier());
+		const char* quality_tiers[] = { "Full", "Half", "Quarter", "Eighth" };
+		if (ImGui::Combo("Texture quality", &quality_tier, quality_tiers, IM_ARRAYSIZE(quality_tiers))) {
+			TextureQuality::SetTier(static_cast<TextureQuality::Tier>(quality_tier));
+		}
+
 		ImGui::End();
 	}
 
 	m_gui->Render(command_list, render_target);
-}
+}
\ No newline at end of file
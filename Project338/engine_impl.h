@@ -15,11 +15,14 @@
 #include "events.h"
 #include "gui.h"
 #include "light.h"
+#include "light_manager.h"
 #include "pipeline_state_object.h"
 #include "render_target.h"
 #include "root_signature.h"
 #include "scene.h"
+#include "scene_load_task.h"
 #include "swap_chain.h"
+#include "texture_streamer.h"
 #include "window_surface.h"
 
 class EngineImpl{
@@ -60,6 +63,8 @@ private:
     std::shared_ptr<GUI> m_gui;
 
     std::shared_ptr<Scene> m_scene;
+    std::shared_ptr<SceneLoadTask> m_scene_load;
+    std::shared_ptr<TextureStreamer> m_texture_streamer;
 
     std::shared_ptr<Scene> m_sphere;
     std::shared_ptr<Scene> m_cone;
@@ -69,6 +74,8 @@ private:
     std::shared_ptr<EffectPSO> m_decal_pso;
     std::shared_ptr<EffectPSO> m_unlit_pso;
 
+    std::shared_ptr<LightManager> m_light_manager;
+
     RenderTarget m_render_target;
 
     D3D12_VIEWPORT m_viewport;
@@ -77,8 +84,4 @@ private:
     Camera m_camera;
 
     bool m_is_content_loaded;
-
-    std::vector<PointLight> m_point_lights;
-    std::vector<SpotLight>  m_spot_lights;
-    std::vector<DirectionalLight> m_directional_lights;
 };
\ No newline at end of file
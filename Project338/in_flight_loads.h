@@ -0,0 +1,149 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+// Loads of keyed values shared by every caller that asks for the same key. The first caller runs
+// the loader outside of the lock, the others wait for its result without holding it while other
+// keys load in parallel. A load that throws or returns a value is_valid rejects is forgotten, every
+// waiting caller gets the exception or the value and the next request loads the key again.
+//
+// The map is guarded by the mutex of the owning cache, which is passed to GetOrLoad and has to be
+// held for every other call.
+template<typename Key, typename Value>
+class InFlightLoads {
+public:
+	using Entry = std::shared_future<Value>;
+	using Loader = std::function<Value()>;
+
+	struct Statistics {
+		size_t Hits;
+		size_t Misses;
+		size_t InFlightHits; // Hits that had to wait for a load started by another caller.
+		size_t Failures;
+	};
+
+	// Called with the lock held. on_hit sees the entry of a known key and drops it by returning false,
+	// the caller then loads the key itself. on_loaded gets every value that passed is_valid.
+	struct Callbacks {
+		std::function<bool(const Value&)> IsValid;
+		std::function<bool(const Entry&)> OnHit;
+		std::function<void(const Value&)> OnLoaded;
+	};
+
+	InFlightLoads();
+
+	// Returns the loaded value and whether this caller ran the loader.
+	Value GetOrLoad(std::mutex& mutex, const Key& key, const Loader& loader, const Callbacks& callbacks, bool* is_loader = nullptr);
+
+	std::map<Key, Entry>& GetEntries();
+	const std::map<Key, Entry>& GetEntries() const;
+
+	const Statistics& GetStatistics() const;
+
+	static bool IsReady(const Entry& entry);
+
+private:
+	std::map<Key, Entry> m_entries;
+	Statistics m_statistics;
+};
+
+template<typename Key, typename Value>
+InFlightLoads<Key, Value>::InFlightLoads() : m_statistics() {}
+
+template<typename Key, typename Value>
+Value InFlightLoads<Key, Value>::GetOrLoad(std::mutex& mutex, const Key& key, const Loader& loader, const Callbacks& callbacks, bool* is_loader) {
+	std::promise<Value> promise;
+	Entry entry;
+	bool is_loading = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iter = m_entries.find(key);
+		if (iter != m_entries.end() && callbacks.OnHit && !callbacks.OnHit(iter->second)) {
+			m_entries.erase(iter);
+			iter = m_entries.end();
+		}
+
+		if (iter != m_entries.end()) {
+			entry = iter->second;
+			++m_statistics.Hits;
+			if (!IsReady(entry)) {
+				++m_statistics.InFlightHits;
+			}
+		}
+		else {
+			entry = promise.get_future().share();
+			m_entries.emplace(key, entry);
+			++m_statistics.Misses;
+			is_loading = true;
+		}
+	}
+
+	if (is_loader) {
+		*is_loader = is_loading;
+	}
+
+	// Other callers wait for the load without holding the lock.
+	if (!is_loading) {
+		return entry.get();
+	}
+
+	Value value;
+	try {
+		value = loader();
+	}
+	catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			m_entries.erase(key);
+			++m_statistics.Failures;
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	if (callbacks.IsValid && !callbacks.IsValid(value)) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			m_entries.erase(key);
+			++m_statistics.Failures;
+		}
+		promise.set_value(value);
+		return value;
+	}
+
+	promise.set_value(value);
+
+	if (callbacks.OnLoaded) {
+		std::lock_guard<std::mutex> lock(mutex);
+		callbacks.OnLoaded(value);
+	}
+
+	return value;
+}
+
+template<typename Key, typename Value>
+std::map<Key, typename InFlightLoads<Key, Value>::Entry>& InFlightLoads<Key, Value>::GetEntries() {
+	return m_entries;
+}
+
+template<typename Key, typename Value>
+const std::map<Key, typename InFlightLoads<Key, Value>::Entry>& InFlightLoads<Key, Value>::GetEntries() const {
+	return m_entries;
+}
+
+template<typename Key, typename Value>
+const typename InFlightLoads<Key, Value>::Statistics& InFlightLoads<Key, Value>::GetStatistics() const {
+	return m_statistics;
+}
+
+template<typename Key, typename Value>
+bool InFlightLoads<Key, Value>::IsReady(const Entry& entry) {
+	return entry.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
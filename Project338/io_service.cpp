@@ -0,0 +1,333 @@
+#include "io_service.h"
+
+#include "asset_archive.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+
+// Reads mostly wait on the disk, a few threads keep enough of them in flight for an SSD.
+constexpr size_t Thread_count = 4u;
+
+// Range reads closer than this are merged, reading the gap is cheaper than another request.
+constexpr uint64_t Coalesce_gap = 64u * 1024u;
+constexpr uint64_t Max_coalesced_size = 16u * 1024u * 1024u;
+
+constexpr size_t Max_read_chunk = 64u * 1024u * 1024u;
+
+// Whole file reads whose storage is released are forgotten once the map has doubled since the last sweep.
+constexpr size_t Min_whole_file_read_sweep = 64u;
+
+inline size_t ReadBytes(HANDLE file, uint64_t offset, uint8_t* data, size_t size) {
+	size_t bytes_read = 0u;
+	while (bytes_read < size) {
+		uint64_t position = offset + bytes_read;
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(position);
+		overlapped.OffsetHigh = static_cast<DWORD>(position >> 32u);
+
+		DWORD chunk_read = 0u;
+		if (!::ReadFile(file, data + bytes_read, static_cast<DWORD>(std::min(size - bytes_read, Max_read_chunk)), &chunk_read, &overlapped) || chunk_read == 0u) {
+			break;
+		}
+		bytes_read += chunk_read;
+	}
+
+	return bytes_read;
+}
+
+IOService::IOService(size_t thread_count) : m_whole_file_read_sweep(Min_whole_file_read_sweep), m_stop(false), m_statistics{}, m_active_reads(0u) {
+	m_threads.reserve(thread_count);
+	for (size_t i = 0u; i < thread_count; ++i) {
+		m_threads.emplace_back(&IOService::WorkerThread, this);
+	}
+}
+
+IOService::~IOService() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+IOService& IOService::Get() {
+	static IOService io_service(Thread_count);
+	return io_service;
+}
+
+IOService::Request IOService::ReadFile(const std::wstring& file_name, Priority priority) {
+	std::wstring normal_name = std::filesystem::path(file_name).lexically_normal().wstring();
+
+	Request result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_statistics.Requests++;
+
+		auto whole_file_it = m_whole_file_reads.find(normal_name);
+		if (whole_file_it == m_whole_file_reads.end()) {
+			if (m_whole_file_reads.size() >= m_whole_file_read_sweep) {
+				SweepWholeFileReads();
+			}
+			whole_file_it = m_whole_file_reads.emplace(normal_name, WholeFileRead()).first;
+		}
+
+		WholeFileRead& whole_file_read = whole_file_it->second;
+		if (whole_file_read.pPending) {
+			m_statistics.RequestsShared++;
+
+			// A more urgent request moves the read up, unless it is already in flight.
+			PendingRead& pending = *whole_file_read.pPending;
+			if (priority < pending.ReadPriority) {
+				auto& queue = m_queues[static_cast<size_t>(pending.ReadPriority)];
+				auto it = std::find(queue.begin(), queue.end(), whole_file_read.pPending);
+				if (it != queue.end()) {
+					queue.erase(it);
+					m_queues[static_cast<size_t>(priority)].push_back(whole_file_read.pPending);
+				}
+				pending.ReadPriority = priority;
+			}
+
+			return whole_file_read.Result;
+		}
+
+		std::shared_ptr<const void> storage = whole_file_read.Storage.lock();
+		if (storage) {
+			m_statistics.RequestsShared++;
+
+			std::promise<Buffer> promise;
+			promise.set_value({ storage, whole_file_read.pData, whole_file_read.Size });
+			return promise.get_future().share();
+		}
+
+		auto read = std::make_shared<PendingRead>();
+		read->FileName = normal_name;
+		read->IsWholeFile = true;
+		read->Offset = 0u;
+		read->Size = 0u;
+		read->ReadPriority = priority;
+
+		whole_file_read.pPending = read;
+		whole_file_read.Result = read->Promise.get_future().share();
+		result = whole_file_read.Result;
+
+		m_queues[static_cast<size_t>(priority)].push_back(read);
+	}
+	m_condition.notify_one();
+
+	return result;
+}
+
+IOService::Request IOService::ReadRange(const std::wstring& file_name, uint64_t offset, size_t size, Priority priority) {
+	auto read = std::make_shared<PendingRead>();
+	read->FileName = std::filesystem::path(file_name).lexically_normal().wstring();
+	read->IsWholeFile = false;
+	read->Offset = offset;
+	read->Size = size;
+	read->ReadPriority = priority;
+
+	Request result = read->Promise.get_future().share();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_statistics.Requests++;
+		m_queues[static_cast<size_t>(priority)].push_back(read);
+	}
+	m_condition.notify_one();
+
+	return result;
+}
+
+IOService::Statistics IOService::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics statistics = m_statistics;
+	if (m_active_reads > 0u) {
+		statistics.BusyTime += std::chrono::duration<double, std::milli>(Clock::now() - m_busy_start_time).count();
+	}
+
+	return statistics;
+}
+
+void IOService::LogStatistics() const {
+	Statistics statistics = GetStatistics();
+
+	double megabytes = statistics.BytesRead / (1024.0 * 1024.0);
+	char message[512];
+	sprintf_s(message, "I/O service: %zu requests, %zu reads (%zu requests shared, %zu coalesced), %.2f MB in %.2f ms busy, %.1f MB/s\n",
+		statistics.Requests, statistics.Reads, statistics.RequestsShared, statistics.RequestsCoalesced, megabytes, statistics.BusyTime,
+		statistics.BusyTime > 0.0 ? megabytes * 1000.0 / statistics.BusyTime : 0.0);
+	OutputDebugStringA(message);
+}
+
+void IOService::SweepWholeFileReads() {
+	for (auto it = m_whole_file_reads.begin(); it != m_whole_file_reads.end();) {
+		if (!it->second.pPending && it->second.Storage.expired()) {
+			it = m_whole_file_reads.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+	m_whole_file_read_sweep = std::max(Min_whole_file_read_sweep, 2u * m_whole_file_reads.size());
+}
+
+std::vector<std::shared_ptr<IOService::PendingRead>> IOService::TakeReads() {
+	std::vector<std::shared_ptr<PendingRead>> reads;
+	for (auto& queue : m_queues) {
+		if (!queue.empty()) {
+			reads.push_back(queue.front());
+			queue.pop_front();
+			break;
+		}
+	}
+
+	const PendingRead& first = *reads.front();
+	if (first.IsWholeFile) {
+		return reads;
+	}
+
+	// Lower priority ranges join as well, they cost next to nothing once the disk is reading there.
+	uint64_t begin = first.Offset;
+	uint64_t end = first.Offset + first.Size;
+	for (bool is_merged = true; is_merged;) {
+		is_merged = false;
+		for (auto& queue : m_queues) {
+			for (auto it = queue.begin(); it != queue.end();) {
+				const PendingRead& read = **it;
+				uint64_t read_end = read.Offset + read.Size;
+				if (!read.IsWholeFile && read.FileName == first.FileName && read.Offset <= end + Coalesce_gap && read_end + Coalesce_gap >= begin
+					&& std::max(end, read_end) - std::min(begin, read.Offset) <= Max_coalesced_size) {
+					begin = std::min(begin, read.Offset);
+					end = std::max(end, read_end);
+					reads.push_back(*it);
+					it = queue.erase(it);
+					is_merged = true;
+				}
+				else {
+					++it;
+				}
+			}
+		}
+	}
+	m_statistics.RequestsCoalesced += reads.size() - 1u;
+
+	return reads;
+}
+
+void IOService::ExecuteReads(const std::vector<std::shared_ptr<PendingRead>>& reads) {
+	const PendingRead& first = *reads.front();
+
+	// Archived files need no file of their own, compressed ones are decompressed here.
+	Buffer archived_buffer;
+	if (first.IsWholeFile && AssetArchive::ReadFile(first.FileName, archived_buffer)) {
+		CompleteWholeFileRead(reads.front(), archived_buffer);
+		return;
+	}
+
+	uint64_t begin = first.Offset;
+	uint64_t end = first.Offset + first.Size;
+	for (const std::shared_ptr<PendingRead>& read : reads) {
+		begin = std::min(begin, read->Offset);
+		end = std::max(end, read->Offset + read->Size);
+	}
+
+	std::shared_ptr<std::vector<uint8_t>> storage;
+	HANDLE file = CreateFileW(first.FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER file_size;
+		bool has_size = true;
+		if (first.IsWholeFile) {
+			has_size = GetFileSizeEx(file, &file_size) != FALSE;
+			end = has_size ? static_cast<uint64_t>(file_size.QuadPart) : 0u;
+		}
+
+		if (has_size) {
+			storage = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(end - begin));
+			size_t bytes_read = ReadBytes(file, begin, storage->data(), storage->size());
+			if (first.IsWholeFile && bytes_read != storage->size()) {
+				storage.reset();
+			}
+			else {
+				storage->resize(bytes_read);
+			}
+		}
+
+		CloseHandle(file);
+	}
+
+	if (first.IsWholeFile) {
+		CompleteWholeFileRead(reads.front(), storage ? Buffer{ storage, storage->data(), storage->size() } : Buffer{ nullptr, nullptr, 0u });
+		return;
+	}
+
+	if (storage) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_statistics.Reads++;
+		m_statistics.BytesRead += storage->size();
+	}
+
+	for (const std::shared_ptr<PendingRead>& read : reads) {
+		Buffer buffer = { storage, nullptr, 0u };
+		if (storage) {
+			size_t offset = static_cast<size_t>(std::min<uint64_t>(read->Offset - begin, storage->size()));
+			buffer.pData = storage->data() + offset;
+			buffer.Size = std::min(read->Size, storage->size() - offset);
+		}
+		read->Promise.set_value(buffer);
+	}
+}
+
+void IOService::CompleteWholeFileRead(const std::shared_ptr<PendingRead>& read, const Buffer& buffer) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_whole_file_reads.find(read->FileName);
+		if (it != m_whole_file_reads.end() && it->second.pPending == read) {
+			it->second.pPending.reset();
+			it->second.Result = Request();
+			it->second.Storage = buffer.Storage;
+			it->second.pData = buffer.pData;
+			it->second.Size = buffer.Size;
+		}
+		if (buffer.Storage) {
+			m_statistics.Reads++;
+			m_statistics.BytesRead += buffer.Size;
+		}
+	}
+
+	read->Promise.set_value(buffer);
+}
+
+void IOService::WorkerThread() {
+	auto has_queued_reads = [this]() {
+		return std::any_of(std::begin(m_queues), std::end(m_queues), [](const std::deque<std::shared_ptr<PendingRead>>& queue) { return !queue.empty(); });
+	};
+
+	for (;;) {
+		std::vector<std::shared_ptr<PendingRead>> reads;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this, &has_queued_reads]() { return m_stop || has_queued_reads(); });
+			if (m_stop && !has_queued_reads()) {
+				break;
+			}
+
+			reads = TakeReads();
+			if (m_active_reads++ == 0u) {
+				m_busy_start_time = Clock::now();
+			}
+		}
+
+		ExecuteReads(reads);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_active_reads == 0u) {
+			m_statistics.BusyTime += std::chrono::duration<double, std::milli>(Clock::now() - m_busy_start_time).count();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Reads asset files on dedicated I/O threads, so blocking reads never hold up the workers
+// of the thread pool. Requests wait in one queue per priority. A whole file read of a file
+// that is queued, in flight or still held by someone shares that read, so a file prefetched
+// and held is read from disk once. Range reads of the same file that lie close together are
+// merged into one read. Every I/O thread keeps a read in flight, which keeps the disk queue
+// full while a level loads.
+// Whole file reads are served from the mounted asset archives first, see AssetArchive.
+// Files are expected not to change while a read of them is held.
+class IOService {
+public:
+	enum class Priority : uint32_t {
+		High,
+		Normal,
+		Low,
+	};
+
+	// Storage owns the bytes and is empty if the read failed. Range reads point into the storage of
+	// the merged read, files from a mounted asset archive can point into its mapping.
+	struct Buffer {
+		std::shared_ptr<const void> Storage;
+		const uint8_t* pData;
+		size_t Size;
+	};
+
+	using Request = std::shared_future<Buffer>;
+
+	struct Statistics {
+		size_t Requests;
+		size_t Reads;
+		size_t RequestsShared;
+		size_t RequestsCoalesced;
+		uint64_t BytesRead;
+		double BusyTime; // Milliseconds with at least one read in flight.
+	};
+
+	explicit IOService(size_t thread_count);
+	~IOService();
+
+	IOService(const IOService& copy) = delete;
+	IOService& operator=(const IOService& copy) = delete;
+
+	static IOService& Get();
+
+	Request ReadFile(const std::wstring& file_name, Priority priority = Priority::Normal);
+
+	// Reads past the end of the file are cut short.
+	Request ReadRange(const std::wstring& file_name, uint64_t offset, size_t size, Priority priority = Priority::Normal);
+
+	Statistics GetStatistics() const;
+	void LogStatistics() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct PendingRead {
+		std::wstring FileName;
+		bool IsWholeFile;
+		uint64_t Offset;
+		size_t Size;
+		Priority ReadPriority;
+		std::promise<Buffer> Promise;
+	};
+
+	// A whole file read stays known while it is queued or in flight and afterwards as long as someone holds
+	// its storage, so a prefetched file is read once. Entries whose storage is released are swept on insert.
+	struct WholeFileRead {
+		std::shared_ptr<PendingRead> pPending;
+		Request Result;
+		std::weak_ptr<const void> Storage;
+		const uint8_t* pData;
+		size_t Size;
+	};
+
+	// Forgets the finished whole file reads nobody holds anymore.
+	void SweepWholeFileReads();
+
+	std::vector<std::shared_ptr<PendingRead>> TakeReads();
+	void ExecuteReads(const std::vector<std::shared_ptr<PendingRead>>& reads);
+	void CompleteWholeFileRead(const std::shared_ptr<PendingRead>& read, const Buffer& buffer);
+	void WorkerThread();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::shared_ptr<PendingRead>> m_queues[3];
+	std::unordered_map<std::wstring, WholeFileRead> m_whole_file_reads;
+	size_t m_whole_file_read_sweep;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop;
+
+	Statistics m_statistics;
+	size_t m_active_reads;
+	Clock::time_point m_busy_start_time;
+};
\ No newline at end of file
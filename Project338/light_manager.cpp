@@ -0,0 +1,89 @@
+#include "light_manager.h"
+
+#include "command_list.h"
+
+LightManager::LightManager() : m_point_lights_location(0u), m_spot_lights_location(0u), m_directional_lights_location(0u), m_uploaded_recording_index(0u) {}
+
+const std::vector<PointLight>& LightManager::GetPointLights() const {
+	return m_point_lights;
+}
+
+void LightManager::SetPointLights(const std::vector<PointLight>& point_lights) {
+	m_point_lights = point_lights;
+	m_uploaded_recording_index = 0u;
+}
+
+const std::vector<SpotLight>& LightManager::GetSpotLights() const {
+	return m_spot_lights;
+}
+
+void LightManager::SetSpotLights(const std::vector<SpotLight>& spot_lights) {
+	m_spot_lights = spot_lights;
+	m_uploaded_recording_index = 0u;
+}
+
+const std::vector<DirectionalLight>& LightManager::GetDirectionalLights() const {
+	return m_directional_lights;
+}
+
+void LightManager::SetDirectionalLights(const std::vector<DirectionalLight>& directional_lights) {
+	m_directional_lights = directional_lights;
+	m_uploaded_recording_index = 0u;
+}
+
+void XM_CALLCONV LightManager::Update(DirectX::FXMMATRIX view_matrix) {
+	// The light structures keep the world and view space vectors side by side, so each
+	// field can be transformed as one strided stream. Positions carry w = 1 and directions
+	// w = 0, which lets the same 4D transform handle both. The view matrix is orthonormal,
+	// so unit length directions stay unit length.
+	if (!m_point_lights.empty()) {
+		DirectX::XMVector4TransformStream(&m_point_lights[0].PositionVS, sizeof(PointLight), &m_point_lights[0].PositionWS, sizeof(PointLight), m_point_lights.size(), view_matrix);
+	}
+
+	if (!m_spot_lights.empty()) {
+		DirectX::XMVector4TransformStream(&m_spot_lights[0].PositionVS, sizeof(SpotLight), &m_spot_lights[0].PositionWS, sizeof(SpotLight), m_spot_lights.size(), view_matrix);
+		DirectX::XMVector4TransformStream(&m_spot_lights[0].DirectionVS, sizeof(SpotLight), &m_spot_lights[0].DirectionWS, sizeof(SpotLight), m_spot_lights.size(), view_matrix);
+	}
+
+	if (!m_directional_lights.empty()) {
+		DirectX::XMVector4TransformStream(&m_directional_lights[0].DirectionVS, sizeof(DirectionalLight), &m_directional_lights[0].DirectionWS, sizeof(DirectionalLight), m_directional_lights.size(), view_matrix);
+	}
+
+	m_uploaded_recording_index = 0u;
+}
+
+void LightManager::Upload(CommandList& command_list) {
+	m_point_lights_location = command_list.CopyDynamicStructuredBuffer(m_point_lights);
+	m_spot_lights_location = command_list.CopyDynamicStructuredBuffer(m_spot_lights);
+	m_directional_lights_location = command_list.CopyDynamicStructuredBuffer(m_directional_lights);
+
+	m_uploaded_recording_index = command_list.GetRecordingIndex();
+}
+
+bool LightManager::IsUploaded(const CommandList& command_list) const {
+	return m_uploaded_recording_index == command_list.GetRecordingIndex();
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS LightManager::GetPointLightsLocation() const {
+	return m_point_lights_location;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS LightManager::GetSpotLightsLocation() const {
+	return m_spot_lights_location;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS LightManager::GetDirectionalLightsLocation() const {
+	return m_directional_lights_location;
+}
+
+uint32_t LightManager::GetNumPointLights() const {
+	return static_cast<uint32_t>(m_point_lights.size());
+}
+
+uint32_t LightManager::GetNumSpotLights() const {
+	return static_cast<uint32_t>(m_spot_lights.size());
+}
+
+uint32_t LightManager::GetNumDirectionalLights() const {
+	return static_cast<uint32_t>(m_directional_lights.size());
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "light.h"
+
+#include <DirectXMath.h>
+#include <d3d12.h>
+
+#include <cstdint>
+#include <vector>
+
+class CommandList;
+
+// Owns the scene lights for a frame. View space positions and directions are
+// transformed for all lights at once and the light arrays are uploaded a single
+// time per frame; every EffectPSO that references the manager binds the same
+// GPU addresses as root SRVs instead of keeping its own copy of the lights.
+class LightManager {
+public:
+	LightManager();
+	~LightManager() = default;
+
+	const std::vector<PointLight>& GetPointLights() const;
+	void SetPointLights(const std::vector<PointLight>& point_lights);
+
+	const std::vector<SpotLight>& GetSpotLights() const;
+	void SetSpotLights(const std::vector<SpotLight>& spot_lights);
+
+	const std::vector<DirectionalLight>& GetDirectionalLights() const;
+	void SetDirectionalLights(const std::vector<DirectionalLight>& directional_lights);
+
+	void XM_CALLCONV Update(DirectX::FXMMATRIX view_matrix);
+	void Upload(CommandList& command_list);
+
+	bool IsUploaded(const CommandList& command_list) const;
+
+	D3D12_GPU_VIRTUAL_ADDRESS GetPointLightsLocation() const;
+	D3D12_GPU_VIRTUAL_ADDRESS GetSpotLightsLocation() const;
+	D3D12_GPU_VIRTUAL_ADDRESS GetDirectionalLightsLocation() const;
+
+	uint32_t GetNumPointLights() const;
+	uint32_t GetNumSpotLights() const;
+	uint32_t GetNumDirectionalLights() const;
+
+private:
+	std::vector<PointLight> m_point_lights;
+	std::vector<SpotLight> m_spot_lights;
+	std::vector<DirectionalLight> m_directional_lights;
+
+	D3D12_GPU_VIRTUAL_ADDRESS m_point_lights_location;
+	D3D12_GPU_VIRTUAL_ADDRESS m_spot_lights_location;
+	D3D12_GPU_VIRTUAL_ADDRESS m_directional_lights_location;
+
+	// Recording index of the command list the lights were last uploaded on, zero if they changed since.
+	uint64_t m_uploaded_recording_index;
+};
\ No newline at end of file
@@ -20,9 +20,13 @@
 #pragma comment(lib, "assimp-vc142-mtd.lib")
 #pragma comment(lib, "winmm.lib")
 #pragma comment(lib, "Shlwapi.lib")
+#pragma comment(lib, "Cabinet.lib")
 
 #include "application.h"
 #include "engine_impl.h"
+#include "tools.h"
+
+#include <iostream>
 
 void ReportLiveObjects() {
     IDXGIDebug1* dxgiDebug;
@@ -32,9 +36,14 @@ void ReportLiveObjects() {
     dxgiDebug->Release();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     int retCode = 0;
 
+    // Offline tools run without creating a window or a device.
+    if (Tools::Run(argc, argv, std::cout, retCode)) {
+        return retCode;
+    }
+
     WCHAR path[MAX_PATH];
     HMODULE hModule = GetModuleHandleW(NULL);
     if (GetModuleFileNameW(hModule, path, MAX_PATH) > 0) {
@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+
+#include "utils.h"
+
+MappedFile::MappedFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_data(nullptr), m_size(0u) {}
+
+MappedFile::MappedFile(const std::wstring& file_name) : MappedFile() {
+	Open(file_name);
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::wstring& file_name) {
+	Close();
+
+	m_file = CreateFileW(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(m_file, &file_size) || file_size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping) {
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data) {
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(file_size.QuadPart);
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0u;
+}
+
+bool MappedFile::IsOpen() const {
+	return m_data != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const {
+	return m_data;
+}
+
+size_t MappedFile::GetSize() const {
+	return m_size;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only view of a whole file through a Win32 file mapping. Pages are faulted in
+// by the OS on first access, so large blobs can be handed to the upload path without
+// reading them into an intermediate buffer first.
+class MappedFile {
+public:
+	MappedFile();
+	explicit MappedFile(const std::wstring& file_name);
+	~MappedFile();
+
+	MappedFile(const MappedFile& copy) = delete;
+	MappedFile& operator=(const MappedFile& copy) = delete;
+
+	bool Open(const std::wstring& file_name);
+	void Close();
+
+	bool IsOpen() const;
+
+	const uint8_t* GetData() const;
+	size_t GetSize() const;
+
+private:
+	void* m_file;
+	void* m_mapping;
+	const uint8_t* m_data;
+	size_t m_size;
+};
\ No newline at end of file
@@ -5,8 +5,9 @@
 #include "vertex_buffer.h"
 #include "visitor.h"
 
+#include <algorithm>
 
-Mesh::Mesh() : m_primitive_topology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST) {}
+Mesh::Mesh() : m_primitive_topology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST), m_vertex_format(VertexFormat::PositionNormalTangentBitangentTexture), m_position_scale(1.0f, 1.0f, 1.0f), m_position_offset(0.0f, 0.0f, 0.0f) {}
 
 const Mesh::BufferMap& Mesh::GetVertexBuffers() const {
     return m_vertex_buffers;
@@ -41,7 +42,10 @@ std::shared_ptr<IndexBuffer> Mesh::GetIndexBuffer() {
 
 size_t Mesh::GetIndexCount() const {
     size_t index_count = 0;
-    if (m_index_buffer) {
+    if (!m_lods.empty()) {
+        index_count = m_lods[0].IndexCount;
+    }
+    else if (m_index_buffer) {
         index_count = m_index_buffer->GetNumIndices();
     }
 
@@ -67,7 +71,78 @@ std::shared_ptr<Material> Mesh::GetMaterial() const {
     return m_material;
 }
 
+void Mesh::SetLODs(const std::vector<LOD>& lods) {
+    m_lods = lods;
+}
+
+const std::vector<Mesh::LOD>& Mesh::GetLODs() const {
+    return m_lods;
+}
+
+size_t Mesh::GetLODCount() const {
+    return std::max<size_t>(m_lods.size(), 1u);
+}
+
+void Mesh::SetMeshlets(const std::vector<MeshOptimizer::Meshlet>& meshlets) {
+    m_meshlets = meshlets;
+}
+
+const std::vector<MeshOptimizer::Meshlet>& Mesh::GetMeshlets() const {
+    return m_meshlets;
+}
+
+size_t XM_CALLCONV Mesh::CullMeshlets(DirectX::FXMMATRIX world_view, const DirectX::BoundingFrustum& view_frustum, float pixels_per_unit, float min_pixel_size, std::vector<IndexRange>& visible_ranges) const {
+    visible_ranges.clear();
+
+    // The scale of the world view transform, cones assume it is uniform.
+    float scale = std::max({
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(world_view.r[0])),
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(world_view.r[1])),
+        DirectX::XMVectorGetX(DirectX::XMVector3Length(world_view.r[2]))
+    });
+
+    size_t visible_meshlets = 0u;
+    for (const MeshOptimizer::Meshlet& meshlet : m_meshlets) {
+        DirectX::XMVECTOR center = DirectX::XMVector3Transform(DirectX::XMVectorSet(meshlet.Center[0], meshlet.Center[1], meshlet.Center[2], 1.0f), world_view);
+        float radius = meshlet.Radius * scale;
+
+        DirectX::BoundingSphere sphere;
+        DirectX::XMStoreFloat3(&sphere.Center, center);
+        sphere.Radius = radius;
+        if (!view_frustum.Intersects(sphere)) {
+            continue;
+        }
+
+        // The camera sits at the origin of view space.
+        float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(center));
+        if (meshlet.ConeCutoff < 1.0f) {
+            DirectX::XMVECTOR axis = DirectX::XMVector3Normalize(DirectX::XMVector3TransformNormal(DirectX::XMVectorSet(meshlet.ConeAxis[0], meshlet.ConeAxis[1], meshlet.ConeAxis[2], 0.0f), world_view));
+            if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(center, axis)) >= meshlet.ConeCutoff * distance + radius) {
+                continue;
+            }
+        }
+
+        if (sphere.Center.z > radius && 2.0f * radius * pixels_per_unit / sphere.Center.z < min_pixel_size) {
+            continue;
+        }
+
+        ++visible_meshlets;
+        if (!visible_ranges.empty() && visible_ranges.back().StartIndex + visible_ranges.back().IndexCount == meshlet.StartIndex) {
+            visible_ranges.back().IndexCount += meshlet.IndexCount;
+        }
+        else {
+            visible_ranges.push_back({ meshlet.StartIndex, meshlet.IndexCount });
+        }
+    }
+
+    return visible_meshlets;
+}
+
 void Mesh::Draw(CommandList& command_list, uint32_t instance_count, uint32_t start_instance) {
+    DrawLOD(command_list, 0u, instance_count, start_instance);
+}
+
+void Mesh::DrawLOD(CommandList& command_list, size_t lod_index, uint32_t instance_count, uint32_t start_instance) {
     command_list.SetPrimitiveTopology(GetPrimitiveTopology());
 
     for (auto vertex_buffer : m_vertex_buffers) {
@@ -78,8 +153,15 @@ void Mesh::Draw(CommandList& command_list, uint32_t instance_count, uint32_t sta
     auto vertex_count = GetVertexCount();
 
     if (index_count > 0) {
+        uint32_t start_index = 0u;
+        if (!m_lods.empty()) {
+            const LOD& lod = m_lods[std::min(lod_index, m_lods.size() - 1u)];
+            start_index = lod.StartIndex;
+            index_count = lod.IndexCount;
+        }
+
         command_list.SetIndexBuffer(m_index_buffer);
-        command_list.DrawIndexed(index_count, instance_count, 0u, 0u, start_instance);
+        command_list.DrawIndexed(static_cast<uint32_t>(index_count), instance_count, start_index, 0u, start_instance);
     }
     else if (vertex_count > 0) {
         command_list.Draw(vertex_count, instance_count, 0u, start_instance);
@@ -96,4 +178,42 @@ void Mesh::SetAABB(const DirectX::BoundingBox& aabb) {
 
 const DirectX::BoundingBox& Mesh::GetAABB() const {
     return m_AABB;
+}
+
+void Mesh::SetVertexFormat(VertexFormat vertex_format) {
+    m_vertex_format = vertex_format;
+}
+
+VertexFormat Mesh::GetVertexFormat() const {
+    return m_vertex_format;
+}
+
+void Mesh::SetPositionDequantization(const DirectX::XMFLOAT3& position_scale, const DirectX::XMFLOAT3& position_offset) {
+    m_position_scale = position_scale;
+    m_position_offset = position_offset;
+}
+
+const DirectX::XMFLOAT3& Mesh::GetPositionScale() const {
+    return m_position_scale;
+}
+
+const DirectX::XMFLOAT3& Mesh::GetPositionOffset() const {
+    return m_position_offset;
+}
+
+void Mesh::DrawRanges(CommandList& command_list, const std::vector<IndexRange>& index_ranges, uint32_t instance_count, uint32_t start_instance) {
+    if (!m_index_buffer || index_ranges.empty()) {
+        return;
+    }
+
+    command_list.SetPrimitiveTopology(GetPrimitiveTopology());
+
+    for (auto vertex_buffer : m_vertex_buffers) {
+        command_list.SetVertexBuffer(vertex_buffer.first, vertex_buffer.second);
+    }
+
+    command_list.SetIndexBuffer(m_index_buffer);
+    for (const IndexRange& range : index_ranges) {
+        command_list.DrawIndexed(range.IndexCount, instance_count, range.StartIndex, 0u, start_instance);
+    }
 }
\ No newline at end of file
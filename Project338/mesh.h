@@ -1,11 +1,15 @@
 #pragma once
 
+#include "mesh_optimizer.h"
+#include "vertex_types.h"
+
 #include <DirectXCollision.h>
 #include <DirectXMath.h>
 #include <d3d12.h>
 
 #include <map>
 #include <memory>
+#include <vector>
 
 class CommandList;
 class IndexBuffer;
@@ -17,6 +21,19 @@ class Mesh {
 public:
 	using BufferMap = std::map<uint32_t, std::shared_ptr<VertexBuffer>>;
 
+	// A level of detail is a range of the shared index buffer. Error is the simplification
+	// error relative to the mesh extent, LOD 0 is the full mesh with an error of zero.
+	struct LOD {
+		uint32_t StartIndex;
+		uint32_t IndexCount;
+		float Error;
+	};
+
+	struct IndexRange {
+		uint32_t StartIndex;
+		uint32_t IndexCount;
+	};
+
 	Mesh();
 	~Mesh() = default;
 
@@ -39,7 +56,30 @@ public:
 	void SetAABB(const DirectX::BoundingBox& aabb);
 	const DirectX::BoundingBox& GetAABB() const;
 
+	void SetVertexFormat(VertexFormat vertex_format);
+	VertexFormat GetVertexFormat() const;
+
+	// Restores quantized positions in the vertex shader: position = stored * scale + offset.
+	void SetPositionDequantization(const DirectX::XMFLOAT3& position_scale, const DirectX::XMFLOAT3& position_offset);
+	const DirectX::XMFLOAT3& GetPositionScale() const;
+	const DirectX::XMFLOAT3& GetPositionOffset() const;
+
+	void SetLODs(const std::vector<LOD>& lods);
+	const std::vector<LOD>& GetLODs() const;
+	size_t GetLODCount() const;
+
+	// Optional cluster decomposition of LOD 0, every meshlet is a contiguous index range.
+	void SetMeshlets(const std::vector<MeshOptimizer::Meshlet>& meshlets);
+	const std::vector<MeshOptimizer::Meshlet>& GetMeshlets() const;
+
+	// Frustum, normal cone and small size culling of the meshlets in view space. Visible
+	// meshlets that follow each other in the index buffer are merged into one range.
+	// Returns the number of visible meshlets.
+	size_t XM_CALLCONV CullMeshlets(DirectX::FXMMATRIX world_view, const DirectX::BoundingFrustum& view_frustum, float pixels_per_unit, float min_pixel_size, std::vector<IndexRange>& visible_ranges) const;
+
 	void Draw(CommandList& command_list, uint32_t instance_count = 1, uint32_t start_instance = 0);
+	void DrawLOD(CommandList& command_list, size_t lod_index, uint32_t instance_count = 1, uint32_t start_instance = 0);
+	void DrawRanges(CommandList& command_list, const std::vector<IndexRange>& index_ranges, uint32_t instance_count = 1, uint32_t start_instance = 0);
 
 	void Accept(Visitor& visitor);
 
@@ -49,4 +89,9 @@ private:
 	std::shared_ptr<Material> m_material;
 	D3D12_PRIMITIVE_TOPOLOGY m_primitive_topology;
 	DirectX::BoundingBox m_AABB;
+	std::vector<LOD> m_lods;
+	std::vector<MeshOptimizer::Meshlet> m_meshlets;
+	VertexFormat m_vertex_format;
+	DirectX::XMFLOAT3 m_position_scale;
+	DirectX::XMFLOAT3 m_position_offset;
 };
\ No newline at end of file
@@ -0,0 +1,867 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+	constexpr uint32_t Forsyth_cache_size = 32u;
+	constexpr uint32_t Fifo_cache_size = 16u;
+	constexpr int Overdraw_grid_size = 256;
+	constexpr uint32_t Fetch_cache_line_size = 64u;
+	constexpr uint32_t Fetch_cache_line_count = 256u;
+
+	inline const float* GetPosition(const float* positions, size_t position_stride, uint32_t index) {
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + index * position_stride);
+	}
+
+	float ForsythVertexScore(int32_t cache_position, uint32_t live_triangles) {
+		if (live_triangles == 0u) {
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cache_position >= 0) {
+			if (cache_position < 3) {
+				// The last triangle's vertices get a fixed score, so the next triangle doesn't simply reuse them.
+				score = 0.75f;
+			}
+			else {
+				float scaler = 1.0f - static_cast<float>(cache_position - 3) / static_cast<float>(Forsyth_cache_size - 3u);
+				score = std::pow(scaler, 1.5f);
+			}
+		}
+
+		// Prefer vertices with few triangles left, they finish off a patch and free the cache.
+		score += 2.0f * (1.0f / std::sqrt(static_cast<float>(live_triangles)));
+
+		return score;
+	}
+
+	// FIFO cache simulation with timestamps, a vertex is in the cache when it was
+	// inserted fewer than cache_size misses ago. Increasing timestamp by cache_size + 1
+	// flushes the cache.
+	inline uint32_t UpdateFifoCache(const uint32_t* triangle, uint32_t cache_size, std::vector<uint32_t>& timestamps, uint32_t& timestamp) {
+		uint32_t misses = 0u;
+		for (int k = 0; k < 3; ++k) {
+			uint32_t vertex = triangle[k];
+			if (timestamp - timestamps[vertex] > cache_size) {
+				timestamps[vertex] = timestamp++;
+				++misses;
+			}
+		}
+
+		return misses;
+	}
+
+	inline float EdgeFunction(const float a[3], const float b[3], float x, float y) {
+		return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+	}
+
+	// Triangles facing the viewer are clockwise like in the renderer. The view plane has y pointing up,
+	// where clockwise triangles have a negative area, so they are rasterized as (a, c, b).
+	void RasterizeTriangle(std::vector<float>& depth_buffer, uint32_t& pixels_shaded, const float a[3], const float b[3], const float c[3]) {
+		const float* v0 = a;
+		const float* v1 = c;
+		const float* v2 = b;
+
+		float area = EdgeFunction(v0, v1, v2[0], v2[1]);
+		if (area <= 0.0f) {
+			return;
+		}
+
+		int min_x = std::max(static_cast<int>(std::floor(std::min({ v0[0], v1[0], v2[0] }))), 0);
+		int min_y = std::max(static_cast<int>(std::floor(std::min({ v0[1], v1[1], v2[1] }))), 0);
+		int max_x = std::min(static_cast<int>(std::ceil(std::max({ v0[0], v1[0], v2[0] }))), Overdraw_grid_size - 1);
+		int max_y = std::min(static_cast<int>(std::ceil(std::max({ v0[1], v1[1], v2[1] }))), Overdraw_grid_size - 1);
+
+		float inv_area = 1.0f / area;
+		for (int y = min_y; y <= max_y; ++y) {
+			for (int x = min_x; x <= max_x; ++x) {
+				float px = static_cast<float>(x) + 0.5f;
+				float py = static_cast<float>(y) + 0.5f;
+
+				float w0 = EdgeFunction(v1, v2, px, py);
+				float w1 = EdgeFunction(v2, v0, px, py);
+				float w2 = EdgeFunction(v0, v1, px, py);
+				if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+					continue;
+				}
+
+				float depth = (w0 * v0[2] + w1 * v1[2] + w2 * v2[2]) * inv_area;
+				float& stored_depth = depth_buffer[y * Overdraw_grid_size + x];
+				if (depth < stored_depth) {
+					stored_depth = depth;
+					++pixels_shaded;
+				}
+			}
+		}
+	}
+
+	// Symmetric 4x4 error quadric of a set of planes, the error of a point is its weighted
+	// sum of squared distances to the planes.
+	struct Quadric {
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+	};
+
+	void AddPlaneQuadric(Quadric& q, const float p0[3], const float p1[3], const float p2[3]) {
+		double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length <= 0.0) {
+			return;
+		}
+
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+		double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+		// Weighting by area keeps large flat regions from being eroded by small triangles.
+		double w = length * 0.5;
+
+		q.a00 += w * n[0] * n[0];
+		q.a01 += w * n[0] * n[1];
+		q.a02 += w * n[0] * n[2];
+		q.a11 += w * n[1] * n[1];
+		q.a12 += w * n[1] * n[2];
+		q.a22 += w * n[2] * n[2];
+		q.b0 += w * n[0] * d;
+		q.b1 += w * n[1] * d;
+		q.b2 += w * n[2] * d;
+		q.c += w * d * d;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& r) {
+		q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02;
+		q.a11 += r.a11; q.a12 += r.a12; q.a22 += r.a22;
+		q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+		q.c += r.c;
+	}
+
+	double QuadricError(const Quadric& q, const float p[3]) {
+		double x = p[0];
+		double y = p[1];
+		double z = p[2];
+
+		double error =
+			q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+			2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+			2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+			q.c;
+
+		return std::abs(error);
+	}
+
+	double QuadricWeight(const Quadric& q) {
+		// Sum of the plane weights is the trace of the normal part, the normals are unit length.
+		return q.a00 + q.a11 + q.a22;
+	}
+
+	struct Collapse {
+		uint32_t Source;
+		uint32_t Target;
+		float Error;
+	};
+
+	bool CollapseFlipsTriangle(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangle_offsets, const std::vector<uint32_t>& adjacent_triangles, const std::vector<float>& positions, uint32_t source, uint32_t target) {
+		const float* target_position = &positions[target * 3u];
+
+		for (uint32_t i = triangle_offsets[source]; i < triangle_offsets[source + 1u]; ++i) {
+			const uint32_t* triangle = &indices[adjacent_triangles[i] * 3u];
+			if (triangle[0] == target || triangle[1] == target || triangle[2] == target) {
+				continue;
+			}
+
+			const float* p[3];
+			const float* q[3];
+			for (int k = 0; k < 3; ++k) {
+				p[k] = &positions[triangle[k] * 3u];
+				q[k] = triangle[k] == source ? target_position : p[k];
+			}
+
+			float pe1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float pe2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float qe1[3] = { q[1][0] - q[0][0], q[1][1] - q[0][1], q[1][2] - q[0][2] };
+			float qe2[3] = { q[2][0] - q[0][0], q[2][1] - q[0][1], q[2][2] - q[0][2] };
+
+			float pn[3] = { pe1[1] * pe2[2] - pe1[2] * pe2[1], pe1[2] * pe2[0] - pe1[0] * pe2[2], pe1[0] * pe2[1] - pe1[1] * pe2[0] };
+			float qn[3] = { qe1[1] * qe2[2] - qe1[2] * qe2[1], qe1[2] * qe2[0] - qe1[0] * qe2[2], qe1[0] * qe2[1] - qe1[1] * qe2[0] };
+
+			if (pn[0] * qn[0] + pn[1] * qn[1] + pn[2] * qn[2] <= 0.0f) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+namespace MeshOptimizer {
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count) {
+		const size_t face_count = indices.size() / 3u;
+		if (face_count == 0u) {
+			return;
+		}
+
+		// Vertex to triangle adjacency, live_triangles[v] entries of each range are still unemitted.
+		std::vector<uint32_t> triangle_offsets(vertex_count + 1u, 0u);
+		for (uint32_t index : indices) {
+			++triangle_offsets[index + 1u];
+		}
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			triangle_offsets[i + 1u] += triangle_offsets[i];
+		}
+
+		std::vector<uint32_t> live_triangles(vertex_count);
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			live_triangles[i] = triangle_offsets[i + 1u] - triangle_offsets[i];
+		}
+
+		std::vector<uint32_t> adjacent_triangles(indices.size());
+		std::vector<uint32_t> fill_offsets(triangle_offsets.cbegin(), triangle_offsets.cend() - 1);
+		for (size_t i = 0u; i < indices.size(); ++i) {
+			adjacent_triangles[fill_offsets[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+		}
+
+		std::vector<float> vertex_scores(vertex_count);
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			vertex_scores[i] = ForsythVertexScore(-1, live_triangles[i]);
+		}
+
+		std::vector<float> triangle_scores(face_count);
+		std::vector<bool> emitted(face_count, false);
+		uint32_t best_triangle = 0u;
+		for (size_t i = 0u; i < face_count; ++i) {
+			triangle_scores[i] = vertex_scores[indices[i * 3u + 0u]] + vertex_scores[indices[i * 3u + 1u]] + vertex_scores[indices[i * 3u + 2u]];
+			if (triangle_scores[i] > triangle_scores[best_triangle]) {
+				best_triangle = static_cast<uint32_t>(i);
+			}
+		}
+
+		std::vector<uint32_t> result;
+		result.reserve(face_count * 3u);
+
+		uint32_t cache[Forsyth_cache_size + 3u];
+		uint32_t new_cache[Forsyth_cache_size + 3u];
+		uint32_t cache_count = 0u;
+		size_t dead_end_cursor = 0u;
+
+		for (size_t emitted_count = 0u; emitted_count < face_count; ++emitted_count) {
+			if (best_triangle == InvalidIndex) {
+				// None of the cached vertices has triangles left, continue with the next unemitted one.
+				while (emitted[dead_end_cursor]) {
+					++dead_end_cursor;
+				}
+				best_triangle = static_cast<uint32_t>(dead_end_cursor);
+			}
+
+			const uint32_t* triangle = &indices[best_triangle * 3u];
+			result.insert(result.end(), triangle, triangle + 3);
+			emitted[best_triangle] = true;
+
+			uint32_t new_cache_count = 0u;
+			for (int k = 0; k < 3; ++k) {
+				uint32_t vertex = triangle[k];
+
+				uint32_t* begin = &adjacent_triangles[triangle_offsets[vertex]];
+				uint32_t* end = begin + live_triangles[vertex];
+				uint32_t* it = std::find(begin, end, best_triangle);
+				if (it != end) {
+					std::swap(*it, *(end - 1));
+					--live_triangles[vertex];
+				}
+
+				if (std::find(new_cache, new_cache + new_cache_count, vertex) == new_cache + new_cache_count) {
+					new_cache[new_cache_count++] = vertex;
+				}
+			}
+
+			for (uint32_t i = 0u; i < cache_count; ++i) {
+				uint32_t vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+					new_cache[new_cache_count++] = vertex;
+				}
+			}
+
+			// Vertices past the cache size are evicted, their scores drop as well.
+			for (uint32_t i = 0u; i < new_cache_count; ++i) {
+				uint32_t vertex = new_cache[i];
+				int32_t cache_position = i < Forsyth_cache_size ? static_cast<int32_t>(i) : -1;
+
+				float score = ForsythVertexScore(cache_position, live_triangles[vertex]);
+				float score_delta = score - vertex_scores[vertex];
+				vertex_scores[vertex] = score;
+
+				const uint32_t* adjacent = &adjacent_triangles[triangle_offsets[vertex]];
+				for (uint32_t j = 0u; j < live_triangles[vertex]; ++j) {
+					triangle_scores[adjacent[j]] += score_delta;
+				}
+			}
+
+			cache_count = std::min(new_cache_count, Forsyth_cache_size);
+			std::copy(new_cache, new_cache + cache_count, cache);
+
+			best_triangle = InvalidIndex;
+			float best_score = -1.0f;
+			for (uint32_t i = 0u; i < cache_count; ++i) {
+				uint32_t vertex = cache[i];
+				const uint32_t* adjacent = &adjacent_triangles[triangle_offsets[vertex]];
+				for (uint32_t j = 0u; j < live_triangles[vertex]; ++j) {
+					if (triangle_scores[adjacent[j]] > best_score) {
+						best_score = triangle_scores[adjacent[j]];
+						best_triangle = adjacent[j];
+					}
+				}
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, float threshold) {
+		const size_t face_count = indices.size() / 3u;
+		if (face_count == 0u) {
+			return;
+		}
+
+		std::vector<uint32_t> timestamps(vertex_count, 0u);
+		uint32_t timestamp = Fifo_cache_size + 1u;
+
+		// Hard boundaries: a triangle with three cache misses starts a new patch of the mesh.
+		std::vector<uint32_t> hard_clusters;
+		for (size_t i = 0u; i < face_count; ++i) {
+			uint32_t misses = UpdateFifoCache(&indices[i * 3u], Fifo_cache_size, timestamps, timestamp);
+			if (i == 0u || misses == 3u) {
+				hard_clusters.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		// Soft boundaries: split a patch further as soon as the running ACMR is within the
+		// threshold of the patch ACMR, every split costs a cache flush.
+		std::vector<uint32_t> clusters;
+		for (size_t c = 0u; c < hard_clusters.size(); ++c) {
+			size_t start = hard_clusters[c];
+			size_t end = c + 1u < hard_clusters.size() ? hard_clusters[c + 1u] : face_count;
+
+			timestamp += Fifo_cache_size + 1u;
+			uint32_t patch_misses = 0u;
+			for (size_t i = start; i < end; ++i) {
+				patch_misses += UpdateFifoCache(&indices[i * 3u], Fifo_cache_size, timestamps, timestamp);
+			}
+			float cluster_threshold = threshold * static_cast<float>(patch_misses) / static_cast<float>(end - start);
+
+			timestamp += Fifo_cache_size + 1u;
+			clusters.push_back(static_cast<uint32_t>(start));
+			size_t cluster_start = start;
+			uint32_t cluster_misses = 0u;
+			for (size_t i = start; i < end; ++i) {
+				cluster_misses += UpdateFifoCache(&indices[i * 3u], Fifo_cache_size, timestamps, timestamp);
+
+				if (i + 1u < end && static_cast<float>(cluster_misses) / static_cast<float>(i - cluster_start + 1u) <= cluster_threshold) {
+					cluster_start = i + 1u;
+					cluster_misses = 0u;
+					timestamp += Fifo_cache_size + 1u;
+					clusters.push_back(static_cast<uint32_t>(cluster_start));
+				}
+			}
+		}
+
+		// Sort clusters so the ones facing away from the mesh centroid are drawn first,
+		// they are the most likely to occlude the rest.
+		float mesh_centroid[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			const float* position = GetPosition(positions, position_stride, static_cast<uint32_t>(i));
+			mesh_centroid[0] += position[0];
+			mesh_centroid[1] += position[1];
+			mesh_centroid[2] += position[2];
+		}
+		if (vertex_count > 0u) {
+			float inv_count = 1.0f / static_cast<float>(vertex_count);
+			mesh_centroid[0] *= inv_count;
+			mesh_centroid[1] *= inv_count;
+			mesh_centroid[2] *= inv_count;
+		}
+
+		std::vector<float> cluster_sort_keys(clusters.size());
+		for (size_t c = 0u; c < clusters.size(); ++c) {
+			size_t start = clusters[c];
+			size_t end = c + 1u < clusters.size() ? clusters[c + 1u] : face_count;
+
+			float centroid[3] = { 0.0f, 0.0f, 0.0f };
+			float normal[3] = { 0.0f, 0.0f, 0.0f };
+			float cluster_area = 0.0f;
+			for (size_t i = start; i < end; ++i) {
+				const float* p0 = GetPosition(positions, position_stride, indices[i * 3u + 0u]);
+				const float* p1 = GetPosition(positions, position_stride, indices[i * 3u + 1u]);
+				const float* p2 = GetPosition(positions, position_stride, indices[i * 3u + 2u]);
+
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				for (int k = 0; k < 3; ++k) {
+					centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+					normal[k] += n[k];
+				}
+				cluster_area += area;
+			}
+
+			float inv_area = cluster_area > 0.0f ? 1.0f / cluster_area : 0.0f;
+			float normal_length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			float inv_normal_length = normal_length > 0.0f ? 1.0f / normal_length : 0.0f;
+
+			float sort_key = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				sort_key += (centroid[k] * inv_area - mesh_centroid[k]) * (normal[k] * inv_normal_length);
+			}
+			cluster_sort_keys[c] = sort_key;
+		}
+
+		std::vector<uint32_t> cluster_order(clusters.size());
+		for (size_t c = 0u; c < clusters.size(); ++c) {
+			cluster_order[c] = static_cast<uint32_t>(c);
+		}
+		std::stable_sort(cluster_order.begin(), cluster_order.end(), [&cluster_sort_keys](uint32_t lhs, uint32_t rhs) { return cluster_sort_keys[lhs] > cluster_sort_keys[rhs]; });
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t c : cluster_order) {
+			size_t start = clusters[c];
+			size_t end = c + 1u < clusters.size() ? clusters[c + 1u] : face_count;
+			result.insert(result.end(), indices.cbegin() + start * 3u, indices.cbegin() + end * 3u);
+		}
+
+		indices.swap(result);
+	}
+
+	size_t OptimizeVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertex_count) {
+		remap.assign(vertex_count, InvalidIndex);
+
+		uint32_t next_vertex = 0u;
+		for (uint32_t index : indices) {
+			if (remap[index] == InvalidIndex) {
+				remap[index] = next_vertex++;
+			}
+		}
+
+		return next_vertex;
+	}
+
+	void RemapIndexBuffer(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap) {
+		for (uint32_t& index : indices) {
+			index = remap[index];
+		}
+	}
+
+	std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, size_t target_index_count, float target_error, float* result_error) {
+		std::vector<uint32_t> result = indices;
+		float max_error = 0.0f;
+
+		if (result.empty() || vertex_count == 0u) {
+			if (result_error) {
+				*result_error = max_error;
+			}
+			return result;
+		}
+
+		// Work in a unit cube so errors are relative to the mesh size.
+		float min_position[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max_position[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			const float* position = GetPosition(positions, position_stride, static_cast<uint32_t>(i));
+			for (int k = 0; k < 3; ++k) {
+				min_position[k] = std::min(min_position[k], position[k]);
+				max_position[k] = std::max(max_position[k], position[k]);
+			}
+		}
+		float extent = std::max({ max_position[0] - min_position[0], max_position[1] - min_position[1], max_position[2] - min_position[2] });
+		float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+		std::vector<float> scaled_positions(vertex_count * 3u);
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			const float* position = GetPosition(positions, position_stride, static_cast<uint32_t>(i));
+			for (int k = 0; k < 3; ++k) {
+				scaled_positions[i * 3u + k] = (position[k] - min_position[k]) * scale;
+			}
+		}
+
+		// A directed edge without its opposite is an open border or an attribute seam, where
+		// moving a vertex would tear the surface apart. Those vertices are locked.
+		std::vector<bool> locked(vertex_count, false);
+		{
+			std::unordered_set<uint64_t> edges;
+			edges.reserve(result.size());
+			for (size_t i = 0u; i < result.size(); i += 3u) {
+				for (int k = 0; k < 3; ++k) {
+					uint64_t a = result[i + k];
+					uint64_t b = result[i + (k + 1) % 3];
+					edges.insert((a << 32) | b);
+				}
+			}
+			for (size_t i = 0u; i < result.size(); i += 3u) {
+				for (int k = 0; k < 3; ++k) {
+					uint64_t a = result[i + k];
+					uint64_t b = result[i + (k + 1) % 3];
+					if (edges.find((b << 32) | a) == edges.end()) {
+						locked[a] = true;
+						locked[b] = true;
+					}
+				}
+			}
+		}
+
+		std::vector<Quadric> quadrics(vertex_count, Quadric{});
+		for (size_t i = 0u; i < result.size(); i += 3u) {
+			const float* p0 = &scaled_positions[result[i + 0u] * 3u];
+			const float* p1 = &scaled_positions[result[i + 1u] * 3u];
+			const float* p2 = &scaled_positions[result[i + 2u] * 3u];
+
+			Quadric q = {};
+			AddPlaneQuadric(q, p0, p1, p2);
+			AddQuadric(quadrics[result[i + 0u]], q);
+			AddQuadric(quadrics[result[i + 1u]], q);
+			AddQuadric(quadrics[result[i + 2u]], q);
+		}
+
+		const double error_limit = static_cast<double>(target_error) * static_cast<double>(target_error);
+
+		std::vector<uint32_t> remap(vertex_count);
+		std::vector<bool> touched(vertex_count);
+		std::vector<uint32_t> triangle_offsets(vertex_count + 1u);
+		std::vector<uint32_t> adjacent_triangles;
+		std::vector<Collapse> collapses;
+
+		// Every pass collapses a set of independent edges, cheapest first, then rebuilds the index buffer.
+		while (result.size() > target_index_count) {
+			std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0u);
+			for (uint32_t index : result) {
+				++triangle_offsets[index + 1u];
+			}
+			for (size_t i = 0u; i < vertex_count; ++i) {
+				triangle_offsets[i + 1u] += triangle_offsets[i];
+			}
+			adjacent_triangles.resize(result.size());
+			std::vector<uint32_t> fill_offsets(triangle_offsets.cbegin(), triangle_offsets.cend() - 1);
+			for (size_t i = 0u; i < result.size(); ++i) {
+				adjacent_triangles[fill_offsets[result[i]]++] = static_cast<uint32_t>(i / 3u);
+			}
+
+			collapses.clear();
+			for (size_t i = 0u; i < result.size(); i += 3u) {
+				for (int k = 0; k < 3; ++k) {
+					uint32_t v0 = result[i + k];
+					uint32_t v1 = result[i + (k + 1) % 3];
+
+					// Each interior edge is seen from both triangles, keep one of them.
+					if (v0 > v1 && !locked[v0] && !locked[v1]) {
+						continue;
+					}
+
+					Quadric q = quadrics[v0];
+					AddQuadric(q, quadrics[v1]);
+					double weight = std::max(QuadricWeight(q), 1e-12);
+
+					double error01 = locked[v0] ? DBL_MAX : QuadricError(q, &scaled_positions[v1 * 3u]) / weight;
+					double error10 = locked[v1] ? DBL_MAX : QuadricError(q, &scaled_positions[v0 * 3u]) / weight;
+					double error = std::min(error01, error10);
+					if (error > error_limit) {
+						continue;
+					}
+
+					if (error01 <= error10) {
+						collapses.push_back({ v0, v1, static_cast<float>(error) });
+					}
+					else {
+						collapses.push_back({ v1, v0, static_cast<float>(error) });
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.Error < rhs.Error; });
+
+			for (size_t i = 0u; i < vertex_count; ++i) {
+				remap[i] = static_cast<uint32_t>(i);
+			}
+			std::fill(touched.begin(), touched.end(), false);
+
+			// An interior edge collapse removes two triangles.
+			size_t triangles_to_remove = (result.size() - target_index_count) / 3u;
+			size_t triangles_removed = 0u;
+			size_t applied_collapses = 0u;
+			for (const Collapse& collapse : collapses) {
+				if (triangles_removed >= triangles_to_remove) {
+					break;
+				}
+				if (touched[collapse.Source] || touched[collapse.Target]) {
+					continue;
+				}
+				if (CollapseFlipsTriangle(result, triangle_offsets, adjacent_triangles, scaled_positions, collapse.Source, collapse.Target)) {
+					continue;
+				}
+
+				// The neighbourhood of both vertices changes, so they wait for the next pass.
+				for (uint32_t j = triangle_offsets[collapse.Source]; j < triangle_offsets[collapse.Source + 1u]; ++j) {
+					const uint32_t* triangle = &result[adjacent_triangles[j] * 3u];
+					touched[triangle[0]] = true;
+					touched[triangle[1]] = true;
+					touched[triangle[2]] = true;
+				}
+
+				remap[collapse.Source] = collapse.Target;
+				AddQuadric(quadrics[collapse.Target], quadrics[collapse.Source]);
+
+				max_error = std::max(max_error, collapse.Error);
+				triangles_removed += 2u;
+				++applied_collapses;
+			}
+
+			if (applied_collapses == 0u) {
+				break;
+			}
+
+			size_t write = 0u;
+			for (size_t i = 0u; i < result.size(); i += 3u) {
+				uint32_t a = remap[result[i + 0u]];
+				uint32_t b = remap[result[i + 1u]];
+				uint32_t c = remap[result[i + 2u]];
+				if (a != b && b != c && a != c) {
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+			}
+			result.resize(write);
+		}
+
+		if (result_error) {
+			*result_error = std::sqrt(max_error);
+		}
+
+		return result;
+	}
+
+	std::vector<Meshlet> BuildMeshlets(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, size_t max_vertices, size_t max_triangles) {
+		std::vector<Meshlet> meshlets;
+
+		const size_t face_count = indices.size() / 3u;
+		if (face_count == 0u) {
+			return meshlets;
+		}
+
+		// Vertices are tagged with the id of the last meshlet that used them.
+		std::vector<uint32_t> vertex_meshlet(vertex_count, InvalidIndex);
+		std::vector<uint32_t> meshlet_vertices;
+		meshlet_vertices.reserve(max_vertices);
+
+		size_t start_face = 0u;
+		auto finish_meshlet = [&](size_t end_face) {
+			Meshlet meshlet = {};
+			meshlet.StartIndex = static_cast<uint32_t>(start_face * 3u);
+			meshlet.IndexCount = static_cast<uint32_t>((end_face - start_face) * 3u);
+
+			float min_position[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float max_position[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t vertex : meshlet_vertices) {
+				const float* position = GetPosition(positions, position_stride, vertex);
+				for (int k = 0; k < 3; ++k) {
+					min_position[k] = std::min(min_position[k], position[k]);
+					max_position[k] = std::max(max_position[k], position[k]);
+				}
+			}
+
+			float radius_squared = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				meshlet.Center[k] = (min_position[k] + max_position[k]) * 0.5f;
+			}
+			for (uint32_t vertex : meshlet_vertices) {
+				const float* position = GetPosition(positions, position_stride, vertex);
+				float d[3] = { position[0] - meshlet.Center[0], position[1] - meshlet.Center[1], position[2] - meshlet.Center[2] };
+				radius_squared = std::max(radius_squared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			}
+			meshlet.Radius = std::sqrt(radius_squared);
+
+			// Normal cone from the unit face normals, the axis is their normalized average and the
+			// spread is given by the normal that deviates the most from it.
+			std::vector<float> normals;
+			normals.reserve((end_face - start_face) * 3u);
+			float axis[3] = { 0.0f, 0.0f, 0.0f };
+			for (size_t i = start_face; i < end_face; ++i) {
+				const float* p0 = GetPosition(positions, position_stride, indices[i * 3u + 0u]);
+				const float* p1 = GetPosition(positions, position_stride, indices[i * 3u + 1u]);
+				const float* p2 = GetPosition(positions, position_stride, indices[i * 3u + 2u]);
+
+				float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length <= 0.0f) {
+					continue;
+				}
+
+				for (int k = 0; k < 3; ++k) {
+					normals.push_back(n[k] / length);
+					axis[k] += n[k] / length;
+				}
+			}
+
+			float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			meshlet.ConeCutoff = 1.0f;
+			if (axis_length > 0.0f) {
+				for (int k = 0; k < 3; ++k) {
+					meshlet.ConeAxis[k] = axis[k] / axis_length;
+				}
+
+				float min_dot = 1.0f;
+				for (size_t i = 0u; i < normals.size(); i += 3u) {
+					float dot = normals[i + 0u] * meshlet.ConeAxis[0] + normals[i + 1u] * meshlet.ConeAxis[1] + normals[i + 2u] * meshlet.ConeAxis[2];
+					min_dot = std::min(min_dot, dot);
+				}
+
+				// Cones of 90 degrees or wider contain both front and back facing directions.
+				if (min_dot > 0.0f) {
+					meshlet.ConeCutoff = std::sqrt(1.0f - min_dot * min_dot);
+				}
+			}
+
+			meshlets.push_back(meshlet);
+		};
+
+		for (size_t i = 0u; i < face_count; ++i) {
+			const uint32_t* triangle = &indices[i * 3u];
+			const uint32_t meshlet_id = static_cast<uint32_t>(meshlets.size());
+
+			size_t new_vertices = 0u;
+			for (int k = 0; k < 3; ++k) {
+				bool seen_in_triangle = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+				if (vertex_meshlet[triangle[k]] != meshlet_id && !seen_in_triangle) {
+					++new_vertices;
+				}
+			}
+
+			if (meshlet_vertices.size() + new_vertices > max_vertices || i - start_face >= max_triangles) {
+				finish_meshlet(i);
+				start_face = i;
+				meshlet_vertices.clear();
+			}
+
+			const uint32_t current_id = static_cast<uint32_t>(meshlets.size());
+			for (int k = 0; k < 3; ++k) {
+				if (vertex_meshlet[triangle[k]] != current_id) {
+					vertex_meshlet[triangle[k]] = current_id;
+					meshlet_vertices.push_back(triangle[k]);
+				}
+			}
+		}
+		finish_meshlet(face_count);
+
+		return meshlets;
+	}
+
+	VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size) {
+		VertexCacheStatistics statistics = {};
+
+		const size_t face_count = indices.size() / 3u;
+		if (face_count == 0u || vertex_count == 0u) {
+			return statistics;
+		}
+
+		std::vector<uint32_t> timestamps(vertex_count, 0u);
+		uint32_t timestamp = cache_size + 1u;
+		for (size_t i = 0u; i < face_count; ++i) {
+			statistics.VerticesTransformed += UpdateFifoCache(&indices[i * 3u], cache_size, timestamps, timestamp);
+		}
+
+		statistics.ACMR = static_cast<float>(statistics.VerticesTransformed) / static_cast<float>(face_count);
+		statistics.ATVR = static_cast<float>(statistics.VerticesTransformed) / static_cast<float>(vertex_count);
+
+		return statistics;
+	}
+
+	OverdrawStatistics AnalyzeOverdraw(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride) {
+		OverdrawStatistics statistics = {};
+
+		const size_t face_count = indices.size() / 3u;
+		if (face_count == 0u || vertex_count == 0u) {
+			return statistics;
+		}
+
+		float min_position[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max_position[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0u; i < vertex_count; ++i) {
+			const float* position = GetPosition(positions, position_stride, static_cast<uint32_t>(i));
+			for (int k = 0; k < 3; ++k) {
+				min_position[k] = std::min(min_position[k], position[k]);
+				max_position[k] = std::max(max_position[k], position[k]);
+			}
+		}
+
+		float extent = std::max({ max_position[0] - min_position[0], max_position[1] - min_position[1], max_position[2] - min_position[2] });
+		float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+		// Orthographic views along the three axes from both sides. Flipping the view mirrors
+		// x, which also flips the winding, so each side culls the opposite faces.
+		std::vector<float> depth_buffer(Overdraw_grid_size * Overdraw_grid_size);
+		for (int axis = 0; axis < 3; ++axis) {
+			for (int flip = 0; flip < 2; ++flip) {
+				std::fill(depth_buffer.begin(), depth_buffer.end(), FLT_MAX);
+
+				for (size_t i = 0u; i < face_count; ++i) {
+					float triangle[3][3];
+					for (int k = 0; k < 3; ++k) {
+						const float* position = GetPosition(positions, position_stride, indices[i * 3u + k]);
+						float x = (position[(axis + 1) % 3] - min_position[(axis + 1) % 3]) * scale;
+						float y = (position[(axis + 2) % 3] - min_position[(axis + 2) % 3]) * scale;
+						float z = (position[axis] - min_position[axis]) * scale;
+
+						triangle[k][0] = (flip ? 1.0f - x : x) * static_cast<float>(Overdraw_grid_size - 1);
+						triangle[k][1] = y * static_cast<float>(Overdraw_grid_size - 1);
+						triangle[k][2] = flip ? 1.0f - z : z;
+					}
+
+					RasterizeTriangle(depth_buffer, statistics.PixelsShaded, triangle[0], triangle[1], triangle[2]);
+				}
+
+				for (float depth : depth_buffer) {
+					statistics.PixelsCovered += depth < FLT_MAX ? 1u : 0u;
+				}
+			}
+		}
+
+		statistics.Overdraw = statistics.PixelsCovered > 0u ? static_cast<float>(statistics.PixelsShaded) / static_cast<float>(statistics.PixelsCovered) : 0.0f;
+
+		return statistics;
+	}
+
+	VertexFetchStatistics AnalyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertex_count, size_t vertex_size) {
+		VertexFetchStatistics statistics = {};
+
+		if (indices.empty() || vertex_count == 0u || vertex_size == 0u) {
+			return statistics;
+		}
+
+		size_t line_count = (vertex_count * vertex_size + Fetch_cache_line_size - 1u) / Fetch_cache_line_size;
+		std::vector<uint32_t> timestamps(line_count, 0u);
+		uint32_t timestamp = Fetch_cache_line_count + 1u;
+
+		for (uint32_t index : indices) {
+			size_t first_line = (index * vertex_size) / Fetch_cache_line_size;
+			size_t last_line = (index * vertex_size + vertex_size - 1u) / Fetch_cache_line_size;
+			for (size_t line = first_line; line <= last_line; ++line) {
+				if (timestamp - timestamps[line] > Fetch_cache_line_count) {
+					timestamps[line] = timestamp++;
+					statistics.BytesFetched += Fetch_cache_line_size;
+				}
+			}
+		}
+
+		statistics.Overfetch = static_cast<float>(statistics.BytesFetched) / static_cast<float>(vertex_count * vertex_size);
+
+		return statistics;
+	}
+}
\ No newline at end of file
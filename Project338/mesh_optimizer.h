@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Import time reordering of indexed triangle lists. The passes are meant to run in order:
+// vertex cache optimization, overdraw aware cluster sort (which keeps most of the cache
+// efficiency), and finally vertex fetch remapping which renumbers vertices in order of use.
+// Positions are read from a strided float3 stream so any vertex structure can be passed in.
+namespace MeshOptimizer {
+	constexpr uint32_t InvalidIndex = ~0u;
+
+	struct VertexCacheStatistics {
+		uint32_t VerticesTransformed;
+		float ACMR; // Transformed vertices per triangle, 0.5 is ideal for regular grids, 3.0 is worst.
+		float ATVR; // Transformed vertices per vertex, 1.0 is ideal.
+	};
+
+	struct OverdrawStatistics {
+		uint32_t PixelsCovered;
+		uint32_t PixelsShaded;
+		float Overdraw; // Shaded per covered pixel, 1.0 is ideal.
+	};
+
+	// A contiguous range of triangles with bounds for cluster culling. The normal cone is
+	// stored as axis and cutoff: all triangles face away from a viewer at position p when
+	// dot(Center - p, ConeAxis) >= ConeCutoff * length(Center - p) + Radius.
+	// A cutoff of one means the cone is too wide to ever cull.
+	struct Meshlet {
+		uint32_t StartIndex;
+		uint32_t IndexCount;
+		float Center[3];
+		float Radius;
+		float ConeAxis[3];
+		float ConeCutoff;
+	};
+
+	struct VertexFetchStatistics {
+		uint32_t BytesFetched;
+		float Overfetch; // Fetched bytes per vertex buffer byte, 1.0 is ideal.
+	};
+
+	// Forsyth's linear speed vertex cache optimization.
+	void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+	// Splits the cache optimized index buffer into clusters and sorts them so that outward
+	// facing clusters are drawn first. A threshold of 1.05 allows ACMR to grow by at most 5%.
+	void OptimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, float threshold = 1.05f);
+
+	// Fills remap with the new position of every vertex in order of first use, unused vertices
+	// get InvalidIndex. Returns the number of referenced vertices.
+	size_t OptimizeVertexFetchRemap(std::vector<uint32_t>& remap, const std::vector<uint32_t>& indices, size_t vertex_count);
+
+	void RemapIndexBuffer(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap);
+
+	template<typename T>
+	void RemapVertexBuffer(std::vector<T>& vertices, const std::vector<uint32_t>& remap, size_t unique_vertex_count) {
+		std::vector<T> remapped_vertices(unique_vertex_count);
+		for (size_t i = 0u; i < vertices.size(); ++i) {
+			if (remap[i] != InvalidIndex) {
+				remapped_vertices[remap[i]] = vertices[i];
+			}
+		}
+		vertices.swap(remapped_vertices);
+	}
+
+	// Quadric error edge collapse towards target_index_count. Vertices are only moved onto
+	// other existing vertices, so the result indexes the same vertex buffer. Vertices on open
+	// borders and attribute seams stay in place. Errors are relative to the mesh extent, the
+	// collapse stops before exceeding target_error and the reached error goes to result_error.
+	std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, size_t target_index_count, float target_error, float* result_error = nullptr);
+
+	// Splits the triangle list into meshlets of at most max_vertices unique vertices and
+	// max_triangles triangles in its current order, which keeps the cache optimized order
+	// and makes every meshlet a contiguous index range.
+	std::vector<Meshlet> BuildMeshlets(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride, size_t max_vertices = 64u, size_t max_triangles = 124u);
+
+	VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, uint32_t cache_size = 16u);
+	OverdrawStatistics AnalyzeOverdraw(const std::vector<uint32_t>& indices, const float* positions, size_t vertex_count, size_t position_stride);
+	VertexFetchStatistics AnalyzeVertexFetch(const std::vector<uint32_t>& indices, size_t vertex_count, size_t vertex_size);
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "mip_generator.h"
+
+#include "pixel_convert.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <xmmintrin.h>
+
+#include <DirectXTex/DirectXTex.h>
+
+namespace MipGenerator {
+	static std::atomic<Filter> Mip_filter(Filter::Box);
+
+	// Destination rows per task, enough work to amortize the vertical pass buffer.
+	constexpr size_t Band_rows = 8u;
+
+	constexpr double Kaiser_radius = 3.0;
+	constexpr double Kaiser_alpha = 4.0;
+	constexpr double Pi = 3.14159265358979323846;
+
+	// The source texels one destination texel reads along one axis. Taps past the edges
+	// are folded onto the edge texels, so every tap range lies inside the source.
+	struct Kernel {
+		struct Taps {
+			size_t First;
+			size_t Count;
+			size_t WeightOffset;
+		};
+
+		std::vector<Taps> Destination;
+		std::vector<float> Weights;
+	};
+
+	inline double BesselI0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; ++k) {
+			term *= (x * 0.5 / k) * (x * 0.5 / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	inline double KaiserWeight(double x) {
+		if (std::abs(x) >= Kaiser_radius) {
+			return 0.0;
+		}
+
+		double sinc = x == 0.0 ? 1.0 : std::sin(Pi * x) / (Pi * x);
+		double t = x / Kaiser_radius;
+		return sinc * BesselI0(Kaiser_alpha * std::sqrt(1.0 - t * t)) / BesselI0(Kaiser_alpha);
+	}
+
+	static Kernel BuildKernel(size_t source_size, size_t destination_size, Filter filter) {
+		const double scale = static_cast<double>(source_size) / destination_size;
+		const double radius = filter == Filter::Box ? scale * 0.5 : Kaiser_radius * scale;
+
+		Kernel kernel;
+		kernel.Destination.reserve(destination_size);
+
+		std::vector<double> weights;
+		for (size_t i = 0u; i < destination_size; ++i) {
+			double center = (i + 0.5) * scale;
+			ptrdiff_t first = static_cast<ptrdiff_t>(std::floor(center - radius));
+			ptrdiff_t last = static_cast<ptrdiff_t>(std::ceil(center + radius));
+
+			size_t clamped_first = static_cast<size_t>(std::max<ptrdiff_t>(first, 0));
+			size_t clamped_last = static_cast<size_t>(std::min<ptrdiff_t>(last, source_size - 1u));
+			weights.assign(clamped_last - clamped_first + 1u, 0.0);
+
+			double sum = 0.0;
+			for (ptrdiff_t s = first; s <= last; ++s) {
+				double weight = 0.0;
+				if (filter == Filter::Box) {
+					weight = std::max(0.0, std::min<double>(s + 1, center + radius) - std::max<double>(s, center - radius));
+				}
+				else {
+					weight = KaiserWeight((s + 0.5 - center) / scale);
+				}
+
+				size_t index = static_cast<size_t>(std::clamp<ptrdiff_t>(s, 0, source_size - 1u));
+				weights[index - clamped_first] += weight;
+				sum += weight;
+			}
+
+			kernel.Destination.push_back({ clamped_first, weights.size(), kernel.Weights.size() });
+			for (double weight : weights) {
+				kernel.Weights.push_back(static_cast<float>(weight / sum));
+			}
+		}
+
+		return kernel;
+	}
+
+	// Converts a row of the image to linear float4 texels.
+	inline void DecodeRow(const uint8_t* pixels, DXGI_FORMAT format, size_t width, float* texels) {
+		switch (format) {
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+				PixelConvert::SRGBA8ToLinearFloat4(pixels, texels, width);
+				break;
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+				PixelConvert::RGBA8ToFloat4(pixels, texels, width);
+				break;
+			default:
+				std::memcpy(texels, pixels, width * 4u * sizeof(float));
+				break;
+		}
+	}
+
+	inline void EncodeRow(const float* texels, DXGI_FORMAT format, size_t width, uint8_t* pixels) {
+		switch (format) {
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+				PixelConvert::LinearFloat4ToSRGBA8(texels, pixels, width);
+				break;
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+				PixelConvert::Float4ToRGBA8(texels, pixels, width);
+				break;
+			default: {
+				// The negative lobes of the Kaiser filter can ring below zero.
+				float* destination = reinterpret_cast<float*>(pixels);
+				for (size_t x = 0u; x < width; ++x) {
+					_mm_storeu_ps(destination + x * 4u, _mm_max_ps(_mm_loadu_ps(texels + x * 4u), _mm_setzero_ps()));
+				}
+				break;
+			}
+		}
+	}
+
+	bool IsSupported(const DirectX::TexMetadata& metadata) {
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1u || metadata.depth != 1u) {
+			return false;
+		}
+
+		switch (metadata.format) {
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+			case DXGI_FORMAT_R32G32B32A32_FLOAT:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	void Generate(const DirectX::ScratchImage& source, Filter filter, ThreadPool& thread_pool, DirectX::ScratchImage& mip_chain) {
+		const DirectX::TexMetadata& metadata = source.GetMetadata();
+		if (!IsSupported(metadata)) {
+			throw std::exception("Mip generation is only supported for RGBA 2D textures.");
+		}
+
+		const DXGI_FORMAT format = metadata.format;
+		ThrowIfFailed(mip_chain.Initialize2D(format, metadata.width, metadata.height, 1u, 0u));
+
+		const size_t mip_levels = mip_chain.GetMetadata().mipLevels;
+		const DirectX::Image& top_image = *source.GetImage(0u, 0u, 0u);
+
+		// Texels of the level the next one is filtered from, rows are tightly packed.
+		size_t width = metadata.width;
+		size_t height = metadata.height;
+		std::vector<float> texels(width * height * 4u);
+
+		const DirectX::Image& top_mip = *mip_chain.GetImage(0u, 0u, 0u);
+		thread_pool.ParallelFor((height + Band_rows - 1u) / Band_rows, [&](size_t band) {
+			for (size_t y = band * Band_rows; y < std::min(height, (band + 1u) * Band_rows); ++y) {
+				const uint8_t* pixels = top_image.pixels + y * top_image.rowPitch;
+				std::memcpy(top_mip.pixels + y * top_mip.rowPitch, pixels, std::min(top_image.rowPitch, top_mip.rowPitch));
+				DecodeRow(pixels, format, width, texels.data() + y * width * 4u);
+			}
+		});
+
+		std::vector<float> next_texels;
+		for (size_t level = 1u; level < mip_levels; ++level) {
+			const size_t next_width = std::max<size_t>(width / 2u, 1u);
+			const size_t next_height = std::max<size_t>(height / 2u, 1u);
+			const Kernel horizontal = BuildKernel(width, next_width, filter);
+			const Kernel vertical = BuildKernel(height, next_height, filter);
+			const DirectX::Image& mip = *mip_chain.GetImage(level, 0u, 0u);
+
+			next_texels.assign(next_width * next_height * 4u, 0.0f);
+			thread_pool.ParallelFor((next_height + Band_rows - 1u) / Band_rows, [&](size_t band) {
+				std::vector<float> column_sums(width * 4u);
+				for (size_t y = band * Band_rows; y < std::min(next_height, (band + 1u) * Band_rows); ++y) {
+					// Vertical pass into one row at the source width.
+					const Kernel::Taps& row_taps = vertical.Destination[y];
+					std::fill(column_sums.begin(), column_sums.end(), 0.0f);
+					for (size_t k = 0u; k < row_taps.Count; ++k) {
+						const float* source_row = texels.data() + (row_taps.First + k) * width * 4u;
+						const __m128 weight = _mm_set1_ps(vertical.Weights[row_taps.WeightOffset + k]);
+						for (size_t x = 0u; x < width; ++x) {
+							__m128 sum = _mm_loadu_ps(column_sums.data() + x * 4u);
+							_mm_storeu_ps(column_sums.data() + x * 4u, _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(source_row + x * 4u), weight)));
+						}
+					}
+
+					// Horizontal pass into the destination row.
+					float* next_row = next_texels.data() + y * next_width * 4u;
+					for (size_t x = 0u; x < next_width; ++x) {
+						const Kernel::Taps& taps = horizontal.Destination[x];
+						__m128 sum = _mm_setzero_ps();
+						for (size_t k = 0u; k < taps.Count; ++k) {
+							__m128 texel = _mm_loadu_ps(column_sums.data() + (taps.First + k) * 4u);
+							sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(horizontal.Weights[taps.WeightOffset + k])));
+						}
+						_mm_storeu_ps(next_row + x * 4u, sum);
+					}
+
+					EncodeRow(next_row, format, next_width, mip.pixels + y * mip.rowPitch);
+				}
+			});
+
+			texels.swap(next_texels);
+			width = next_width;
+			height = next_height;
+		}
+	}
+
+	bool GenerateInPlace(DirectX::ScratchImage& image) {
+		const DirectX::TexMetadata& metadata = image.GetMetadata();
+		if (metadata.mipLevels > 1u || (metadata.width == 1u && metadata.height == 1u)) {
+			return true;
+		}
+		if (!IsSupported(metadata)) {
+			return false;
+		}
+
+		DirectX::ScratchImage mip_chain;
+		Generate(image, Mip_filter, ThreadPool::Get(), mip_chain);
+		image = std::move(mip_chain);
+		return true;
+	}
+
+	void SetFilter(Filter filter) {
+		Mip_filter = filter;
+	}
+
+	Filter GetFilter() {
+		return Mip_filter;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+class ThreadPool;
+
+namespace DirectX {
+	class ScratchImage;
+	struct TexMetadata;
+}
+
+// CPU mip chain generation for textures at load and cook time, so the GPU never has to
+// generate mips for a loaded texture. Filtering happens on float4 texels in linear space,
+// sRGB formats are decoded before and encoded after. Every level is filtered from the one
+// above it, the rows of a level are spread over the thread pool.
+namespace MipGenerator {
+	enum class Filter {
+		Box, // Averages the texels under the footprint, exact for power of two sizes.
+		Kaiser, // Kaiser windowed sinc over three destination texels, sharper but slower.
+	};
+
+	// 2D textures without arrays in R8G8B8A8_UNORM, R8G8B8A8_UNORM_SRGB or R32G32B32A32_FLOAT.
+	bool IsSupported(const DirectX::TexMetadata& metadata);
+
+	// Builds the full mip chain for the top level of source. The top level is copied as is.
+	void Generate(const DirectX::ScratchImage& source, Filter filter, ThreadPool& thread_pool, DirectX::ScratchImage& mip_chain);
+
+	// Generates the mip chain in place with the current filter on the shared thread pool if the
+	// image has a single level and a supported format. Returns true if the image has mips.
+	bool GenerateInPlace(DirectX::ScratchImage& image);
+
+	void SetFilter(Filter filter);
+	Filter GetFilter();
+}
\ No newline at end of file
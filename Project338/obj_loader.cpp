@@ -0,0 +1,829 @@
+#include "obj_loader.h"
+
+#include "io_service.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+using namespace DirectX;
+
+namespace ObjLoader {
+	// Chunks are big enough that splitting costs nothing, several per thread even out slow ones.
+	constexpr size_t Min_chunk_size = 256u * 1024u;
+	constexpr size_t Chunks_per_thread = 4u;
+
+	constexpr int32_t Missing_index = -1;
+
+	// Same crease angle as the smooth normals of the assimp import.
+	constexpr float Smoothing_angle = 80.0f;
+
+	const double Powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	// Indices are 0 based once parsed. Negative indices count back from the data parsed so far at
+	// the face, chunks only know their own data and keep them relative to the start of the chunk
+	// until the chunks before them are counted.
+	struct Corner {
+		int32_t Position;
+		int32_t TexCoord;
+		int32_t Normal;
+	};
+
+	struct MaterialRun {
+		size_t NameIndex;
+		size_t FirstCorner;
+	};
+
+	struct Chunk {
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT3> TexCoords;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<Corner> Corners; // Three per triangle
+		std::vector<size_t> RelativeCorners; // Corner index * 3 + component
+		std::vector<MaterialRun> MaterialRuns;
+		std::vector<std::string> MaterialNames;
+		std::vector<std::string> Libraries;
+		bool IsValid;
+	};
+
+	// Corners of a material in one chunk.
+	struct CornerRange {
+		size_t ChunkIndex;
+		size_t Begin;
+		size_t End;
+	};
+
+	struct VertexKey {
+		int32_t Position;
+		int32_t TexCoord;
+		int32_t Normal;
+		uint32_t GeneratedNormal[3];
+
+		bool operator==(const VertexKey& other) const {
+			return std::memcmp(this, &other, sizeof(VertexKey)) == 0;
+		}
+	};
+
+	struct VertexKeyHash {
+		size_t operator()(const VertexKey& key) const {
+			uint32_t words[sizeof(VertexKey) / sizeof(uint32_t)];
+			std::memcpy(words, &key, sizeof(words));
+
+			uint64_t hash = 0x9E3779B97F4A7C15ull;
+			for (uint32_t word : words) {
+				hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+				hash ^= hash >> 32u;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	inline bool IsDigit(char c) {
+		return static_cast<unsigned char>(c - '0') < 10u;
+	}
+
+	inline bool IsSpace(char c) {
+		return c == ' ' || c == '\t';
+	}
+
+	inline void SkipSpaces(const char*& text, const char* end) {
+		while (text < end && IsSpace(*text)) {
+			++text;
+		}
+	}
+
+	inline const char* FindLineEnd(const char* text, const char* end) {
+		const void* line_end = std::memchr(text, '\n', end - text);
+		return line_end ? static_cast<const char*>(line_end) : end;
+	}
+
+	// True if the statement at text is keyword followed by white space.
+	inline bool IsStatement(const char* text, const char* end, std::string_view keyword) {
+		return static_cast<size_t>(end - text) > keyword.size() && std::memcmp(text, keyword.data(), keyword.size()) == 0 && IsSpace(text[keyword.size()]);
+	}
+
+	// Rest of the line without surrounding white space and comments.
+	inline std::string ReadName(const char* text, const char* end) {
+		SkipSpaces(text, end);
+		const char* name_end = std::find(text, end, '#');
+		while (name_end > text && (IsSpace(name_end[-1]) || name_end[-1] == '\r')) {
+			--name_end;
+		}
+		return std::string(text, name_end);
+	}
+
+	// Both take eight bytes in memory order, the first character ends up in the lowest byte.
+	inline bool IsEightDigits(const char* text) {
+		uint64_t value;
+		std::memcpy(&value, text, sizeof(value));
+		return ((value & 0xF0F0F0F0F0F0F0F0ull) | (((value + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4u)) == 0x3333333333333333ull;
+	}
+
+	inline uint32_t ParseEightDigits(const char* text) {
+		uint64_t value;
+		std::memcpy(&value, text, sizeof(value));
+		value = (value & 0x0F0F0F0F0F0F0F0Full) * 2561u >> 8u;
+		value = (value & 0x00FF00FF00FF00FFull) * 6553601u >> 16u;
+		return static_cast<uint32_t>((value & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32u);
+	}
+
+	inline size_t ParseDigits(const char*& text, const char* end, uint64_t& mantissa) {
+		const char* start = text;
+		while (end - text >= 8 && IsEightDigits(text)) {
+			mantissa = mantissa * 100000000u + ParseEightDigits(text);
+			text += 8;
+		}
+		while (text < end && IsDigit(*text)) {
+			mantissa = mantissa * 10u + static_cast<uint64_t>(*text - '0');
+			++text;
+		}
+		return static_cast<size_t>(text - start);
+	}
+
+	bool ParseFloat(const char*& text, const char* end, float& value) {
+		const char* start = text;
+
+		bool is_negative = false;
+		if (text < end && (*text == '-' || *text == '+')) {
+			is_negative = *text == '-';
+			++text;
+		}
+
+		uint64_t mantissa = 0u;
+		size_t digit_count = ParseDigits(text, end, mantissa);
+		int32_t exponent = 0;
+		if (text < end && *text == '.') {
+			++text;
+			size_t fraction_digit_count = ParseDigits(text, end, mantissa);
+			digit_count += fraction_digit_count;
+			exponent = -static_cast<int32_t>(fraction_digit_count);
+		}
+		if (digit_count == 0u) {
+			text = start;
+			return false;
+		}
+
+		if (text < end && (*text == 'e' || *text == 'E')) {
+			const char* exponent_start = text++;
+			bool is_negative_exponent = false;
+			if (text < end && (*text == '-' || *text == '+')) {
+				is_negative_exponent = *text == '-';
+				++text;
+			}
+			int32_t exponent_value = 0;
+			const char* exponent_digits = text;
+			while (text < end && IsDigit(*text)) {
+				exponent_value = std::min(exponent_value * 10 + (*text - '0'), 100000);
+				++text;
+			}
+			if (text == exponent_digits) {
+				text = exponent_start;
+			}
+			else {
+				exponent += is_negative_exponent ? -exponent_value : exponent_value;
+			}
+		}
+
+		// Mantissa and power of ten are both exact as doubles here, so the double result is correctly rounded.
+		if (digit_count <= 19u && mantissa <= (1ull << 53u) && exponent >= -22 && exponent <= 22) {
+			double result = static_cast<double>(mantissa);
+			result = exponent < 0 ? result / Powers_of_ten[-exponent] : result * Powers_of_ten[exponent];
+			value = static_cast<float>(is_negative ? -result : result);
+			return true;
+		}
+
+		std::string number(start, text);
+		value = std::strtof(number.c_str(), nullptr);
+		return true;
+	}
+
+	inline bool ParseIndex(const char*& text, const char* end, int32_t& value) {
+		bool is_negative = false;
+		if (text < end && (*text == '-' || *text == '+')) {
+			is_negative = *text == '-';
+			++text;
+		}
+
+		const char* digits = text;
+		int64_t result = 0;
+		while (text < end && IsDigit(*text)) {
+			result = std::min<int64_t>(result * 10 + (*text - '0'), INT32_MAX);
+			++text;
+		}
+
+		value = static_cast<int32_t>(is_negative ? -result : result);
+		return text != digits;
+	}
+
+	// Missing components are 0, like the assimp import leaves them.
+	inline XMFLOAT3 ParseVector(const char* text, const char* end, size_t component_count) {
+		float values[3] = { 0.0f, 0.0f, 0.0f };
+		for (size_t i = 0u; i < component_count; ++i) {
+			SkipSpaces(text, end);
+			if (!ParseFloat(text, end, values[i])) {
+				break;
+			}
+		}
+		return XMFLOAT3(values[0], values[1], values[2]);
+	}
+
+	// Index as written to a 0 based one, negative ones become relative to the start of the chunk.
+	// The count is the number of elements the chunk has parsed before the face.
+	inline bool ResolveIndex(int32_t index, size_t count, bool& is_relative, int32_t& value) {
+		is_relative = index < 0;
+		value = is_relative ? static_cast<int32_t>(count) + index : index - 1;
+		return index != 0;
+	}
+
+	void ParseFace(const char* text, const char* end, Chunk& chunk, std::vector<Corner>& face, std::vector<uint32_t>& face_relative) {
+		face.clear();
+		face_relative.clear();
+		for (;;) {
+			SkipSpaces(text, end);
+			if (text >= end || *text == '\r' || *text == '#') {
+				break;
+			}
+
+			Corner corner = { Missing_index, Missing_index, Missing_index };
+			uint32_t relative = 0u;
+			bool is_relative = false;
+			int32_t index = 0;
+			if (!ParseIndex(text, end, index) || !ResolveIndex(index, chunk.Positions.size(), is_relative, corner.Position)) {
+				chunk.IsValid = false;
+				return;
+			}
+			relative |= is_relative ? 1u : 0u;
+
+			if (text < end && *text == '/') {
+				++text;
+				if (text < end && *text != '/') {
+					if (!ParseIndex(text, end, index) || !ResolveIndex(index, chunk.TexCoords.size(), is_relative, corner.TexCoord)) {
+						chunk.IsValid = false;
+						return;
+					}
+					relative |= is_relative ? 2u : 0u;
+				}
+				if (text < end && *text == '/') {
+					++text;
+					if (!ParseIndex(text, end, index) || !ResolveIndex(index, chunk.Normals.size(), is_relative, corner.Normal)) {
+						chunk.IsValid = false;
+						return;
+					}
+					relative |= is_relative ? 4u : 0u;
+				}
+			}
+			if (text < end && !IsSpace(*text) && *text != '\r') {
+				chunk.IsValid = false;
+				return;
+			}
+
+			face.push_back(corner);
+			face_relative.push_back(relative);
+		}
+
+		// Points and lines are dropped, like the assimp import does. Polygons become a fan.
+		for (size_t i = 2u; i < face.size(); ++i) {
+			size_t triangle[3] = { 0u, i - 1u, i };
+			for (size_t corner : triangle) {
+				for (size_t component = 0u; component < 3u; ++component) {
+					if (face_relative[corner] & (1u << component)) {
+						chunk.RelativeCorners.push_back(chunk.Corners.size() * 3u + component);
+					}
+				}
+				chunk.Corners.push_back(face[corner]);
+			}
+		}
+	}
+
+	void ParseChunk(const char* begin, const char* end, Chunk& chunk) {
+		chunk.IsValid = true;
+
+		std::vector<Corner> face;
+		std::vector<uint32_t> face_relative;
+		for (const char* line = begin; line < end && chunk.IsValid;) {
+			const char* line_end = FindLineEnd(line, end);
+			const char* text = line;
+			SkipSpaces(text, line_end);
+
+			if (IsStatement(text, line_end, "v")) {
+				chunk.Positions.push_back(ParseVector(text + 1, line_end, 3u));
+			}
+			else if (IsStatement(text, line_end, "vt")) {
+				chunk.TexCoords.push_back(ParseVector(text + 2, line_end, 3u));
+			}
+			else if (IsStatement(text, line_end, "vn")) {
+				chunk.Normals.push_back(ParseVector(text + 2, line_end, 3u));
+			}
+			else if (IsStatement(text, line_end, "f")) {
+				ParseFace(text + 1, line_end, chunk, face, face_relative);
+			}
+			else if (IsStatement(text, line_end, "usemtl")) {
+				chunk.MaterialRuns.push_back({ chunk.MaterialNames.size(), chunk.Corners.size() });
+				chunk.MaterialNames.push_back(ReadName(text + 6, line_end));
+			}
+			else if (IsStatement(text, line_end, "mtllib")) {
+				chunk.Libraries.push_back(ReadName(text + 6, line_end));
+			}
+
+			line = line_end + 1;
+		}
+	}
+
+	// Texture statements start with options, the file name is the rest of the line.
+	void ParseTexture(const char* text, const char* end, Material& material, std::string& texture) {
+		for (;;) {
+			SkipSpaces(text, end);
+			if (text >= end || *text != '-') {
+				break;
+			}
+
+			const char* option = text;
+			while (text < end && !IsSpace(*text)) {
+				++text;
+			}
+			std::string_view name(option, text - option);
+
+			size_t max_argument_count = name == "-mm" ? 2u : name == "-o" || name == "-s" || name == "-t" ? 3u : 1u;
+			for (size_t i = 0u; i < max_argument_count; ++i) {
+				SkipSpaces(text, end);
+				const char* argument = text;
+				float value = 0.0f;
+				bool is_number = ParseFloat(text, end, value) && (text >= end || IsSpace(*text));
+				if (name == "-bm" && is_number) {
+					material.BumpIntensity = value;
+					material.HasBumpIntensity = true;
+				}
+				if (!is_number && max_argument_count > 1u) {
+					text = argument;
+					break;
+				}
+				if (!is_number) {
+					while (text < end && !IsSpace(*text)) {
+						++text;
+					}
+				}
+			}
+		}
+
+		texture = ReadName(text, end);
+	}
+
+	inline XMFLOAT4 ParseColor(const char* text, const char* end) {
+		XMFLOAT3 color = ParseVector(text, end, 3u);
+		return XMFLOAT4(color.x, color.y, color.z, 1.0f);
+	}
+
+	Material CreateMaterial(std::string name) {
+		Material material = {};
+		material.Name = std::move(name);
+		material.AmbientColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		material.DiffuseColor = XMFLOAT4(0.6f, 0.6f, 0.6f, 1.0f);
+		material.SpecularColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		material.EmissiveColor = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		material.SpecularPower = 0.0f;
+		material.Opacity = 1.0f;
+		material.IndexOfRefraction = 1.0f;
+		material.BumpIntensity = 1.0f;
+		material.HasBumpIntensity = false;
+		return material;
+	}
+
+	void ParseMaterialLibrary(const char* begin, const char* end, std::vector<Material>& materials) {
+		Material* material = nullptr;
+		for (const char* line = begin; line < end;) {
+			const char* line_end = FindLineEnd(line, end);
+			const char* text = line;
+			SkipSpaces(text, line_end);
+
+			const char* keyword = text;
+			while (text < line_end && !IsSpace(*text) && *text != '\r') {
+				++text;
+			}
+			std::string_view statement(keyword, text - keyword);
+			line = line_end + 1;
+
+			if (statement == "newmtl") {
+				materials.push_back(CreateMaterial(ReadName(text, line_end)));
+				material = &materials.back();
+				continue;
+			}
+			if (!material) {
+				continue;
+			}
+
+			if (statement == "Ka") {
+				material->AmbientColor = ParseColor(text, line_end);
+			}
+			else if (statement == "Kd") {
+				material->DiffuseColor = ParseColor(text, line_end);
+			}
+			else if (statement == "Ks") {
+				material->SpecularColor = ParseColor(text, line_end);
+			}
+			else if (statement == "Ke") {
+				material->EmissiveColor = ParseColor(text, line_end);
+			}
+			else if (statement == "Ns") {
+				material->SpecularPower = ParseVector(text, line_end, 1u).x;
+			}
+			else if (statement == "d") {
+				material->Opacity = ParseVector(text, line_end, 1u).x;
+			}
+			else if (statement == "Tr") {
+				material->Opacity = 1.0f - ParseVector(text, line_end, 1u).x;
+			}
+			else if (statement == "Ni") {
+				material->IndexOfRefraction = ParseVector(text, line_end, 1u).x;
+			}
+			else if (statement == "map_Ka") {
+				ParseTexture(text, line_end, *material, material->AmbientTexture);
+			}
+			else if (statement == "map_Ke") {
+				ParseTexture(text, line_end, *material, material->EmissiveTexture);
+			}
+			else if (statement == "map_Kd") {
+				ParseTexture(text, line_end, *material, material->DiffuseTexture);
+			}
+			else if (statement == "map_Ks") {
+				ParseTexture(text, line_end, *material, material->SpecularTexture);
+			}
+			else if (statement == "map_Ns") {
+				ParseTexture(text, line_end, *material, material->SpecularPowerTexture);
+			}
+			else if (statement == "map_d") {
+				ParseTexture(text, line_end, *material, material->OpacityTexture);
+			}
+			else if (statement == "norm" || statement == "map_Kn") {
+				ParseTexture(text, line_end, *material, material->NormalTexture);
+			}
+			else if (statement == "map_bump" || statement == "map_Bump" || statement == "bump") {
+				ParseTexture(text, line_end, *material, material->BumpTexture);
+			}
+		}
+	}
+
+	// Degenerate triangles get a zero normal and don't take part in smoothing.
+	inline XMVECTOR GetFaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2) {
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+		return XMVector3Equal(normal, XMVectorZero()) ? normal : XMVector3Normalize(normal);
+	}
+
+	// Smooth normal for every corner, averaging the faces that share the corner position and
+	// lie within the smoothing angle. Positions are matched by value, like the assimp import does.
+	std::vector<XMFLOAT3> GenerateNormals(const std::vector<XMFLOAT3>& positions, const std::vector<Corner>& corners) {
+		size_t triangle_count = corners.size() / 3u;
+		std::vector<XMFLOAT3> face_normals(triangle_count);
+		for (size_t i = 0u; i < triangle_count; ++i) {
+			// Winding as written to the mesh, see BuildMesh.
+			XMStoreFloat3(&face_normals[i], GetFaceNormal(positions[corners[i * 3u].Position], positions[corners[i * 3u + 2u].Position], positions[corners[i * 3u + 1u].Position]));
+		}
+
+		auto position_less = [&positions, &corners](uint32_t a, uint32_t b) {
+			const XMFLOAT3& pa = positions[corners[a].Position];
+			const XMFLOAT3& pb = positions[corners[b].Position];
+			return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+		};
+		std::vector<uint32_t> order(corners.size());
+		for (size_t i = 0u; i < order.size(); ++i) {
+			order[i] = static_cast<uint32_t>(i);
+		}
+		std::sort(order.begin(), order.end(), position_less);
+
+		float min_cos = std::cos(XMConvertToRadians(Smoothing_angle));
+		std::vector<XMFLOAT3> normals(corners.size());
+		for (size_t begin = 0u; begin < order.size();) {
+			size_t end = begin + 1u;
+			while (end < order.size() && !position_less(order[begin], order[end])) {
+				++end;
+			}
+
+			for (size_t i = begin; i < end; ++i) {
+				XMVECTOR face_normal = XMLoadFloat3(&face_normals[order[i] / 3u]);
+				XMVECTOR normal = XMVectorZero();
+				for (size_t j = begin; j < end; ++j) {
+					XMVECTOR other_normal = XMLoadFloat3(&face_normals[order[j] / 3u]);
+					if (XMVectorGetX(XMVector3Dot(face_normal, other_normal)) >= min_cos) {
+						normal = XMVectorAdd(normal, other_normal);
+					}
+				}
+				XMStoreFloat3(&normals[order[i]], XMVector3Equal(normal, XMVectorZero()) ? normal : XMVector3Normalize(normal));
+			}
+
+			begin = end;
+		}
+
+		return normals;
+	}
+
+	// Per face tangents from the texture coordinate deltas, projected into the plane of each vertex
+	// normal and averaged over the faces of the vertex.
+	void GenerateTangents(std::vector<VertexPositionNormalTangentBitangentTexture>& vertices, const std::vector<uint32_t>& indices) {
+		std::vector<XMFLOAT3> tangents(vertices.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+		std::vector<XMFLOAT3> bitangents(vertices.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+		for (size_t i = 0u; i + 2u < indices.size(); i += 3u) {
+			const VertexPositionNormalTangentBitangentTexture& v0 = vertices[indices[i]];
+			const VertexPositionNormalTangentBitangentTexture& v1 = vertices[indices[i + 1u]];
+			const VertexPositionNormalTangentBitangentTexture& v2 = vertices[indices[i + 2u]];
+
+			XMVECTOR v = XMVectorSubtract(XMLoadFloat3(&v1.Position), XMLoadFloat3(&v0.Position));
+			XMVECTOR w = XMVectorSubtract(XMLoadFloat3(&v2.Position), XMLoadFloat3(&v0.Position));
+			float sx = v1.TexCoord.x - v0.TexCoord.x;
+			float sy = v1.TexCoord.y - v0.TexCoord.y;
+			float tx = v2.TexCoord.x - v0.TexCoord.x;
+			float ty = v2.TexCoord.y - v0.TexCoord.y;
+			float direction = tx * sy - ty * sx < 0.0f ? -1.0f : 1.0f;
+			if (sx * ty == sy * tx) {
+				sx = 0.0f;
+				sy = 1.0f;
+				tx = 1.0f;
+				ty = 0.0f;
+			}
+
+			XMVECTOR tangent = XMVectorScale(XMVectorSubtract(XMVectorScale(w, sy), XMVectorScale(v, ty)), direction);
+			XMVECTOR bitangent = XMVectorScale(XMVectorSubtract(XMVectorScale(w, sx), XMVectorScale(v, tx)), direction);
+			for (size_t corner = 0u; corner < 3u; ++corner) {
+				uint32_t index = indices[i + corner];
+				XMVECTOR normal = XMLoadFloat3(&vertices[index].Normal);
+				XMVECTOR local_tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(tangent, normal))));
+				XMVECTOR local_bitangent = XMVector3Normalize(XMVectorSubtract(bitangent, XMVectorMultiply(normal, XMVector3Dot(bitangent, normal))));
+				XMStoreFloat3(&tangents[index], XMVectorAdd(XMLoadFloat3(&tangents[index]), local_tangent));
+				XMStoreFloat3(&bitangents[index], XMVectorAdd(XMLoadFloat3(&bitangents[index]), local_bitangent));
+			}
+		}
+
+		for (size_t i = 0u; i < vertices.size(); ++i) {
+			XMVECTOR tangent = XMLoadFloat3(&tangents[i]);
+			XMVECTOR bitangent = XMLoadFloat3(&bitangents[i]);
+			XMStoreFloat3(&vertices[i].Tangent, XMVector3Equal(tangent, XMVectorZero()) ? tangent : XMVector3Normalize(tangent));
+			XMStoreFloat3(&vertices[i].Bitangent, XMVector3Equal(bitangent, XMVectorZero()) ? bitangent : XMVector3Normalize(bitangent));
+		}
+	}
+
+	void BuildMesh(const std::vector<Chunk>& chunks, const std::vector<CornerRange>& ranges, const std::vector<XMFLOAT3>& positions, const std::vector<XMFLOAT3>& tex_coords, const std::vector<XMFLOAT3>& normals, Mesh& mesh) {
+		std::vector<Corner> corners;
+		size_t corner_count = 0u;
+		for (const CornerRange& range : ranges) {
+			corner_count += range.End - range.Begin;
+		}
+		corners.reserve(corner_count);
+
+		// Triangles with two corners on the same position are dropped, like the assimp import drops them.
+		bool has_normals = false;
+		bool has_tex_coords = false;
+		for (const CornerRange& range : ranges) {
+			const std::vector<Corner>& chunk_corners = chunks[range.ChunkIndex].Corners;
+			for (size_t i = range.Begin; i + 2u < range.End; i += 3u) {
+				const Corner* triangle = &chunk_corners[i];
+				XMVECTOR p0 = XMLoadFloat3(&positions[triangle[0].Position]);
+				XMVECTOR p1 = XMLoadFloat3(&positions[triangle[1].Position]);
+				XMVECTOR p2 = XMLoadFloat3(&positions[triangle[2].Position]);
+				if (XMVector3Equal(p0, p1) || XMVector3Equal(p1, p2) || XMVector3Equal(p2, p0)) {
+					continue;
+				}
+
+				for (size_t corner = 0u; corner < 3u; ++corner) {
+					has_normals |= triangle[corner].Normal != Missing_index;
+					has_tex_coords |= triangle[corner].TexCoord != Missing_index;
+					corners.push_back(triangle[corner]);
+				}
+			}
+		}
+		if (corners.empty()) {
+			return;
+		}
+
+		std::vector<XMFLOAT3> generated_normals;
+		if (!has_normals) {
+			generated_normals = GenerateNormals(positions, corners);
+		}
+
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertex_indices;
+		vertex_indices.reserve(corners.size() / 2u);
+		mesh.Vertices.reserve(corners.size() / 2u);
+		mesh.Indices.resize(corners.size());
+		for (size_t i = 0u; i < corners.size(); ++i) {
+			const Corner& corner = corners[i];
+			VertexKey key = { corner.Position, corner.TexCoord, corner.Normal, { 0u, 0u, 0u } };
+			if (!has_normals) {
+				std::memcpy(key.GeneratedNormal, &generated_normals[i], sizeof(key.GeneratedNormal));
+			}
+
+			auto inserted = vertex_indices.emplace(key, static_cast<uint32_t>(mesh.Vertices.size()));
+			if (inserted.second) {
+				XMFLOAT3 normal = has_normals ? (corner.Normal != Missing_index ? normals[corner.Normal] : XMFLOAT3(0.0f, 0.0f, 0.0f)) : generated_normals[i];
+				XMFLOAT3 tex_coord = corner.TexCoord != Missing_index ? tex_coords[corner.TexCoord] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+				mesh.Vertices.emplace_back(positions[corner.Position], normal, tex_coord);
+			}
+
+			// Left handed winding, the triangle is written back to front.
+			size_t triangle = i - i % 3u;
+			mesh.Indices[triangle + (3u - i % 3u) % 3u] = inserted.first->second;
+		}
+
+		if (has_tex_coords) {
+			GenerateTangents(mesh.Vertices, mesh.Indices);
+		}
+
+		XMFLOAT3 min = mesh.Vertices.front().Position;
+		XMFLOAT3 max = min;
+		for (const VertexPositionNormalTangentBitangentTexture& vertex : mesh.Vertices) {
+			XMStoreFloat3(&min, XMVectorMin(XMLoadFloat3(&min), XMLoadFloat3(&vertex.Position)));
+			XMStoreFloat3(&max, XMVectorMax(XMLoadFloat3(&max), XMLoadFloat3(&vertex.Position)));
+		}
+		BoundingBox::CreateFromPoints(mesh.AABB, XMLoadFloat3(&min), XMLoadFloat3(&max));
+	}
+
+	bool IsObjFile(const std::filesystem::path& file_name) {
+		std::string extension = file_name.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		return extension == ".obj";
+	}
+
+	bool Load(const std::filesystem::path& file_name, ThreadPool& thread_pool, Model& model) {
+		using Clock = std::chrono::steady_clock;
+		Clock::time_point start_time = Clock::now();
+
+		model = Model{};
+		IOService::Buffer file = IOService::Get().ReadFile(file_name.wstring(), IOService::Priority::High).get();
+		if (!file.Storage) {
+			return false;
+		}
+		model.FileSize = file.Size;
+		Clock::time_point read_time = Clock::now();
+
+		// Chunks end after a line break, so no line is split between two of them.
+		const char* text = reinterpret_cast<const char*>(file.pData);
+		const char* text_end = text + file.Size;
+		size_t chunk_count = std::clamp<size_t>(file.Size / Min_chunk_size, 1u, (thread_pool.GetThreadCount() + 1u) * Chunks_per_thread);
+		std::vector<const char*> chunk_begins;
+		chunk_begins.push_back(text);
+		for (size_t i = 1u; i < chunk_count; ++i) {
+			const char* chunk_begin = std::max(chunk_begins.back(), text + file.Size * i / chunk_count);
+			chunk_begin = std::min(FindLineEnd(chunk_begin, text_end) + 1, text_end);
+			chunk_begins.push_back(chunk_begin);
+		}
+		chunk_begins.push_back(text_end);
+
+		std::vector<Chunk> chunks(chunk_count);
+		thread_pool.ParallelFor(chunk_count, [&](size_t i) {
+			ParseChunk(chunk_begins[i], chunk_begins[i + 1u], chunks[i]);
+		});
+
+		// Every chunk copies its data to the offsets the chunks before it leave and turns its relative indices absolute.
+		std::vector<size_t> position_bases(chunk_count + 1u, 0u);
+		std::vector<size_t> tex_coord_bases(chunk_count + 1u, 0u);
+		std::vector<size_t> normal_bases(chunk_count + 1u, 0u);
+		for (size_t i = 0u; i < chunk_count; ++i) {
+			if (!chunks[i].IsValid) {
+				return false;
+			}
+			position_bases[i + 1u] = position_bases[i] + chunks[i].Positions.size();
+			tex_coord_bases[i + 1u] = tex_coord_bases[i] + chunks[i].TexCoords.size();
+			normal_bases[i + 1u] = normal_bases[i] + chunks[i].Normals.size();
+		}
+		if (position_bases.back() > INT32_MAX || tex_coord_bases.back() > INT32_MAX || normal_bases.back() > INT32_MAX) {
+			return false;
+		}
+
+		std::vector<XMFLOAT3> positions(position_bases.back());
+		std::vector<XMFLOAT3> tex_coords(tex_coord_bases.back());
+		std::vector<XMFLOAT3> normals(normal_bases.back());
+		std::atomic<bool> is_valid = true;
+		thread_pool.ParallelFor(chunk_count, [&](size_t i) {
+			// Converted to left handed with flipped texture coordinates on the way.
+			Chunk& chunk = chunks[i];
+			for (size_t j = 0u; j < chunk.Positions.size(); ++j) {
+				const XMFLOAT3& position = chunk.Positions[j];
+				positions[position_bases[i] + j] = XMFLOAT3(position.x, position.y, -position.z);
+			}
+			for (size_t j = 0u; j < chunk.TexCoords.size(); ++j) {
+				const XMFLOAT3& tex_coord = chunk.TexCoords[j];
+				tex_coords[tex_coord_bases[i] + j] = XMFLOAT3(tex_coord.x, 1.0f - tex_coord.y, tex_coord.z);
+			}
+			for (size_t j = 0u; j < chunk.Normals.size(); ++j) {
+				const XMFLOAT3& normal = chunk.Normals[j];
+				normals[normal_bases[i] + j] = XMFLOAT3(normal.x, normal.y, -normal.z);
+			}
+
+			int64_t bases[3] = { static_cast<int64_t>(position_bases[i]), static_cast<int64_t>(tex_coord_bases[i]), static_cast<int64_t>(normal_bases[i]) };
+			for (size_t relative : chunk.RelativeCorners) {
+				Corner& corner = chunk.Corners[relative / 3u];
+				int32_t* components[3] = { &corner.Position, &corner.TexCoord, &corner.Normal };
+				int64_t index = bases[relative % 3u] + *components[relative % 3u];
+				if (index < 0) {
+					is_valid = false;
+					return;
+				}
+				*components[relative % 3u] = static_cast<int32_t>(index);
+			}
+
+			int32_t position_count = static_cast<int32_t>(positions.size());
+			int32_t tex_coord_count = static_cast<int32_t>(tex_coords.size());
+			int32_t normal_count = static_cast<int32_t>(normals.size());
+			for (const Corner& corner : chunk.Corners) {
+				if (corner.Position < 0 || corner.Position >= position_count || corner.TexCoord >= tex_coord_count || corner.Normal >= normal_count) {
+					is_valid = false;
+					return;
+				}
+			}
+			std::vector<XMFLOAT3>().swap(chunk.Positions);
+			std::vector<XMFLOAT3>().swap(chunk.TexCoords);
+			std::vector<XMFLOAT3>().swap(chunk.Normals);
+		});
+		if (!is_valid) {
+			return false;
+		}
+		Clock::time_point parse_time = Clock::now();
+
+		std::vector<Material> materials;
+		std::vector<std::string> libraries;
+		for (const Chunk& chunk : chunks) {
+			for (const std::string& library : chunk.Libraries) {
+				if (std::find(libraries.begin(), libraries.end(), library) == libraries.end()) {
+					libraries.push_back(library);
+				}
+			}
+		}
+		for (const std::string& library : libraries) {
+			IOService::Buffer library_file = IOService::Get().ReadFile((file_name.parent_path() / library).wstring(), IOService::Priority::High).get();
+			if (library_file.Storage) {
+				model.FileSize += library_file.Size;
+				const char* library_text = reinterpret_cast<const char*>(library_file.pData);
+				ParseMaterialLibrary(library_text, library_text + library_file.Size, materials);
+			}
+		}
+
+		// Faces before the first usemtl and those with unknown materials get the default material, stored last.
+		std::unordered_map<std::string, size_t> material_indices;
+		for (size_t i = 0u; i < materials.size(); ++i) {
+			material_indices.emplace(materials[i].Name, i);
+		}
+		size_t default_material = materials.size();
+		std::vector<std::vector<CornerRange>> material_ranges(materials.size() + 1u);
+		size_t current_material = default_material;
+		for (size_t i = 0u; i < chunk_count; ++i) {
+			const Chunk& chunk = chunks[i];
+			size_t begin = 0u;
+			for (size_t j = 0u; j <= chunk.MaterialRuns.size(); ++j) {
+				size_t end = j < chunk.MaterialRuns.size() ? chunk.MaterialRuns[j].FirstCorner : chunk.Corners.size();
+				if (end > begin) {
+					material_ranges[current_material].push_back({ i, begin, end });
+				}
+				if (j < chunk.MaterialRuns.size()) {
+					auto it = material_indices.find(chunk.MaterialNames[chunk.MaterialRuns[j].NameIndex]);
+					current_material = it != material_indices.end() ? it->second : default_material;
+				}
+				begin = end;
+			}
+		}
+		materials.push_back(CreateMaterial("DefaultMaterial"));
+
+		for (size_t i = 0u; i < materials.size(); ++i) {
+			if (material_ranges[i].empty()) {
+				continue;
+			}
+			Mesh mesh = {};
+			mesh.Name = materials[i].Name;
+			mesh.MaterialIndex = static_cast<uint32_t>(model.Materials.size());
+			model.Materials.push_back(std::move(materials[i]));
+			model.Meshes.push_back(std::move(mesh));
+		}
+		if (model.Meshes.empty()) {
+			return false;
+		}
+
+		std::vector<size_t> mesh_ranges;
+		for (size_t i = 0u; i < material_ranges.size(); ++i) {
+			if (!material_ranges[i].empty()) {
+				mesh_ranges.push_back(i);
+			}
+		}
+		thread_pool.ParallelFor(model.Meshes.size(), [&](size_t i) {
+			BuildMesh(chunks, material_ranges[mesh_ranges[i]], positions, tex_coords, normals, model.Meshes[i]);
+		});
+		model.Meshes.erase(std::remove_if(model.Meshes.begin(), model.Meshes.end(), [](const Mesh& mesh) { return mesh.Indices.empty(); }), model.Meshes.end());
+		if (model.Meshes.empty()) {
+			return false;
+		}
+		Clock::time_point mesh_time = Clock::now();
+
+		model.ReadTime = std::chrono::duration<double, std::milli>(read_time - start_time).count();
+		model.ParseTime = std::chrono::duration<double, std::milli>(parse_time - read_time).count();
+		model.MeshTime = std::chrono::duration<double, std::milli>(mesh_time - parse_time).count();
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vertex_types.h"
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Native importer for Wavefront OBJ files and their MTL libraries. The file is split into
+// chunks at line boundaries that are parsed on the thread pool, then every material becomes
+// one mesh whose face corners are deduplicated through a hash map. The result matches the
+// assimp import with the scene import flags: triangulated, left handed with flipped texture
+// coordinates and winding, smooth normals for meshes without any and tangents from the
+// texture coordinates. Materials no face uses are dropped.
+namespace ObjLoader {
+	// Texture names are as written in the MTL file, relative to the folder of the OBJ file.
+	struct Material {
+		std::string Name;
+		DirectX::XMFLOAT4 AmbientColor;
+		DirectX::XMFLOAT4 DiffuseColor;
+		DirectX::XMFLOAT4 SpecularColor;
+		DirectX::XMFLOAT4 EmissiveColor;
+		float SpecularPower;
+		float Opacity;
+		float IndexOfRefraction;
+		float BumpIntensity;
+		bool HasBumpIntensity;
+		std::string AmbientTexture;
+		std::string EmissiveTexture;
+		std::string DiffuseTexture;
+		std::string SpecularTexture;
+		std::string SpecularPowerTexture;
+		std::string OpacityTexture;
+		std::string NormalTexture;
+		std::string BumpTexture;
+	};
+
+	struct Mesh {
+		std::string Name;
+		uint32_t MaterialIndex;
+		std::vector<VertexPositionNormalTangentBitangentTexture> Vertices;
+		std::vector<uint32_t> Indices;
+		DirectX::BoundingBox AABB;
+	};
+
+	// FileSize counts the OBJ file and its material libraries, times are in milliseconds.
+	struct Model {
+		std::vector<Material> Materials;
+		std::vector<Mesh> Meshes;
+		size_t FileSize;
+		double ReadTime;
+		double ParseTime;
+		double MeshTime;
+	};
+
+	bool IsObjFile(const std::filesystem::path& file_name);
+
+	// Fails for files that can't be read, contain indices out of range or no triangles at all,
+	// the caller falls back to assimp then.
+	bool Load(const std::filesystem::path& file_name, ThreadPool& thread_pool, Model& model);
+
+	// Parses the decimal forms OBJ files use, eight digits at a time. The result is within one
+	// float ulp of strtof, numbers with more than 19 digits or large exponents go through strtof.
+	bool ParseFloat(const char*& text, const char* end, float& value);
+}
\ No newline at end of file
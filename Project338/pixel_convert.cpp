@@ -0,0 +1,464 @@
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// MSVC compiles intrinsics of any instruction set, other compilers need them enabled per function.
+#if defined(_MSC_VER)
+#define PIXEL_CONVERT_SSE4
+#define PIXEL_CONVERT_AVX2
+#else
+#define PIXEL_CONVERT_SSE4 __attribute__((target("sse4.1")))
+#define PIXEL_CONVERT_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace PixelConvert {
+	constexpr float Unorm8_scale = 1.0f / 255.0f;
+
+	// The decoder is a table lookup. The encoder counts the sRGB values whose midpoint to
+	// the next value, taken back to linear space, lies at or below the input. Both paths
+	// share the tables, which is what keeps them bit exact.
+	//
+	// The SIMD encoders skip the search. The float bits from 2^-13 to 1 are cut into buckets
+	// of 128 per octave, narrow enough that no bucket holds more than one threshold, so the
+	// count at the bucket start plus one compare gives the same result. Inputs below 2^-13
+	// all encode to 0.
+	constexpr uint32_t Bucket_first_bits = 0x39000000u; // 2^-13
+	constexpr uint32_t Bucket_last_bits = 0x3F7FFFFFu; // The largest float below 1
+	constexpr int Bucket_shift = 16;
+	constexpr int Bucket_count = static_cast<int>((Bucket_last_bits - Bucket_first_bits) >> Bucket_shift) + 1;
+
+	inline float BitsToFloat(uint32_t bits) {
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	struct SRGBTables {
+		float ToLinear[256];
+		float Thresholds[256]; // Only the first 255 are searched.
+		int32_t BucketBase[Bucket_count];
+		float BucketThreshold[Bucket_count];
+
+		SRGBTables() {
+			for (int i = 0; i < 256; ++i) {
+				ToLinear[i] = static_cast<float>(DecodeSRGB(i / 255.0));
+				Thresholds[i] = i < 255 ? static_cast<float>(DecodeSRGB((i + 0.5) / 255.0)) : std::numeric_limits<float>::max();
+			}
+
+			for (int i = 0; i < Bucket_count; ++i) {
+				float bucket_start = BitsToFloat(Bucket_first_bits + (static_cast<uint32_t>(i) << Bucket_shift));
+				BucketBase[i] = static_cast<int32_t>(std::upper_bound(Thresholds, Thresholds + 255, bucket_start) - Thresholds);
+				BucketThreshold[i] = Thresholds[BucketBase[i]];
+			}
+		}
+
+		static double DecodeSRGB(double c) {
+			return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+		}
+	};
+
+	static const SRGBTables& GetSRGBTables() {
+		static SRGBTables tables;
+		return tables;
+	}
+
+	inline void GetCPUID(int leaf, int sub_leaf, int registers[4]) {
+#if defined(_MSC_VER)
+		__cpuidex(registers, leaf, sub_leaf);
+#else
+		__cpuid_count(leaf, sub_leaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	static InstructionSet DetectInstructionSet() {
+		int registers[4] = {};
+		GetCPUID(0, 0, registers);
+		const int max_leaf = registers[0];
+
+		GetCPUID(1, 0, registers);
+		const bool has_ssse3 = (registers[2] & (1 << 9)) != 0;
+		const bool has_sse41 = (registers[2] & (1 << 19)) != 0;
+		const bool has_osxsave = (registers[2] & (1 << 27)) != 0;
+		const bool has_avx = (registers[2] & (1 << 28)) != 0;
+		if (!has_ssse3 || !has_sse41) {
+			return InstructionSet::Scalar;
+		}
+
+		// AVX2 also needs the OS to save the upper halves of the YMM registers.
+		bool has_avx2 = false;
+		if (max_leaf >= 7 && has_osxsave && has_avx) {
+#if defined(_MSC_VER)
+			const unsigned long long xcr0 = _xgetbv(0);
+#else
+			unsigned int xcr0_low = 0u;
+			unsigned int xcr0_high = 0u;
+			__asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+			const unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0_high) << 32) | xcr0_low;
+#endif
+			GetCPUID(7, 0, registers);
+			has_avx2 = (xcr0 & 0x6u) == 0x6u && (registers[1] & (1 << 5)) != 0;
+		}
+
+		return has_avx2 ? InstructionSet::AVX2 : InstructionSet::SSE4;
+	}
+
+	static std::atomic<InstructionSet> Active_instruction_set(GetSupportedInstructionSet());
+
+	InstructionSet GetSupportedInstructionSet() {
+		static const InstructionSet supported_instruction_set = DetectInstructionSet();
+		return supported_instruction_set;
+	}
+
+	void SetInstructionSet(InstructionSet instruction_set) {
+		Active_instruction_set = std::min(instruction_set, GetSupportedInstructionSet());
+	}
+
+	InstructionSet GetInstructionSet() {
+		return Active_instruction_set;
+	}
+
+	const char* GetInstructionSetName(InstructionSet instruction_set) {
+		switch (instruction_set) {
+			case InstructionSet::SSE4:
+				return "SSE4";
+			case InstructionSet::AVX2:
+				return "AVX2";
+			default:
+				return "Scalar";
+		}
+	}
+
+	float GetSRGBThreshold(int srgb_value) {
+		return GetSRGBTables().Thresholds[srgb_value];
+	}
+
+#pragma region Scalar
+
+	inline uint8_t EncodeUnorm8(float value) {
+		float c = value > 0.0f ? value : 0.0f;
+		c = c < 1.0f ? c : 1.0f;
+		return static_cast<uint8_t>(static_cast<int>(c * 255.0f + 0.5f));
+	}
+
+	inline uint8_t EncodeSRGB8(const float thresholds[256], float value) {
+		int index = 0;
+		for (int step = 128; step > 0; step >>= 1) {
+			if (value >= thresholds[index + step - 1]) {
+				index += step;
+			}
+		}
+		return static_cast<uint8_t>(index);
+	}
+
+	static void RGBA8ToFloat4_Scalar(const uint8_t* source, float* destination, size_t begin, size_t end) {
+		for (size_t i = begin * 4u; i < end * 4u; ++i) {
+			destination[i] = source[i] * Unorm8_scale;
+		}
+	}
+
+	static void Float4ToRGBA8_Scalar(const float* source, uint8_t* destination, size_t begin, size_t end) {
+		for (size_t i = begin * 4u; i < end * 4u; ++i) {
+			destination[i] = EncodeUnorm8(source[i]);
+		}
+	}
+
+	static void SRGBA8ToLinearFloat4_Scalar(const uint8_t* source, float* destination, size_t begin, size_t end) {
+		const SRGBTables& tables = GetSRGBTables();
+		for (size_t i = begin; i < end; ++i) {
+			destination[i * 4u + 0u] = tables.ToLinear[source[i * 4u + 0u]];
+			destination[i * 4u + 1u] = tables.ToLinear[source[i * 4u + 1u]];
+			destination[i * 4u + 2u] = tables.ToLinear[source[i * 4u + 2u]];
+			destination[i * 4u + 3u] = source[i * 4u + 3u] * Unorm8_scale;
+		}
+	}
+
+	static void LinearFloat4ToSRGBA8_Scalar(const float* source, uint8_t* destination, size_t begin, size_t end) {
+		const SRGBTables& tables = GetSRGBTables();
+		for (size_t i = begin; i < end; ++i) {
+			destination[i * 4u + 0u] = EncodeSRGB8(tables.Thresholds, source[i * 4u + 0u]);
+			destination[i * 4u + 1u] = EncodeSRGB8(tables.Thresholds, source[i * 4u + 1u]);
+			destination[i * 4u + 2u] = EncodeSRGB8(tables.Thresholds, source[i * 4u + 2u]);
+			destination[i * 4u + 3u] = EncodeUnorm8(source[i * 4u + 3u]);
+		}
+	}
+
+	static void BGRA8ToRGBA8_Scalar(const uint8_t* source, uint8_t* destination, size_t begin, size_t end, bool force_opaque) {
+		for (size_t i = begin; i < end; ++i) {
+			uint8_t b = source[i * 4u + 0u];
+			uint8_t g = source[i * 4u + 1u];
+			uint8_t r = source[i * 4u + 2u];
+			uint8_t a = source[i * 4u + 3u];
+			destination[i * 4u + 0u] = r;
+			destination[i * 4u + 1u] = g;
+			destination[i * 4u + 2u] = b;
+			destination[i * 4u + 3u] = force_opaque ? 255u : a;
+		}
+	}
+
+#pragma endregion
+
+#pragma region SSE4
+
+	PIXEL_CONVERT_SSE4 inline __m128i EncodeUnorm8_SSE4(__m128 value) {
+		__m128 c = _mm_max_ps(value, _mm_setzero_ps());
+		c = _mm_min_ps(c, _mm_set1_ps(1.0f));
+		return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+	}
+
+	// Packs two pixels of 32 bit channels into 8 bytes.
+	PIXEL_CONVERT_SSE4 inline void StorePixels_SSE4(uint8_t* destination, __m128i first, __m128i second) {
+		__m128i packed = _mm_packus_epi32(first, second);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination), _mm_packus_epi16(packed, packed));
+	}
+
+	PIXEL_CONVERT_SSE4 static void RGBA8ToFloat4_SSE4(const uint8_t* source, float* destination, size_t pixel_count) {
+		const __m128 scale = _mm_set1_ps(Unorm8_scale);
+
+		size_t i = 0u;
+		for (; i + 4u <= pixel_count; i += 4u) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4u));
+			for (int j = 0; j < 4; ++j) {
+				__m128i channels = _mm_cvtepu8_epi32(pixels);
+				_mm_storeu_ps(destination + (i + j) * 4u, _mm_mul_ps(_mm_cvtepi32_ps(channels), scale));
+				pixels = _mm_srli_si128(pixels, 4);
+			}
+		}
+
+		RGBA8ToFloat4_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_SSE4 static void Float4ToRGBA8_SSE4(const float* source, uint8_t* destination, size_t pixel_count) {
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			__m128i first = EncodeUnorm8_SSE4(_mm_loadu_ps(source + i * 4u));
+			__m128i second = EncodeUnorm8_SSE4(_mm_loadu_ps(source + i * 4u + 4u));
+			StorePixels_SSE4(destination + i * 4u, first, second);
+		}
+
+		Float4ToRGBA8_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_SSE4 static void SRGBA8ToLinearFloat4_SSE4(const uint8_t* source, float* destination, size_t pixel_count) {
+		const float* to_linear = GetSRGBTables().ToLinear;
+		for (size_t i = 0u; i < pixel_count; ++i) {
+			const uint8_t* pixel = source + i * 4u;
+			_mm_storeu_ps(destination + i * 4u, _mm_setr_ps(to_linear[pixel[0]], to_linear[pixel[1]], to_linear[pixel[2]], pixel[3] * Unorm8_scale));
+		}
+	}
+
+	// Maximum before minimum sends NaN to the first bucket.
+	PIXEL_CONVERT_SSE4 inline __m128 ClampToBuckets_SSE4(__m128 value) {
+		__m128 clamped = _mm_max_ps(value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(Bucket_first_bits))));
+		return _mm_min_ps(clamped, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(Bucket_last_bits))));
+	}
+
+	PIXEL_CONVERT_SSE4 static void LinearFloat4ToSRGBA8_SSE4(const float* source, uint8_t* destination, size_t pixel_count) {
+		const SRGBTables& tables = GetSRGBTables();
+
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			__m128i encoded[2];
+			for (int j = 0; j < 2; ++j) {
+				__m128 value = _mm_loadu_ps(source + (i + j) * 4u);
+
+				__m128 clamped = ClampToBuckets_SSE4(value);
+				alignas(16) int32_t bucket[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(bucket), _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(clamped), _mm_set1_epi32(static_cast<int>(Bucket_first_bits))), Bucket_shift));
+				__m128i base = _mm_setr_epi32(tables.BucketBase[bucket[0]], tables.BucketBase[bucket[1]], tables.BucketBase[bucket[2]], 0);
+				__m128 threshold = _mm_setr_ps(tables.BucketThreshold[bucket[0]], tables.BucketThreshold[bucket[1]], tables.BucketThreshold[bucket[2]], 0.0f);
+
+				// The mask is -1 where the input reaches the threshold.
+				__m128i color = _mm_sub_epi32(base, _mm_castps_si128(_mm_cmpge_ps(clamped, threshold)));
+				encoded[j] = _mm_blend_epi16(color, EncodeUnorm8_SSE4(value), 0xC0);
+			}
+			StorePixels_SSE4(destination + i * 4u, encoded[0], encoded[1]);
+		}
+
+		LinearFloat4ToSRGBA8_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_SSE4 static void BGRA8ToRGBA8_SSE4(const uint8_t* source, uint8_t* destination, size_t pixel_count, bool force_opaque) {
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		const __m128i alpha = _mm_set1_epi32(force_opaque ? static_cast<int>(0xFF000000u) : 0);
+
+		size_t i = 0u;
+		for (; i + 4u <= pixel_count; i += 4u) {
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4u));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4u), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+		}
+
+		BGRA8ToRGBA8_Scalar(source, destination, i, pixel_count, force_opaque);
+	}
+
+#pragma endregion
+
+#pragma region AVX2
+
+	PIXEL_CONVERT_AVX2 inline __m256i EncodeUnorm8_AVX2(__m256 value) {
+		__m256 c = _mm256_max_ps(value, _mm256_setzero_ps());
+		c = _mm256_min_ps(c, _mm256_set1_ps(1.0f));
+		return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(c, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+	}
+
+	// Packs two pixels of 32 bit channels in one register into 8 bytes.
+	PIXEL_CONVERT_AVX2 inline void StorePixels_AVX2(uint8_t* destination, __m256i pixels) {
+		__m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(pixels), _mm256_extracti128_si256(pixels, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination), _mm_packus_epi16(packed, packed));
+	}
+
+	PIXEL_CONVERT_AVX2 static void RGBA8ToFloat4_AVX2(const uint8_t* source, float* destination, size_t pixel_count) {
+		const __m256 scale = _mm256_set1_ps(Unorm8_scale);
+
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			__m256i channels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i * 4u)));
+			_mm256_storeu_ps(destination + i * 4u, _mm256_mul_ps(_mm256_cvtepi32_ps(channels), scale));
+		}
+
+		RGBA8ToFloat4_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_AVX2 static void Float4ToRGBA8_AVX2(const float* source, uint8_t* destination, size_t pixel_count) {
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			StorePixels_AVX2(destination + i * 4u, EncodeUnorm8_AVX2(_mm256_loadu_ps(source + i * 4u)));
+		}
+
+		Float4ToRGBA8_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_AVX2 static void SRGBA8ToLinearFloat4_AVX2(const uint8_t* source, float* destination, size_t pixel_count) {
+		const float* to_linear = GetSRGBTables().ToLinear;
+		const __m256 scale = _mm256_set1_ps(Unorm8_scale);
+
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			__m256i channels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i * 4u)));
+			__m256 color = _mm256_i32gather_ps(to_linear, channels, 4);
+			__m256 alpha = _mm256_mul_ps(_mm256_cvtepi32_ps(channels), scale);
+			_mm256_storeu_ps(destination + i * 4u, _mm256_blend_ps(color, alpha, 0x88));
+		}
+
+		SRGBA8ToLinearFloat4_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_AVX2 static void LinearFloat4ToSRGBA8_AVX2(const float* source, uint8_t* destination, size_t pixel_count) {
+		const SRGBTables& tables = GetSRGBTables();
+		const __m256 first = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(Bucket_first_bits)));
+		const __m256 last = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(Bucket_last_bits)));
+
+		size_t i = 0u;
+		for (; i + 2u <= pixel_count; i += 2u) {
+			__m256 value = _mm256_loadu_ps(source + i * 4u);
+
+			// Maximum before minimum sends NaN to the first bucket.
+			__m256 clamped = _mm256_min_ps(_mm256_max_ps(value, first), last);
+			__m256i bucket = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_castps_si256(clamped), _mm256_castps_si256(first)), Bucket_shift);
+			__m256i base = _mm256_i32gather_epi32(tables.BucketBase, bucket, 4);
+			__m256 threshold = _mm256_i32gather_ps(tables.BucketThreshold, bucket, 4);
+
+			// The mask is -1 where the input reaches the threshold.
+			__m256i color = _mm256_sub_epi32(base, _mm256_castps_si256(_mm256_cmp_ps(clamped, threshold, _CMP_GE_OQ)));
+			StorePixels_AVX2(destination + i * 4u, _mm256_blend_epi32(color, EncodeUnorm8_AVX2(value), 0x88));
+		}
+
+		LinearFloat4ToSRGBA8_Scalar(source, destination, i, pixel_count);
+	}
+
+	PIXEL_CONVERT_AVX2 static void BGRA8ToRGBA8_AVX2(const uint8_t* source, uint8_t* destination, size_t pixel_count, bool force_opaque) {
+		const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		const __m256i alpha = _mm256_set1_epi32(force_opaque ? static_cast<int>(0xFF000000u) : 0);
+
+		size_t i = 0u;
+		for (; i + 8u <= pixel_count; i += 8u) {
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4u));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i * 4u), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+		}
+
+		BGRA8ToRGBA8_Scalar(source, destination, i, pixel_count, force_opaque);
+	}
+
+#pragma endregion
+
+	void RGBA8ToFloat4(const uint8_t* source, float* destination, size_t pixel_count) {
+		switch (GetInstructionSet()) {
+			case InstructionSet::AVX2:
+				RGBA8ToFloat4_AVX2(source, destination, pixel_count);
+				break;
+			case InstructionSet::SSE4:
+				RGBA8ToFloat4_SSE4(source, destination, pixel_count);
+				break;
+			default:
+				RGBA8ToFloat4_Scalar(source, destination, 0u, pixel_count);
+				break;
+		}
+	}
+
+	void Float4ToRGBA8(const float* source, uint8_t* destination, size_t pixel_count) {
+		switch (GetInstructionSet()) {
+			case InstructionSet::AVX2:
+				Float4ToRGBA8_AVX2(source, destination, pixel_count);
+				break;
+			case InstructionSet::SSE4:
+				Float4ToRGBA8_SSE4(source, destination, pixel_count);
+				break;
+			default:
+				Float4ToRGBA8_Scalar(source, destination, 0u, pixel_count);
+				break;
+		}
+	}
+
+	void SRGBA8ToLinearFloat4(const uint8_t* source, float* destination, size_t pixel_count) {
+		switch (GetInstructionSet()) {
+			case InstructionSet::AVX2:
+				SRGBA8ToLinearFloat4_AVX2(source, destination, pixel_count);
+				break;
+			case InstructionSet::SSE4:
+				SRGBA8ToLinearFloat4_SSE4(source, destination, pixel_count);
+				break;
+			default:
+				SRGBA8ToLinearFloat4_Scalar(source, destination, 0u, pixel_count);
+				break;
+		}
+	}
+
+	void LinearFloat4ToSRGBA8(const float* source, uint8_t* destination, size_t pixel_count) {
+		switch (GetInstructionSet()) {
+			case InstructionSet::AVX2:
+				LinearFloat4ToSRGBA8_AVX2(source, destination, pixel_count);
+				break;
+			case InstructionSet::SSE4:
+				LinearFloat4ToSRGBA8_SSE4(source, destination, pixel_count);
+				break;
+			default:
+				LinearFloat4ToSRGBA8_Scalar(source, destination, 0u, pixel_count);
+				break;
+		}
+	}
+
+	void BGRA8ToRGBA8(const uint8_t* source, uint8_t* destination, size_t pixel_count, bool force_opaque) {
+		switch (GetInstructionSet()) {
+			case InstructionSet::AVX2:
+				BGRA8ToRGBA8_AVX2(source, destination, pixel_count, force_opaque);
+				break;
+			case InstructionSet::SSE4:
+				BGRA8ToRGBA8_SSE4(source, destination, pixel_count, force_opaque);
+				break;
+			default:
+				BGRA8ToRGBA8_Scalar(source, destination, 0u, pixel_count, force_opaque);
+				break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Conversions between the pixel layouts texture loading runs into all the time. Every
+// function has a scalar reference and SSE4 and AVX2 kernels that produce the same bits,
+// the widest instruction set the CPU supports is picked at startup. Pixels are 8 bit RGBA
+// or float4 RGBA, float values are in [0, 1] and out of range values are clamped.
+namespace PixelConvert {
+	enum class InstructionSet {
+		Scalar,
+		SSE4,
+		AVX2,
+	};
+
+	InstructionSet GetSupportedInstructionSet();
+
+	// Limits the kernels to a lower instruction set, for comparisons and benchmarks.
+	// Sets the CPU doesn't support fall back to the best supported one.
+	void SetInstructionSet(InstructionSet instruction_set);
+	InstructionSet GetInstructionSet();
+	const char* GetInstructionSetName(InstructionSet instruction_set);
+
+	// Linear value from which the encoder rounds srgb_value up to the next one, for srgb_value below 255.
+	float GetSRGBThreshold(int srgb_value);
+
+	void RGBA8ToFloat4(const uint8_t* source, float* destination, size_t pixel_count);
+	void Float4ToRGBA8(const float* source, uint8_t* destination, size_t pixel_count);
+
+	// The color channels go through the sRGB curve, alpha is always linear. The encoder
+	// rounds to the nearest sRGB value, not to the nearest value in linear space.
+	void SRGBA8ToLinearFloat4(const uint8_t* source, float* destination, size_t pixel_count);
+	void LinearFloat4ToSRGBA8(const float* source, uint8_t* destination, size_t pixel_count);
+
+	// Swaps red and blue, force_opaque sets alpha to 255 for BGRX data. Source and destination may be the same.
+	void BGRA8ToRGBA8(const uint8_t* source, uint8_t* destination, size_t pixel_count, bool force_opaque);
+}
\ No newline at end of file
@@ -1,23 +1,51 @@
 #include "scene.h"
 
+#include "asset_archive.h"
 #include "command_list.h"
+#include "cooked_scene.h"
+#include "derived_data_cache.h"
 #include "device.h"
+#include "index_buffer.h"
+#include "io_service.h"
+#include "mapped_file.h"
 #include "material.h"
 #include "mesh.h"
+#include "obj_loader.h"
+#include "scene_builder.h"
 #include "scene_node.h"
 #include "texture.h"
+#include "texture_streamer.h"
+#include "thread_pool.h"
+#include "vertex_buffer.h"
 #include "vertex_types.h"
 #include "visitor.h"
 
 #include <assimp/config.h>
 #include <assimp/Exporter.hpp>
 #include <assimp/Importer.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
 #include <assimp/ProgressHandler.hpp>
 #include <assimp/anim.h>
 #include <assimp/mesh.h>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <mutex>
+
+#include <psapi.h>
+
+#include <DirectXTex/DirectXTex.h>
+
+Scene::Scene() : m_vertex_format(VertexFormat::PositionPackedNormalTangentTexture), m_lod_levels({ { 0.5f, 0.01f }, { 0.25f, 0.02f }, { 0.125f, 0.04f } }), m_build_meshlets(true), m_native_obj_import(true), m_import_memory_budget(256u * 1024u * 1024u) {}
 
 void Scene::SetRootNode(std::shared_ptr<SceneNode> node) {
 	m_root_node = node;
@@ -32,8 +60,9 @@ public:
     ProgressHandler(const Scene& scene, const std::function<bool(float)> progress_callback) : m_scene(scene), m_progress_callback(progress_callback) {}
 
     virtual bool Update(float percentage) override {
+        // Reading the source file is the first half of an import.
         if (m_progress_callback) {
-            return m_progress_callback(percentage);
+            return m_progress_callback(0.5f * percentage);
         }
 
         return true;
@@ -54,9 +83,233 @@ inline DirectX::BoundingBox CreateBoundingBox(const aiAABB& aabb) {
     return bb;
 }
 
+static constexpr size_t Meshlet_min_triangles = 4u * 124u;
+
+inline uint64_t GetWorkingSetSize() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0u;
+    }
+
+    return counters.WorkingSetSize;
+}
+
+inline uint64_t GetPeakWorkingSetSize() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0u;
+    }
+
+    return counters.PeakWorkingSetSize;
+}
+
+template<typename T>
+inline void StoreBlob(std::vector<uint8_t>& blob, const std::vector<T>& data) {
+    blob.resize(data.size() * sizeof(T));
+    if (!data.empty()) {
+        std::memcpy(blob.data(), data.data(), blob.size());
+    }
+}
+
+void Scene::ExtractMeshData(const aiMesh& aiMesh, std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices) {
+    vertex_data.resize(aiMesh.mNumVertices);
+
+    unsigned int i;
+    if (aiMesh.HasPositions()) {
+        for (i = 0u; i < aiMesh.mNumVertices; ++i) {
+            vertex_data[i].Position = { aiMesh.mVertices[i].x, aiMesh.mVertices[i].y, aiMesh.mVertices[i].z };
+        }
+    }
+
+    if (aiMesh.HasNormals()) {
+        for (i = 0; i < aiMesh.mNumVertices; ++i) {
+            vertex_data[i].Normal = { aiMesh.mNormals[i].x, aiMesh.mNormals[i].y, aiMesh.mNormals[i].z };
+        }
+    }
+
+    if (aiMesh.HasTangentsAndBitangents()) {
+        for (i = 0; i < aiMesh.mNumVertices; ++i) {
+            vertex_data[i].Tangent = { aiMesh.mTangents[i].x, aiMesh.mTangents[i].y, aiMesh.mTangents[i].z };
+            vertex_data[i].Bitangent = { aiMesh.mBitangents[i].x, aiMesh.mBitangents[i].y, aiMesh.mBitangents[i].z };
+        }
+    }
+
+    if (aiMesh.HasTextureCoords(0)) {
+        for (i = 0; i < aiMesh.mNumVertices; ++i) {
+            vertex_data[i].TexCoord = { aiMesh.mTextureCoords[0][i].x, aiMesh.mTextureCoords[0][i].y, aiMesh.mTextureCoords[0][i].z };
+        }
+    }
+
+    indices.clear();
+    if (aiMesh.HasFaces()) {
+        indices.reserve(aiMesh.mNumFaces * 3u);
+        for (i = 0; i < aiMesh.mNumFaces; ++i) {
+            const aiFace& face = aiMesh.mFaces[i];
+
+            if (face.mNumIndices == 3) {
+                indices.push_back(face.mIndices[0]);
+                indices.push_back(face.mIndices[1]);
+                indices.push_back(face.mIndices[2]);
+            }
+        }
+    }
+}
+
+// Stream over a whole file read by the I/O service.
+class IOServiceStream : public Assimp::IOStream {
+public:
+    IOServiceStream(const IOService::Buffer& buffer) : m_buffer(buffer), m_position(0u) {}
+
+    virtual size_t Read(void* pvBuffer, size_t pSize, size_t pCount) override {
+        if (pSize == 0u) {
+            return 0u;
+        }
+
+        size_t count = std::min(pCount, (m_buffer.Size - m_position) / pSize);
+        std::memcpy(pvBuffer, m_buffer.pData + m_position, count * pSize);
+        m_position += count * pSize;
+
+        return count;
+    }
+
+    virtual size_t Write(const void* pvBuffer, size_t pSize, size_t pCount) override {
+        return 0u;
+    }
+
+    virtual aiReturn Seek(size_t pOffset, aiOrigin pOrigin) override {
+        size_t position = 0u;
+        switch (pOrigin) {
+            case aiOrigin_SET:
+                position = pOffset;
+                break;
+            case aiOrigin_CUR:
+                position = m_position + pOffset;
+                break;
+            case aiOrigin_END:
+                if (pOffset > m_buffer.Size) {
+                    return aiReturn_FAILURE;
+                }
+                position = m_buffer.Size - pOffset;
+                break;
+            default:
+                return aiReturn_FAILURE;
+        }
+
+        if (position > m_buffer.Size) {
+            return aiReturn_FAILURE;
+        }
+        m_position = position;
+
+        return aiReturn_SUCCESS;
+    }
+
+    virtual size_t Tell() const override {
+        return m_position;
+    }
+
+    virtual size_t FileSize() const override {
+        return m_buffer.Size;
+    }
+
+    virtual void Flush() override {}
+
+private:
+    IOService::Buffer m_buffer;
+    size_t m_position;
+};
+
+// Scene files and the files they reference are read through the I/O service at high priority,
+// they hold up everything else of a load. Importing never writes.
+class IOServiceSystem : public Assimp::IOSystem {
+public:
+    virtual bool Exists(const char* pFile) const override {
+        std::error_code error;
+        return AssetArchive::Exists(pFile) || std::filesystem::is_regular_file(std::filesystem::path(pFile), error);
+    }
+
+    virtual char getOsSeparator() const override {
+        return '\\';
+    }
+
+    virtual Assimp::IOStream* Open(const char* pFile, const char* pMode) override {
+        if (std::strchr(pMode, 'w') || std::strchr(pMode, 'a')) {
+            return nullptr;
+        }
+
+        IOService::Buffer buffer = IOService::Get().ReadFile(std::filesystem::path(pFile).wstring(), IOService::Priority::High).get();
+        if (!buffer.Storage) {
+            return nullptr;
+        }
+
+        return new IOServiceStream(buffer);
+    }
+
+    virtual void Close(Assimp::IOStream* pFile) override {
+        delete pFile;
+    }
+};
+
+// Vertex cache locality is handled by the engine's own mesh optimization.
+static const unsigned int Source_preprocess_flags = (aiProcessPreset_TargetRealtime_MaxQuality & ~aiProcess_ImproveCacheLocality) | aiProcess_OptimizeGraph | aiProcess_ConvertToLeftHanded | aiProcess_GenBoundingBoxes;
+static constexpr float Source_max_smoothing_angle = 80.0f;
+
+const aiScene* Scene::ReadSourceScene(Assimp::Importer& importer, const std::filesystem::path& file_path) {
+    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, Source_max_smoothing_angle);
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+    importer.SetIOHandler(new IOServiceSystem());
+
+    return importer.ReadFile(file_path.string(), Source_preprocess_flags);
+}
+
+// Hashes the scene file and, for OBJ files, the material libraries it references.
+inline bool AddSourceFiles(DerivedDataCache::Key& key, const std::filesystem::path& file_path) {
+    IOService::Buffer file = IOService::Get().ReadFile(file_path.wstring(), IOService::Priority::High).get();
+    if (!file.Storage) {
+        return false;
+    }
+    key.Add(file.pData, file.Size);
+
+    if (!ObjLoader::IsObjFile(file_path)) {
+        return true;
+    }
+
+    const char* line = reinterpret_cast<const char*>(file.pData);
+    const char* end = line + file.Size;
+    while (line < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!line_end) {
+            line_end = end;
+        }
+
+        const size_t keyword_length = 7u;
+        if (static_cast<size_t>(line_end - line) > keyword_length && std::strncmp(line, "mtllib", 6u) == 0 && std::isspace(static_cast<unsigned char>(line[6]))) {
+            const char* name_begin = line + keyword_length;
+            const char* name_end = line_end;
+            while (name_begin < name_end && std::isspace(static_cast<unsigned char>(*name_begin))) {
+                ++name_begin;
+            }
+            while (name_end > name_begin && std::isspace(static_cast<unsigned char>(name_end[-1]))) {
+                --name_end;
+            }
+
+            // A missing library still imports, with default materials, so it only changes the key.
+            std::string library_name(name_begin, name_end);
+            key.Add(library_name);
+            if (!key.AddFile(file_path.parent_path() / library_name)) {
+                key.Add(DerivedDataCache::HashBytes(nullptr, 0u));
+            }
+        }
+
+        line = line_end + 1;
+    }
+
+    return true;
+}
+
 bool Scene::LoadSceneFromFile(CommandList& command_list, const std::wstring& file_name, const std::function<bool(float)>& loading_progress) {
+    using Clock = std::chrono::steady_clock;
+
     std::filesystem::path file_path = file_name;
-    std::filesystem::path export_path = std::filesystem::path(file_path).replace_extension("assbin");
 
     std::filesystem::path parent_path;
     if (file_path.has_parent_path()) {
@@ -66,46 +319,214 @@ bool Scene::LoadSceneFromFile(CommandList& command_list, const std::wstring& fil
         parent_path = std::filesystem::current_path();
     }
 
-    Assimp::Importer importer;
-    const aiScene* scene;
+    // Returning false from the callback cancels the load between phases.
+    auto report_progress = [&loading_progress](float progress) {
+        return !loading_progress || loading_progress(progress);
+    };
+
+    char message[512];
+    Clock::time_point start_time = Clock::now();
+
+    DerivedDataCache& derived_data_cache = DerivedDataCache::Get();
+    DerivedDataCache::Key cooked_scene_key("scene");
+    bool has_key = CreateCookedSceneKey(file_path, cooked_scene_key);
+    if (has_key) {
+        std::filesystem::path cooked_path = derived_data_cache.Find(cooked_scene_key);
+        if (!cooked_path.empty() && LoadCookedScene(command_list, cooked_path, parent_path)) {
+            sprintf_s(message, "Scene \"%s\" loaded from cooked file %s in %.2f ms\n", file_path.string().c_str(), cooked_scene_key.ToString().c_str(),
+                std::chrono::duration<double, std::milli>(Clock::now() - start_time).count());
+            OutputDebugStringA(message);
+            report_progress(1.0f);
+
+            return true;
+        }
+    }
+
+    if (!report_progress(0.0f)) {
+        return false;
+    }
 
-    importer.SetProgressHandler(new ProgressHandler(*this, loading_progress));
+    CookedScene::Writer cooked_scene(m_vertex_format, parent_path);
+    // OBJ files the native loader rejects still get the chance to import through assimp.
+    ObjLoader::Model obj_model;
+    if (m_native_obj_import && ObjLoader::IsObjFile(file_path) && ObjLoader::Load(file_path, ThreadPool::Get(), obj_model)) {
+        if (!report_progress(0.5f)) {
+            return false;
+        }
 
-    if (std::filesystem::exists(export_path) && std::filesystem::is_regular_file(export_path)) {
-        scene = importer.ReadFile(export_path.string(), aiProcess_GenBoundingBoxes);
+        ImportObjScene(command_list, obj_model, file_path.filename().string(), parent_path, &cooked_scene);
     }
     else {
-        importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f);
-        importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
+        Assimp::Importer importer;
+        importer.SetProgressHandler(new ProgressHandler(*this, loading_progress));
 
-        unsigned int preprocess_flags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_OptimizeGraph | aiProcess_ConvertToLeftHanded | aiProcess_GenBoundingBoxes;
-        scene = importer.ReadFile(file_path.string(), preprocess_flags);
-
-        if (scene) {
-            Assimp::Exporter exporter;
-            exporter.Export(scene, "assbin", export_path.string(), 0);
+        // The import takes the scene over to free every mesh once it's converted.
+        std::unique_ptr<aiScene> scene(ReadSourceScene(importer, file_path) ? importer.GetOrphanedScene() : nullptr);
+        if (!scene || !report_progress(0.5f)) {
+            return false;
         }
+
+        ImportScene(command_list, *scene, parent_path, &cooked_scene);
+    }
+    if (!report_progress(0.9f)) {
+        return false;
     }
 
-    if (!scene) {
+    Clock::time_point import_time = Clock::now();
+    if (has_key && !derived_data_cache.Store(cooked_scene_key, [&cooked_scene](const std::filesystem::path& cooked_path) { return cooked_scene.Write(cooked_path); })) {
+        sprintf_s(message, "Failed to store cooked scene %s\n", cooked_scene_key.ToString().c_str());
+        OutputDebugStringA(message);
+    }
+
+    sprintf_s(message, "Scene \"%s\" imported in %.2f ms, cooked in %.2f ms\n", file_path.string().c_str(),
+        std::chrono::duration<double, std::milli>(import_time - start_time).count(),
+        std::chrono::duration<double, std::milli>(Clock::now() - import_time).count());
+    OutputDebugStringA(message);
+    report_progress(1.0f);
+
+    return true;
+}
+
+bool Scene::CreateCookedSceneKey(const std::filesystem::path& file_path, DerivedDataCache::Key& key) const {
+    if (!AddSourceFiles(key, file_path)) {
         return false;
     }
 
-    ImportScene(command_list, *scene, parent_path);
+    key.Add(CookedScene::Version);
+    AddImportSettings(key);
+
+    return true;
+}
+
+void Scene::AddImportSettings(DerivedDataCache::Key& key) const {
+    // Everything that changes the cooked result has to be part of the key.
+    key.Add(Source_preprocess_flags);
+    key.Add(Source_max_smoothing_angle);
+    key.Add(m_vertex_format);
+    key.Add(m_build_meshlets);
+    key.Add(m_native_obj_import);
+    key.Add(Meshlet_min_triangles);
+    key.Add(m_lod_levels.data(), m_lod_levels.size() * sizeof(LODLevel));
+}
+
+uint64_t Scene::GetImportSettingsHash() const {
+    // Materials of a streaming scene start with placeholders. Its streamer swaps in the final textures and
+    // is kept alive by the loaded scene, so instances may share them with any other streaming scene.
+    DerivedDataCache::Key key("scene");
+    AddImportSettings(key);
+    key.Add(m_texture_streamer != nullptr);
+
+    return key.GetHash();
+}
+
+std::shared_ptr<Scene> Scene::CreateInstance(const std::shared_ptr<const Scene>& source) {
+    auto scene = std::make_shared<Scene>();
+    scene->m_material_map = source->m_material_map;
+    scene->m_materials = source->m_materials;
+    scene->m_meshes = source->m_meshes;
+    if (source->m_root_node) {
+        scene->m_root_node = source->m_root_node->Clone();
+    }
+
+    scene->m_scene_file = source->m_scene_file;
+    scene->m_vertex_format = source->m_vertex_format;
+    scene->m_lod_levels = source->m_lod_levels;
+    scene->m_build_meshlets = source->m_build_meshlets;
+    scene->m_native_obj_import = source->m_native_obj_import;
+    scene->m_import_memory_budget = source->m_import_memory_budget;
+    scene->m_texture_streamer = source->m_texture_streamer;
+    scene->m_source = source->m_source ? source->m_source : source;
+
+    return scene;
+}
+
+bool Scene::LoadCookedScene(CommandList& command_list, const std::filesystem::path& cooked_path, const std::filesystem::path& parent_path) {
+    MappedFile file(cooked_path.wstring());
+
+    CookedScene::View view;
+    if (!CookedScene::Parse(file, view) || view.pHeader->VertexFormat != static_cast<uint32_t>(m_vertex_format)) {
+        return false;
+    }
+
+    const CookedScene::Header& header = *view.pHeader;
+
+    m_root_node.reset();
+    m_material_map.clear();
+    m_materials.clear();
+    m_meshes.clear();
+
+    std::vector<MaterialImport> material_imports(header.MaterialCount);
+    for (uint32_t i = 0u; i < header.MaterialCount; ++i) {
+        const CookedScene::MaterialRecord& record = view.pMaterials[i];
+
+        material_imports[i].pMaterial = std::make_shared<Material>(record.Properties);
+        for (size_t texture_type = 0u; texture_type < CookedScene::TextureTypeCount; ++texture_type) {
+            if (record.TextureNames[texture_type] == CookedScene::InvalidIndex) {
+                continue;
+            }
+
+            std::filesystem::path texture_path = parent_path / std::filesystem::path(ConvertString(std::string(view.GetString(record.TextureNames[texture_type]))));
+            bool sRGB = (record.SRGBTextureMask & (1u << texture_type)) != 0u;
+            material_imports[i].Textures.push_back({ static_cast<Material::TextureType>(texture_type), texture_path.wstring(), sRGB, false, 0u });
+        }
+    }
+
+    std::vector<ImageImport> image_imports;
+    CollectImages(material_imports, image_imports);
+    std::vector<IOService::Request> prefetches = PrefetchImages(image_imports);
+    ThreadPool::Get().ParallelFor(image_imports.size(), [&image_imports](size_t i) {
+        DecodeImage(image_imports[i]);
+    });
+    UploadMaterials(command_list, material_imports, image_imports, nullptr);
+
+    // Vertex and index blobs are already in the GPU layout and go to the upload buffer straight from the mapped file.
+    m_meshes.reserve(header.MeshCount);
+    for (uint32_t i = 0u; i < header.MeshCount; ++i) {
+        const CookedScene::MeshRecord& record = view.pMeshes[i];
+
+        auto mesh = std::make_shared<Mesh>();
+        mesh->SetMaterial(m_materials[record.MaterialIndex]);
+        mesh->SetVertexBuffer(0, command_list.CopyVertexBuffer(record.VertexCount, record.VertexStride, view.pData + record.VertexDataOffset));
+        mesh->SetVertexFormat(m_vertex_format);
+        mesh->SetPositionDequantization(record.PositionScale, record.PositionOffset);
+
+        if (record.IndexCount > 0u) {
+            mesh->SetIndexBuffer(command_list.CopyIndexBuffer(record.IndexCount, static_cast<DXGI_FORMAT>(record.IndexFormat), view.pData + record.IndexDataOffset));
+        }
+
+        mesh->SetLODs(std::vector<Mesh::LOD>(view.pLODs + record.FirstLOD, view.pLODs + record.FirstLOD + record.LODCount));
+        mesh->SetMeshlets(std::vector<MeshOptimizer::Meshlet>(view.pMeshlets + record.FirstMeshlet, view.pMeshlets + record.FirstMeshlet + record.MeshletCount));
+        mesh->SetAABB(DirectX::BoundingBox(record.AABBCenter, record.AABBExtents));
+
+        m_meshes.push_back(mesh);
+    }
+
+    SceneBuilder builder(header.NodeCount);
+    for (uint32_t i = 0u; i < header.NodeCount; ++i) {
+        const CookedScene::NodeRecord& record = view.pNodes[i];
+
+        uint32_t node_index = builder.AddNode(std::string(view.GetString(record.NameOffset)), record.ParentIndex, DirectX::XMLoadFloat4x4(&record.LocalTransform));
+        for (uint32_t j = 0u; j < record.MeshCount; ++j) {
+            builder.AddMesh(node_index, m_meshes[view.pNodeMeshes[record.FirstMesh + j]]);
+        }
+    }
+    m_root_node = builder.Build();
 
     return true;
 }
 
 bool Scene::LoadSceneFromString(CommandList& command_list, const std::string& scene_str, const std::string& format) {
     Assimp::Importer importer;
-    const aiScene* scene = nullptr;
 
     importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f);
     importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);
 
-    unsigned int preprocess_flags = aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_ConvertToLeftHanded | aiProcess_GenBoundingBoxes;
+    unsigned int preprocess_flags = (aiProcessPreset_TargetRealtime_MaxQuality & ~aiProcess_ImproveCacheLocality) | aiProcess_ConvertToLeftHanded | aiProcess_GenBoundingBoxes;
 
-    scene = importer.ReadFileFromMemory(scene_str.data(), scene_str.size(), preprocess_flags, format.c_str());
+    std::unique_ptr<aiScene> scene;
+    if (importer.ReadFileFromMemory(scene_str.data(), scene_str.size(), preprocess_flags, format.c_str())) {
+        scene.reset(importer.GetOrphanedScene());
+    }
 
     if (!scene) {
         return false;
@@ -116,7 +537,80 @@ bool Scene::LoadSceneFromString(CommandList& command_list, const std::string& sc
     return true;
 }
 
-void Scene::ImportScene(CommandList& command_list, const aiScene& scene, std::filesystem::path parent_path) {
+void Scene::ImportScene(CommandList& command_list, aiScene& scene, std::filesystem::path parent_path, CookedScene::Writer* cooked_scene) {
+    SceneSource source;
+    source.MaterialCount = scene.mNumMaterials;
+    source.ImportMaterial = [&](size_t i) {
+        return ImportMaterial(*(scene.mMaterials[i]), parent_path);
+    };
+    for (unsigned int i = 0u; i < scene.mNumMeshes; ++i) {
+        source.MeshSizes.push_back(EstimateMeshImportSize(scene.mMeshes[i]->mNumVertices, scene.mMeshes[i]->mNumFaces * 3u));
+    }
+    source.ImportMesh = [&](size_t i) {
+        std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data;
+        std::vector<uint32_t> indices;
+        const aiMesh& aiMesh = *(scene.mMeshes[i]);
+        ExtractMeshData(aiMesh, vertex_data, indices);
+
+        std::string mesh_name = aiMesh.mName.C_Str();
+        unsigned int material_index = aiMesh.mMaterialIndex;
+        DirectX::BoundingBox aabb = CreateBoundingBox(aiMesh.mAABB);
+
+        // The source mesh isn't needed anymore, the nodes only refer to meshes by index.
+        delete scene.mMeshes[i];
+        scene.mMeshes[i] = nullptr;
+
+        return ImportMesh(mesh_name, material_index, vertex_data, indices, aabb);
+    };
+
+    StreamScene(command_list, source, cooked_scene, [&]() {
+        // Cooked node indices follow the builder ones, both add the nodes in the same order.
+        SceneBuilder builder;
+        ImportSceneNode(builder, scene.mRootNode, SceneBuilder::InvalidIndex, cooked_scene);
+        return builder.Build();
+    });
+}
+
+void Scene::ImportObjScene(CommandList& command_list, ObjLoader::Model& model, const std::string& root_name, const std::filesystem::path& parent_path, CookedScene::Writer* cooked_scene) {
+    SceneSource source;
+    source.MaterialCount = model.Materials.size();
+    source.ImportMaterial = [&](size_t i) {
+        return ImportMaterial(model.Materials[i], parent_path);
+    };
+    for (const ObjLoader::Mesh& mesh : model.Meshes) {
+        source.MeshSizes.push_back(EstimateMeshImportSize(mesh.Vertices.size(), mesh.Indices.size()));
+    }
+    source.ImportMesh = [&](size_t i) {
+        ObjLoader::Mesh& mesh = model.Meshes[i];
+        MeshImport mesh_import = ImportMesh(mesh.Name, mesh.MaterialIndex, mesh.Vertices, mesh.Indices, mesh.AABB);
+
+        std::vector<VertexPositionNormalTangentBitangentTexture>().swap(mesh.Vertices);
+        std::vector<uint32_t>().swap(mesh.Indices);
+
+        return mesh_import;
+    };
+
+    // OBJ files have no hierarchy, every mesh hangs off one root node like after assimp's graph optimization.
+    StreamScene(command_list, source, cooked_scene, [&]() {
+        auto node = std::make_shared<SceneNode>();
+        node->SetName(root_name);
+
+        std::vector<uint32_t> mesh_indices(m_meshes.size());
+        for (uint32_t i = 0u; i < m_meshes.size(); ++i) {
+            node->AddMesh(m_meshes[i]);
+            mesh_indices[i] = i;
+        }
+
+        if (cooked_scene) {
+            cooked_scene->AddNode(node->GetName(), CookedScene::InvalidIndex, node->GetLocalTransform(), mesh_indices);
+        }
+
+        return node;
+    });
+}
+
+void Scene::StreamScene(CommandList& command_list, const SceneSource& source, CookedScene::Writer* cooked_scene, const std::function<std::shared_ptr<SceneNode>()>& import_nodes) {
+    using Clock = std::chrono::steady_clock;
 
     if (m_root_node) {
         m_root_node.reset();
@@ -126,18 +620,352 @@ void Scene::ImportScene(CommandList& command_list, const aiScene& scene, std::fi
     m_materials.clear();
     m_meshes.clear();
 
-    for (unsigned int i = 0u; i < scene.mNumMaterials; ++i) {
-        ImportMaterial(command_list, *(scene.mMaterials[i]), parent_path);
+    // Meshes are uploaded as they come in and get their materials once the textures are decoded.
+    std::vector<unsigned int> mesh_material_indices;
+    std::chrono::nanoseconds mesh_upload_time(0);
+    SceneImport scene_import;
+    ImportSceneData(source, [&](MeshImport& mesh_import) {
+        Clock::time_point upload_start_time = Clock::now();
+        mesh_material_indices.push_back(mesh_import.MaterialIndex);
+        UploadMesh(command_list, mesh_import, cooked_scene);
+        mesh_upload_time += Clock::now() - upload_start_time;
+    }, ThreadPool::Get(), scene_import);
+
+    Clock::time_point upload_start_time = Clock::now();
+    UploadMaterials(command_list, scene_import.Materials, scene_import.Images, cooked_scene);
+    for (size_t i = 0u; i < m_meshes.size(); ++i) {
+        assert(mesh_material_indices[i] < m_materials.size());
+        m_meshes[i]->SetMaterial(m_materials[mesh_material_indices[i]]);
+    }
+    Clock::time_point upload_time = Clock::now();
+
+    m_root_node = import_nodes();
+    Clock::time_point node_time = Clock::now();
+
+    char message[512];
+    sprintf_s(message, "Scene import on %zu threads: material parse %.2f ms, texture decode and mesh processing %.2f ms (%zu textures %.2f ms, %zu meshes %.2f ms, %.1fx parallel), upload recording %.2f ms, nodes %.2f ms\n",
+        scene_import.ThreadCount, scene_import.ParseTime, scene_import.ProcessTime,
+        scene_import.Images.size(), scene_import.DecodeTime, scene_import.MeshCount, scene_import.MeshTime,
+        scene_import.ProcessTime > 0.0 ? (scene_import.DecodeTime + scene_import.MeshTime) / scene_import.ProcessTime : 1.0,
+        std::chrono::duration<double, std::milli>(mesh_upload_time + (upload_time - upload_start_time)).count(),
+        std::chrono::duration<double, std::milli>(node_time - upload_time).count());
+    OutputDebugStringA(message);
+
+    sprintf_s(message, "Scene import memory: %.1f MB peak working set (%.1f MB process peak), %.1f MB of mesh data pending at most with a %.1f MB budget\n",
+        scene_import.PeakWorkingSetSize / (1024.0 * 1024.0), GetPeakWorkingSetSize() / (1024.0 * 1024.0),
+        scene_import.PeakPendingSize / (1024.0 * 1024.0), m_import_memory_budget / (1024.0 * 1024.0));
+    OutputDebugStringA(message);
+}
+
+uint64_t Scene::EstimateMeshImportSize(size_t vertex_count, size_t index_count) const {
+    // Full and GPU vertices live side by side, the levels of detail add less than the full index count
+    // and indices exist as 32 bit and GPU copies.
+    return static_cast<uint64_t>(vertex_count) * (sizeof(VertexPositionNormalTangentBitangentTexture) + GetVertexStride(m_vertex_format))
+        + static_cast<uint64_t>(index_count) * 2u * (sizeof(uint32_t) + sizeof(uint32_t));
+}
+
+void Scene::ImportSceneData(const aiScene& scene, const std::filesystem::path& parent_path, ThreadPool& thread_pool, SceneImport& scene_import) const {
+    SceneSource source;
+    source.MaterialCount = scene.mNumMaterials;
+    source.ImportMaterial = [&](size_t i) {
+        return ImportMaterial(*(scene.mMaterials[i]), parent_path);
+    };
+    for (unsigned int i = 0u; i < scene.mNumMeshes; ++i) {
+        source.MeshSizes.push_back(EstimateMeshImportSize(scene.mMeshes[i]->mNumVertices, scene.mMeshes[i]->mNumFaces * 3u));
     }
-    
-    for (unsigned int i = 0; i < scene.mNumMeshes; ++i) {
-        ImportMesh(command_list, *(scene.mMeshes[i]));
+    source.ImportMesh = [&](size_t i) {
+        return ImportMesh(*(scene.mMeshes[i]));
+    };
+
+    ImportSceneData(source, [](MeshImport&) {}, thread_pool, scene_import);
+}
+
+void Scene::ImportSceneData(const SceneSource& source, const std::function<void(MeshImport&)>& consume_mesh, ThreadPool& thread_pool, SceneImport& scene_import) const {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start_time = Clock::now();
+
+    scene_import.Materials.resize(source.MaterialCount);
+    thread_pool.ParallelFor(source.MaterialCount, [&](size_t i) {
+        scene_import.Materials[i] = source.ImportMaterial(i);
+    });
+    CollectImages(scene_import.Materials, scene_import.Images);
+    std::vector<IOService::Request> prefetches = PrefetchImages(scene_import.Images);
+
+    Clock::time_point parse_time = Clock::now();
+
+    // Texture decodes and mesh conversions share the workers and the calling thread, textures first. Meshes
+    // start in order while the estimated size of the pending ones fits into the memory budget and are handed
+    // to consume_mesh on the calling thread in order, which frees them. The next mesh to be handed on may
+    // always start, nothing else is pending then, so a mesh larger than the budget imports on its own.
+    struct State {
+        std::mutex Mutex;
+        std::condition_variable Condition;
+        std::vector<uint64_t> MeshSizes;
+        uint64_t MemoryBudget = 0u;
+        size_t NextImage = 0u;
+        size_t NextMesh = 0u;
+        size_t NextConsumedMesh = 0u;
+        size_t ActiveCount = 0u;
+        size_t HelperCount = 0u;
+        uint64_t PendingSize = 0u;
+        uint64_t PeakPendingSize = 0u;
+        std::vector<std::unique_ptr<MeshImport>> Meshes;
+        std::exception_ptr Exception;
+        std::atomic<int64_t> DecodeTime = 0;
+        std::atomic<int64_t> MeshTime = 0;
+
+        bool CanStartImage(size_t image_count) const {
+            return !Exception && NextImage < image_count;
+        }
+
+        bool CanStartMesh() const {
+            return !Exception && NextMesh < MeshSizes.size() && (NextMesh == NextConsumedMesh || PendingSize + MeshSizes[NextMesh] <= MemoryBudget);
+        }
+    };
+    auto state = std::make_shared<State>();
+    state->MeshSizes = source.MeshSizes;
+    state->MemoryBudget = m_import_memory_budget;
+    state->Meshes.resize(source.MeshSizes.size());
+
+    const size_t image_count = scene_import.Images.size();
+    const size_t mesh_count = source.MeshSizes.size();
+    std::vector<ImageImport>& images = scene_import.Images;
+
+    // Both run one task with the lock held on entry and on return.
+    auto run_image = [state, &images](std::unique_lock<std::mutex>& lock) {
+        size_t index = state->NextImage++;
+        ++state->ActiveCount;
+        lock.unlock();
+
+        std::exception_ptr exception;
+        Clock::time_point task_start_time = Clock::now();
+        try {
+            DecodeImage(images[index]);
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+        state->DecodeTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - task_start_time).count();
+
+        lock.lock();
+        if (exception && !state->Exception) {
+            state->Exception = exception;
+        }
+        --state->ActiveCount;
+        state->Condition.notify_all();
+    };
+    auto run_mesh = [state, &source](std::unique_lock<std::mutex>& lock) {
+        size_t index = state->NextMesh++;
+        state->PendingSize += state->MeshSizes[index];
+        state->PeakPendingSize = std::max(state->PeakPendingSize, state->PendingSize);
+        ++state->ActiveCount;
+        lock.unlock();
+
+        std::unique_ptr<MeshImport> mesh_import;
+        std::exception_ptr exception;
+        Clock::time_point task_start_time = Clock::now();
+        try {
+            mesh_import = std::make_unique<MeshImport>(source.ImportMesh(index));
+        }
+        catch (...) {
+            exception = std::current_exception();
+        }
+        state->MeshTime += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - task_start_time).count();
+
+        lock.lock();
+        state->Meshes[index] = std::move(mesh_import);
+        if (exception && !state->Exception) {
+            state->Exception = exception;
+        }
+        --state->ActiveCount;
+        state->Condition.notify_all();
+    };
+
+    // Helpers return instead of waiting when the budget is used up, so they never block a worker.
+    // Consuming a mesh frees budget and brings them back.
+    const size_t helper_limit = std::min(thread_pool.GetThreadCount(), image_count + mesh_count);
+    auto helper = [state, image_count, run_image, run_mesh]() {
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        for (;;) {
+            if (state->CanStartImage(image_count)) {
+                run_image(lock);
+            }
+            else if (state->CanStartMesh()) {
+                run_mesh(lock);
+            }
+            else {
+                --state->HelperCount;
+                return;
+            }
+        }
+    };
+    auto start_helpers = [&]() {
+        while (state->HelperCount < helper_limit && (state->CanStartImage(image_count) || state->CanStartMesh())) {
+            ++state->HelperCount;
+            thread_pool.Submit(helper);
+        }
+    };
+
+    uint64_t peak_working_set_size = GetWorkingSetSize();
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    start_helpers();
+    while (!state->Exception && (state->NextConsumedMesh < mesh_count || state->NextImage < image_count || state->ActiveCount > 0u)) {
+        size_t index = state->NextConsumedMesh;
+        if (index < mesh_count && state->Meshes[index]) {
+            std::unique_ptr<MeshImport> mesh_import = std::move(state->Meshes[index]);
+            lock.unlock();
+
+            try {
+                consume_mesh(*mesh_import);
+            }
+            catch (...) {
+                lock.lock();
+                if (!state->Exception) {
+                    state->Exception = std::current_exception();
+                }
+                break;
+            }
+            mesh_import.reset();
+            peak_working_set_size = std::max(peak_working_set_size, GetWorkingSetSize());
+
+            lock.lock();
+            state->PendingSize -= state->MeshSizes[index];
+            state->NextConsumedMesh++;
+            start_helpers();
+        }
+        else if (state->CanStartMesh()) {
+            run_mesh(lock);
+        }
+        else if (state->CanStartImage(image_count)) {
+            run_image(lock);
+        }
+        else {
+            state->Condition.wait(lock);
+        }
     }
 
-    m_root_node = ImportSceneNode(command_list, nullptr, scene.mRootNode);
+    // After a failure nothing new starts, the tasks still running refer to this frame.
+    state->Condition.wait(lock, [&state]() { return state->ActiveCount == 0u; });
+    if (state->Exception) {
+        std::rethrow_exception(state->Exception);
+    }
+    lock.unlock();
+
+    Clock::time_point process_time = Clock::now();
+
+    scene_import.MeshCount = mesh_count;
+    scene_import.ThreadCount = thread_pool.GetThreadCount() + 1u;
+    scene_import.ParseTime = std::chrono::duration<double, std::milli>(parse_time - start_time).count();
+    scene_import.ProcessTime = std::chrono::duration<double, std::milli>(process_time - parse_time).count();
+    scene_import.DecodeTime = state->DecodeTime / 1000000.0;
+    scene_import.MeshTime = state->MeshTime / 1000000.0;
+    scene_import.PeakPendingSize = state->PeakPendingSize;
+    scene_import.PeakWorkingSetSize = std::max(peak_working_set_size, GetWorkingSetSize());
 }
 
-void Scene::ImportMaterial(CommandList& command_list, const aiMaterial& material, std::filesystem::path parent_path) {
+void Scene::CollectImages(std::vector<MaterialImport>& material_imports, std::vector<ImageImport>& image_imports) const {
+    // Materials often share textures, every file is decoded once per color space.
+    std::map<std::pair<std::wstring, bool>, size_t> image_indices;
+    for (MaterialImport& material_import : material_imports) {
+        for (TextureImport& texture_import : material_import.Textures) {
+            auto result = image_indices.emplace(std::make_pair(texture_import.FileName, texture_import.SRGB), image_imports.size());
+            if (result.second) {
+                TextureCooker::Usage usage = texture_import.IsHeightMap ? TextureCooker::Usage::HeightMap : TextureCooker::GetUsage(texture_import.Type);
+                image_imports.push_back({ texture_import.FileName, texture_import.SRGB, usage, m_texture_streamer != nullptr, nullptr });
+            }
+            texture_import.ImageIndex = result.first->second;
+
+            // Whether a height map becomes a normal or a bump map is decided by its decoded format,
+            // so height maps are decoded during the import even when streaming.
+            if (texture_import.IsHeightMap) {
+                image_imports[texture_import.ImageIndex].IsStreamed = false;
+            }
+        }
+    }
+}
+
+std::vector<IOService::Request> Scene::PrefetchImages(const std::vector<ImageImport>& image_imports) {
+    std::vector<IOService::Request> prefetches;
+    prefetches.reserve(image_imports.size());
+    for (const ImageImport& image_import : image_imports) {
+        if (!image_import.IsStreamed && !CommandList::IsTextureCached(image_import.FileName, image_import.SRGB)) {
+            prefetches.push_back(IOService::Get().ReadFile(image_import.FileName));
+        }
+    }
+
+    return prefetches;
+}
+
+void Scene::DecodeImage(ImageImport& image_import) {
+    // Cached textures are created from the cache when the materials are uploaded.
+    if (image_import.IsStreamed || CommandList::IsTextureCached(image_import.FileName, image_import.SRGB)) {
+        return;
+    }
+
+    image_import.pImage = std::make_shared<DirectX::ScratchImage>();
+    TextureCooker::LoadTexture(image_import.FileName, image_import.SRGB, image_import.Usage, *image_import.pImage);
+}
+
+void Scene::UploadMaterials(CommandList& command_list, std::vector<MaterialImport>& material_imports, const std::vector<ImageImport>& image_imports, CookedScene::Writer* cooked_scene) {
+    m_materials.reserve(m_materials.size() + material_imports.size());
+    for (MaterialImport& material_import : material_imports) {
+        for (const TextureImport& texture_import : material_import.Textures) {
+            const ImageImport& image_import = image_imports[texture_import.ImageIndex];
+
+            std::shared_ptr<Texture> texture;
+            if (image_import.IsStreamed) {
+                texture = m_texture_streamer->CreatePlaceholder(texture_import.Type, image_import.FileName, image_import.SRGB);
+            }
+            else if (image_import.pImage) {
+                texture = command_list.LoadTextureFromImage(image_import.FileName, image_import.SRGB, *image_import.pImage);
+            }
+            else {
+                texture = command_list.LoadTextureFromFile(image_import.FileName, image_import.SRGB, image_import.Usage);
+            }
+
+            Material::TextureType texture_type = texture_import.Type;
+            if (texture_import.IsHeightMap) {
+                texture_type = TextureCooker::IsNormalMapFormat(texture->GetD3D12ResourceDesc().Format) ? Material::TextureType::Normal : Material::TextureType::Bump;
+            }
+
+            material_import.pMaterial->SetTexture(texture_type, texture);
+        }
+
+        if (cooked_scene) {
+            cooked_scene->AddMaterial(*material_import.pMaterial);
+        }
+
+        // Streaming starts once the material is recorded, from here on the streamer may swap its textures.
+        for (const TextureImport& texture_import : material_import.Textures) {
+            const ImageImport& image_import = image_imports[texture_import.ImageIndex];
+            if (image_import.IsStreamed) {
+                m_texture_streamer->StreamTexture(material_import.pMaterial, texture_import.Type, image_import.FileName, image_import.SRGB);
+            }
+        }
+
+        m_materials.push_back(material_import.pMaterial);
+    }
+}
+
+void Scene::UploadMesh(CommandList& command_list, MeshImport& mesh_import, CookedScene::Writer* cooked_scene) {
+    const size_t vertex_stride = GetVertexStride(m_vertex_format);
+
+    // The upload buffer keeps its own copy, so the CPU data can go right after.
+    std::shared_ptr<Mesh> mesh = mesh_import.pMesh;
+    mesh->SetVertexBuffer(0, command_list.CopyVertexBuffer(mesh_import.VertexCount, vertex_stride, mesh_import.VertexData.data()));
+    if (mesh_import.IndexCount > 0) {
+        mesh->SetIndexBuffer(command_list.CopyIndexBuffer(mesh_import.IndexCount, mesh_import.IndexFormat, mesh_import.IndexData.data()));
+    }
+
+    if (cooked_scene) {
+        cooked_scene->AddMesh(*mesh, mesh_import.MaterialIndex, mesh_import.VertexData.data(), mesh_import.VertexCount, vertex_stride, mesh_import.IndexData.data(), mesh_import.IndexCount, mesh_import.IndexFormat);
+    }
+
+    m_meshes.push_back(mesh);
+}
+
+Scene::MaterialImport Scene::ImportMaterial(const aiMaterial& material, const std::filesystem::path& parent_path) const {
     aiString material_name;
     aiString aiTexture_path;
     aiTextureOp aiBlend_operation;
@@ -154,6 +982,9 @@ void Scene::ImportMaterial(CommandList& command_list, const aiMaterial& material
 
     std::shared_ptr<Material> pMaterial = std::make_shared<Material>();
 
+    MaterialImport material_import;
+    material_import.pMaterial = pMaterial;
+
     if (material.Get(AI_MATKEY_COLOR_AMBIENT, ambient_color) == aiReturn_SUCCESS) {
         pMaterial->SetAmbientColor(DirectX::XMFLOAT4(ambient_color.r, ambient_color.g, ambient_color.b, ambient_color.a));
     }
@@ -184,142 +1015,247 @@ void Scene::ImportMaterial(CommandList& command_list, const aiMaterial& material
 
     if (material.GetTextureCount(aiTextureType_AMBIENT) > 0 && material.GetTexture(aiTextureType_AMBIENT, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, true);
-        pMaterial->SetTexture(Material::TextureType::Ambient, texture);
+        material_import.Textures.push_back({ Material::TextureType::Ambient, (parent_path / texture_path).wstring(), true, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_EMISSIVE) > 0 && material.GetTexture(aiTextureType_EMISSIVE, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, true);
-        pMaterial->SetTexture(Material::TextureType::Emissive, texture);
+        material_import.Textures.push_back({ Material::TextureType::Emissive, (parent_path / texture_path).wstring(), true, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_DIFFUSE) > 0 && material.GetTexture(aiTextureType_DIFFUSE, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, true);
-        pMaterial->SetTexture(Material::TextureType::Diffuse, texture);
+        material_import.Textures.push_back({ Material::TextureType::Diffuse, (parent_path / texture_path).wstring(), true, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_SPECULAR) > 0 && material.GetTexture(aiTextureType_SPECULAR, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, true);
-        pMaterial->SetTexture(Material::TextureType::Specular, texture);
+        material_import.Textures.push_back({ Material::TextureType::Specular, (parent_path / texture_path).wstring(), true, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_SHININESS) > 0 && material.GetTexture(aiTextureType_SHININESS, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, false);
-        pMaterial->SetTexture(Material::TextureType::SpecularPower, texture);
+        material_import.Textures.push_back({ Material::TextureType::SpecularPower, (parent_path / texture_path).wstring(), false, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_OPACITY) > 0 && material.GetTexture(aiTextureType_OPACITY, 0, &aiTexture_path, nullptr, nullptr, &blend_factor, &aiBlend_operation) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, false);
-        pMaterial->SetTexture(Material::TextureType::Opacity, texture);
+        material_import.Textures.push_back({ Material::TextureType::Opacity, (parent_path / texture_path).wstring(), false, false, 0u });
     }
 
     if (material.GetTextureCount(aiTextureType_NORMALS) > 0 && material.GetTexture(aiTextureType_NORMALS, 0, &aiTexture_path) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, false);
-        pMaterial->SetTexture(Material::TextureType::Normal, texture);
+        material_import.Textures.push_back({ Material::TextureType::Normal, (parent_path / texture_path).wstring(), false, false, 0u });
     }
     else if (material.GetTextureCount(aiTextureType_HEIGHT) > 0 && material.GetTexture(aiTextureType_HEIGHT, 0, &aiTexture_path, nullptr, nullptr, &blend_factor) == aiReturn_SUCCESS) {
         std::filesystem::path texture_path(aiTexture_path.C_Str());
-        auto texture = command_list.LoadTextureFromFile(parent_path / texture_path, false);
-
-        Material::TextureType texture_type = (texture->BitsPerPixel() >= 24) ? Material::TextureType::Normal : Material::TextureType::Bump;
-
-        pMaterial->SetTexture(texture_type, texture);
+        // Whether it's a normal or a bump map is decided by the channel count after decoding.
+        material_import.Textures.push_back({ Material::TextureType::Bump, (parent_path / texture_path).wstring(), false, true, 0u });
     }
 
-    m_materials.push_back(pMaterial);
+    return material_import;
 }
 
-void Scene::ImportMesh(CommandList& command_list, const aiMesh& aiMesh) {
-    auto mesh = std::make_shared<Mesh>();
-
-    std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data(aiMesh.mNumVertices);
+Scene::MaterialImport Scene::ImportMaterial(const ObjLoader::Material& material, const std::filesystem::path& parent_path) const {
+    std::shared_ptr<Material> pMaterial = std::make_shared<Material>();
 
-    assert(aiMesh.mMaterialIndex < m_materials.size());
-    mesh->SetMaterial(m_materials[aiMesh.mMaterialIndex]);
+    MaterialImport material_import;
+    material_import.pMaterial = pMaterial;
+
+    pMaterial->SetAmbientColor(material.AmbientColor);
+    pMaterial->SetEmissiveColor(material.EmissiveColor);
+    pMaterial->SetDiffuseColor(material.DiffuseColor);
+    pMaterial->SetSpecularColor(material.SpecularColor);
+    pMaterial->SetSpecularPower(material.SpecularPower);
+    pMaterial->SetOpacity(material.Opacity);
+    pMaterial->SetIndexOfRefraction(material.IndexOfRefraction);
+    if (material.HasBumpIntensity) {
+        pMaterial->SetBumpIntensity(material.BumpIntensity);
+    }
 
-    unsigned int i;
-    if (aiMesh.HasPositions()) {
-        for (i = 0u; i < aiMesh.mNumVertices; ++i) {
-            vertex_data[i].Position = { aiMesh.mVertices[i].x, aiMesh.mVertices[i].y, aiMesh.mVertices[i].z };
+    // Same texture slots and color spaces as for materials imported through assimp.
+    auto add_texture = [&material_import, &parent_path](Material::TextureType type, const std::string& texture_name, bool sRGB, bool is_height_map) {
+        if (!texture_name.empty()) {
+            material_import.Textures.push_back({ type, (parent_path / std::filesystem::path(texture_name)).wstring(), sRGB, is_height_map, 0u });
         }
+    };
+    add_texture(Material::TextureType::Ambient, material.AmbientTexture, true, false);
+    add_texture(Material::TextureType::Emissive, material.EmissiveTexture, true, false);
+    add_texture(Material::TextureType::Diffuse, material.DiffuseTexture, true, false);
+    add_texture(Material::TextureType::Specular, material.SpecularTexture, true, false);
+    add_texture(Material::TextureType::SpecularPower, material.SpecularPowerTexture, false, false);
+    add_texture(Material::TextureType::Opacity, material.OpacityTexture, false, false);
+    if (!material.NormalTexture.empty()) {
+        add_texture(Material::TextureType::Normal, material.NormalTexture, false, false);
+    }
+    else {
+        add_texture(Material::TextureType::Bump, material.BumpTexture, false, true);
     }
 
-    if (aiMesh.HasNormals()) {
-        for (i = 0; i < aiMesh.mNumVertices; ++i) {
-            vertex_data[i].Normal = { aiMesh.mNormals[i].x, aiMesh.mNormals[i].y, aiMesh.mNormals[i].z };
-        }
+    return material_import;
+}
+
+void Scene::OptimizeMesh(std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices, MeshOptimization* statistics) const {
+    using Clock = std::chrono::steady_clock;
+
+    const float* positions = &vertex_data[0].Position.x;
+    const size_t vertex_stride = sizeof(VertexPositionNormalTangentBitangentTexture);
+
+    if (statistics) {
+        statistics->CacheBefore = MeshOptimizer::AnalyzeVertexCache(indices, vertex_data.size());
+        statistics->OverdrawBefore = MeshOptimizer::AnalyzeOverdraw(indices, positions, vertex_data.size(), vertex_stride);
+        statistics->FetchBefore = MeshOptimizer::AnalyzeVertexFetch(indices, vertex_data.size(), GetVertexStride(m_vertex_format));
     }
 
-    if (aiMesh.HasTangentsAndBitangents()) {
-        for (i = 0; i < aiMesh.mNumVertices; ++i) {
-            vertex_data[i].Tangent = { aiMesh.mTangents[i].x, aiMesh.mTangents[i].y, aiMesh.mTangents[i].z };
-            vertex_data[i].Bitangent = { aiMesh.mBitangents[i].x, aiMesh.mBitangents[i].y, aiMesh.mBitangents[i].z };
-        }
+    Clock::time_point start_time = Clock::now();
+
+    MeshOptimizer::OptimizeVertexCache(indices, vertex_data.size());
+    MeshOptimizer::OptimizeOverdraw(indices, positions, vertex_data.size(), vertex_stride);
+
+    std::vector<uint32_t> remap;
+    size_t unique_vertex_count = MeshOptimizer::OptimizeVertexFetchRemap(remap, indices, vertex_data.size());
+    MeshOptimizer::RemapIndexBuffer(indices, remap);
+    MeshOptimizer::RemapVertexBuffer(vertex_data, remap, unique_vertex_count);
+    Clock::time_point end_time = Clock::now();
+
+    if (statistics) {
+        positions = &vertex_data[0].Position.x;
+        statistics->CacheAfter = MeshOptimizer::AnalyzeVertexCache(indices, vertex_data.size());
+        statistics->OverdrawAfter = MeshOptimizer::AnalyzeOverdraw(indices, positions, vertex_data.size(), vertex_stride);
+        statistics->FetchAfter = MeshOptimizer::AnalyzeVertexFetch(indices, vertex_data.size(), GetVertexStride(m_vertex_format));
+        statistics->OptimizeTime = std::chrono::duration<double, std::milli>(end_time - start_time).count();
     }
+}
 
-    if (aiMesh.HasTextureCoords(0)) {
-        for (i = 0; i < aiMesh.mNumVertices; ++i) {
-            vertex_data[i].TexCoord = { aiMesh.mTextureCoords[0][i].x, aiMesh.mTextureCoords[0][i].y, aiMesh.mTextureCoords[0][i].z };
+std::vector<Mesh::LOD> Scene::GenerateLODs(const std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices) const {
+    const std::vector<uint32_t> full_indices = indices;
+    const float* positions = &vertex_data[0].Position.x;
+    const size_t vertex_stride = sizeof(VertexPositionNormalTangentBitangentTexture);
+
+    std::vector<Mesh::LOD> lods;
+    lods.push_back({ 0u, static_cast<uint32_t>(full_indices.size()), 0.0f });
+
+    size_t previous_index_count = full_indices.size();
+    for (const LODLevel& level : m_lod_levels) {
+        size_t target_index_count = static_cast<size_t>(static_cast<float>(full_indices.size() / 3u) * level.IndexRatio) * 3u;
+
+        // Every level is simplified from the full mesh, so its error is measured against the original surface.
+        float error = 0.0f;
+        std::vector<uint32_t> lod_indices = MeshOptimizer::Simplify(full_indices, positions, vertex_data.size(), vertex_stride, target_index_count, level.MaxError, &error);
+
+        // Stop when the error target doesn't allow a meaningful reduction anymore.
+        if (lod_indices.empty() || lod_indices.size() > previous_index_count * 9u / 10u) {
+            break;
         }
+
+        MeshOptimizer::OptimizeVertexCache(lod_indices, vertex_data.size());
+
+        lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod_indices.size()), error });
+        indices.insert(indices.end(), lod_indices.cbegin(), lod_indices.cend());
+        previous_index_count = lod_indices.size();
     }
 
-    auto vertex_buffer = command_list.CopyVertexBuffer(vertex_data);
-    mesh->SetVertexBuffer(0, vertex_buffer);
+    return lods;
+}
 
-    if (aiMesh.HasFaces()) {
-        std::vector<unsigned int> indices;
-        for (i = 0; i < aiMesh.mNumFaces; ++i) {
-            const aiFace& face = aiMesh.mFaces[i];
+Scene::MeshImport Scene::ImportMesh(const aiMesh& aiMesh) const {
+    std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data;
+    std::vector<uint32_t> indices;
+    ExtractMeshData(aiMesh, vertex_data, indices);
 
-            if (face.mNumIndices == 3) {
-                indices.push_back(face.mIndices[0]);
-                indices.push_back(face.mIndices[1]);
-                indices.push_back(face.mIndices[2]);
-            }
+    return ImportMesh(aiMesh.mName.C_Str(), aiMesh.mMaterialIndex, vertex_data, indices, CreateBoundingBox(aiMesh.mAABB));
+}
+
+Scene::MeshImport Scene::ImportMesh(const std::string& mesh_name, unsigned int material_index, std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices, const DirectX::BoundingBox& aabb) const {
+    auto mesh = std::make_shared<Mesh>();
+
+    MeshImport mesh_import;
+    mesh_import.pMesh = mesh;
+    mesh_import.MaterialIndex = material_index;
+
+    if (indices.size() > 0) {
+        OptimizeMesh(vertex_data, indices);
+        // Small meshes fit into a handful of clusters, culling them per cluster isn't worth a draw call each.
+        if (m_build_meshlets && indices.size() / 3u > Meshlet_min_triangles) {
+            mesh->SetMeshlets(MeshOptimizer::BuildMeshlets(indices, &vertex_data[0].Position.x, vertex_data.size(), sizeof(VertexPositionNormalTangentBitangentTexture)));
         }
+        mesh->SetLODs(GenerateLODs(vertex_data, indices));
+    }
 
-        if (indices.size() > 0) {
-            auto indexBuffer = command_list.CopyIndexBuffer(indices);
-            mesh->SetIndexBuffer(indexBuffer);
+    mesh_import.VertexCount = vertex_data.size();
+    switch (m_vertex_format) {
+        case VertexFormat::PositionPackedNormalTangentTexture: {
+            std::vector<VertexPositionPackedNormalTangentTexture> packed_vertex_data(vertex_data.cbegin(), vertex_data.cend());
+            StoreBlob(mesh_import.VertexData, packed_vertex_data);
+            break;
         }
+        case VertexFormat::QuantizedPositionPackedNormalTangentTexture: {
+            // Quantize inside the mesh bounds, a flat axis keeps a scale of one to avoid dividing by zero.
+            DirectX::XMVECTOR extents = DirectX::XMLoadFloat3(&aabb.Extents);
+            DirectX::XMVECTOR position_scale = DirectX::XMVectorAdd(extents, extents);
+            position_scale = DirectX::XMVectorSelect(position_scale, DirectX::XMVectorSplatOne(), DirectX::XMVectorLessOrEqual(position_scale, DirectX::XMVectorZero()));
+            DirectX::XMVECTOR position_offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&aabb.Center), extents);
+
+            std::vector<VertexQuantizedPositionPackedNormalTangentTexture> quantized_vertex_data;
+            quantized_vertex_data.reserve(vertex_data.size());
+            for (const auto& vertex : vertex_data) {
+                quantized_vertex_data.emplace_back(vertex, position_offset, position_scale);
+            }
+            StoreBlob(mesh_import.VertexData, quantized_vertex_data);
+
+            DirectX::XMFLOAT3 scale;
+            DirectX::XMFLOAT3 offset;
+            DirectX::XMStoreFloat3(&scale, position_scale);
+            DirectX::XMStoreFloat3(&offset, position_offset);
+            mesh->SetPositionDequantization(scale, offset);
+            break;
+        }
+        default:
+            StoreBlob(mesh_import.VertexData, vertex_data);
+            break;
+    }
+    mesh->SetVertexFormat(m_vertex_format);
+
+    mesh_import.IndexCount = indices.size();
+    if (vertex_data.size() <= 0x10000u) {
+        std::vector<uint16_t> short_indices(indices.size());
+        std::transform(indices.cbegin(), indices.cend(), short_indices.begin(), [](uint32_t index) { return static_cast<uint16_t>(index); });
+        StoreBlob(mesh_import.IndexData, short_indices);
+        mesh_import.IndexFormat = DXGI_FORMAT_R16_UINT;
+    }
+    else {
+        StoreBlob(mesh_import.IndexData, indices);
+        mesh_import.IndexFormat = DXGI_FORMAT_R32_UINT;
     }
 
-    mesh->SetAABB(CreateBoundingBox(aiMesh.mAABB));
+    mesh->SetAABB(aabb);
 
-    m_meshes.push_back(mesh);
+    return mesh_import;
 }
 
-std::shared_ptr<SceneNode> Scene::ImportSceneNode(CommandList& command_list, std::shared_ptr<SceneNode> parent, const aiNode* aiNode) {
+void Scene::ImportSceneNode(SceneBuilder& builder, const aiNode* aiNode, uint32_t parent_index, CookedScene::Writer* cooked_scene) {
     if (!aiNode) {
-        return nullptr;
+        return;
     }
 
-    auto node = std::make_shared<SceneNode>(DirectX::XMMATRIX(&(aiNode->mTransformation.a1)));
-    node->SetParent(parent);
-
-    if (aiNode->mName.length > 0) {
-        node->SetName(aiNode->mName.C_Str());
-    }
+    // Node transforms are relative to the parent, the builder takes them as they are.
+    DirectX::XMMATRIX local_transform(&(aiNode->mTransformation.a1));
+    uint32_t node_index = builder.AddNode(aiNode->mName.C_Str(), parent_index, local_transform);
 
     for (unsigned int i = 0; i < aiNode->mNumMeshes; ++i) {
         assert(aiNode->mMeshes[i] < m_meshes.size());
 
-        std::shared_ptr<Mesh> pMesh = m_meshes[aiNode->mMeshes[i]];
-        node->AddMesh(pMesh);
+        builder.AddMesh(node_index, m_meshes[aiNode->mMeshes[i]]);
     }
 
-    for (unsigned int i = 0; i < aiNode->mNumChildren; ++i) {
-        auto child = ImportSceneNode(command_list, node, aiNode->mChildren[i]);
-        node->AddChild(child);
+    if (cooked_scene) {
+        std::vector<uint32_t> mesh_indices(aiNode->mMeshes, aiNode->mMeshes + aiNode->mNumMeshes);
+        cooked_scene->AddNode(builder.GetNode(node_index)->GetName(), parent_index, local_transform, mesh_indices);
     }
 
-    return node;
+    for (unsigned int i = 0; i < aiNode->mNumChildren; ++i) {
+        ImportSceneNode(builder, aiNode->mChildren[i], node_index, cooked_scene);
+    }
 }
 
 void Scene::Accept(Visitor& visitor) {
@@ -329,6 +1265,54 @@ void Scene::Accept(Visitor& visitor) {
     }
 }
 
+void Scene::SetLODLevels(const std::vector<LODLevel>& lod_levels) {
+    m_lod_levels = lod_levels;
+}
+
+const std::vector<Scene::LODLevel>& Scene::GetLODLevels() const {
+    return m_lod_levels;
+}
+
+void Scene::SetBuildMeshlets(bool build_meshlets) {
+    m_build_meshlets = build_meshlets;
+}
+
+bool Scene::GetBuildMeshlets() const {
+    return m_build_meshlets;
+}
+
+void Scene::SetNativeObjImport(bool native_obj_import) {
+    m_native_obj_import = native_obj_import;
+}
+
+bool Scene::GetNativeObjImport() const {
+    return m_native_obj_import;
+}
+
+void Scene::SetImportMemoryBudget(uint64_t import_memory_budget) {
+    m_import_memory_budget = import_memory_budget;
+}
+
+uint64_t Scene::GetImportMemoryBudget() const {
+    return m_import_memory_budget;
+}
+
+void Scene::SetTextureStreamer(std::shared_ptr<TextureStreamer> texture_streamer) {
+    m_texture_streamer = texture_streamer;
+}
+
+std::shared_ptr<TextureStreamer> Scene::GetTextureStreamer() const {
+    return m_texture_streamer;
+}
+
+void Scene::SetVertexFormat(VertexFormat vertex_format) {
+    m_vertex_format = vertex_format;
+}
+
+VertexFormat Scene::GetVertexFormat() const {
+    return m_vertex_format;
+}
+
 DirectX::BoundingBox Scene::GetAABB() const {
     DirectX::BoundingBox aabb{ { 0, 0, 0 }, { 0, 0, 0 } };
 
@@ -1,6 +1,13 @@
 #pragma once
 
+#include "derived_data_cache.h"
+#include "io_service.h"
+#include "material.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "texture_cooker.h"
 #include "utils.h"
+#include "vertex_types.h"
 
 #include <DirectXCollision.h>
 
@@ -17,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 struct aiMaterial;
 struct aiMesh;
@@ -24,14 +32,35 @@ struct aiNode;
 struct aiScene;
 class CommandList;
 class Device;
+class SceneBuilder;
 class SceneNode;
-class Mesh;
-class Material;
+class TextureStreamer;
+class ThreadPool;
 class Visitor;
 
+namespace DirectX {
+	class ScratchImage;
+}
+
+namespace CookedScene {
+	class Writer;
+}
+
+namespace ObjLoader {
+	struct Material;
+	struct Model;
+}
+
 class Scene {
 public:
-	Scene() = default;
+	// One entry per generated level of detail. IndexRatio is the target triangle count
+	// relative to the full mesh, MaxError the allowed error relative to the mesh extent.
+	struct LODLevel {
+		float IndexRatio;
+		float MaxError;
+	};
+
+	Scene();
 	~Scene() = default;
 
 	void SetRootNode(std::shared_ptr<SceneNode> node);
@@ -39,18 +68,159 @@ public:
 
 	DirectX::BoundingBox GetAABB() const;
 
+	// Vertex layout used for meshes created by the following LoadSceneFrom* calls.
+	void SetVertexFormat(VertexFormat vertex_format);
+	VertexFormat GetVertexFormat() const;
+
+	void SetLODLevels(const std::vector<LODLevel>& lod_levels);
+	const std::vector<LODLevel>& GetLODLevels() const;
+
+	// Upper bound for the estimated size of converted meshes waiting for their upload, fewer meshes
+	// convert in parallel when it's reached. A mesh larger than the budget still imports on its own.
+	void SetImportMemoryBudget(uint64_t import_memory_budget);
+	uint64_t GetImportMemoryBudget() const;
+
+	// Larger meshes are split into meshlets for CPU cluster culling.
+	void SetBuildMeshlets(bool build_meshlets);
+	bool GetBuildMeshlets() const;
+
+	// OBJ files are imported by ObjLoader instead of assimp, files it can't handle still go through assimp.
+	void SetNativeObjImport(bool native_obj_import);
+	bool GetNativeObjImport() const;
+
+	// With a streamer, materials start out with placeholder textures and the files load in the background.
+	void SetTextureStreamer(std::shared_ptr<TextureStreamer> texture_streamer);
+	std::shared_ptr<TextureStreamer> GetTextureStreamer() const;
+
+	// Hash of the settings that change what LoadSceneFromFile creates, see SceneCache.
+	uint64_t GetImportSettingsHash() const;
+
+	// A new scene with its own copy of the node hierarchy of source that shares the meshes, materials
+	// and their GPU resources. The instance keeps source alive.
+	static std::shared_ptr<Scene> CreateInstance(const std::shared_ptr<const Scene>& source);
+
 	virtual void Accept(Visitor& visitor);
 
 	friend class CommandList;
+	friend class Tools;
 
 	bool LoadSceneFromFile(CommandList& command_list, const std::wstring& file_name, const std::function<bool(float)>& loading_progress);
 	bool LoadSceneFromString(CommandList& command_list, const std::string& scene_str, const std::string& format);
 
 private:
-	void ImportScene(CommandList& command_list, const aiScene& scene, std::filesystem::path parent_path);
-	void ImportMaterial(CommandList& command_list, const aiMaterial& material, std::filesystem::path parent_path);
-	void ImportMesh(CommandList& command_list, const aiMesh& mesh);
-	std::shared_ptr<SceneNode> ImportSceneNode(CommandList& command_list, std::shared_ptr<SceneNode> parent, const aiNode* aiNode);
+	struct TextureImport {
+		Material::TextureType Type;
+		std::wstring FileName;
+		bool SRGB;
+		bool IsHeightMap;
+		size_t ImageIndex;
+	};
+
+	struct MaterialImport {
+		std::shared_ptr<Material> pMaterial;
+		std::vector<TextureImport> Textures;
+	};
+
+	// Image stays empty for textures that are already in the texture cache and for streamed ones.
+	struct ImageImport {
+		std::wstring FileName;
+		bool SRGB;
+		TextureCooker::Usage Usage;
+		bool IsStreamed;
+		std::shared_ptr<DirectX::ScratchImage> pImage;
+	};
+
+	// Vertex and index data in their final GPU layout, ready to be copied into buffers.
+	struct MeshImport {
+		std::shared_ptr<Mesh> pMesh;
+		unsigned int MaterialIndex;
+		size_t VertexCount;
+		std::vector<uint8_t> VertexData;
+		size_t IndexCount;
+		DXGI_FORMAT IndexFormat;
+		std::vector<uint8_t> IndexData;
+	};
+
+	// Source of an import. MeshSizes holds the estimated size of every converted mesh, ImportMesh may
+	// free the source data of the mesh it converts.
+	struct SceneSource {
+		size_t MaterialCount;
+		std::function<MaterialImport(size_t)> ImportMaterial;
+		std::vector<uint64_t> MeshSizes;
+		std::function<MeshImport(size_t)> ImportMesh;
+	};
+
+	// Result of the CPU side of an import, the meshes are handed on as they are converted. Times are in
+	// milliseconds, the decode and mesh times are summed over all threads while ProcessTime is the wall
+	// clock time of both. Sizes are in bytes.
+	struct SceneImport {
+		std::vector<MaterialImport> Materials;
+		std::vector<ImageImport> Images;
+		size_t MeshCount;
+		size_t ThreadCount;
+		double ParseTime;
+		double ProcessTime;
+		double DecodeTime;
+		double MeshTime;
+		uint64_t PeakPendingSize;
+		uint64_t PeakWorkingSetSize;
+	};
+
+	// Hashes the source files together with the import settings that affect the cooked scene.
+	bool CreateCookedSceneKey(const std::filesystem::path& file_path, DerivedDataCache::Key& key) const;
+	void AddImportSettings(DerivedDataCache::Key& key) const;
+
+	// Loads a scene cooked by an earlier import, fails if the file is invalid or was cooked for another vertex format.
+	bool LoadCookedScene(CommandList& command_list, const std::filesystem::path& cooked_path, const std::filesystem::path& parent_path);
+
+	// Reads a source file through the I/O service with the post processing every import uses.
+	static const aiScene* ReadSourceScene(Assimp::Importer& importer, const std::filesystem::path& file_path);
+	static void ExtractMeshData(const aiMesh& mesh, std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices);
+
+	// The imported materials, meshes and nodes are also recorded into cooked_scene when one is passed in.
+	// Both free the meshes of their source as soon as they are converted.
+	void ImportScene(CommandList& command_list, aiScene& scene, std::filesystem::path parent_path, CookedScene::Writer* cooked_scene = nullptr);
+	void ImportObjScene(CommandList& command_list, ObjLoader::Model& model, const std::string& root_name, const std::filesystem::path& parent_path, CookedScene::Writer* cooked_scene);
+
+	// Replaces the content of the scene with the imported data. Every mesh is uploaded and released as soon as it's
+	// converted, the materials follow once the textures are decoded and import_nodes then builds the node hierarchy.
+	void StreamScene(CommandList& command_list, const SceneSource& source, CookedScene::Writer* cooked_scene, const std::function<std::shared_ptr<SceneNode>()>& import_nodes);
+
+	// Material parsing, texture decoding and mesh processing run on the thread pool, none of them touches the GPU.
+	// Meshes are handed to consume_mesh in order on the calling thread while the ones pending stay within the import memory budget.
+	void ImportSceneData(const aiScene& scene, const std::filesystem::path& parent_path, ThreadPool& thread_pool, SceneImport& scene_import) const;
+	void ImportSceneData(const SceneSource& source, const std::function<void(MeshImport&)>& consume_mesh, ThreadPool& thread_pool, SceneImport& scene_import) const;
+	uint64_t EstimateMeshImportSize(size_t vertex_count, size_t index_count) const;
+	MaterialImport ImportMaterial(const aiMaterial& material, const std::filesystem::path& parent_path) const;
+	MaterialImport ImportMaterial(const ObjLoader::Material& material, const std::filesystem::path& parent_path) const;
+	MeshImport ImportMesh(const aiMesh& mesh) const;
+	MeshImport ImportMesh(const std::string& mesh_name, unsigned int material_index, std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices, const DirectX::BoundingBox& aabb) const;
+	void CollectImages(std::vector<MaterialImport>& material_imports, std::vector<ImageImport>& image_imports) const;
+	static void DecodeImage(ImageImport& image_import);
+
+	// Queues reads of every image that is decoded during the import, the decodes then find the files
+	// already read or in flight. The files stay in memory as long as the returned requests are held.
+	static std::vector<IOService::Request> PrefetchImages(const std::vector<ImageImport>& image_imports);
+
+	// Records the uploads of imported data, called on the thread that owns the command list.
+	void UploadMaterials(CommandList& command_list, std::vector<MaterialImport>& material_imports, const std::vector<ImageImport>& image_imports, CookedScene::Writer* cooked_scene);
+	void UploadMesh(CommandList& command_list, MeshImport& mesh_import, CookedScene::Writer* cooked_scene);
+
+	// Statistics of OptimizeMesh, the time is in milliseconds.
+	struct MeshOptimization {
+		MeshOptimizer::VertexCacheStatistics CacheBefore;
+		MeshOptimizer::VertexCacheStatistics CacheAfter;
+		MeshOptimizer::OverdrawStatistics OverdrawBefore;
+		MeshOptimizer::OverdrawStatistics OverdrawAfter;
+		MeshOptimizer::VertexFetchStatistics FetchBefore;
+		MeshOptimizer::VertexFetchStatistics FetchAfter;
+		double OptimizeTime;
+	};
+
+	// Statistics are only gathered when requested, the overdraw analysis rasterizes the mesh twice from six directions.
+	void OptimizeMesh(std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices, MeshOptimization* statistics = nullptr) const;
+	std::vector<Mesh::LOD> GenerateLODs(const std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, std::vector<uint32_t>& indices) const;
+	void ImportSceneNode(SceneBuilder& builder, const aiNode* aiNode, uint32_t parent_index, CookedScene::Writer* cooked_scene);
 
 	using MaterialMap = std::map<std::string, std::shared_ptr<Material>>;
 	using MaterialList = std::vector<std::shared_ptr<Material>>;
@@ -63,4 +233,15 @@ private:
 	std::shared_ptr<SceneNode> m_root_node;
 
 	std::wstring m_scene_file;
-};
+
+	VertexFormat m_vertex_format;
+	std::vector<LODLevel> m_lod_levels;
+	bool m_build_meshlets;
+	bool m_native_obj_import;
+	uint64_t m_import_memory_budget;
+
+	std::shared_ptr<TextureStreamer> m_texture_streamer;
+
+	// The scene an instance shares its meshes and materials with.
+	std::shared_ptr<const Scene> m_source;
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "scene_builder.h"
+
+#include "mesh.h"
+#include "scene_node.h"
+
+#include <cassert>
+
+SceneBuilder::SceneBuilder(size_t node_capacity) {
+	m_nodes.reserve(node_capacity);
+	m_parent_indices.reserve(node_capacity);
+}
+
+uint32_t SceneBuilder::AddNode(const std::string& name, uint32_t parent_index, const DirectX::XMMATRIX& local_transform) {
+	assert(parent_index == InvalidIndex || parent_index < m_nodes.size());
+
+	auto node = std::make_shared<SceneNode>(local_transform);
+	if (!name.empty()) {
+		node->SetName(name);
+	}
+
+	if (parent_index != InvalidIndex) {
+		const std::shared_ptr<SceneNode>& parent = m_nodes[parent_index];
+		node->m_parent_node = parent;
+		parent->m_children.push_back(node);
+		parent->m_children_by_name.emplace(node->GetName(), node);
+	}
+
+	uint32_t node_index = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back(node);
+	m_parent_indices.push_back(parent_index);
+
+	return node_index;
+}
+
+void SceneBuilder::AddMesh(uint32_t node_index, std::shared_ptr<Mesh> mesh) {
+	m_nodes[node_index]->AddMesh(mesh);
+}
+
+size_t SceneBuilder::GetNodeCount() const {
+	return m_nodes.size();
+}
+
+std::shared_ptr<SceneNode> SceneBuilder::GetNode(uint32_t node_index) const {
+	return m_nodes[node_index];
+}
+
+std::shared_ptr<SceneNode> SceneBuilder::Build() {
+	// Parents come before their children, so a single loop finds every parent world transform up to date.
+	for (size_t i = 0u; i < m_nodes.size(); ++i) {
+		SceneNode& node = *m_nodes[i];
+		if (m_parent_indices[i] == InvalidIndex) {
+			node.m_aligned_data->m_world_transform = node.m_aligned_data->m_local_transform;
+		}
+		else {
+			node.m_aligned_data->m_world_transform = node.m_aligned_data->m_local_transform * m_nodes[m_parent_indices[i]]->m_aligned_data->m_world_transform;
+		}
+		node.m_is_world_dirty = false;
+	}
+
+	std::shared_ptr<SceneNode> root = m_nodes.empty() ? nullptr : m_nodes[0];
+	m_nodes.clear();
+	m_parent_indices.clear();
+
+	return root;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+class Mesh;
+class SceneNode;
+
+// Builds a node hierarchy in one pass. Nodes are added with transforms relative to their parent,
+// which has to be added before them, and are linked directly instead of going through
+// SceneNode::AddChild, which keeps the world transform of the child and inverts matrices on the
+// way. Build computes every world transform from the root down, parents before their children.
+class SceneBuilder {
+public:
+	static constexpr uint32_t InvalidIndex = ~0u;
+
+	explicit SceneBuilder(size_t node_capacity = 0u);
+
+	// Returns the index of the node, nodes without a parent use InvalidIndex. An empty name keeps the default one.
+	uint32_t AddNode(const std::string& name, uint32_t parent_index, const DirectX::XMMATRIX& local_transform);
+	void AddMesh(uint32_t node_index, std::shared_ptr<Mesh> mesh);
+
+	size_t GetNodeCount() const;
+	std::shared_ptr<SceneNode> GetNode(uint32_t node_index) const;
+
+	// Computes the world transforms and returns the first node, or nullptr without any. The builder is empty afterwards.
+	std::shared_ptr<SceneNode> Build();
+
+private:
+	std::vector<std::shared_ptr<SceneNode>> m_nodes;
+	std::vector<uint32_t> m_parent_indices;
+};
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "scene_cache.h"
+
+#include "command_list.h"
+#include "device.h"
+#include "scene.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <filesystem>
+
+SceneCache::SceneCache() : m_statistics() {}
+
+SceneCache& SceneCache::Get() {
+	static SceneCache scene_cache;
+	return scene_cache;
+}
+
+SceneCache::Key SceneCache::CreateKey(const std::wstring& file_name, const Scene& scene) {
+	// Relative names and names with redundant parts of the same file share an entry.
+	std::error_code error_code;
+	std::filesystem::path file_path = std::filesystem::absolute(file_name, error_code);
+	if (error_code) {
+		file_path = file_name;
+	}
+
+	return { file_path.lexically_normal().wstring(), scene.GetImportSettingsHash() };
+}
+
+std::shared_ptr<Scene> SceneCache::GetOrLoad(const Key& key, const Loader& loader, std::vector<Upload>& uploads) {
+	// A failed load leaves an expired scene, a loaded one is forgotten once its scene dies.
+	InFlightLoads<Key, LoadedScene>::Callbacks callbacks;
+	callbacks.IsValid = [](const LoadedScene& loaded_scene) {
+		return !loaded_scene.pScene.expired();
+	};
+	callbacks.OnHit = [this](const Entry& entry) {
+		if (InFlightLoads<Key, LoadedScene>::IsReady(entry) && entry.get().pScene.expired()) {
+			++m_statistics.Unloads;
+			return false;
+		}
+		return true;
+	};
+	callbacks.OnLoaded = [this](const LoadedScene&) {
+		TrimLocked();
+	};
+
+	// A load that fails or a scene that dies before a waiting caller gets to it sends the caller around again.
+	for (;;) {
+		Load load;
+		bool is_loader = false;
+		LoadedScene loaded_scene = m_loads.GetOrLoad(m_mutex, key, [&loader, &load]() {
+			load = loader();
+			return LoadedScene{ load.pScene, load.Uploads };
+		}, callbacks, &is_loader);
+
+		// The loaded scene itself is never handed out, so every instance starts from the imported hierarchy.
+		if (is_loader) {
+			uploads = load.Uploads;
+			return load.pScene ? Scene::CreateInstance(load.pScene) : nullptr;
+		}
+
+		if (std::shared_ptr<const Scene> scene = loaded_scene.pScene.lock()) {
+			uploads = loaded_scene.Uploads;
+			return Scene::CreateInstance(scene);
+		}
+	}
+}
+
+bool SceneCache::Contains(const Key& key) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const std::map<Key, Entry>& entries = m_loads.GetEntries();
+	auto iter = entries.find(key);
+	return iter != entries.end() && InFlightLoads<Key, LoadedScene>::IsReady(iter->second) && !iter->second.get().pScene.expired();
+}
+
+std::vector<SceneCache::Upload> SceneCache::ExecuteUploads(Device& device, std::shared_ptr<CommandList> command_list) {
+	CommandQueue& copy_queue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+	CommandQueue& compute_queue = device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+
+	// Executing the copy list queues the mip generation on the compute queue, the signal comes after it.
+	CommandQueue::FenceValueType copy_fence_value = copy_queue.ExecuteCommandList(command_list);
+	CommandQueue::FenceValueType compute_fence_value = compute_queue.Signal();
+
+	return { { &copy_queue, copy_fence_value }, { &compute_queue, compute_fence_value } };
+}
+
+bool SceneCache::IsComplete(const std::vector<Upload>& uploads) {
+	for (const Upload& upload : uploads) {
+		if (!upload.pQueue->IsFenceComplete(upload.FenceValue)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void SceneCache::Wait(const std::vector<Upload>& uploads) {
+	for (const Upload& upload : uploads) {
+		upload.pQueue->WaitForFenceValue(upload.FenceValue);
+	}
+}
+
+void SceneCache::Trim() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TrimLocked();
+}
+
+void SceneCache::TrimLocked() {
+	std::map<Key, Entry>& entries = m_loads.GetEntries();
+	for (auto iter = entries.begin(); iter != entries.end();) {
+		if (InFlightLoads<Key, LoadedScene>::IsReady(iter->second) && iter->second.get().pScene.expired()) {
+			iter = entries.erase(iter);
+			++m_statistics.Unloads;
+		}
+		else {
+			++iter;
+		}
+	}
+}
+
+SceneCache::Statistics SceneCache::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Every instance holds one reference to the loaded scene.
+	const InFlightLoads<Key, LoadedScene>::Statistics& load_statistics = m_loads.GetStatistics();
+	Statistics statistics = m_statistics;
+	statistics.Hits = load_statistics.Hits;
+	statistics.Misses = load_statistics.Misses;
+	statistics.InFlightHits = load_statistics.InFlightHits;
+	statistics.Failures = load_statistics.Failures;
+	statistics.SceneCount = 0u;
+	statistics.InstanceCount = 0u;
+	for (const auto& [key, entry] : m_loads.GetEntries()) {
+		if (InFlightLoads<Key, LoadedScene>::IsReady(entry)) {
+			long use_count = entry.get().pScene.use_count();
+			if (use_count > 0) {
+				++statistics.SceneCount;
+				statistics.InstanceCount += static_cast<size_t>(use_count);
+			}
+		}
+	}
+
+	return statistics;
+}
+
+void SceneCache::LogStatistics() const {
+	Statistics statistics = GetStatistics();
+
+	char message[512];
+	sprintf_s(message, "Scene cache: %zu hits (%zu on loads in flight), %zu misses, %zu failed loads, %zu unloads, %zu scenes with %zu instances alive\n",
+		statistics.Hits, statistics.InFlightHits, statistics.Misses, statistics.Failures, statistics.Unloads, statistics.SceneCount, statistics.InstanceCount);
+	OutputDebugStringA(message);
+}
\ No newline at end of file
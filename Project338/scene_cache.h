@@ -0,0 +1,103 @@
+#pragma once
+
+#include "command_queue.h"
+#include "in_flight_loads.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CommandList;
+class Device;
+class Scene;
+
+// Process wide cache of scenes loaded from files. Entries are keyed by the file and the hash of
+// the import settings of the scene that loads it. Every request gets its own instance, a scene
+// with a new node hierarchy that shares the meshes, materials and GPU buffers of the loaded one.
+// Concurrent requests for the same key wait for the first load, see InFlightLoads. The loader
+// executes its uploads before it returns, and every caller gets the fences that complete them, so
+// an instance is only used once the uploads of the load it shares have executed.
+//
+// The cache only holds on to the loaded scene weakly, every instance keeps it alive. Once the last
+// instance is gone its meshes and materials are released and the next request loads the file again.
+class SceneCache {
+public:
+	// Absolute file name and the import settings hash of the loading scene.
+	using Key = std::pair<std::wstring, uint64_t>;
+
+	// A queue and the fence value after which the uploads of a loaded scene have executed on it.
+	struct Upload {
+		CommandQueue* pQueue;
+		CommandQueue::FenceValueType FenceValue;
+	};
+
+	// The loaded scene or nullptr if the load failed or was canceled, with the uploads the loader executed.
+	struct Load {
+		std::shared_ptr<Scene> pScene;
+		std::vector<Upload> Uploads;
+	};
+
+	using Loader = std::function<Load()>;
+
+	struct Statistics {
+		size_t Hits;
+		size_t Misses;
+		size_t InFlightHits; // Hits that had to wait for a load started by another caller.
+		size_t Failures;
+		size_t Unloads;
+		size_t SceneCount;
+		size_t InstanceCount;
+	};
+
+	SceneCache();
+
+	SceneCache(const SceneCache& copy) = delete;
+	SceneCache& operator=(const SceneCache& copy) = delete;
+
+	static SceneCache& Get();
+
+	// The key for loading file_name into a scene configured like scene.
+	static Key CreateKey(const std::wstring& file_name, const Scene& scene);
+
+	// Returns a new instance of the cached scene or calls loader on this thread to load it first.
+	// Uploads gets the fences the instance has to wait for, those of the load, whoever ran it.
+	// When the loader fails, callers waiting for the key try loading it themselves. When it throws,
+	// every caller waiting for the key gets the exception and the key can be loaded again.
+	std::shared_ptr<Scene> GetOrLoad(const Key& key, const Loader& loader, std::vector<Upload>& uploads);
+
+	// Executes a copy list with recorded scene uploads and returns the fences of the copy queue and of the
+	// compute queue that generates the missing mips of its textures.
+	static std::vector<Upload> ExecuteUploads(Device& device, std::shared_ptr<CommandList> command_list);
+	static bool IsComplete(const std::vector<Upload>& uploads);
+	static void Wait(const std::vector<Upload>& uploads);
+
+	// True while a loaded scene for the key is alive.
+	bool Contains(const Key& key) const;
+
+	// Forgets the entries whose scenes are no longer used.
+	void Trim();
+
+	Statistics GetStatistics() const;
+	void LogStatistics() const;
+
+private:
+	struct LoadedScene {
+		std::weak_ptr<const Scene> pScene;
+		std::vector<Upload> Uploads;
+	};
+
+	using Entry = InFlightLoads<Key, LoadedScene>::Entry;
+
+	void TrimLocked();
+
+	InFlightLoads<Key, LoadedScene> m_loads;
+	Statistics m_statistics;
+	mutable std::mutex m_mutex;
+};
\ No newline at end of file
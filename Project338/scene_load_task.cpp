@@ -0,0 +1,141 @@
+#include "scene_load_task.h"
+
+#include "command_list.h"
+#include "device.h"
+#include "scene.h"
+#include "scene_cache.h"
+#include "utils.h"
+
+SceneLoadTask::SceneLoadTask(Device& device, const std::wstring& file_name, VertexFormat vertex_format, std::shared_ptr<TextureStreamer> texture_streamer) : m_device(device), m_file_name(file_name), m_vertex_format(vertex_format), m_texture_streamer(texture_streamer), m_status(Status::Loading), m_progress(0.0f), m_cancel(false) {}
+
+SceneLoadTask::~SceneLoadTask() {
+	m_cancel = true;
+	if (m_future.valid()) {
+		m_future.wait();
+	}
+}
+
+void SceneLoadTask::Start() {
+	// A dedicated thread keeps multi-second imports from occupying a thread pool worker.
+	m_future = std::async(std::launch::async, &SceneLoadTask::Run, this);
+}
+
+void SceneLoadTask::Run() {
+	// Texture decoding goes through WIC and this thread takes part in the parallel decodes.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	try {
+		std::shared_ptr<CommandList> command_list = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY).GetCommandList();
+
+		auto scene = std::make_shared<Scene>();
+		scene->SetVertexFormat(m_vertex_format);
+		scene->SetTextureStreamer(m_texture_streamer);
+
+		// A file that is loaded already only needs a new instance, it waits for the uploads of the first load.
+		// The list is executed even for a failed or canceled import, it keeps its upload pages until then.
+		std::vector<SceneCache::Upload> uploads;
+		bool is_executed = false;
+		std::shared_ptr<Scene> instance = SceneCache::Get().GetOrLoad(SceneCache::CreateKey(m_file_name, *scene), [&]() {
+			bool is_loaded = scene->LoadSceneFromFile(*command_list, m_file_name, [this](float progress) {
+				m_progress = progress;
+				return !m_cancel;
+			});
+
+			is_executed = true;
+			return SceneCache::Load{ is_loaded && !m_cancel ? scene : nullptr, SceneCache::ExecuteUploads(m_device, command_list) };
+		}, uploads);
+		if (!is_executed) {
+			SceneCache::ExecuteUploads(m_device, command_list);
+		}
+
+		bool is_loaded = instance != nullptr;
+		if (is_loaded) {
+			m_progress = 1.0f;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_uploads = uploads;
+		if (m_cancel) {
+			m_status = Status::Canceled;
+		}
+		else if (!is_loaded) {
+			m_error = "Failed to import " + ConvertString(m_file_name);
+			m_status = Status::Failed;
+		}
+		else {
+			m_scene = instance;
+			m_status = Status::Uploading;
+		}
+	}
+	catch (const std::exception& e) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_error = e.what();
+		m_status = Status::Failed;
+	}
+
+	if (SUCCEEDED(hr)) {
+		CoUninitialize();
+	}
+}
+
+SceneLoadTask::Status SceneLoadTask::GetStatus() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return UpdateStatus();
+}
+
+SceneLoadTask::Status SceneLoadTask::UpdateStatus() {
+	if (m_status == Status::Uploading) {
+		if (m_cancel) {
+			m_scene.reset();
+			m_status = Status::Canceled;
+		}
+		else if (SceneCache::IsComplete(m_uploads)) {
+			m_status = Status::Ready;
+		}
+	}
+
+	return m_status;
+}
+
+bool SceneLoadTask::IsDone() {
+	Status status = GetStatus();
+	return status == Status::Ready || status == Status::Canceled || status == Status::Failed;
+}
+
+float SceneLoadTask::GetProgress() const {
+	return m_progress;
+}
+
+void SceneLoadTask::Cancel() {
+	m_cancel = true;
+}
+
+void SceneLoadTask::Wait() {
+	if (m_future.valid()) {
+		m_future.wait();
+	}
+
+	std::vector<SceneCache::Upload> uploads;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uploads = m_uploads;
+	}
+
+	SceneCache::Wait(uploads);
+
+	GetStatus();
+}
+
+std::shared_ptr<Scene> SceneLoadTask::GetScene() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return UpdateStatus() == Status::Ready ? m_scene : nullptr;
+}
+
+const std::wstring& SceneLoadTask::GetFileName() const {
+	return m_file_name;
+}
+
+std::string SceneLoadTask::GetError() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_error;
+}
\ No newline at end of file
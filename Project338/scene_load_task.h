@@ -0,0 +1,80 @@
+#pragma once
+
+#include "scene_cache.h"
+#include "vertex_types.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Device;
+class Scene;
+class TextureStreamer;
+
+// Loads a scene in the background while the frame loop keeps running. The import runs on
+// its own thread (and the thread pool), the uploads are recorded on a copy queue command
+// list. The scene is only handed out once the copy queue, and the compute queue that
+// generates missing mips, have finished with it, so it can be rendered right away. A scene
+// from the SceneCache waits for the uploads of the load that put it there.
+class SceneLoadTask {
+public:
+	enum class Status {
+		Loading,
+		Uploading,
+		Ready,
+		Canceled,
+		Failed,
+	};
+
+	// Polls the fences, so a finished upload becomes Ready on the next call.
+	Status GetStatus();
+	bool IsDone();
+
+	// Import progress from zero to one.
+	float GetProgress() const;
+
+	// Stops the import at the next check. A scene that is uploading already is dropped.
+	void Cancel();
+
+	// Blocks until the import is done and its uploads have completed.
+	void Wait();
+
+	// The loaded scene, or nullptr until the task is Ready.
+	std::shared_ptr<Scene> GetScene();
+
+	const std::wstring& GetFileName() const;
+	std::string GetError() const;
+
+protected:
+	friend class Device;
+
+	SceneLoadTask(Device& device, const std::wstring& file_name, VertexFormat vertex_format, std::shared_ptr<TextureStreamer> texture_streamer);
+	virtual ~SceneLoadTask();
+
+	void Start();
+
+private:
+	void Run();
+
+	// Moves an uploading task on to Ready or Canceled, called with m_mutex held.
+	Status UpdateStatus();
+
+	Device& m_device;
+	std::wstring m_file_name;
+	VertexFormat m_vertex_format;
+	std::shared_ptr<TextureStreamer> m_texture_streamer;
+
+	std::future<void> m_future;
+	std::atomic<Status> m_status;
+	std::atomic<float> m_progress;
+	std::atomic_bool m_cancel;
+
+	std::vector<SceneCache::Upload> m_uploads;
+
+	std::shared_ptr<Scene> m_scene;
+	std::string m_error;
+	mutable std::mutex m_mutex;
+};
\ No newline at end of file
@@ -5,10 +5,9 @@
 
 #include <cstdlib>
 
-SceneNode::SceneNode(const DirectX::XMMATRIX& local_transform) : m_name("SceneNode"), m_AABB({ 0, 0, 0 }, { 0, 0, 0 }) {
+SceneNode::SceneNode(const DirectX::XMMATRIX& local_transform) : m_name("SceneNode"), m_is_inverse_dirty(true), m_is_world_dirty(true), m_AABB({ 0, 0, 0 }, { 0, 0, 0 }) {
     m_aligned_data = (AlignedData*)_aligned_malloc(sizeof(AlignedData), 16);
     m_aligned_data->m_local_transform = local_transform;
-    m_aligned_data->m_inverse_transform = DirectX::XMMatrixInverse(nullptr, local_transform);
 }
 
 SceneNode::~SceneNode() {
@@ -29,15 +28,37 @@ DirectX::XMMATRIX SceneNode::GetLocalTransform() const {
 
 void SceneNode::SetLocalTransform(const DirectX::XMMATRIX& local_transform) {
     m_aligned_data->m_local_transform = local_transform;
-    m_aligned_data->m_inverse_transform = DirectX::XMMatrixInverse(nullptr, local_transform);
+    m_is_inverse_dirty = true;
+    InvalidateWorldTransform();
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseLocalTransform() const {
+    if (m_is_inverse_dirty) {
+        m_aligned_data->m_inverse_transform = DirectX::XMMatrixInverse(nullptr, m_aligned_data->m_local_transform);
+        m_is_inverse_dirty = false;
+    }
+
     return m_aligned_data->m_inverse_transform;
 }
 
 DirectX::XMMATRIX SceneNode::GetWorldTransform() const {
-    return m_aligned_data->m_local_transform* GetParentWorldTransform();
+    if (m_is_world_dirty) {
+        m_aligned_data->m_world_transform = m_aligned_data->m_local_transform * GetParentWorldTransform();
+        m_is_world_dirty = false;
+    }
+
+    return m_aligned_data->m_world_transform;
+}
+
+void SceneNode::InvalidateWorldTransform() {
+    if (m_is_world_dirty) {
+        return;
+    }
+
+    m_is_world_dirty = true;
+    for (const NodePtr& child : m_children) {
+        child->InvalidateWorldTransform();
+    }
 }
 
 DirectX::XMMATRIX SceneNode::GetInverseWorldTransform() const {
@@ -53,6 +74,27 @@ DirectX::XMMATRIX SceneNode::GetParentWorldTransform() const {
     return parent_transform;
 }
 
+std::shared_ptr<SceneNode> SceneNode::Clone() const {
+    auto node = std::make_shared<SceneNode>(m_aligned_data->m_local_transform);
+    node->m_aligned_data->m_inverse_transform = m_aligned_data->m_inverse_transform;
+    node->m_is_inverse_dirty = m_is_inverse_dirty;
+    node->m_name = m_name;
+    node->m_meshes = m_meshes;
+    node->m_AABB = m_AABB;
+
+    // The local transforms stay as they are, so the children are linked directly instead of through AddChild.
+    for (const NodePtr& child : m_children) {
+        NodePtr child_node = child->Clone();
+        child_node->m_parent_node = node;
+        node->m_children.push_back(child_node);
+        if (!child_node->GetName().empty()) {
+            node->m_children_by_name.emplace(child_node->GetName(), child_node);
+        }
+    }
+
+    return node;
+}
+
 void SceneNode::AddChild(std::shared_ptr<SceneNode> child_node) {
     if (child_node) {
         NodeList::iterator iter = std::find(m_children.begin(), m_children.end(), child_node);
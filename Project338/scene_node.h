@@ -12,6 +12,8 @@ class Mesh;
 class CommandList;
 class Visitor;
 
+// World transforms are cached and recomputed on the next query once the node or one of its
+// ancestors changes, the inverse of the local transform is computed on the first query.
 class SceneNode : public std::enable_shared_from_this<SceneNode> {
 public:
 	explicit SceneNode(const DirectX::XMMATRIX& local_transform = DirectX::XMMatrixIdentity());
@@ -27,6 +29,9 @@ public:
 	DirectX::XMMATRIX GetWorldTransform() const;
 	DirectX::XMMATRIX GetInverseWorldTransform() const;
 
+	// Copies the node and its children, the copies share the meshes.
+	std::shared_ptr<SceneNode> Clone() const;
+
 	void AddChild(std::shared_ptr<SceneNode> child_node);
 	void RemoveChild(std::shared_ptr<SceneNode> child_node);
 	void SetParent(std::shared_ptr<SceneNode> parent_node);
@@ -43,6 +48,12 @@ public:
 	DirectX::XMMATRIX GetParentWorldTransform() const;
 
 private:
+	friend class SceneBuilder;
+
+	// Marks the world transforms of the node and its descendants as outdated. A node whose
+	// world transform is outdated never has descendants with an up to date one.
+	void InvalidateWorldTransform();
+
 	using NodePtr = std::shared_ptr<SceneNode>;
 	using NodeList = std::vector<NodePtr>;
 	using NodeNameMap = std::multimap<std::string, NodePtr>;
@@ -53,7 +64,10 @@ private:
 	struct alignas(16) AlignedData {
 		DirectX::XMMATRIX m_local_transform;
 		DirectX::XMMATRIX m_inverse_transform;
+		DirectX::XMMATRIX m_world_transform;
 	}* m_aligned_data;
+	mutable bool m_is_inverse_dirty;
+	mutable bool m_is_world_dirty;
 
 	std::weak_ptr<SceneNode> m_parent_node;
 	NodeList m_children;
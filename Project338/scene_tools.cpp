@@ -0,0 +1,553 @@
+#include "tools.h"
+
+#include "derived_data_cache.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "obj_loader.h"
+#include "scene.h"
+#include "scene_builder.h"
+#include "scene_node.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include "vertex_types.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/mesh.h>
+#include <assimp/scene.h>
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <random>
+#include <thread>
+#include <unordered_set>
+
+bool Tools::WriteLODReport(const std::wstring& file_name, std::ostream& output) {
+	Assimp::Importer importer;
+	const aiScene* scene = Scene::ReadSourceScene(importer, file_name);
+	if (!scene) {
+		output << "Failed to import " << ConvertString(file_name) << ": " << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	Scene lod_scene;
+
+	output << "Mesh, LOD, Triangles, Reduction, Error" << std::endl;
+	for (unsigned int i = 0u; i < scene->mNumMeshes; ++i) {
+		const aiMesh& aiMesh = *(scene->mMeshes[i]);
+
+		std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data;
+		std::vector<uint32_t> indices;
+		Scene::ExtractMeshData(aiMesh, vertex_data, indices);
+		if (indices.empty()) {
+			continue;
+		}
+
+		lod_scene.OptimizeMesh(vertex_data, indices);
+		std::vector<Mesh::LOD> lods = lod_scene.GenerateLODs(vertex_data, indices);
+
+		for (size_t lod_index = 0u; lod_index < lods.size(); ++lod_index) {
+			const Mesh::LOD& lod = lods[lod_index];
+			output << aiMesh.mName.C_Str() << ", " << lod_index << ", " << lod.IndexCount / 3u << ", "
+				<< std::fixed << std::setprecision(1) << 100.0 * (1.0 - static_cast<double>(lod.IndexCount) / lods[0].IndexCount) << "%, "
+				<< std::setprecision(5) << lod.Error << std::defaultfloat << std::endl;
+		}
+	}
+
+	return true;
+}
+
+bool Tools::WriteMeshOptimizationReport(const std::wstring& file_name, std::ostream& output) {
+	Assimp::Importer importer;
+	const aiScene* scene = Scene::ReadSourceScene(importer, file_name);
+	if (!scene) {
+		output << "Failed to import " << ConvertString(file_name) << ": " << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	Scene optimization_scene;
+
+	output << "Mesh, Vertices, Triangles, ACMR before, ACMR after, ATVR before, ATVR after, Overdraw before, Overdraw after, Overfetch before, Overfetch after, Optimize ms" << std::endl;
+	for (unsigned int i = 0u; i < scene->mNumMeshes; ++i) {
+		const aiMesh& aiMesh = *(scene->mMeshes[i]);
+
+		std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data;
+		std::vector<uint32_t> indices;
+		Scene::ExtractMeshData(aiMesh, vertex_data, indices);
+		if (indices.empty()) {
+			continue;
+		}
+
+		Scene::MeshOptimization statistics;
+		optimization_scene.OptimizeMesh(vertex_data, indices, &statistics);
+
+		output << aiMesh.mName.C_Str() << ", " << vertex_data.size() << ", " << indices.size() / 3u << ", " << std::fixed << std::setprecision(3)
+			<< statistics.CacheBefore.ACMR << ", " << statistics.CacheAfter.ACMR << ", " << statistics.CacheBefore.ATVR << ", " << statistics.CacheAfter.ATVR << ", "
+			<< statistics.OverdrawBefore.Overdraw << ", " << statistics.OverdrawAfter.Overdraw << ", " << statistics.FetchBefore.Overfetch << ", " << statistics.FetchAfter.Overfetch << ", "
+			<< std::setprecision(2) << statistics.OptimizeTime << std::defaultfloat << std::endl;
+	}
+
+	return true;
+}
+
+bool Tools::WriteImportScalingReport(const std::wstring& file_name, std::ostream& output) {
+	Assimp::Importer importer;
+	const aiScene* scene = Scene::ReadSourceScene(importer, file_name);
+	if (!scene) {
+		output << "Failed to import " << ConvertString(file_name) << ": " << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	std::filesystem::path file_path = file_name;
+	std::filesystem::path parent_path = file_path.has_parent_path() ? file_path.parent_path() : std::filesystem::current_path();
+
+	// Texture decoding needs COM on the calling thread as well, it takes part in every loop.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	Scene import_scene;
+	const size_t max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	double single_thread_time = 0.0;
+
+	output << "Threads, Material parse ms, Decode and mesh processing ms, Texture decode CPU ms, Mesh processing CPU ms, Speedup, Peak pending mesh MB, Peak working set MB" << std::endl;
+	for (size_t thread_count = 1u;; thread_count = std::min(thread_count * 2u, max_thread_count)) {
+		ThreadPool thread_pool(thread_count - 1u);
+
+		Scene::SceneImport scene_import;
+		import_scene.ImportSceneData(*scene, parent_path, thread_pool, scene_import);
+
+		double total_time = scene_import.ParseTime + scene_import.ProcessTime;
+		if (thread_count == 1u) {
+			single_thread_time = total_time;
+		}
+
+		output << thread_count << ", " << std::fixed << std::setprecision(2) << scene_import.ParseTime << ", " << scene_import.ProcessTime << ", "
+			<< scene_import.DecodeTime << ", " << scene_import.MeshTime << ", " << (total_time > 0.0 ? single_thread_time / total_time : 1.0) << ", "
+			<< scene_import.PeakPendingSize / (1024.0 * 1024.0) << ", " << scene_import.PeakWorkingSetSize / (1024.0 * 1024.0) << std::defaultfloat << std::endl;
+
+		if (thread_count == max_thread_count) {
+			break;
+		}
+	}
+
+	if (SUCCEEDED(hr)) {
+		CoUninitialize();
+	}
+
+	return true;
+}
+
+// Triangles of one material. The native and the assimp import split meshes differently, so they are compared per material.
+struct ObjImportSummary {
+	size_t TriangleCount = 0u;
+	size_t VertexCount = 0u;
+	double Area = 0.0;
+	DirectX::XMFLOAT3 Min = { FLT_MAX, FLT_MAX, FLT_MAX };
+	DirectX::XMFLOAT3 Max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	std::vector<VertexPositionNormalTangentBitangentTexture> Vertices;
+};
+
+inline void AddObjImportMesh(ObjImportSummary& summary, const std::vector<VertexPositionNormalTangentBitangentTexture>& vertex_data, const std::vector<uint32_t>& indices) {
+	summary.TriangleCount += indices.size() / 3u;
+	summary.VertexCount += vertex_data.size();
+	for (size_t i = 0u; i + 2u < indices.size(); i += 3u) {
+		DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&vertex_data[indices[i]].Position);
+		DirectX::XMVECTOR p1 = DirectX::XMLoadFloat3(&vertex_data[indices[i + 1u]].Position);
+		DirectX::XMVECTOR p2 = DirectX::XMLoadFloat3(&vertex_data[indices[i + 2u]].Position);
+		summary.Area += 0.5 * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0))));
+	}
+	for (const VertexPositionNormalTangentBitangentTexture& vertex : vertex_data) {
+		DirectX::XMStoreFloat3(&summary.Min, DirectX::XMVectorMin(DirectX::XMLoadFloat3(&summary.Min), DirectX::XMLoadFloat3(&vertex.Position)));
+		DirectX::XMStoreFloat3(&summary.Max, DirectX::XMVectorMax(DirectX::XMLoadFloat3(&summary.Max), DirectX::XMLoadFloat3(&vertex.Position)));
+	}
+	summary.Vertices.insert(summary.Vertices.end(), vertex_data.cbegin(), vertex_data.cend());
+}
+
+// Vertices match when position, normal and texture coordinates agree after rounding, tangents are averaged
+// differently by both imports and left out.
+inline uint64_t GetVertexMatchKey(const VertexPositionNormalTangentBitangentTexture& vertex, float position_step) {
+	const float attribute_step = 1.0f / 1024.0f;
+	int64_t values[8] = {
+		std::llround(vertex.Position.x / position_step), std::llround(vertex.Position.y / position_step), std::llround(vertex.Position.z / position_step),
+		std::llround(vertex.Normal.x / attribute_step), std::llround(vertex.Normal.y / attribute_step), std::llround(vertex.Normal.z / attribute_step),
+		std::llround(vertex.TexCoord.x / attribute_step), std::llround(vertex.TexCoord.y / attribute_step),
+	};
+	return DerivedDataCache::HashBytes(values, sizeof(values));
+}
+
+// Negative indices count back from the data read so far at the face. Every object is written as a block of vertices
+// followed by its faces, the last face refers back to the first block, and the whole file ends up in a single chunk.
+inline bool CheckObjRelativeIndices(std::ostream& output) {
+	const char* obj_text =
+		"o first\nv 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf -3//-1 -2//-1 -1//-1\n"
+		"o second\nv 10 0 0\nv 11 0 0\nv 10 1 0\nvn 0 0 -1\nf -3//-1 -2//-1 -1//-1\n"
+		"f -6//-2 -5//-2 -4//-2\n";
+
+	std::error_code error_code;
+	std::filesystem::path file_path = std::filesystem::temp_directory_path(error_code) / "obj_relative_indices.obj";
+	{
+		std::ofstream file(file_path, std::ios::binary);
+		file << obj_text;
+	}
+
+	ObjLoader::Model model;
+	bool is_loaded = ObjLoader::Load(file_path, ThreadPool::Get(), model);
+	std::filesystem::remove(file_path, error_code);
+
+	// The import flips z, so the first block faces -z and the second one +z.
+	size_t first_count = 0u;
+	size_t second_count = 0u;
+	size_t misplaced_count = 0u;
+	for (const ObjLoader::Mesh& mesh : model.Meshes) {
+		for (size_t i = 0u; i + 2u < mesh.Indices.size(); i += 3u) {
+			bool is_first = true;
+			bool is_second = true;
+			for (size_t j = 0u; j < 3u; ++j) {
+				const VertexPositionNormalTangentBitangentTexture& vertex = mesh.Vertices[mesh.Indices[i + j]];
+				is_first = is_first && vertex.Position.x < 2.0f && vertex.Normal.z < 0.0f;
+				is_second = is_second && vertex.Position.x > 9.0f && vertex.Normal.z > 0.0f;
+			}
+			first_count += is_first ? 1u : 0u;
+			second_count += is_second ? 1u : 0u;
+			misplaced_count += is_first || is_second ? 0u : 1u;
+		}
+	}
+
+	bool is_matching = is_loaded && first_count == 2u && second_count == 1u && misplaced_count == 0u;
+	output << "Relative indices: " << first_count << " triangles on the first block, " << second_count << " on the second, " << misplaced_count << " misplaced"
+		<< (is_matching ? "" : ", expected 2, 1 and 0") << std::endl;
+
+	return is_matching;
+}
+
+bool Tools::WriteObjImportReport(const std::wstring& file_name, std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	std::filesystem::path file_path = file_name;
+
+	// Best of a few runs, the first one also pays for reading the file from disk.
+	const size_t run_count = 3u;
+	ThreadPool single_thread_pool(0u);
+	ObjLoader::Model model;
+	double native_time = std::numeric_limits<double>::max();
+	double single_thread_time = std::numeric_limits<double>::max();
+	for (size_t run = 0u; run < run_count; ++run) {
+		Clock::time_point start_time = Clock::now();
+		if (!ObjLoader::Load(file_path, single_thread_pool, model)) {
+			output << "Native import of " << ConvertString(file_name) << " failed" << std::endl;
+			return false;
+		}
+		Clock::time_point single_thread_end_time = Clock::now();
+		ObjLoader::Load(file_path, ThreadPool::Get(), model);
+		single_thread_time = std::min(single_thread_time, std::chrono::duration<double, std::milli>(single_thread_end_time - start_time).count());
+		native_time = std::min(native_time, std::chrono::duration<double, std::milli>(Clock::now() - single_thread_end_time).count());
+	}
+
+	Assimp::Importer importer;
+	const aiScene* scene = nullptr;
+	double assimp_time = std::numeric_limits<double>::max();
+	for (size_t run = 0u; run < run_count; ++run) {
+		Clock::time_point start_time = Clock::now();
+		scene = Scene::ReadSourceScene(importer, file_path);
+		if (!scene) {
+			output << "Failed to import " << ConvertString(file_name) << ": " << importer.GetErrorString() << std::endl;
+			return false;
+		}
+		assimp_time = std::min(assimp_time, std::chrono::duration<double, std::milli>(Clock::now() - start_time).count());
+	}
+
+	double megabytes = model.FileSize / (1024.0 * 1024.0);
+	output << "Importer, Threads, Time ms, MB/s" << std::endl << std::fixed << std::setprecision(2);
+	output << "Native, " << ThreadPool::Get().GetThreadCount() + 1u << ", " << native_time << ", " << megabytes * 1000.0 / native_time << std::endl;
+	output << "Native, 1, " << single_thread_time << ", " << megabytes * 1000.0 / single_thread_time << std::endl;
+	output << "Assimp, 1, " << assimp_time << ", " << megabytes * 1000.0 / assimp_time << std::endl;
+	output << "Native speedup " << std::setprecision(1) << assimp_time / native_time << "x" << std::defaultfloat << std::endl << std::endl;
+
+	std::map<std::string, ObjImportSummary> native_summaries;
+	for (const ObjLoader::Mesh& mesh : model.Meshes) {
+		AddObjImportMesh(native_summaries[model.Materials[mesh.MaterialIndex].Name], mesh.Vertices, mesh.Indices);
+	}
+	std::map<std::string, ObjImportSummary> assimp_summaries;
+	for (unsigned int i = 0u; i < scene->mNumMeshes; ++i) {
+		const aiMesh& aiMesh = *(scene->mMeshes[i]);
+
+		std::vector<VertexPositionNormalTangentBitangentTexture> vertex_data;
+		std::vector<uint32_t> indices;
+		Scene::ExtractMeshData(aiMesh, vertex_data, indices);
+		AddObjImportMesh(assimp_summaries[scene->mMaterials[aiMesh.mMaterialIndex]->GetName().C_Str()], vertex_data, indices);
+	}
+
+	bool is_matching = native_summaries.size() == assimp_summaries.size();
+	output << "Material, Triangles, Assimp triangles, Vertices, Assimp vertices, Area difference, Bounds difference, Unmatched vertices" << std::endl;
+	for (const auto& [material_name, native] : native_summaries) {
+		auto it = assimp_summaries.find(material_name);
+		if (it == assimp_summaries.end()) {
+			output << material_name << ", " << native.TriangleCount << ", missing" << std::endl;
+			is_matching = false;
+			continue;
+		}
+		const ObjImportSummary& assimp = it->second;
+
+		// Bounds and positions are compared relative to the size of the material's geometry.
+		DirectX::XMVECTOR extent = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&native.Max), DirectX::XMLoadFloat3(&native.Min));
+		float size = std::max({ DirectX::XMVectorGetX(extent), DirectX::XMVectorGetY(extent), DirectX::XMVectorGetZ(extent), FLT_MIN });
+		DirectX::XMVECTOR bounds_difference = DirectX::XMVectorMax(
+			DirectX::XMVectorAbs(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&native.Min), DirectX::XMLoadFloat3(&assimp.Min))),
+			DirectX::XMVectorAbs(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&native.Max), DirectX::XMLoadFloat3(&assimp.Max))));
+		float relative_bounds_difference = std::max({ DirectX::XMVectorGetX(bounds_difference), DirectX::XMVectorGetY(bounds_difference), DirectX::XMVectorGetZ(bounds_difference) }) / size;
+		double relative_area_difference = std::abs(native.Area - assimp.Area) / std::max(assimp.Area, static_cast<double>(FLT_MIN));
+
+		// Rounding puts a few vertices that lie close to a step on different sides in both imports.
+		float position_step = size / 65536.0f;
+		std::unordered_set<uint64_t> assimp_keys;
+		for (const VertexPositionNormalTangentBitangentTexture& vertex : assimp.Vertices) {
+			assimp_keys.insert(GetVertexMatchKey(vertex, position_step));
+		}
+		size_t unmatched_count = std::count_if(native.Vertices.cbegin(), native.Vertices.cend(), [&](const VertexPositionNormalTangentBitangentTexture& vertex) { return assimp_keys.count(GetVertexMatchKey(vertex, position_step)) == 0u; });
+		double unmatched_ratio = native.Vertices.empty() ? 0.0 : static_cast<double>(unmatched_count) / native.Vertices.size();
+
+		is_matching = is_matching && native.TriangleCount == assimp.TriangleCount && relative_area_difference < 1e-3 && relative_bounds_difference < 1e-4f && unmatched_ratio < 0.01;
+
+		output << material_name << ", " << native.TriangleCount << ", " << assimp.TriangleCount << ", " << native.VertexCount << ", " << assimp.VertexCount << ", "
+			<< std::fixed << std::setprecision(4) << 100.0 * relative_area_difference << "%, " << 100.0 * relative_bounds_difference << "%, "
+			<< std::setprecision(2) << 100.0 * unmatched_ratio << "%" << std::defaultfloat << std::endl;
+	}
+
+	output << (is_matching ? "Native import matches assimp" : "Native import differs from assimp") << std::endl;
+
+	is_matching = CheckObjRelativeIndices(output) && is_matching;
+
+	return is_matching;
+}
+
+// A grid of quads in the xy plane from -1 to 1. Front facing triangles are clockwise seen from -z.
+inline void CreateMeshletGrid(uint32_t size, bool is_front_facing, std::vector<DirectX::XMFLOAT3>& positions, std::vector<uint32_t>& indices) {
+	positions.clear();
+	indices.clear();
+	for (uint32_t y = 0u; y <= size; ++y) {
+		for (uint32_t x = 0u; x <= size; ++x) {
+			positions.push_back({ 2.0f * x / size - 1.0f, 2.0f * y / size - 1.0f, 0.0f });
+		}
+	}
+	for (uint32_t y = 0u; y < size; ++y) {
+		for (uint32_t x = 0u; x < size; ++x) {
+			uint32_t v0 = y * (size + 1u) + x;
+			uint32_t v1 = v0 + size + 1u;
+			uint32_t quad[6] = { v0, v1, v1 + 1u, v0, v1 + 1u, v0 + 1u };
+			if (!is_front_facing) {
+				std::swap(quad[1], quad[2]);
+				std::swap(quad[4], quad[5]);
+			}
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+bool Tools::WriteMeshletReport(std::ostream& output) {
+	struct Layout {
+		const char* Name;
+		bool IsShuffled;
+		size_t MaxVertices;
+		size_t MaxTriangles;
+	};
+
+	// Shuffled triangles share few vertices, so their meshlets hit the vertex limit instead of the triangle one.
+	const Layout layouts[] = {
+		{ "Grid", false, 64u, 124u },
+		{ "Grid", false, 32u, 16u },
+		{ "Grid", false, 128u, 256u },
+		{ "Shuffled grid", true, 64u, 124u },
+		{ "Shuffled grid", true, 16u, 124u },
+	};
+
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	bool is_passing = true;
+
+	output << "Mesh, Max vertices, Max triangles, Triangles, Meshlets, Largest vertex count, Largest triangle count, Uncovered triangles, Result" << std::endl;
+	for (const Layout& layout : layouts) {
+		CreateMeshletGrid(64u, true, positions, indices);
+		if (layout.IsShuffled) {
+			std::vector<uint32_t> triangles(indices.size() / 3u);
+			for (uint32_t i = 0u; i < triangles.size(); ++i) {
+				triangles[i] = i;
+			}
+			std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1u));
+
+			std::vector<uint32_t> shuffled_indices;
+			shuffled_indices.reserve(indices.size());
+			for (uint32_t triangle : triangles) {
+				shuffled_indices.insert(shuffled_indices.end(), indices.cbegin() + triangle * 3u, indices.cbegin() + triangle * 3u + 3u);
+			}
+			indices.swap(shuffled_indices);
+		}
+
+		std::vector<MeshOptimizer::Meshlet> meshlets = MeshOptimizer::BuildMeshlets(indices, &positions[0].x, positions.size(), sizeof(DirectX::XMFLOAT3), layout.MaxVertices, layout.MaxTriangles);
+
+		// Meshlets are contiguous ranges, so each triangle is in exactly one of them when the ranges follow each other without gaps.
+		size_t largest_vertex_count = 0u;
+		size_t largest_triangle_count = 0u;
+		uint32_t next_index = 0u;
+		bool is_valid = true;
+		for (const MeshOptimizer::Meshlet& meshlet : meshlets) {
+			is_valid = is_valid && meshlet.StartIndex == next_index && meshlet.IndexCount > 0u && meshlet.IndexCount % 3u == 0u;
+			next_index = meshlet.StartIndex + meshlet.IndexCount;
+
+			std::unordered_set<uint32_t> vertices(indices.cbegin() + meshlet.StartIndex, indices.cbegin() + meshlet.StartIndex + meshlet.IndexCount);
+			largest_vertex_count = std::max(largest_vertex_count, vertices.size());
+			largest_triangle_count = std::max<size_t>(largest_triangle_count, meshlet.IndexCount / 3u);
+		}
+		size_t uncovered_triangles = next_index <= indices.size() ? (indices.size() - next_index) / 3u : 0u;
+		is_valid = is_valid && next_index == indices.size() && largest_vertex_count <= layout.MaxVertices && largest_triangle_count <= layout.MaxTriangles;
+		is_passing = is_passing && is_valid;
+
+		output << layout.Name << ", " << layout.MaxVertices << ", " << layout.MaxTriangles << ", " << indices.size() / 3u << ", " << meshlets.size() << ", "
+			<< largest_vertex_count << ", " << largest_triangle_count << ", " << uncovered_triangles << ", " << (is_valid ? "passed" : "failed") << std::endl;
+	}
+
+	// The camera looks down +z at the grid, which faces it or faces away. Small meshlets are never culled here.
+	DirectX::BoundingFrustum view_frustum(DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+	DirectX::XMMATRIX world_view = DirectX::XMMatrixTranslation(0.0f, 0.0f, 3.0f);
+
+	output << std::endl << "Grid, Meshlets, Visible meshlets, Expected, Result" << std::endl;
+	for (bool is_front_facing : { true, false }) {
+		CreateMeshletGrid(64u, is_front_facing, positions, indices);
+
+		Mesh mesh;
+		mesh.SetMeshlets(MeshOptimizer::BuildMeshlets(indices, &positions[0].x, positions.size(), sizeof(DirectX::XMFLOAT3)));
+
+		std::vector<Mesh::IndexRange> visible_ranges;
+		size_t visible_meshlets = mesh.CullMeshlets(world_view, view_frustum, 1.0f, 0.0f, visible_ranges);
+		size_t expected_meshlets = is_front_facing ? mesh.GetMeshlets().size() : 0u;
+		bool is_valid = visible_meshlets == expected_meshlets;
+		is_passing = is_passing && is_valid;
+
+		output << (is_front_facing ? "Front facing" : "Back facing") << ", " << mesh.GetMeshlets().size() << ", " << visible_meshlets << ", " << expected_meshlets << ", "
+			<< (is_valid ? "passed" : "failed") << std::endl;
+	}
+
+	return is_passing;
+}
+
+// Small rotations and offsets keep long chains of transforms well conditioned.
+inline DirectX::XMMATRIX GetBenchmarkTransform(size_t node_index) {
+	float angle = 0.002f * static_cast<float>(node_index % 7u);
+	DirectX::XMVECTOR axis = DirectX::XMVectorSet(1.0f, 1.0f, static_cast<float>(node_index % 3u), 0.0f);
+	DirectX::XMMATRIX rotation = DirectX::XMMatrixRotationAxis(axis, angle);
+
+	return rotation * DirectX::XMMatrixTranslation(0.01f * static_cast<float>(node_index % 5u), 0.01f, 0.0f);
+}
+
+bool Tools::WriteSceneBuildReport(std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	struct Hierarchy {
+		const char* Name;
+		std::vector<uint32_t> ParentIndices;
+	};
+
+	std::vector<Hierarchy> hierarchies;
+	for (uint32_t depth : { 256u, 1024u, 4096u }) {
+		Hierarchy hierarchy = { "Chain", {} };
+		for (uint32_t i = 0u; i < depth; ++i) {
+			hierarchy.ParentIndices.push_back(i == 0u ? SceneBuilder::InvalidIndex : i - 1u);
+		}
+		hierarchies.push_back(std::move(hierarchy));
+	}
+
+	Hierarchy wide = { "Wide", { SceneBuilder::InvalidIndex } };
+	for (uint32_t i = 1u; i < 16384u; ++i) {
+		wide.ParentIndices.push_back(0u);
+	}
+	hierarchies.push_back(std::move(wide));
+
+	// Four children per node, eight levels.
+	Hierarchy balanced = { "Balanced", { SceneBuilder::InvalidIndex } };
+	for (uint32_t i = 1u; i < (65536u - 1u) / 3u; ++i) {
+		balanced.ParentIndices.push_back((i - 1u) / 4u);
+	}
+	hierarchies.push_back(std::move(balanced));
+
+	bool is_matching = true;
+	output << "Hierarchy, Nodes, Depth, SetParent ms, Builder ms, Speedup, Max world difference" << std::endl;
+	for (const Hierarchy& hierarchy : hierarchies) {
+		const size_t node_count = hierarchy.ParentIndices.size();
+
+		size_t depth = 0u;
+		std::vector<size_t> node_depths(node_count, 1u);
+		for (size_t i = 0u; i < node_count; ++i) {
+			if (hierarchy.ParentIndices[i] != SceneBuilder::InvalidIndex) {
+				node_depths[i] = node_depths[hierarchy.ParentIndices[i]] + 1u;
+			}
+			depth = std::max(depth, node_depths[i]);
+		}
+
+		// Best of three, both variants end with every world transform queried once like a frame would.
+		double parent_time = 0.0;
+		double builder_time = 0.0;
+		std::vector<std::shared_ptr<SceneNode>> parent_nodes;
+		std::vector<std::shared_ptr<SceneNode>> builder_nodes;
+		for (int run = 0; run < 3; ++run) {
+			parent_nodes.clear();
+			builder_nodes.clear();
+
+			Clock::time_point start_time = Clock::now();
+			parent_nodes.resize(node_count);
+			for (size_t i = 0u; i < node_count; ++i) {
+				parent_nodes[i] = std::make_shared<SceneNode>();
+				if (hierarchy.ParentIndices[i] != SceneBuilder::InvalidIndex) {
+					parent_nodes[i]->SetParent(parent_nodes[hierarchy.ParentIndices[i]]);
+				}
+				parent_nodes[i]->SetLocalTransform(GetBenchmarkTransform(i));
+			}
+			for (const std::shared_ptr<SceneNode>& node : parent_nodes) {
+				node->GetWorldTransform();
+			}
+			Clock::time_point parent_end_time = Clock::now();
+
+			SceneBuilder builder(node_count);
+			for (size_t i = 0u; i < node_count; ++i) {
+				builder.AddNode(std::string(), hierarchy.ParentIndices[i], GetBenchmarkTransform(i));
+			}
+			for (uint32_t i = 0u; i < node_count; ++i) {
+				builder_nodes.push_back(builder.GetNode(i));
+			}
+			builder.Build();
+			for (const std::shared_ptr<SceneNode>& node : builder_nodes) {
+				node->GetWorldTransform();
+			}
+			Clock::time_point builder_end_time = Clock::now();
+
+			double run_parent_time = std::chrono::duration<double, std::milli>(parent_end_time - start_time).count();
+			double run_builder_time = std::chrono::duration<double, std::milli>(builder_end_time - parent_end_time).count();
+			parent_time = run == 0 ? run_parent_time : std::min(parent_time, run_parent_time);
+			builder_time = run == 0 ? run_builder_time : std::min(builder_time, run_builder_time);
+		}
+
+		float max_difference = 0.0f;
+		for (size_t i = 0u; i < node_count; ++i) {
+			DirectX::XMFLOAT4X4 parent_world;
+			DirectX::XMFLOAT4X4 builder_world;
+			DirectX::XMStoreFloat4x4(&parent_world, parent_nodes[i]->GetWorldTransform());
+			DirectX::XMStoreFloat4x4(&builder_world, builder_nodes[i]->GetWorldTransform());
+			for (int row = 0; row < 4; ++row) {
+				for (int column = 0; column < 4; ++column) {
+					max_difference = std::max(max_difference, std::abs(parent_world.m[row][column] - builder_world.m[row][column]));
+				}
+			}
+		}
+		is_matching = is_matching && max_difference < 1e-4f;
+
+		output << hierarchy.Name << ", " << node_count << ", " << depth << ", " << std::fixed << std::setprecision(2) << parent_time << ", " << builder_time << ", "
+			<< (builder_time > 0.0 ? parent_time / builder_time : 1.0) << std::defaultfloat << ", " << max_difference << std::endl;
+	}
+
+	return is_matching;
+}
\ No newline at end of file
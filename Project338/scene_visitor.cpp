@@ -8,13 +8,25 @@
 #include "mesh.h"
 #include "scene_node.h"
 
+#include <DirectXCollision.h>
 #include <DirectXMath.h>
 
-SceneVisitor::SceneVisitor(CommandList& command_list, const Camera& camera, EffectPSO& pso, bool transparent) : m_command_list(command_list), m_camera(camera), m_lighting_pso(pso), m_transparent_pass(transparent) {}
+#include <algorithm>
+
+SceneVisitor::SceneVisitor(CommandList& command_list, const Camera& camera, EffectPSO& pso, bool transparent) : m_command_list(command_list), m_camera(camera), m_lighting_pso(pso), m_transparent_pass(transparent), m_screen_height(0.0f), m_max_pixel_error(1.0f), m_min_pixel_size(1.0f), m_projection_scale(0.0f) {}
+
+void SceneVisitor::SetLODSelection(float screen_height, float max_pixel_error, float min_pixel_size) {
+    m_screen_height = screen_height;
+    m_max_pixel_error = max_pixel_error;
+    m_min_pixel_size = min_pixel_size;
+}
 
 void SceneVisitor::Visit(Scene& scene) {
     m_lighting_pso.SetViewMatrix(m_camera.get_ViewMatrix());
     m_lighting_pso.SetProjectionMatrix(m_camera.get_ProjectionMatrix());
+
+    DirectX::BoundingFrustum::CreateFromMatrix(m_view_frustum, m_camera.get_ProjectionMatrix());
+    m_projection_scale = DirectX::XMVectorGetY(m_camera.get_ProjectionMatrix().r[1]) * 0.5f * m_screen_height;
 }
 
 void SceneVisitor::Visit(SceneNode& scene_node) {
@@ -25,9 +37,60 @@ void SceneVisitor::Visit(SceneNode& scene_node) {
 void SceneVisitor::Visit(Mesh& mesh) {
     auto material = mesh.GetMaterial();
     if (material->IsTransparent() == m_transparent_pass) {
+        size_t lod_index = 0u;
+        bool cull_meshlets = false;
+        if (m_screen_height > 0.0f) {
+            const DirectX::BoundingBox& aabb = mesh.GetAABB();
+
+            DirectX::BoundingSphere local_sphere;
+            DirectX::BoundingSphere::CreateFromBoundingBox(local_sphere, aabb);
+
+            DirectX::BoundingSphere view_sphere;
+            DirectX::XMMATRIX world_view = m_lighting_pso.GetWorldMatrix() * m_camera.get_ViewMatrix();
+            local_sphere.Transform(view_sphere, world_view);
+
+            if (!m_view_frustum.Intersects(view_sphere)) {
+                return;
+            }
+
+            // Meshes that reach the camera are always drawn at full detail.
+            if (view_sphere.Center.z > view_sphere.Radius) {
+                float pixels_per_unit = m_projection_scale / view_sphere.Center.z;
+
+                if (2.0f * view_sphere.Radius * pixels_per_unit < m_min_pixel_size) {
+                    return;
+                }
+
+                // LOD errors are relative to the largest side of the local bounding box.
+                float world_scale = local_sphere.Radius > 0.0f ? view_sphere.Radius / local_sphere.Radius : 1.0f;
+                float mesh_extent = 2.0f * std::max({ aabb.Extents.x, aabb.Extents.y, aabb.Extents.z }) * world_scale;
+
+                const auto& lods = mesh.GetLODs();
+                for (size_t i = lods.size(); i-- > 1u;) {
+                    if (lods[i].Error * mesh_extent * pixels_per_unit <= m_max_pixel_error) {
+                        lod_index = i;
+                        break;
+                    }
+                }
+            }
+
+            // Simplified levels are small on screen already, clusters only pay off at full detail.
+            if (lod_index == 0u && !mesh.GetMeshlets().empty()) {
+                mesh.CullMeshlets(world_view, m_view_frustum, m_projection_scale, m_min_pixel_size, m_visible_ranges);
+                cull_meshlets = true;
+            }
+        }
+
         m_lighting_pso.SetMaterial(material);
+        m_lighting_pso.SetVertexFormat(mesh.GetVertexFormat());
+        m_lighting_pso.SetPositionDequantization(mesh.GetPositionScale(), mesh.GetPositionOffset());
 
         m_lighting_pso.Apply(m_command_list);
-        mesh.Draw(m_command_list);
+        if (cull_meshlets) {
+            mesh.DrawRanges(m_command_list, m_visible_ranges);
+        }
+        else {
+            mesh.DrawLOD(m_command_list, lod_index);
+        }
     }
 }
\ No newline at end of file
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "mesh.h"
 #include "visitor.h"
 
+#include <DirectXCollision.h>
+
+#include <vector>
+
 class Camera;
 class EffectPSO;
 class CommandList;
@@ -10,6 +15,11 @@ class SceneVisitor : public Visitor {
 public:
     SceneVisitor(CommandList& commandList, const Camera& camera, EffectPSO& pso, bool transparent);
 
+    // Enables screen size based LOD selection. A mesh uses its coarsest LOD whose error stays
+    // below max_pixel_error and is skipped when it covers less than min_pixel_size pixels.
+    // A screen height of zero draws every mesh at full detail.
+    void SetLODSelection(float screen_height, float max_pixel_error = 1.0f, float min_pixel_size = 1.0f);
+
     virtual void Visit(Scene& scene) override;
     virtual void Visit(SceneNode& scene_node) override;
     virtual void Visit(Mesh& mesh) override;
@@ -19,4 +29,12 @@ private:
     const Camera& m_camera;
     EffectPSO& m_lighting_pso;
     bool m_transparent_pass;
+
+    float m_screen_height;
+    float m_max_pixel_error;
+    float m_min_pixel_size;
+
+    DirectX::BoundingFrustum m_view_frustum;
+    float m_projection_scale;
+    std::vector<Mesh::IndexRange> m_visible_ranges;
 };
\ No newline at end of file
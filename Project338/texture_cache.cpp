@@ -0,0 +1,176 @@
+#include "texture_cache.h"
+
+#include "texture.h"
+#include "utils.h"
+
+#include <cstdio>
+
+TextureCache::LRUPolicy::LRUPolicy(uint64_t budget) : m_size(0u), m_budget(budget) {}
+
+void TextureCache::LRUPolicy::SetBudget(uint64_t budget) {
+	m_budget = budget;
+}
+
+uint64_t TextureCache::LRUPolicy::GetBudget() const {
+	return m_budget;
+}
+
+uint64_t TextureCache::LRUPolicy::GetSize() const {
+	return m_size;
+}
+
+size_t TextureCache::LRUPolicy::GetCount() const {
+	return m_entries.size();
+}
+
+void TextureCache::LRUPolicy::Add(const Key& key, uint64_t size) {
+	Remove(key);
+
+	m_order.push_back(key);
+	m_entries.emplace(key, Entry{ std::prev(m_order.end()), size });
+	m_size += size;
+}
+
+void TextureCache::LRUPolicy::Touch(const Key& key) {
+	auto iter = m_entries.find(key);
+	if (iter != m_entries.end()) {
+		m_order.splice(m_order.end(), m_order, iter->second.Position);
+	}
+}
+
+void TextureCache::LRUPolicy::Remove(const Key& key) {
+	auto iter = m_entries.find(key);
+	if (iter != m_entries.end()) {
+		m_size -= iter->second.Size;
+		m_order.erase(iter->second.Position);
+		m_entries.erase(iter);
+	}
+}
+
+std::vector<TextureCache::Key> TextureCache::LRUPolicy::SelectEvictions(const std::function<bool(const Key&)>& is_in_use) const {
+	std::vector<Key> evictions;
+
+	uint64_t size = m_size;
+	for (auto iter = m_order.begin(); iter != m_order.end() && size > m_budget; ++iter) {
+		if (!is_in_use(*iter)) {
+			evictions.push_back(*iter);
+			size -= m_entries.at(*iter).Size;
+		}
+	}
+
+	return evictions;
+}
+
+// Video memory the texture occupies, including alignment and mips.
+inline uint64_t GetTextureSize(const Texture& texture) {
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource = texture.GetD3D12Resource();
+	if (!resource) {
+		return 0u;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Device> d3d12_device;
+	ThrowIfFailed(resource->GetDevice(IID_PPV_ARGS(&d3d12_device)));
+
+	D3D12_RESOURCE_DESC resource_desc = resource->GetDesc();
+	return d3d12_device->GetResourceAllocationInfo(0u, 1u, &resource_desc).SizeInBytes;
+}
+
+TextureCache::TextureCache(uint64_t budget) : m_policy(budget), m_statistics() {}
+
+TextureCache& TextureCache::Get() {
+	static TextureCache texture_cache(512u * 1024u * 1024u);
+	return texture_cache;
+}
+
+std::shared_ptr<Texture> TextureCache::GetOrLoad(const Key& key, const Loader& loader) {
+	// A failed load isn't cached, callers waiting for it get nullptr and the next request tries again.
+	uint64_t size = 0u;
+	InFlightLoads<Key, std::shared_ptr<Texture>>::Callbacks callbacks;
+	callbacks.IsValid = [](const std::shared_ptr<Texture>& texture) {
+		return texture != nullptr;
+	};
+	callbacks.OnHit = [this, &key](const Entry&) {
+		m_policy.Touch(key);
+		return true;
+	};
+	callbacks.OnLoaded = [this, &key, &size](const std::shared_ptr<Texture>&) {
+		m_policy.Add(key, size);
+		TrimLocked();
+	};
+
+	return m_loads.GetOrLoad(m_mutex, key, [&loader, &size]() {
+		std::shared_ptr<Texture> texture = loader();
+		if (texture) {
+			size = GetTextureSize(*texture);
+		}
+		return texture;
+	}, callbacks);
+}
+
+bool TextureCache::Contains(const Key& key) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const std::map<Key, Entry>& entries = m_loads.GetEntries();
+	auto iter = entries.find(key);
+	return iter != entries.end() && InFlightLoads<Key, std::shared_ptr<Texture>>::IsReady(iter->second);
+}
+
+void TextureCache::SetBudget(uint64_t budget) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_policy.SetBudget(budget);
+	TrimLocked();
+}
+
+uint64_t TextureCache::GetBudget() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_policy.GetBudget();
+}
+
+void TextureCache::Trim() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	TrimLocked();
+}
+
+void TextureCache::TrimLocked() {
+	// Only keys that finished loading are known to the policy. The future holds one reference,
+	// any other one belongs to a material or a caller. Command lists in flight keep their own
+	// reference to the resource, so releasing the texture here is safe for the GPU.
+	std::vector<Key> evictions = m_policy.SelectEvictions([this](const Key& key) {
+		return m_loads.GetEntries().at(key).get().use_count() > 1;
+	});
+
+	for (const Key& key : evictions) {
+		uint64_t size = m_policy.GetSize();
+		m_policy.Remove(key);
+		m_loads.GetEntries().erase(key);
+
+		++m_statistics.Evictions;
+		m_statistics.BytesEvicted += size - m_policy.GetSize();
+	}
+}
+
+TextureCache::Statistics TextureCache::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const InFlightLoads<Key, std::shared_ptr<Texture>>::Statistics& load_statistics = m_loads.GetStatistics();
+	Statistics statistics = m_statistics;
+	statistics.Hits = load_statistics.Hits;
+	statistics.Misses = load_statistics.Misses;
+	statistics.InFlightHits = load_statistics.InFlightHits;
+	statistics.Failures = load_statistics.Failures;
+	statistics.TextureCount = m_policy.GetCount();
+	statistics.Size = m_policy.GetSize();
+	statistics.Budget = m_policy.GetBudget();
+
+	return statistics;
+}
+
+void TextureCache::LogStatistics() const {
+	Statistics statistics = GetStatistics();
+
+	char message[512];
+	sprintf_s(message, "Texture cache: %zu hits (%zu on loads in flight), %zu misses, %zu failed loads, %zu evictions (%.2f MB), %zu textures using %.2f of %.2f MB\n",
+		statistics.Hits, statistics.InFlightHits, statistics.Misses, statistics.Failures, statistics.Evictions, statistics.BytesEvicted / (1024.0 * 1024.0),
+		statistics.TextureCount, statistics.Size / (1024.0 * 1024.0), statistics.Budget / (1024.0 * 1024.0));
+	OutputDebugStringA(message);
+}
\ No newline at end of file
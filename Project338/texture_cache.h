@@ -0,0 +1,113 @@
+#pragma once
+
+#include "in_flight_loads.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Texture;
+
+// Process wide cache of textures loaded from files. Entries are keyed by the file and the
+// color space it was loaded in. A load runs outside of the lock, concurrent requests for the
+// same key wait for the first one and share its texture while other keys load in parallel.
+// An entry is ready once its upload is recorded, not once it has executed.
+//
+// Textures are shared between everyone who requested them. When the cached textures exceed
+// the memory budget, the least recently used ones that nobody else holds on to are released.
+// They are loaded again on the next request.
+class TextureCache {
+public:
+	// File name and whether the texture was loaded as sRGB.
+	using Key = std::pair<std::wstring, bool>;
+	using Loader = std::function<std::shared_ptr<Texture>()>;
+
+	// Budget and recency bookkeeping of the cache. It only knows keys and sizes, so the
+	// eviction order can be checked without a device using made up texture sizes.
+	class LRUPolicy {
+	public:
+		explicit LRUPolicy(uint64_t budget);
+
+		void SetBudget(uint64_t budget);
+		uint64_t GetBudget() const;
+		uint64_t GetSize() const;
+		size_t GetCount() const;
+
+		// Adds the key as the most recently used one.
+		void Add(const Key& key, uint64_t size);
+		void Touch(const Key& key);
+		void Remove(const Key& key);
+
+		// Keys to release, least recently used first, until the size fits into the budget.
+		// Keys that are still in use are skipped, so the result may not be enough.
+		std::vector<Key> SelectEvictions(const std::function<bool(const Key&)>& is_in_use) const;
+
+	private:
+		struct Entry {
+			std::list<Key>::iterator Position;
+			uint64_t Size;
+		};
+
+		std::list<Key> m_order; // Least recently used first.
+		std::map<Key, Entry> m_entries;
+		uint64_t m_size;
+		uint64_t m_budget;
+	};
+
+	struct Statistics {
+		size_t Hits;
+		size_t Misses;
+		size_t InFlightHits; // Hits that had to wait for a load started by another caller.
+		size_t Failures;
+		size_t Evictions;
+		uint64_t BytesEvicted;
+		size_t TextureCount;
+		uint64_t Size;
+		uint64_t Budget;
+	};
+
+	explicit TextureCache(uint64_t budget);
+
+	TextureCache(const TextureCache& copy) = delete;
+	TextureCache& operator=(const TextureCache& copy) = delete;
+
+	// Shared cache with a 512 MB budget.
+	static TextureCache& Get();
+
+	// Returns the cached texture or calls loader on this thread to create it. When the loader
+	// returns nullptr, every caller waiting for the key gets nullptr, and when it throws, they get
+	// the exception. Either way nothing is cached and the key can be loaded again.
+	std::shared_ptr<Texture> GetOrLoad(const Key& key, const Loader& loader);
+
+	// True once a load for the key has finished successfully and it hasn't been evicted since.
+	bool Contains(const Key& key) const;
+
+	// Lowering the budget releases unused textures right away.
+	void SetBudget(uint64_t budget);
+	uint64_t GetBudget() const;
+
+	// Releases unused textures until the cache fits into its budget.
+	void Trim();
+
+	Statistics GetStatistics() const;
+	void LogStatistics() const;
+
+private:
+	using Entry = InFlightLoads<Key, std::shared_ptr<Texture>>::Entry;
+
+	void TrimLocked();
+
+	InFlightLoads<Key, std::shared_ptr<Texture>> m_loads;
+	LRUPolicy m_policy;
+	Statistics m_statistics;
+	mutable std::mutex m_mutex;
+};
\ No newline at end of file
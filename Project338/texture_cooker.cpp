@@ -0,0 +1,241 @@
+#include "texture_cooker.h"
+
+#include "command_list.h"
+#include "derived_data_cache.h"
+#include "io_service.h"
+#include "mip_generator.h"
+#include "texture_quality.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+
+#include <DirectXTex/DirectXTex.h>
+
+namespace TextureCooker {
+	static std::atomic_bool Cooking_enabled(true);
+	static std::atomic<Quality> Cooking_quality(Quality::Fast);
+
+	static Statistics Cook_statistics = {};
+	static std::mutex Cook_statistics_mutex;
+
+	// Block rows per compression task, small enough to balance mips of different sizes.
+	constexpr size_t Band_block_rows = 16u;
+
+	Usage ResolveUsage(Usage usage, DXGI_FORMAT format) {
+		if (usage == Usage::HeightMap) {
+			return IsNormalMapFormat(format) ? Usage::Normal : Usage::Scalar;
+		}
+
+		return usage;
+	}
+
+	Usage GetUsage(Material::TextureType type) {
+		switch (type) {
+			case Material::TextureType::Normal:
+				return Usage::Normal;
+			case Material::TextureType::SpecularPower:
+			case Material::TextureType::Bump:
+			case Material::TextureType::Opacity:
+				return Usage::Scalar;
+			default:
+				return Usage::Color;
+		}
+	}
+
+	DXGI_FORMAT SelectFormat(Usage usage, bool sRGB, bool has_alpha, bool is_float) {
+		if (is_float) {
+			return usage == Usage::Color && !has_alpha ? DXGI_FORMAT_BC6H_UF16 : DXGI_FORMAT_UNKNOWN;
+		}
+
+		switch (usage) {
+			case Usage::Color:
+				if (has_alpha) {
+					return sRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+				}
+				return sRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+			case Usage::Normal:
+				return DXGI_FORMAT_BC5_UNORM;
+			case Usage::Scalar:
+				return DXGI_FORMAT_BC4_UNORM;
+			default:
+				return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	bool IsNormalMapFormat(DXGI_FORMAT format) {
+		switch (format) {
+			case DXGI_FORMAT_BC5_UNORM:
+				return true;
+			case DXGI_FORMAT_BC4_UNORM:
+				return false;
+			default:
+				return DirectX::BitsPerPixel(format) >= 24u;
+		}
+	}
+
+	void Cook(DirectX::ScratchImage& image, Usage usage, bool sRGB) {
+		const DirectX::TexMetadata& metadata = image.GetMetadata();
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1u || DirectX::IsCompressed(metadata.format)) {
+			return;
+		}
+
+		usage = ResolveUsage(usage, metadata.format);
+
+		// Decoded images usually have their mips already. Formats the mip generator doesn't
+		// handle go through DirectXTex, which filters sRGB formats in linear space as well.
+		if (!MipGenerator::GenerateInPlace(image)) {
+			DirectX::ScratchImage mip_chain;
+			ThrowIfFailed(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), metadata, DirectX::TEX_FILTER_DEFAULT, 0u, mip_chain));
+			image = std::move(mip_chain);
+		}
+
+		const DirectX::TexMetadata& mip_metadata = image.GetMetadata();
+		bool is_float = DirectX::FormatDataType(mip_metadata.format) == DirectX::FORMAT_TYPE_FLOAT;
+		bool is_compressible = (mip_metadata.width % 4u) == 0u && (mip_metadata.height % 4u) == 0u && (is_float || DirectX::BitsPerColor(mip_metadata.format) <= 8u);
+		DXGI_FORMAT format = SelectFormat(usage, sRGB, !image.IsAlphaAllOpaque(), is_float);
+		if (!is_compressible || format == DXGI_FORMAT_UNKNOWN) {
+			return;
+		}
+
+		DirectX::ScratchImage compressed_image;
+		Compress(image, format, Cooking_quality, ThreadPool::Get(), compressed_image);
+		image = std::move(compressed_image);
+	}
+
+	void Compress(const DirectX::ScratchImage& source, DXGI_FORMAT format, Quality quality, ThreadPool& thread_pool, DirectX::ScratchImage& compressed) {
+		DirectX::TexMetadata metadata = source.GetMetadata();
+		metadata.format = format;
+		ThrowIfFailed(compressed.Initialize(metadata));
+
+		struct Band {
+			size_t ImageIndex;
+			size_t FirstBlockRow;
+			size_t BlockRowCount;
+		};
+
+		std::vector<Band> bands;
+		for (size_t i = 0u; i < source.GetImageCount(); ++i) {
+			size_t block_rows = (source.GetImages()[i].height + 3u) / 4u;
+			for (size_t row = 0u; row < block_rows; row += Band_block_rows) {
+				bands.push_back({ i, row, std::min(Band_block_rows, block_rows - row) });
+			}
+		}
+
+		DirectX::TEX_COMPRESS_FLAGS flags = (quality == Quality::Fast) ? DirectX::TEX_COMPRESS_BC7_QUICK : DirectX::TEX_COMPRESS_DEFAULT;
+		thread_pool.ParallelFor(bands.size(), [&](size_t i) {
+			const Band& band = bands[i];
+			const DirectX::Image& source_image = source.GetImages()[band.ImageIndex];
+			const DirectX::Image& compressed_image = compressed.GetImages()[band.ImageIndex];
+
+			// Bands are views into the source image, only the last one of an image can end in a partial block.
+			DirectX::Image band_image = source_image;
+			band_image.pixels = source_image.pixels + band.FirstBlockRow * 4u * source_image.rowPitch;
+			band_image.height = std::min(band.BlockRowCount * 4u, source_image.height - band.FirstBlockRow * 4u);
+			band_image.slicePitch = band_image.rowPitch * band_image.height;
+
+			DirectX::ScratchImage compressed_band;
+			ThrowIfFailed(DirectX::Compress(band_image, format, flags, DirectX::TEX_THRESHOLD_DEFAULT, compressed_band));
+
+			const DirectX::Image& compressed_band_image = *compressed_band.GetImage(0u, 0u, 0u);
+			for (size_t row = 0u; row < band.BlockRowCount; ++row) {
+				std::memcpy(compressed_image.pixels + (band.FirstBlockRow + row) * compressed_image.rowPitch, compressed_band_image.pixels + row * compressed_band_image.rowPitch, compressed_image.rowPitch);
+			}
+		});
+	}
+
+	// Cooked entries always hold the full resolution, the quality tier is applied after loading.
+	static void LoadFullTexture(const std::wstring& file_name, bool sRGB, Usage usage, DirectX::ScratchImage& image) {
+		using Clock = std::chrono::steady_clock;
+
+		if (!Cooking_enabled) {
+			CommandList::DecodeTextureFromFile(file_name, sRGB, image);
+			return;
+		}
+
+		DerivedDataCache& derived_data_cache = DerivedDataCache::Get();
+		DerivedDataCache::Key key("texture");
+		bool has_key = key.AddFile(file_name);
+		key.Add(Version);
+		key.Add(usage);
+		key.Add(sRGB);
+		key.Add(Cooking_quality.load());
+		key.Add(MipGenerator::GetFilter());
+
+		if (has_key) {
+			std::filesystem::path cooked_path = derived_data_cache.Find(key);
+			if (!cooked_path.empty()) {
+				IOService::Buffer buffer = IOService::Get().ReadFile(cooked_path.wstring()).get();
+				if (buffer.Storage && SUCCEEDED(DirectX::LoadFromDDSMemory(buffer.pData, buffer.Size, DirectX::DDS_FLAGS_NONE, nullptr, image))) {
+					return;
+				}
+			}
+		}
+
+		Clock::time_point start_time = Clock::now();
+		CommandList::DecodeTextureFromFile(file_name, sRGB, image);
+		size_t source_size = image.GetPixelsSize();
+
+		Clock::time_point decode_time = Clock::now();
+		Cook(image, usage, sRGB);
+
+		Clock::time_point cook_time = Clock::now();
+		if (has_key && !derived_data_cache.Store(key, [&image](const std::filesystem::path& cooked_path) {
+			return SUCCEEDED(DirectX::SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS_NONE, cooked_path.c_str()));
+		})) {
+			char message[512];
+			sprintf_s(message, "Failed to store cooked texture %s\n", key.ToString().c_str());
+			OutputDebugStringA(message);
+		}
+
+		std::lock_guard<std::mutex> lock(Cook_statistics_mutex);
+		++Cook_statistics.TexturesCooked;
+		Cook_statistics.SourceBytes += source_size;
+		Cook_statistics.CookedBytes += image.GetPixelsSize();
+		Cook_statistics.DecodeTime += std::chrono::duration<double, std::milli>(decode_time - start_time).count();
+		Cook_statistics.CookTime += std::chrono::duration<double, std::milli>(cook_time - decode_time).count();
+	}
+
+	void LoadTexture(const std::wstring& file_name, bool sRGB, Usage usage, DirectX::ScratchImage& image) {
+		LoadFullTexture(file_name, sRGB, usage, image);
+		TextureQuality::Apply(image, ResolveUsage(usage, image.GetMetadata().format));
+	}
+
+	void SetEnabled(bool enabled) {
+		Cooking_enabled = enabled;
+	}
+
+	bool IsEnabled() {
+		return Cooking_enabled;
+	}
+
+	void SetQuality(Quality quality) {
+		Cooking_quality = quality;
+	}
+
+	Quality GetQuality() {
+		return Cooking_quality;
+	}
+
+	Statistics GetStatistics() {
+		std::lock_guard<std::mutex> lock(Cook_statistics_mutex);
+		return Cook_statistics;
+	}
+
+	void LogStatistics() {
+		Statistics statistics = GetStatistics();
+
+		char message[512];
+		sprintf_s(message, "Texture cooker: %zu textures cooked, %.2f MB to %.2f MB, decode %.2f ms, mips and compression %.2f ms\n",
+			statistics.TexturesCooked, statistics.SourceBytes / (1024.0 * 1024.0), statistics.CookedBytes / (1024.0 * 1024.0), statistics.DecodeTime, statistics.CookTime);
+		OutputDebugStringA(message);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "material.h"
+
+#include <dxgiformat.h>
+
+#include <cstdint>
+#include <string>
+
+class ThreadPool;
+
+namespace DirectX {
+	class ScratchImage;
+}
+
+// Offline conversion of source images into GPU ready textures. A cooked texture has its full
+// mip chain and is block compressed by usage: BC1 for opaque and BC7 for translucent color,
+// BC6H for opaque float color, BC5 for normal maps and BC4 for single channel data. Results are
+// kept as DDS files in the derived data cache, so later loads skip decoding and compression.
+namespace TextureCooker {
+	constexpr uint32_t Version = 2u;
+
+	enum class Usage : uint32_t {
+		Color,
+		Normal,
+		Scalar,
+		HeightMap, // Becomes Normal or Scalar depending on the decoded image.
+	};
+
+	// Fast limits BC7 to its single subset mode, High searches all partitionings.
+	enum class Quality : uint32_t {
+		Fast,
+		High,
+	};
+
+	// Textures cooked on a cache miss. The source size is the top mip only, the cooked size includes
+	// the whole chain. Times are in milliseconds and summed over all threads.
+	struct Statistics {
+		size_t TexturesCooked;
+		uint64_t SourceBytes;
+		uint64_t CookedBytes;
+		double DecodeTime;
+		double CookTime;
+	};
+
+	Usage GetUsage(Material::TextureType type);
+
+	// The block compressed format for the usage, or DXGI_FORMAT_UNKNOWN when the image is kept as is.
+	// Float images only compress to BC6H, which keeps their range but has no alpha.
+	DXGI_FORMAT SelectFormat(Usage usage, bool sRGB, bool has_alpha, bool is_float);
+
+	// Height maps with three or more channels are normal maps, the same rule the scene import uses.
+	bool IsNormalMapFormat(DXGI_FORMAT format);
+
+	// Usage of a texture of the format, HeightMap resolved to Normal or Scalar.
+	Usage ResolveUsage(Usage usage, DXGI_FORMAT format);
+
+	// Generates the missing mips and compresses the image in place. Images that can't be block
+	// compressed (not 2D, not a multiple of 4 texels, neither 8 bits per channel nor float) only get mips.
+	void Cook(DirectX::ScratchImage& image, Usage usage, bool sRGB);
+
+	// Compresses every image of source in bands of block rows on the thread pool. Doesn't rely
+	// on the OpenMP path of DirectXTex, so it scales the same on every build.
+	void Compress(const DirectX::ScratchImage& source, DXGI_FORMAT format, Quality quality, ThreadPool& thread_pool, DirectX::ScratchImage& compressed);
+
+	// Loads the cooked texture from the derived data cache, or decodes, cooks and stores it.
+	// With cooking disabled the file is only decoded, like CommandList::DecodeTextureFromFile.
+	// Either way the result is reduced to the current TextureQuality settings.
+	void LoadTexture(const std::wstring& file_name, bool sRGB, Usage usage, DirectX::ScratchImage& image);
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	void SetQuality(Quality quality);
+	Quality GetQuality();
+
+	Statistics GetStatistics();
+	void LogStatistics();
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "texture_quality.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <DirectXTex/DirectXTex.h>
+
+namespace TextureQuality {
+	constexpr size_t Usage_count = static_cast<size_t>(TextureCooker::Usage::HeightMap) + 1u;
+
+	static std::atomic<Tier> Quality_tier(Tier::Full);
+	static std::atomic<uint32_t> Max_sizes[Usage_count];
+
+	static std::atomic<size_t> Textures_reduced(0u);
+	static std::atomic<size_t> Mips_skipped(0u);
+	static std::atomic<uint64_t> Bytes_skipped(0u);
+
+	void SetTier(Tier tier) {
+		Quality_tier = tier;
+	}
+
+	Tier GetTier() {
+		return Quality_tier;
+	}
+
+	void SetMaxSize(TextureCooker::Usage usage, uint32_t max_size) {
+		Max_sizes[static_cast<size_t>(usage)] = max_size;
+	}
+
+	uint32_t GetMaxSize(TextureCooker::Usage usage) {
+		return Max_sizes[static_cast<size_t>(usage)];
+	}
+
+	uint32_t GetSkippedMips(TextureCooker::Usage usage, DXGI_FORMAT format, size_t width, size_t height, size_t mip_levels) {
+		uint32_t skipped = static_cast<uint32_t>(Quality_tier.load());
+
+		uint32_t max_size = GetMaxSize(usage);
+		if (max_size > 0u) {
+			while (std::max(width >> skipped, height >> skipped) > max_size) {
+				++skipped;
+			}
+		}
+
+		uint32_t max_skipped = 0u;
+		while ((std::max(width, height) >> (max_skipped + 1u)) > 0u) {
+			++max_skipped;
+		}
+		if (mip_levels > 1u) {
+			max_skipped = std::min(max_skipped, static_cast<uint32_t>(mip_levels - 1u));
+		}
+		skipped = std::min(skipped, max_skipped);
+
+		// The top level of a block compressed texture has to stay a multiple of the block size.
+		if (DirectX::IsCompressed(format)) {
+			while (skipped > 0u && (((width >> skipped) % 4u) != 0u || ((height >> skipped) % 4u) != 0u)) {
+				--skipped;
+			}
+		}
+
+		return skipped;
+	}
+
+	void Apply(DirectX::ScratchImage& image, TextureCooker::Usage usage) {
+		const DirectX::TexMetadata& metadata = image.GetMetadata();
+		if (metadata.dimension != DirectX::TEX_DIMENSION_TEXTURE2D || metadata.arraySize != 1u) {
+			return;
+		}
+
+		const bool is_compressed = DirectX::IsCompressed(metadata.format);
+		const uint32_t skipped = GetSkippedMips(usage, metadata.format, metadata.width, metadata.height, metadata.mipLevels);
+		if (skipped == 0u || (metadata.mipLevels == 1u && is_compressed)) {
+			return;
+		}
+
+		const size_t width = std::max<size_t>(metadata.width >> skipped, 1u);
+		const size_t height = std::max<size_t>(metadata.height >> skipped, 1u);
+		const size_t size_before = image.GetPixelsSize();
+
+		DirectX::ScratchImage reduced_image;
+		if (metadata.mipLevels > 1u) {
+			DirectX::TexMetadata reduced_metadata = metadata;
+			reduced_metadata.width = width;
+			reduced_metadata.height = height;
+			reduced_metadata.mipLevels = metadata.mipLevels - skipped;
+			ThrowIfFailed(reduced_image.Initialize(reduced_metadata));
+
+			for (size_t level = 0u; level < reduced_metadata.mipLevels; ++level) {
+				const DirectX::Image& source = *image.GetImage(level + skipped, 0u, 0u);
+				const DirectX::Image& destination = *reduced_image.GetImage(level, 0u, 0u);
+				std::memcpy(destination.pixels, source.pixels, std::min(source.slicePitch, destination.slicePitch));
+			}
+		}
+		else {
+			ThrowIfFailed(DirectX::Resize(*image.GetImage(0u, 0u, 0u), width, height, DirectX::TEX_FILTER_DEFAULT, reduced_image));
+		}
+
+		image = std::move(reduced_image);
+		ReportSkippedMips(skipped, size_before - image.GetPixelsSize());
+	}
+
+	void ReportSkippedMips(uint32_t skipped_mips, uint64_t skipped_bytes) {
+		if (skipped_mips == 0u) {
+			return;
+		}
+
+		Textures_reduced++;
+		Mips_skipped += skipped_mips;
+		Bytes_skipped += skipped_bytes;
+	}
+
+	Statistics GetStatistics() {
+		Statistics statistics;
+		statistics.TexturesReduced = Textures_reduced;
+		statistics.MipsSkipped = Mips_skipped;
+		statistics.BytesSkipped = Bytes_skipped;
+		return statistics;
+	}
+
+	void LogStatistics() {
+		Statistics statistics = GetStatistics();
+
+		char message[512];
+		sprintf_s(message, "Texture quality: tier %u, %zu textures reduced by %zu mips, %.2f MB skipped\n",
+			static_cast<uint32_t>(Quality_tier.load()), statistics.TexturesReduced, statistics.MipsSkipped, statistics.BytesSkipped / (1024.0 * 1024.0));
+		OutputDebugStringA(message);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "texture_cooker.h"
+
+#include <dxgiformat.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DirectX {
+	class ScratchImage;
+}
+
+// Resolution limits applied to textures as they are loaded, so the same content fits
+// deployments with less video memory. The tier drops that many top mips from every
+// texture, a per usage size limit drops more until the largest side fits. Cooked and
+// decoded images with mips lose their top levels, images without mips are resized.
+// Changes apply to textures loaded afterwards, cached textures keep their size.
+namespace TextureQuality {
+	enum class Tier : uint32_t {
+		Full,
+		Half,
+		Quarter,
+		Eighth,
+	};
+
+	struct Statistics {
+		size_t TexturesReduced;
+		size_t MipsSkipped;
+		uint64_t BytesSkipped; // CPU side image bytes, close to the video memory saved.
+	};
+
+	void SetTier(Tier tier);
+	Tier GetTier();
+
+	// Largest width or height a texture of the usage keeps, 0 for no limit.
+	void SetMaxSize(TextureCooker::Usage usage, uint32_t max_size);
+	uint32_t GetMaxSize(TextureCooker::Usage usage);
+
+	// Number of top levels to drop from a texture. Keeps at least one level of the chain and,
+	// for block compressed formats, a top level that is a multiple of the block size. A single
+	// level is reduced by resizing, so the count can go down to a 1x1 level then.
+	uint32_t GetSkippedMips(TextureCooker::Usage usage, DXGI_FORMAT format, size_t width, size_t height, size_t mip_levels);
+
+	// Drops the top levels of a 2D image according to the tier and the size limit of the usage.
+	void Apply(DirectX::ScratchImage& image, TextureCooker::Usage usage);
+
+	// Counts levels a loader dropped without going through Apply.
+	void ReportSkippedMips(uint32_t skipped_mips, uint64_t skipped_bytes);
+
+	Statistics GetStatistics();
+	void LogStatistics();
+}
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "texture_streamer.h"
+
+#include "command_list.h"
+#include "device.h"
+#include "texture.h"
+#include "texture_cooker.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <DirectXTex/DirectXTex.h>
+
+// Placeholders leave the shading as close as possible to a material without the texture.
+// Colors that replace the material color (ambient, emissive) are black, colors that scale
+// it are white, normal maps point straight out and height maps are flat.
+enum PlaceholderColor {
+	PC_White,
+	PC_Black,
+	PC_FlatNormal,
+	PC_Count,
+};
+
+inline PlaceholderColor GetPlaceholderColor(Material::TextureType type) {
+	switch (type) {
+		case Material::TextureType::Ambient:
+		case Material::TextureType::Emissive:
+		case Material::TextureType::Bump:
+			return PC_Black;
+		case Material::TextureType::Normal:
+			return PC_FlatNormal;
+		default:
+			return PC_White;
+	}
+}
+
+TextureStreamer::TextureStreamer(Device& device, ThreadPool& thread_pool) : m_device(device), m_thread_pool(thread_pool), m_decodes_pending(0u), m_stop(false), m_upload_budget(64u * 1024u * 1024u), m_bytes_in_flight(0u), m_bytes_uploaded(0u), m_textures_streamed(0u), m_textures_failed(0u), m_total_time_to_final(0.0), m_max_time_to_final(0.0) {
+	const uint32_t placeholder_texels[PC_Count] = { 0xFFFFFFFFu, 0xFF000000u, 0xFFFF8080u };
+
+	CommandQueue& command_queue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+	std::shared_ptr<CommandList> command_list = command_queue.GetCommandList();
+
+	for (int color = 0; color < PC_Count; ++color) {
+		for (int sRGB = 0; sRGB < 2; ++sRGB) {
+			D3D12_RESOURCE_DESC texture_desc = CD3DX12_RESOURCE_DESC::Tex2D(sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM, 1u, 1u, 1u, 1u);
+			std::shared_ptr<Texture> texture = m_device.CreateTexture(texture_desc);
+			texture->SetName(L"Texture Streamer Placeholder");
+
+			D3D12_SUBRESOURCE_DATA subresource = {};
+			subresource.pData = &placeholder_texels[color];
+			subresource.RowPitch = sizeof(uint32_t);
+			subresource.SlicePitch = sizeof(uint32_t);
+			command_list->CopyTextureSubresource(texture, 0u, 1u, &subresource);
+
+			m_placeholders[color][sRGB] = texture->GetD3D12Resource();
+		}
+	}
+
+	command_queue.WaitForFenceValue(command_queue.ExecuteCommandList(command_list));
+}
+
+TextureStreamer::~TextureStreamer() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_stop = true;
+	m_decode_condition.wait(lock, [this]() { return m_decodes_pending == 0u; });
+
+	if (!m_uploads.empty()) {
+		m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY).WaitForFenceValue(m_uploads.back().CopyFenceValue);
+		m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE).WaitForFenceValue(m_uploads.back().ComputeFenceValue);
+	}
+}
+
+std::shared_ptr<Texture> TextureStreamer::CreatePlaceholder(Material::TextureType type, const std::wstring& file_name, bool sRGB) const {
+	std::shared_ptr<Texture> texture = m_device.CreateTexture(m_placeholders[GetPlaceholderColor(type)][sRGB ? 1 : 0]);
+	texture->SetName(file_name);
+	return texture;
+}
+
+void TextureStreamer::StreamTexture(const std::shared_ptr<Material>& material, Material::TextureType type, const std::wstring& file_name, bool sRGB) {
+	auto request = std::make_shared<Request>();
+	request->pMaterial = material;
+	request->Type = type;
+	request->FileName = file_name;
+	request->SRGB = sRGB;
+	request->RequestTime = Clock::now();
+	request->Bytes = 0u;
+	request->Failed = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_decodes_pending;
+	}
+
+	m_thread_pool.Submit([this, request]() { Decode(request); });
+}
+
+void TextureStreamer::Decode(const std::shared_ptr<Request>& request) {
+	bool stop;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		stop = m_stop;
+	}
+
+	// Cached textures are created from the cache when the upload is recorded.
+	if (!stop && !CommandList::IsTextureCached(request->FileName, request->SRGB)) {
+		try {
+			request->pImage = std::make_shared<DirectX::ScratchImage>();
+			TextureCooker::LoadTexture(request->FileName, request->SRGB, TextureCooker::GetUsage(request->Type), *request->pImage);
+			request->Bytes = request->pImage->GetPixelsSize();
+		}
+		catch (const std::exception& e) {
+			char message[512];
+			sprintf_s(message, "Failed to stream texture \"%s\": %s\n", ConvertString(request->FileName).c_str(), e.what());
+			OutputDebugStringA(message);
+
+			request->pImage.reset();
+			request->Failed = true;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!stop) {
+		m_decoded.push_back(request);
+		m_bytes_in_flight += request->Bytes;
+	}
+	--m_decodes_pending;
+	m_decode_condition.notify_all();
+}
+
+void TextureStreamer::Update() {
+	std::vector<std::shared_ptr<Request>> finished;
+	std::vector<std::shared_ptr<Request>> decoded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		CommandQueue& copy_queue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+		CommandQueue& compute_queue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+		while (!m_uploads.empty() && copy_queue.IsFenceComplete(m_uploads.front().CopyFenceValue) && compute_queue.IsFenceComplete(m_uploads.front().ComputeFenceValue)) {
+			finished.insert(finished.end(), m_uploads.front().Requests.begin(), m_uploads.front().Requests.end());
+			m_uploads.pop_front();
+		}
+
+		// At least one texture goes out per update, however large it is.
+		uint64_t upload_bytes = 0u;
+		while (!m_decoded.empty() && (decoded.empty() || upload_bytes + m_decoded.front()->Bytes <= m_upload_budget)) {
+			upload_bytes += m_decoded.front()->Bytes;
+			decoded.push_back(m_decoded.front());
+			m_decoded.pop_front();
+		}
+	}
+
+	if (!decoded.empty()) {
+		CommandQueue& copy_queue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+		std::shared_ptr<CommandList> command_list = copy_queue.GetCommandList();
+
+		Upload upload;
+		for (const std::shared_ptr<Request>& request : decoded) {
+			if (!request->Failed) {
+				try {
+					request->pTexture = request->pImage ? command_list->LoadTextureFromImage(request->FileName, request->SRGB, *request->pImage) : command_list->LoadTextureFromFile(request->FileName, request->SRGB, TextureCooker::GetUsage(request->Type));
+				}
+				catch (const std::exception& e) {
+					char message[512];
+					sprintf_s(message, "Failed to upload streamed texture \"%s\": %s\n", ConvertString(request->FileName).c_str(), e.what());
+					OutputDebugStringA(message);
+
+					request->Failed = true;
+				}
+			}
+
+			// The command list keeps its own copy of the pixels in the upload heap.
+			request->pImage.reset();
+			upload.Requests.push_back(request);
+		}
+
+		// Missing mips are generated on the compute queue, which the copy queue submission has queued already.
+		upload.CopyFenceValue = copy_queue.ExecuteCommandList(command_list);
+		upload.ComputeFenceValue = m_device.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE).Signal();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_uploads.push_back(std::move(upload));
+	}
+
+	for (const std::shared_ptr<Request>& request : finished) {
+		Finish(*request);
+	}
+}
+
+void TextureStreamer::Finish(const Request& request) {
+	// Without its texture the material falls back to its plain colors.
+	request.pMaterial->SetTexture(request.Type, request.Failed ? nullptr : request.pTexture);
+
+	double time_to_final = std::chrono::duration<double, std::milli>(Clock::now() - request.RequestTime).count();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_bytes_in_flight -= request.Bytes;
+	if (request.Failed) {
+		++m_textures_failed;
+	}
+	else {
+		m_bytes_uploaded += request.Bytes;
+		++m_textures_streamed;
+		m_total_time_to_final += time_to_final;
+		m_max_time_to_final = std::max(m_max_time_to_final, time_to_final);
+	}
+}
+
+void TextureStreamer::SetUploadBudget(uint64_t upload_budget) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_upload_budget = upload_budget;
+}
+
+uint64_t TextureStreamer::GetUploadBudget() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_upload_budget;
+}
+
+bool TextureStreamer::IsIdle() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_decodes_pending == 0u && m_decoded.empty() && m_uploads.empty();
+}
+
+TextureStreamer::Statistics TextureStreamer::GetStatistics() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics statistics;
+	statistics.QueueDepth = m_decodes_pending + m_decoded.size();
+	statistics.UploadsInFlight = 0u;
+	for (const Upload& upload : m_uploads) {
+		statistics.UploadsInFlight += upload.Requests.size();
+	}
+	statistics.BytesInFlight = m_bytes_in_flight;
+	statistics.BytesUploaded = m_bytes_uploaded;
+	statistics.TexturesStreamed = m_textures_streamed;
+	statistics.TexturesFailed = m_textures_failed;
+	statistics.AverageTimeToFinal = m_textures_streamed > 0u ? m_total_time_to_final / m_textures_streamed : 0.0;
+	statistics.MaxTimeToFinal = m_max_time_to_final;
+
+	return statistics;
+}
+
+void TextureStreamer::LogStatistics() const {
+	Statistics statistics = GetStatistics();
+
+	char message[512];
+	sprintf_s(message, "Texture streamer: %zu streamed, %zu failed, %.2f MB uploaded, time to final texture %.2f ms average, %.2f ms max, %zu queued, %zu uploading, %.2f MB in flight\n",
+		statistics.TexturesStreamed, statistics.TexturesFailed, statistics.BytesUploaded / (1024.0 * 1024.0), statistics.AverageTimeToFinal, statistics.MaxTimeToFinal,
+		statistics.QueueDepth, statistics.UploadsInFlight, statistics.BytesInFlight / (1024.0 * 1024.0));
+	OutputDebugStringA(message);
+}
\ No newline at end of file
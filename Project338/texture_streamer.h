@@ -0,0 +1,116 @@
+#pragma once
+
+#include "command_queue.h"
+#include "material.h"
+
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Device;
+class Texture;
+class ThreadPool;
+
+namespace DirectX {
+	class ScratchImage;
+}
+
+// Streams material textures in the background. A material slot gets a 1x1 placeholder right
+// away, the file is decoded on the thread pool and uploaded on the copy queue, and the real
+// texture replaces the placeholder once its upload fence has passed.
+class TextureStreamer {
+public:
+	// Times are in milliseconds and measured from the request to the swap into the material.
+	struct Statistics {
+		size_t QueueDepth;
+		size_t UploadsInFlight;
+		uint64_t BytesInFlight;
+		uint64_t BytesUploaded;
+		size_t TexturesStreamed;
+		size_t TexturesFailed;
+		double AverageTimeToFinal;
+		double MaxTimeToFinal;
+	};
+
+	TextureStreamer(Device& device, ThreadPool& thread_pool);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer& copy) = delete;
+	TextureStreamer& operator=(const TextureStreamer& copy) = delete;
+
+	// A neutral 1x1 texture for the slot, named after the file so the material still reports
+	// where its texture comes from. Can be called from any thread.
+	std::shared_ptr<Texture> CreatePlaceholder(Material::TextureType type, const std::wstring& file_name, bool sRGB) const;
+
+	// Queues the file for the slot, the material keeps whatever it has until the texture is ready.
+	// Can be called from any thread.
+	void StreamTexture(const std::shared_ptr<Material>& material, Material::TextureType type, const std::wstring& file_name, bool sRGB);
+
+	// Records the uploads of decoded textures and swaps in the ones that finished. Materials are
+	// only changed here, so it has to run on the thread that renders them, once per frame.
+	void Update();
+
+	// Uploads recorded by one Update are limited to roughly this many bytes.
+	void SetUploadBudget(uint64_t upload_budget);
+	uint64_t GetUploadBudget() const;
+
+	bool IsIdle() const;
+
+	Statistics GetStatistics() const;
+	void LogStatistics() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Request {
+		std::shared_ptr<Material> pMaterial;
+		Material::TextureType Type;
+		std::wstring FileName;
+		bool SRGB;
+		Clock::time_point RequestTime;
+		std::shared_ptr<DirectX::ScratchImage> pImage;
+		std::shared_ptr<Texture> pTexture;
+		uint64_t Bytes;
+		bool Failed;
+	};
+
+	struct Upload {
+		CommandQueue::FenceValueType CopyFenceValue;
+		CommandQueue::FenceValueType ComputeFenceValue;
+		std::vector<std::shared_ptr<Request>> Requests;
+	};
+
+	void Decode(const std::shared_ptr<Request>& request);
+	void Finish(const Request& request);
+
+	Device& m_device;
+	ThreadPool& m_thread_pool;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_placeholders[3][2];
+
+	// Requests that are decoded and wait for Update, and the uploads whose fences haven't passed yet.
+	std::deque<std::shared_ptr<Request>> m_decoded;
+	std::deque<Upload> m_uploads;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_decode_condition;
+
+	size_t m_decodes_pending;
+	bool m_stop;
+	uint64_t m_upload_budget;
+
+	uint64_t m_bytes_in_flight;
+	uint64_t m_bytes_uploaded;
+	size_t m_textures_streamed;
+	size_t m_textures_failed;
+	double m_total_time_to_final;
+	double m_max_time_to_final;
+};
\ No newline at end of file
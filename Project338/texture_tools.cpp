@@ -0,0 +1,522 @@
+#include "tools.h"
+
+#include "command_list.h"
+#include "dds_file.h"
+#include "mip_generator.h"
+#include "pixel_convert.h"
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <random>
+
+#include <DirectXTex/DirectXTex.h>
+
+bool Tools::WriteTextureCachePolicyReport(std::ostream& output) {
+	const uint64_t megabyte = 1024u * 1024u;
+	auto key = [](const char* name) {
+		return TextureCache::Key(ConvertString(std::string(name)), false);
+	};
+	auto to_string = [](const std::vector<TextureCache::Key>& keys) {
+		std::string names;
+		for (const TextureCache::Key& key : keys) {
+			names += (names.empty() ? "" : " ") + ConvertString(key.first);
+		}
+		return names.empty() ? std::string("none") : names;
+	};
+
+	TextureCache::LRUPolicy policy(100u * megabyte);
+	bool is_passing = true;
+	auto check = [&](const char* step, const std::function<bool(const TextureCache::Key&)>& is_in_use, const std::vector<TextureCache::Key>& expected) {
+		std::vector<TextureCache::Key> evictions = policy.SelectEvictions(is_in_use);
+		bool is_valid = evictions == expected;
+		is_passing = is_passing && is_valid;
+
+		output << step << ", " << policy.GetBudget() / megabyte << ", " << policy.GetSize() / megabyte << ", " << policy.GetCount() << ", "
+			<< to_string(evictions) << ", " << to_string(expected) << ", " << (is_valid ? "passed" : "failed") << std::endl;
+	};
+	auto is_unused = [](const TextureCache::Key&) {
+		return false;
+	};
+
+	output << "Step, Budget MB, Size MB, Textures, Evicted, Expected, Result" << std::endl;
+
+	policy.Add(key("a"), 40u * megabyte);
+	policy.Add(key("b"), 30u * megabyte);
+	policy.Add(key("c"), 20u * megabyte);
+	check("Within budget", is_unused, {});
+
+	policy.Add(key("d"), 25u * megabyte);
+	policy.Touch(key("a"));
+	check("Over budget after touching a", is_unused, { key("b") });
+
+	check("b in use", [&](const TextureCache::Key& in_use_key) { return in_use_key == key("b"); }, { key("c") });
+	check("Everything in use", [](const TextureCache::Key&) { return true; }, {});
+
+	policy.SetBudget(50u * megabyte);
+	check("Budget lowered", is_unused, { key("b"), key("c"), key("d") });
+
+	// Adding a key again replaces its size and makes it the most recently used one.
+	policy.Add(key("b"), 5u * megabyte);
+	check("b added again", is_unused, { key("c"), key("d") });
+
+	policy.Remove(key("c"));
+	policy.Remove(key("d"));
+	check("c and d removed", is_unused, {});
+
+	policy.SetBudget(0u);
+	check("Zero budget", is_unused, { key("a"), key("b") });
+
+	bool is_size_valid = policy.GetSize() == 45u * megabyte && policy.GetCount() == 2u;
+	output << "Size accounting " << (is_size_valid ? "passed" : "failed") << std::endl;
+
+	return is_passing && is_size_valid;
+}
+
+inline const char* GetFormatName(DXGI_FORMAT format) {
+	switch (format) {
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+			return "BC1";
+		case DXGI_FORMAT_BC4_UNORM:
+			return "BC4";
+		case DXGI_FORMAT_BC5_UNORM:
+			return "BC5";
+		case DXGI_FORMAT_BC6H_UF16:
+			return "BC6H";
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return "BC7";
+		default:
+			return "uncompressed";
+	}
+}
+
+// Decodes the file with its full mip chain like an uncooked load, the chain is built on the CPU here.
+inline void DecodeWithMips(const std::wstring& file_name, DirectX::ScratchImage& image) {
+	CommandList::DecodeTextureFromFile(file_name, false, image);
+	if (!MipGenerator::GenerateInPlace(image)) {
+		DirectX::ScratchImage mip_chain;
+		ThrowIfFailed(DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_DEFAULT, 0u, mip_chain));
+		image = std::move(mip_chain);
+	}
+}
+
+bool Tools::WriteTextureCookReport(const std::vector<std::wstring>& file_names, std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	// Texture decoding needs COM on the calling thread.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	// Cooked loads against decoding the sources, both with the full mip chain as color textures. The first cooked
+	// load creates the entry in the derived data cache, the second one is timed. VRAM is the size of the mip chain,
+	// nothing lowers the TextureQuality tier before a tool runs.
+	bool is_successful = true;
+	double total_times[2] = {};
+	uint64_t total_sizes[2] = {};
+	output << "File, Uncooked format, Uncooked VRAM MB, Uncooked load ms, Cooked format, Cooked VRAM MB, Cooked load ms" << std::endl;
+	for (const std::wstring& file_name : file_names) {
+		DirectX::ScratchImage images[2];
+		double times[2];
+		try {
+			Clock::time_point start_time = Clock::now();
+			DecodeWithMips(file_name, images[0]);
+			times[0] = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+
+			TextureCooker::LoadTexture(file_name, false, TextureCooker::Usage::Color, images[1]);
+			start_time = Clock::now();
+			TextureCooker::LoadTexture(file_name, false, TextureCooker::Usage::Color, images[1]);
+			times[1] = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+		}
+		catch (const std::exception& e) {
+			output << "Failed to load " << ConvertString(file_name) << ": " << e.what() << std::endl;
+			is_successful = false;
+			continue;
+		}
+
+		output << ConvertString(file_name);
+		for (size_t i = 0u; i < 2u; ++i) {
+			total_times[i] += times[i];
+			total_sizes[i] += images[i].GetPixelsSize();
+			output << ", " << GetFormatName(images[i].GetMetadata().format) << ", " << std::fixed << std::setprecision(2) << images[i].GetPixelsSize() / (1024.0 * 1024.0) << ", " << times[i] << std::defaultfloat;
+		}
+		output << std::endl;
+	}
+
+	output << "Total, , " << std::fixed << std::setprecision(2) << total_sizes[0] / (1024.0 * 1024.0) << ", " << total_times[0] << ", , " << total_sizes[1] / (1024.0 * 1024.0) << ", " << total_times[1] << std::endl;
+	if (total_sizes[0] > 0u && total_times[1] > 0.0) {
+		output << "Cooked textures use " << std::setprecision(1) << 100.0 * total_sizes[1] / total_sizes[0] << "% of the uncooked VRAM and load "
+			<< std::setprecision(2) << total_times[0] / total_times[1] << "x as fast" << std::endl;
+	}
+	output << std::defaultfloat;
+
+	if (SUCCEEDED(hr)) {
+		CoUninitialize();
+	}
+
+	return is_successful;
+}
+
+bool Tools::WriteTextureCompressionReport(const std::vector<std::wstring>& file_names, std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	// The error is measured over the channels the format stores.
+	struct Target {
+		const char* Name;
+		DXGI_FORMAT Format;
+		TextureCooker::Quality CompressionQuality;
+		size_t ChannelCount;
+	};
+
+	const Target targets[] = {
+		{ "BC1", DXGI_FORMAT_BC1_UNORM, TextureCooker::Quality::Fast, 3u },
+		{ "BC4", DXGI_FORMAT_BC4_UNORM, TextureCooker::Quality::Fast, 1u },
+		{ "BC5", DXGI_FORMAT_BC5_UNORM, TextureCooker::Quality::Fast, 2u },
+		{ "BC6H", DXGI_FORMAT_BC6H_UF16, TextureCooker::Quality::Fast, 3u },
+		{ "BC7 fast", DXGI_FORMAT_BC7_UNORM, TextureCooker::Quality::Fast, 4u },
+		{ "BC7 high", DXGI_FORMAT_BC7_UNORM, TextureCooker::Quality::High, 4u },
+	};
+
+	// Image decoding goes through WIC.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	ThreadPool single_thread(0u);
+	ThreadPool& thread_pool = ThreadPool::Get();
+	bool is_successful = true;
+
+	output << "File, Format, Megapixels, 1 thread ms, 1 thread MP/s, " << thread_pool.GetThreadCount() + 1u << " threads ms, " << thread_pool.GetThreadCount() + 1u << " threads MP/s, Speedup, PSNR dB" << std::endl;
+	for (const std::wstring& file_name : file_names) {
+		DirectX::ScratchImage image;
+		try {
+			DecodeWithMips(file_name, image);
+		}
+		catch (const std::exception& e) {
+			output << "Failed to load " << ConvertString(file_name) << ": " << e.what() << std::endl;
+			is_successful = false;
+			continue;
+		}
+
+		double megapixels = 0.0;
+		for (size_t i = 0u; i < image.GetImageCount(); ++i) {
+			megapixels += image.GetImages()[i].width * image.GetImages()[i].height / 1000000.0;
+		}
+
+		double bc7_times[2] = {};
+		double bc7_psnrs[2] = {};
+		for (const Target& target : targets) {
+			double times[2];
+			ThreadPool* thread_pools[2] = { &single_thread, &thread_pool };
+			DirectX::ScratchImage compressed;
+			for (size_t i = 0u; i < 2u; ++i) {
+				Clock::time_point start_time = Clock::now();
+				TextureCooker::Compress(image, target.Format, target.CompressionQuality, *thread_pools[i], compressed);
+				times[i] = std::chrono::duration<double, std::milli>(Clock::now() - start_time).count();
+			}
+
+			// Peak signal to noise ratio of the top mip against a peak of one, DirectXTex decompresses the blocks for
+			// the comparison. Float images with values above one score lower than they look.
+			float mse = 0.0f;
+			float channel_mse[4] = {};
+			ThrowIfFailed(DirectX::ComputeMSE(*image.GetImage(0u, 0u, 0u), *compressed.GetImage(0u, 0u, 0u), mse, channel_mse));
+			double target_mse = 0.0;
+			for (size_t i = 0u; i < target.ChannelCount; ++i) {
+				target_mse += channel_mse[i] / target.ChannelCount;
+			}
+			double psnr = 10.0 * std::log10(1.0 / std::max(target_mse, 1e-10));
+
+			if (target.Format == DXGI_FORMAT_BC7_UNORM) {
+				size_t index = target.CompressionQuality == TextureCooker::Quality::Fast ? 0u : 1u;
+				bc7_times[index] = times[1];
+				bc7_psnrs[index] = psnr;
+			}
+
+			output << ConvertString(file_name) << ", " << target.Name << ", " << std::fixed << std::setprecision(2) << megapixels << ", "
+				<< times[0] << ", " << megapixels * 1000.0 / times[0] << ", " << times[1] << ", " << megapixels * 1000.0 / times[1] << ", " << times[0] / times[1] << ", "
+				<< psnr << std::defaultfloat << std::endl;
+		}
+
+		output << ConvertString(file_name) << ": BC7 fast is " << std::fixed << std::setprecision(2) << bc7_times[1] / bc7_times[0] << "x as fast as high at "
+			<< bc7_psnrs[0] - bc7_psnrs[1] << " dB" << std::defaultfloat << std::endl;
+	}
+
+	if (SUCCEEDED(hr)) {
+		CoUninitialize();
+	}
+
+	return is_successful;
+}
+
+bool Tools::WriteDDSLoadReport(const std::vector<std::wstring>& file_names, std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+	constexpr int Runs = 5;
+
+	struct Layout {
+		size_t Offset;
+		size_t RowPitch;
+	};
+
+	bool is_successful = true;
+	output << "File, Format, Size (MB), DirectXTex (ms), DirectXTex (MB/s), Mapped (ms), Mapped (MB/s), Speedup" << std::endl;
+
+	for (const std::wstring& file_name : file_names) {
+		DDSFile probe;
+		if (!probe.Open(file_name)) {
+			output << ConvertString(file_name) << ": not a DDS file the mapped path supports" << std::endl;
+			is_successful = false;
+			continue;
+		}
+
+		// Upload memory layout, every row and subresource aligned like a placed footprint.
+		std::vector<Layout> layouts;
+		size_t staging_size = 0u;
+		size_t texture_size = 0u;
+		for (size_t item = 0u; item < probe.GetArraySize(); ++item) {
+			for (size_t mip = 0u; mip < probe.GetMipLevels(); ++mip) {
+				const DDSFile::Subresource& subresource = probe.GetSubresource(item, mip);
+				size_t row_pitch = (subresource.RowPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1u) / D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+				staging_size = (staging_size + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1u) / D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+				layouts.push_back({ staging_size, row_pitch });
+				staging_size += row_pitch * subresource.RowCount;
+				texture_size += subresource.RowPitch * subresource.RowCount;
+			}
+		}
+
+		std::vector<uint8_t> staging(staging_size);
+		auto copy_rows = [&staging](const Layout& layout, const uint8_t* source, size_t source_pitch, size_t row_size, size_t row_count) {
+			for (size_t row = 0u; row < row_count; ++row) {
+				std::memcpy(staging.data() + layout.Offset + row * layout.RowPitch, source + row * source_pitch, row_size);
+			}
+		};
+
+		double directxtex_time = std::numeric_limits<double>::max();
+		double mapped_time = std::numeric_limits<double>::max();
+		for (int run = 0; run < Runs; ++run) {
+			Clock::time_point start_time = Clock::now();
+			DirectX::ScratchImage image;
+			if (FAILED(DirectX::LoadFromDDSFile(file_name.c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image))) {
+				break;
+			}
+			for (size_t item = 0u; item < probe.GetArraySize(); ++item) {
+				for (size_t mip = 0u; mip < probe.GetMipLevels(); ++mip) {
+					const DirectX::Image& source = *image.GetImage(mip, item, 0u);
+					const DDSFile::Subresource& subresource = probe.GetSubresource(item, mip);
+					copy_rows(layouts[item * probe.GetMipLevels() + mip], source.pixels, source.rowPitch, subresource.RowPitch, subresource.RowCount);
+				}
+			}
+			directxtex_time = std::min(directxtex_time, std::chrono::duration<double, std::milli>(Clock::now() - start_time).count());
+
+			start_time = Clock::now();
+			DDSFile dds_file;
+			if (!dds_file.Open(file_name)) {
+				break;
+			}
+			for (size_t item = 0u; item < dds_file.GetArraySize(); ++item) {
+				for (size_t mip = 0u; mip < dds_file.GetMipLevels(); ++mip) {
+					const DDSFile::Subresource& subresource = dds_file.GetSubresource(item, mip);
+					copy_rows(layouts[item * dds_file.GetMipLevels() + mip], subresource.Data, subresource.RowPitch, subresource.RowPitch, subresource.RowCount);
+				}
+			}
+			mapped_time = std::min(mapped_time, std::chrono::duration<double, std::milli>(Clock::now() - start_time).count());
+		}
+
+		if (directxtex_time == std::numeric_limits<double>::max() || mapped_time == std::numeric_limits<double>::max()) {
+			output << ConvertString(file_name) << ": failed to load" << std::endl;
+			is_successful = false;
+			continue;
+		}
+
+		double megabytes = texture_size / (1024.0 * 1024.0);
+		output << ConvertString(file_name) << ", " << probe.GetFormat() << ", " << std::fixed << std::setprecision(2) << megabytes << ", "
+			<< directxtex_time << ", " << megabytes * 1000.0 / directxtex_time << ", " << mapped_time << ", " << megabytes * 1000.0 / mapped_time << ", " << directxtex_time / mapped_time << std::defaultfloat << std::endl;
+	}
+
+	return is_successful;
+}
+
+// Odd sizes make every kernel run its scalar tail as well.
+constexpr size_t Pixel_verify_count = 4099u;
+constexpr size_t Pixel_benchmark_count = 1024u * 1024u;
+
+struct PixelTestData {
+	std::vector<uint8_t> Bytes;
+	std::vector<float> Floats;
+
+	PixelTestData() : Bytes(Pixel_verify_count * 4u), Floats(Pixel_verify_count * 4u) {
+		std::mt19937 random(1234u);
+		for (size_t i = 0u; i < Bytes.size(); ++i) {
+			Bytes[i] = i < 1024u ? static_cast<uint8_t>(i / 4u) : static_cast<uint8_t>(random());
+		}
+
+		// Values on and next to every sRGB threshold, out of range values and non-finite values come first.
+		size_t count = 0u;
+		const float specials[] = { 0.0f, -0.0f, 1.0f, -1.0f, 2.0f, 0.5f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min(), 1.0f / 510.0f, 254.5f / 255.0f };
+		for (float value : specials) {
+			Floats[count++] = value;
+		}
+		for (int i = 0; i < 255; ++i) {
+			Floats[count++] = PixelConvert::GetSRGBThreshold(i);
+			Floats[count++] = std::nextafter(PixelConvert::GetSRGBThreshold(i), 0.0f);
+			Floats[count++] = std::nextafter(PixelConvert::GetSRGBThreshold(i), 1.0f);
+			Floats[count++] = (i + 0.5f) / 255.0f;
+		}
+
+		std::uniform_real_distribution<float> distribution(-0.25f, 1.25f);
+		for (; count < Floats.size(); ++count) {
+			Floats[count] = distribution(random);
+		}
+	}
+};
+
+template<typename T>
+inline size_t CountMismatches(const std::vector<T>& expected, const std::vector<T>& actual) {
+	size_t mismatches = 0u;
+	for (size_t i = 0u; i < expected.size(); ++i) {
+		if (std::memcmp(&expected[i], &actual[i], sizeof(T)) != 0) {
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+inline bool VerifyPixelConversions(std::ostream& output) {
+	const PixelConvert::InstructionSet active_instruction_set = PixelConvert::GetInstructionSet();
+	const PixelConvert::InstructionSet supported_instruction_set = PixelConvert::GetSupportedInstructionSet();
+	const PixelTestData data;
+	const size_t n = Pixel_verify_count;
+
+	struct Results {
+		std::vector<float> ToFloat;
+		std::vector<uint8_t> FromFloat;
+		std::vector<float> ToLinear;
+		std::vector<uint8_t> FromLinear;
+		std::vector<uint8_t> Swizzled;
+		std::vector<uint8_t> SwizzledOpaque;
+		std::vector<uint8_t> SwizzledInPlace;
+	};
+
+	auto run = [&data, n](PixelConvert::InstructionSet instruction_set) {
+		PixelConvert::SetInstructionSet(instruction_set);
+
+		Results results;
+		results.ToFloat.resize(n * 4u);
+		results.FromFloat.resize(n * 4u);
+		results.ToLinear.resize(n * 4u);
+		results.FromLinear.resize(n * 4u);
+		results.Swizzled.resize(n * 4u);
+		results.SwizzledOpaque.resize(n * 4u);
+		results.SwizzledInPlace = data.Bytes;
+
+		PixelConvert::RGBA8ToFloat4(data.Bytes.data(), results.ToFloat.data(), n);
+		PixelConvert::Float4ToRGBA8(data.Floats.data(), results.FromFloat.data(), n);
+		PixelConvert::SRGBA8ToLinearFloat4(data.Bytes.data(), results.ToLinear.data(), n);
+		PixelConvert::LinearFloat4ToSRGBA8(data.Floats.data(), results.FromLinear.data(), n);
+		PixelConvert::BGRA8ToRGBA8(data.Bytes.data(), results.Swizzled.data(), n, false);
+		PixelConvert::BGRA8ToRGBA8(data.Bytes.data(), results.SwizzledOpaque.data(), n, true);
+		PixelConvert::BGRA8ToRGBA8(results.SwizzledInPlace.data(), results.SwizzledInPlace.data(), n, false);
+
+		return results;
+	};
+
+	const Results reference = run(PixelConvert::InstructionSet::Scalar);
+
+	bool is_exact = true;
+	for (PixelConvert::InstructionSet instruction_set : { PixelConvert::InstructionSet::SSE4, PixelConvert::InstructionSet::AVX2 }) {
+		if (instruction_set > supported_instruction_set) {
+			output << PixelConvert::GetInstructionSetName(instruction_set) << ": not supported, skipped" << std::endl;
+			continue;
+		}
+
+		const Results results = run(instruction_set);
+		const std::pair<const char*, size_t> mismatches[] = {
+			{ "RGBA8 to float4", CountMismatches(reference.ToFloat, results.ToFloat) },
+			{ "float4 to RGBA8", CountMismatches(reference.FromFloat, results.FromFloat) },
+			{ "sRGBA8 to linear float4", CountMismatches(reference.ToLinear, results.ToLinear) },
+			{ "linear float4 to sRGBA8", CountMismatches(reference.FromLinear, results.FromLinear) },
+			{ "BGRA8 to RGBA8", CountMismatches(reference.Swizzled, results.Swizzled) },
+			{ "BGRX8 to RGBA8", CountMismatches(reference.SwizzledOpaque, results.SwizzledOpaque) },
+			{ "BGRA8 to RGBA8 in place", CountMismatches(reference.SwizzledInPlace, results.SwizzledInPlace) },
+		};
+
+		for (const auto& mismatch : mismatches) {
+			if (mismatch.second > 0u) {
+				output << PixelConvert::GetInstructionSetName(instruction_set) << ": " << mismatch.first << " differs from the scalar path in " << mismatch.second << " values" << std::endl;
+				is_exact = false;
+			}
+		}
+		output << PixelConvert::GetInstructionSetName(instruction_set) << ": " << (is_exact ? "matches" : "does not match") << " the scalar path" << std::endl;
+	}
+
+	PixelConvert::SetInstructionSet(active_instruction_set);
+	return is_exact;
+}
+
+inline void WritePixelConversionThroughput(std::ostream& output) {
+	using Clock = std::chrono::steady_clock;
+
+	const PixelConvert::InstructionSet active_instruction_set = PixelConvert::GetInstructionSet();
+	const size_t n = Pixel_benchmark_count;
+
+	std::vector<uint8_t> bytes(n * 4u);
+	std::vector<float> floats(n * 4u);
+	std::vector<uint8_t> byte_output(n * 4u);
+	std::vector<float> float_output(n * 4u);
+
+	std::mt19937 random(1234u);
+	std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+	for (size_t i = 0u; i < bytes.size(); ++i) {
+		bytes[i] = static_cast<uint8_t>(random());
+		floats[i] = distribution(random);
+	}
+
+	const std::pair<const char*, std::function<void()>> conversions[] = {
+		{ "RGBA8 to float4", [&]() { PixelConvert::RGBA8ToFloat4(bytes.data(), float_output.data(), n); } },
+		{ "float4 to RGBA8", [&]() { PixelConvert::Float4ToRGBA8(floats.data(), byte_output.data(), n); } },
+		{ "sRGBA8 to linear float4", [&]() { PixelConvert::SRGBA8ToLinearFloat4(bytes.data(), float_output.data(), n); } },
+		{ "linear float4 to sRGBA8", [&]() { PixelConvert::LinearFloat4ToSRGBA8(floats.data(), byte_output.data(), n); } },
+		{ "BGRA8 to RGBA8", [&]() { PixelConvert::BGRA8ToRGBA8(bytes.data(), byte_output.data(), n, false); } },
+	};
+
+	output << "Conversion, Instruction set, MP/s, Speedup" << std::endl;
+	for (const auto& conversion : conversions) {
+		double scalar_rate = 0.0;
+		for (PixelConvert::InstructionSet instruction_set : { PixelConvert::InstructionSet::Scalar, PixelConvert::InstructionSet::SSE4, PixelConvert::InstructionSet::AVX2 }) {
+			if (instruction_set > PixelConvert::GetSupportedInstructionSet()) {
+				continue;
+			}
+			PixelConvert::SetInstructionSet(instruction_set);
+
+			// The best of a few runs hides page faults and frequency changes.
+			double best_time = std::numeric_limits<double>::max();
+			for (int run = 0; run < 5; ++run) {
+				Clock::time_point start_time = Clock::now();
+				conversion.second();
+				best_time = std::min(best_time, std::chrono::duration<double>(Clock::now() - start_time).count());
+			}
+
+			double rate = n / 1000000.0 / best_time;
+			if (instruction_set == PixelConvert::InstructionSet::Scalar) {
+				scalar_rate = rate;
+			}
+
+			output << conversion.first << ", " << PixelConvert::GetInstructionSetName(instruction_set) << ", " << std::fixed << std::setprecision(1) << rate << ", " << std::setprecision(2) << rate / scalar_rate << std::defaultfloat << std::endl;
+		}
+	}
+
+	PixelConvert::SetInstructionSet(active_instruction_set);
+}
+
+bool Tools::WritePixelConversionReport(std::ostream& output) {
+	bool is_exact = VerifyPixelConversions(output);
+	WritePixelConversionThroughput(output);
+
+	return is_exact;
+}
\ No newline at end of file
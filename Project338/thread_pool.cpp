@@ -0,0 +1,122 @@
+#include "thread_pool.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t thread_count) : m_stop(false) {
+	m_threads.reserve(thread_count);
+	for (size_t i = 0u; i < thread_count; ++i) {
+		m_threads.emplace_back(&ThreadPool::WorkerThread, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+ThreadPool& ThreadPool::Get() {
+	static ThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 2u) - 1u);
+	return thread_pool;
+}
+
+size_t ThreadPool::GetThreadCount() const {
+	return m_threads.size();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+	if (count == 0u) {
+		return;
+	}
+
+	// Helpers that haven't started by the time the caller runs out of work return right away,
+	// the caller only waits for the ones that are running. That makes nested calls from inside
+	// a task safe, a waiting caller never depends on a task stuck behind it in the queue.
+	struct State {
+		std::atomic<size_t> NextIndex = 0u;
+		std::atomic<bool> Failed = false;
+		std::exception_ptr Exception;
+		size_t ActiveHelpers = 0u;
+		bool IsClosed = false;
+		std::mutex Mutex;
+		std::condition_variable Condition;
+	};
+	auto state = std::make_shared<State>();
+
+	auto run = [state, count, &body]() {
+		for (size_t i = state->NextIndex++; i < count && !state->Failed; i = state->NextIndex++) {
+			try {
+				body(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(state->Mutex);
+				if (!state->Exception) {
+					state->Exception = std::current_exception();
+				}
+				state->Failed = true;
+			}
+		}
+	};
+
+	size_t helper_count = std::min(m_threads.size(), count - 1u);
+	for (size_t i = 0u; i < helper_count; ++i) {
+		Submit([state, run]() {
+			{
+				std::lock_guard<std::mutex> lock(state->Mutex);
+				if (state->IsClosed) {
+					return;
+				}
+				++state->ActiveHelpers;
+			}
+
+			run();
+
+			std::lock_guard<std::mutex> lock(state->Mutex);
+			--state->ActiveHelpers;
+			state->Condition.notify_all();
+		});
+	}
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->Mutex);
+	state->IsClosed = true;
+	state->Condition.wait(lock, [&state]() { return state->ActiveHelpers == 0u; });
+
+	if (state->Exception) {
+		std::rethrow_exception(state->Exception);
+	}
+}
+
+void ThreadPool::WorkerThread() {
+	// Texture decoding goes through WIC, which needs COM on every thread that uses it.
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty()) {
+				break;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+
+	if (SUCCEEDED(hr)) {
+		CoUninitialize();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads for CPU side asset work. Tasks must not touch command
+// lists, GPU work recorded from their results stays on the thread that owns the list.
+class ThreadPool {
+public:
+	// A pool without workers runs every task on the calling thread.
+	explicit ThreadPool(size_t thread_count);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool& copy) = delete;
+	ThreadPool& operator=(const ThreadPool& copy) = delete;
+
+	// Shared pool with one worker less than there are hardware threads, the caller of
+	// ParallelFor makes up for the missing one.
+	static ThreadPool& Get();
+
+	size_t GetThreadCount() const;
+
+	template<typename F>
+	std::future<typename std::invoke_result<F>::type> Submit(F&& task) {
+		using Result = typename std::invoke_result<F>::type;
+
+		auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> result = packaged_task->get_future();
+
+		if (m_threads.empty()) {
+			(*packaged_task)();
+			return result;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.emplace([packaged_task]() { (*packaged_task)(); });
+		}
+		m_condition.notify_one();
+
+		return result;
+	}
+
+	// Calls body for every index in [0, count) on the workers and the calling thread and
+	// returns once all calls are done. The first exception thrown by body is rethrown.
+	// Can be called from inside a task of the same pool.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+	void WorkerThread();
+
+	std::vector<std::thread> m_threads;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stop;
+};
\ No newline at end of file
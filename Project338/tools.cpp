@@ -0,0 +1,88 @@
+#include "tools.h"
+
+#include "utils.h"
+
+#include <cstring>
+#include <functional>
+
+bool Tools::Run(int argc, char* argv[], std::ostream& output, int& exit_code) {
+	struct Tool {
+		const char* Name;
+		const char* Usage;
+		size_t MinArgumentCount; // Arguments after the name.
+		std::function<bool(const std::vector<std::string>&)> Run;
+	};
+
+	auto to_file_names = [](const std::vector<std::string>& arguments) {
+		std::vector<std::wstring> file_names;
+		for (const std::string& argument : arguments) {
+			file_names.push_back(ConvertString(argument));
+		}
+		return file_names;
+	};
+
+	const Tool tools[] = {
+		{ "--lod-report", "<scene file>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteLODReport(ConvertString(arguments[0]), output);
+		} },
+		{ "--mesh-optimization", "<scene file>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteMeshOptimizationReport(ConvertString(arguments[0]), output);
+		} },
+		{ "--meshlet-check", "", 0u, [&](const std::vector<std::string>&) {
+			return WriteMeshletReport(output);
+		} },
+		{ "--import-scaling", "<scene file>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteImportScalingReport(ConvertString(arguments[0]), output);
+		} },
+		{ "--obj-import", "<obj file>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteObjImportReport(ConvertString(arguments[0]), output);
+		} },
+		{ "--scene-build", "", 0u, [&](const std::vector<std::string>&) {
+			return WriteSceneBuildReport(output);
+		} },
+		{ "--texture-cache-policy", "", 0u, [&](const std::vector<std::string>&) {
+			return WriteTextureCachePolicyReport(output);
+		} },
+		{ "--texture-cook", "<image files>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteTextureCookReport(to_file_names(arguments), output);
+		} },
+		{ "--texture-compression", "<image files>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteTextureCompressionReport(to_file_names(arguments), output);
+		} },
+		{ "--dds-load", "<dds files>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteDDSLoadReport(to_file_names(arguments), output);
+		} },
+		{ "--pack", "<archive> <files or directories>", 2u, [&](const std::vector<std::string>& arguments) {
+			std::vector<std::filesystem::path> source_paths(arguments.cbegin() + 1, arguments.cend());
+			return WritePackReport(arguments[0], source_paths, std::filesystem::current_path(), output);
+		} },
+		{ "--archive-load", "<archive>", 1u, [&](const std::vector<std::string>& arguments) {
+			return WriteArchiveLoadReport(arguments[0], std::filesystem::current_path(), output);
+		} },
+		{ "--pixel-conversion", "", 0u, [&](const std::vector<std::string>&) {
+			return WritePixelConversionReport(output);
+		} },
+	};
+
+	if (argc < 2) {
+		return false;
+	}
+
+	for (const Tool& tool : tools) {
+		if (std::strcmp(argv[1], tool.Name) != 0) {
+			continue;
+		}
+
+		std::vector<std::string> arguments(argv + 2, argv + argc);
+		if (arguments.size() < tool.MinArgumentCount) {
+			output << "Usage: " << tool.Name << " " << tool.Usage << std::endl;
+			exit_code = 1;
+			return true;
+		}
+
+		exit_code = tool.Run(arguments) ? 0 : 1;
+		return true;
+	}
+
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Offline checks and benchmarks, run from the command line before the application creates a
+// window or a device. Every tool writes a comma separated report and fails if one of its checks
+// does. The tools live next to each other instead of in the classes they measure, so runtime
+// code doesn't carry them around.
+class Tools {
+public:
+	// Runs the tool named by the first argument and returns true with its exit code. Returns
+	// false if the arguments don't name a tool.
+	static bool Run(int argc, char* argv[], std::ostream& output, int& exit_code);
+
+private:
+	// Imports the meshes of a file without touching the GPU and writes the triangle
+	// reduction and error of every generated level of detail.
+	static bool WriteLODReport(const std::wstring& file_name, std::ostream& output);
+
+	// Imports the meshes of a file without touching the GPU and writes the vertex cache, overdraw and
+	// vertex fetch statistics of every mesh before and after the optimization with its time.
+	static bool WriteMeshOptimizationReport(const std::wstring& file_name, std::ostream& output);
+
+	// Runs the CPU side of importing a file with a growing number of threads and writes
+	// the time of every phase and the speedup over a single thread.
+	static bool WriteImportScalingReport(const std::wstring& file_name, std::ostream& output);
+
+	// Imports an OBJ file with ObjLoader and with assimp, writes the throughput of both and compares
+	// the meshes of every material. Fails if the native import differs from the assimp one or resolves
+	// the negative indices of a small generated file wrongly.
+	static bool WriteObjImportReport(const std::wstring& file_name, std::ostream& output);
+
+	// Builds meshlets of synthetic grids with several limits and checks the vertex and triangle counts
+	// and that every triangle is in exactly one meshlet, then culls a grid facing the camera and one
+	// facing away. Fails if any check does.
+	static bool WriteMeshletReport(std::ostream& output);
+
+	// Builds deep, wide and balanced synthetic hierarchies through SceneNode::SetParent and through
+	// SceneBuilder and writes the time of both. Fails if the world transforms of both differ.
+	static bool WriteSceneBuildReport(std::ostream& output);
+
+	// Adds, touches and removes keys of a TextureCache::LRUPolicy with synthetic sizes and writes the
+	// evictions of every step next to the expected ones. Fails if any of them differ.
+	static bool WriteTextureCachePolicyReport(std::ostream& output);
+
+	// Loads the files as color textures decoded from the source and cooked, and writes the VRAM size
+	// and load time of both for every file with their totals. The cooked load is timed once cached.
+	static bool WriteTextureCookReport(const std::vector<std::wstring>& file_names, std::ostream& output);
+
+	// Compresses the files into every block format, BC6H included, on one thread and on the shared
+	// thread pool and writes the time and megapixels per second of each run with the PSNR of the
+	// result, then how fast and accurate fast BC7 is compared to high quality BC7.
+	static bool WriteTextureCompressionReport(const std::vector<std::wstring>& file_names, std::ostream& output);
+
+	// Loads every file through DirectXTex and through DDSFile, copies the subresources into an upload
+	// style layout and writes the time and MB/s of both paths. The GPU copy is the same for both paths
+	// and not part of the measurement.
+	static bool WriteDDSLoadReport(const std::vector<std::wstring>& file_names, std::ostream& output);
+
+	// Runs every supported PixelConvert instruction set on edge cases and random data and compares the
+	// results bit for bit with the scalar path, then writes the throughput of every conversion per
+	// instruction set in megapixels per second. Fails on any mismatch.
+	static bool WritePixelConversionReport(std::ostream& output);
+
+	// Packs the files and the contents of the directories in source_paths into an AssetArchive,
+	// with paths relative to root_path, and writes what was skipped and the size of the result.
+	static bool WritePackReport(const std::filesystem::path& archive_path, const std::vector<std::filesystem::path>& source_paths, const std::filesystem::path& root_path, std::ostream& output);
+
+	// Reads every entry from the archive and from the loose files below root_path and writes the
+	// first and the best of the following passes. The first pass is only cold if the files haven't
+	// been read since the last reboot, packing reads them all.
+	static bool WriteArchiveLoadReport(const std::filesystem::path& archive_path, const std::filesystem::path& root_path, std::ostream& output);
+};
\ No newline at end of file
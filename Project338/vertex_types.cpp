@@ -1,5 +1,9 @@
 #include "vertex_types.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
 const D3D12_INPUT_ELEMENT_DESC VertexPosition::InputElements[] = {
     { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 };
@@ -20,4 +24,102 @@ const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTangentBitangentTexture::Inpu
 const D3D12_INPUT_LAYOUT_DESC VertexPositionNormalTangentBitangentTexture::InputLayout = {
     VertexPositionNormalTangentBitangentTexture::InputElements,
     VertexPositionNormalTangentBitangentTexture::InputElementCount
-};
\ No newline at end of file
+};
+
+namespace {
+    // Maps a unit vector onto the octahedron and unfolds the lower half, the result is in [-1, 1]^2.
+    DirectX::XMFLOAT2 EncodeOctahedral(const DirectX::XMFLOAT3& v) {
+        float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (length <= 0.0f) {
+            return DirectX::XMFLOAT2(0.0f, 0.0f);
+        }
+
+        float x = v.x / length;
+        float y = v.y / length;
+        if (v.z < 0.0f) {
+            float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = folded_x;
+            y = folded_y;
+        }
+
+        return DirectX::XMFLOAT2(x, y);
+    }
+
+    void PackNormalTangent(const VertexPositionNormalTangentBitangentTexture& vertex, DirectX::PackedVector::XMSHORTN2& normal, DirectX::PackedVector::XMSHORTN2& tangent) {
+        DirectX::XMFLOAT2 normal_oct = EncodeOctahedral(vertex.Normal);
+        DirectX::XMFLOAT2 tangent_oct = EncodeOctahedral(vertex.Tangent);
+
+        DirectX::XMVECTOR n = DirectX::XMLoadFloat3(&vertex.Normal);
+        DirectX::XMVECTOR t = DirectX::XMLoadFloat3(&vertex.Tangent);
+        DirectX::XMVECTOR b = DirectX::XMLoadFloat3(&vertex.Bitangent);
+        float handedness = DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMVector3Cross(n, t), b)) < 0.0f ? -1.0f : 1.0f;
+
+        // Remap x to [0, 1] and keep it away from zero, so the sign survives SNORM16 quantization.
+        float tangent_x = std::max(tangent_oct.x * 0.5f + 0.5f, 1.0f / 32767.0f) * handedness;
+
+        DirectX::PackedVector::XMStoreShortN2(&normal, DirectX::XMVectorSet(normal_oct.x, normal_oct.y, 0.0f, 0.0f));
+        DirectX::PackedVector::XMStoreShortN2(&tangent, DirectX::XMVectorSet(tangent_x, tangent_oct.y, 0.0f, 0.0f));
+    }
+}
+
+const D3D12_INPUT_ELEMENT_DESC VertexPositionPackedNormalTangentTexture::InputElements[] = {
+    { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexPositionPackedNormalTangentTexture::InputLayout = {
+    VertexPositionPackedNormalTangentTexture::InputElements,
+    VertexPositionPackedNormalTangentTexture::InputElementCount
+};
+
+VertexPositionPackedNormalTangentTexture::VertexPositionPackedNormalTangentTexture(const VertexPositionNormalTangentBitangentTexture& vertex) : Position(vertex.Position) {
+    PackNormalTangent(vertex, Normal, Tangent);
+    DirectX::PackedVector::XMStoreHalf2(&TexCoord, DirectX::XMVectorSet(vertex.TexCoord.x, vertex.TexCoord.y, 0.0f, 0.0f));
+}
+
+const D3D12_INPUT_ELEMENT_DESC VertexQuantizedPositionPackedNormalTangentTexture::InputElements[] = {
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+const D3D12_INPUT_LAYOUT_DESC VertexQuantizedPositionPackedNormalTangentTexture::InputLayout = {
+    VertexQuantizedPositionPackedNormalTangentTexture::InputElements,
+    VertexQuantizedPositionPackedNormalTangentTexture::InputElementCount
+};
+
+VertexQuantizedPositionPackedNormalTangentTexture::VertexQuantizedPositionPackedNormalTangentTexture(const VertexPositionNormalTangentBitangentTexture& vertex, DirectX::FXMVECTOR position_offset, DirectX::FXMVECTOR position_scale) {
+    DirectX::XMVECTOR position = DirectX::XMVectorDivide(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&vertex.Position), position_offset), position_scale);
+    DirectX::PackedVector::XMStoreUShortN4(&Position, DirectX::XMVectorSetW(position, 1.0f));
+
+    PackNormalTangent(vertex, Normal, Tangent);
+    DirectX::PackedVector::XMStoreHalf2(&TexCoord, DirectX::XMVectorSet(vertex.TexCoord.x, vertex.TexCoord.y, 0.0f, 0.0f));
+}
+
+const D3D12_INPUT_LAYOUT_DESC& GetInputLayout(VertexFormat vertex_format) {
+    switch (vertex_format) {
+        case VertexFormat::PositionPackedNormalTangentTexture:
+            return VertexPositionPackedNormalTangentTexture::InputLayout;
+        case VertexFormat::QuantizedPositionPackedNormalTangentTexture:
+            return VertexQuantizedPositionPackedNormalTangentTexture::InputLayout;
+        default:
+            assert(vertex_format == VertexFormat::PositionNormalTangentBitangentTexture);
+            return VertexPositionNormalTangentBitangentTexture::InputLayout;
+    }
+}
+
+size_t GetVertexStride(VertexFormat vertex_format) {
+    switch (vertex_format) {
+        case VertexFormat::PositionPackedNormalTangentTexture:
+            return sizeof(VertexPositionPackedNormalTangentTexture);
+        case VertexFormat::QuantizedPositionPackedNormalTangentTexture:
+            return sizeof(VertexQuantizedPositionPackedNormalTangentTexture);
+        default:
+            assert(vertex_format == VertexFormat::PositionNormalTangentBitangentTexture);
+            return sizeof(VertexPositionNormalTangentBitangentTexture);
+    }
+}
\ No newline at end of file
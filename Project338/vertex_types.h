@@ -1,9 +1,12 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 #include <d3d12.h>
 
+#include <cstdint>
+
 struct VertexPosition {
 	VertexPosition() = default;
 
@@ -45,4 +48,54 @@ struct VertexPositionNormalTangentBitangentTexture {
 private:
 	static const int InputElementCount = 5;
 	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
-};
\ No newline at end of file
+};
+
+// Octahedral encoded normal and tangent in two SNORM16 channels each. The sign of the
+// bitangent (relative to cross(normal, tangent)) is folded into the tangent's x channel,
+// the texture coordinate is stored as two halfs. 24 bytes instead of 60.
+struct VertexPositionPackedNormalTangentTexture {
+	VertexPositionPackedNormalTangentTexture() = default;
+
+	explicit VertexPositionPackedNormalTangentTexture(const VertexPositionNormalTangentBitangentTexture& vertex);
+
+	DirectX::XMFLOAT3 Position;
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 Tangent;
+	DirectX::PackedVector::XMHALF2 TexCoord;
+
+	static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+private:
+	static const int InputElementCount = 4;
+	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
+// Same as VertexPositionPackedNormalTangentTexture with the position quantized to UNORM16
+// inside the mesh bounding box. The vertex shader restores it with the per mesh
+// PositionScale and PositionOffset. 20 bytes instead of 60.
+struct VertexQuantizedPositionPackedNormalTangentTexture {
+	VertexQuantizedPositionPackedNormalTangentTexture() = default;
+
+	explicit VertexQuantizedPositionPackedNormalTangentTexture(const VertexPositionNormalTangentBitangentTexture& vertex, DirectX::FXMVECTOR position_offset, DirectX::FXMVECTOR position_scale);
+
+	DirectX::PackedVector::XMUSHORTN4 Position;
+	DirectX::PackedVector::XMSHORTN2 Normal;
+	DirectX::PackedVector::XMSHORTN2 Tangent;
+	DirectX::PackedVector::XMHALF2 TexCoord;
+
+	static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+private:
+	static const int InputElementCount = 4;
+	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
+enum class VertexFormat : uint32_t {
+	PositionNormalTangentBitangentTexture,
+	PositionPackedNormalTangentTexture,
+	QuantizedPositionPackedNormalTangentTexture,
+	NumVertexFormats
+};
+
+const D3D12_INPUT_LAYOUT_DESC& GetInputLayout(VertexFormat vertex_format);
+size_t GetVertexStride(VertexFormat vertex_format);
\ No newline at end of file